@@ -0,0 +1,297 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa mittausten apuvlineet: monotonisen kellon, toistettujen
+mittausten tunnusluvut (mediaani, 10. ja 90. persentiili, keskiarvo ja
+varianssi), yksittisten operaatioiden viiveiden histogrammin sek
+tulosten tulostuksen CSV- tai JSON-muodossa.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstring>
+#include <limits>
+#include "bench.h"
+
+using namespace std;
+
+/* Palauttaa monotonisen kellon ajan sekunteina nanosekunnin
+   tarkkuudella. */
+double monotonicSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+/* Palauttaa monotonisen kellon ajan nanosekunteina. */
+long long monotonicNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+/* Palauttaa lokeron, johon arvo kuuluu. */
+int LatencyHistogram::bucketOf(long long value) {
+  // Arvot 0...2*LATENCY_SUB_BUCKETS-1 ovat omissa lokeroissaan. Suuremmista
+  // arvoista silytetn LATENCY_SUB_BUCKET_BITS+1 merkitsevint bitti.
+  if (value<2*LATENCY_SUB_BUCKETS) return (int)value;
+  int shift=63-__builtin_clzll(value)-LATENCY_SUB_BUCKET_BITS;
+  return shift*LATENCY_SUB_BUCKETS+(int)(value>>shift);
+}
+
+/* Palauttaa lokeron suurimman arvon. */
+long long LatencyHistogram::highestOf(int bucket) {
+  if (bucket<2*LATENCY_SUB_BUCKETS) return bucket;
+  int shift=bucket/LATENCY_SUB_BUCKETS-1;
+  long long lowest=(long long)(bucket-shift*LATENCY_SUB_BUCKETS)<<shift;
+  return lowest+((1LL<<shift)-1);
+}
+
+/* Tyhjent histogrammin. */
+void LatencyHistogram::reset() {
+  memset(counts, 0, sizeof(counts));
+  total=minimum=maximum=0;
+  sum=0;
+}
+
+/* Kirjaa viiveen.
+   nanos = viive nanosekunteina; negatiivinen kirjataan nollana */
+void LatencyHistogram::record(long long nanos) {
+  if (nanos<0) nanos=0;
+  counts[bucketOf(nanos)]++;
+  if (total==0 || nanos<minimum) minimum=nanos;
+  if (nanos>maximum) maximum=nanos;
+  total++;
+  sum+=nanos;
+}
+
+/* Lis toisen histogrammin kirjaukset thn histogrammiin. */
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  if (other.total==0) return;
+  for (int i=0; i<LATENCY_BUCKETS; i++) counts[i]+=other.counts[i];
+  if (total==0 || other.minimum<minimum) minimum=other.minimum;
+  if (other.maximum>maximum) maximum=other.maximum;
+  total+=other.total;
+  sum+=other.sum;
+}
+
+/* Palauttaa kirjausten lukumrn. */
+long long LatencyHistogram::getCount() const {
+  return total;
+}
+
+/* Palauttaa suurimman kirjatun viiveen. */
+long long LatencyHistogram::getMax() const {
+  return maximum;
+}
+
+/* Palauttaa viiveiden keskiarvon. */
+double LatencyHistogram::getMean() const {
+  return total>0 ? sum/total : 0;
+}
+
+/* Palauttaa persentiilin q (0...1) eli pienimmn lokeron ylrajan, jota
+   pienempi tai yht suuria on vhintn osuus q kirjauksista. */
+long long LatencyHistogram::percentile(double q) const {
+  if (total==0) return 0;
+  long long rank=(long long)(q*total+0.5);
+  if (rank<1) rank=1;
+  long long seen=0;
+  for (int i=0; i<LATENCY_BUCKETS; i++) {
+    seen+=counts[i];
+    if (seen>=rank) {
+      // Lokeron ylraja ei voi ylitt suurinta kirjattua arvoa.
+      long long value=highestOf(i);
+      return value<maximum ? value : maximum;
+    }
+  }
+  return maximum;
+}
+
+/* Palauttaa jrjestettyjen mittausten persentiilin q (0...1). */
+static double percentile(const vector<double> &sorted, double q) {
+  double position=q*(sorted.size()-1);
+  unsigned int i=(unsigned int)position;
+  if (i+1>=sorted.size()) return sorted[sorted.size()-1];
+  return sorted[i]+(position-i)*(sorted[i+1]-sorted[i]);
+}
+
+/* Laskee mittausten tunnusluvut. Persentiilit interpoloidaan lineaarisesti
+   jrjestettyjen mittausten vlill.
+   samples = mittaukset */
+BenchmarkSummary summarize(vector<double> samples) {
+  BenchmarkSummary summary;
+  if (samples.empty()) {
+    cerr << "summarize(): No samples." << endl;
+    raise(SIGABRT);
+    return summary;
+  }
+
+  sort(samples.begin(), samples.end());
+  summary.median=percentile(samples, 0.5);
+  summary.p10=percentile(samples, 0.1);
+  summary.p90=percentile(samples, 0.9);
+
+  double sum=0;
+  for (unsigned int i=0; i<samples.size(); i++) sum+=samples[i];
+  summary.mean=sum/samples.size();
+
+  // Otosvarianssi; yhdest mittauksesta varianssi on 0.
+  double squares=0;
+  for (unsigned int i=0; i<samples.size(); i++)
+    squares+=(samples[i]-summary.mean)*(samples[i]-summary.mean);
+  summary.variance=samples.size()>1 ? squares/(samples.size()-1) : 0;
+  return summary;
+}
+
+/* json = true=JSON-muoto, false=CSV-muoto
+   columns = sarakkeiden nimet */
+BenchmarkReport::BenchmarkReport(bool json, const vector<string> &columns) :
+  json(json), columns(columns), rows(0) {
+  if (json) cout << "[" << endl;
+  else {
+    for (unsigned int i=0; i<columns.size(); i++)
+      cout << (i>0 ? "," : "") << columns[i];
+    cout << endl;
+  }
+}
+
+/* Ptt JSON-taulukon. */
+BenchmarkReport::~BenchmarkReport() {
+  if (json) cout << (rows>0 ? "\n" : "") << "]" << endl;
+}
+
+/* Lis sarakkeiden nimet tunnusluvuille.
+   columns = sarakkeiden nimet
+   name = mitattavan operaation nimi */
+void BenchmarkReport::addSummaryColumns(vector<string> &columns,
+                                        const string &name) {
+  columns.push_back(name+"Median");
+  columns.push_back(name+"P10");
+  columns.push_back(name+"P90");
+  columns.push_back(name+"Variance");
+}
+
+/* Lis tunnusluvut riville addSummaryColumns()-metodin jrjestyksess.
+   values = rivin arvot
+   summary = tunnusluvut */
+void BenchmarkReport::addSummary(vector<double> &values,
+                                 const BenchmarkSummary &summary) {
+  values.push_back(summary.median);
+  values.push_back(summary.p10);
+  values.push_back(summary.p90);
+  values.push_back(summary.variance);
+}
+
+/* Lis sarakkeiden nimet muistinkytlle avainta kohden: varatut
+   tavut, hukka ja kekomuistin todellinen kytt.
+   columns = sarakkeiden nimet */
+void BenchmarkReport::addMemoryColumns(vector<string> &columns) {
+  columns.push_back("bytesPerKey");
+  columns.push_back("slackBytesPerKey");
+  columns.push_back("heapBytesPerKey");
+}
+
+/* Lis muistinkytn avainta kohden riville addMemoryColumns()-metodin
+   jrjestyksess.
+   values = rivin arvot
+   usage = rakenteen muistinkytt
+   heapBytes = rakenteen kekomuistin kytt
+   keys = avainten mr */
+void BenchmarkReport::addMemory(vector<double> &values,
+                                const MemoryUsage &usage,
+                                long long heapBytes, double keys) {
+  values.push_back(keys>0 ? usage.getAllocated()/keys : 0);
+  values.push_back(keys>0 ? usage.getSlack()/keys : 0);
+  values.push_back(keys>0 ? heapBytes/keys : 0);
+}
+
+/* Lis sarakkeiden nimet viiveiden persentiileille p50, p90, p99,
+   p99.9 ja maksimille.
+   columns = sarakkeiden nimet
+   name = mitattavan operaation nimi */
+void BenchmarkReport::addLatencyColumns(vector<string> &columns,
+                                        const string &name) {
+  columns.push_back(name+"P50Ns");
+  columns.push_back(name+"P90Ns");
+  columns.push_back(name+"P99Ns");
+  columns.push_back(name+"P999Ns");
+  columns.push_back(name+"MaxNs");
+}
+
+/* Lis viiveiden persentiilit riville addLatencyColumns()-metodin
+   jrjestyksess.
+   values = rivin arvot
+   histogram = operaation viiveet */
+void BenchmarkReport::addLatency(vector<double> &values,
+                                 const LatencyHistogram &histogram) {
+  values.push_back(histogram.percentile(0.5));
+  values.push_back(histogram.percentile(0.9));
+  values.push_back(histogram.percentile(0.99));
+  values.push_back(histogram.percentile(0.999));
+  values.push_back(histogram.getMax());
+}
+
+/* Lis sarakkeiden nimet suorituskykylaskureille.
+   columns = sarakkeiden nimet
+   name = mitattavan operaation nimi */
+void BenchmarkReport::addPerfColumns(vector<string> &columns,
+                                     const string &name) {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    columns.push_back(name+PerfCounters::getName(i));
+}
+
+/* Lis laskurien arvot operaatiota kohden riville
+   addPerfColumns()-metodin jrjestyksess. Puuttuvat laskurit jtetn
+   tyhjiksi.
+   values = rivin arvot
+   counters = vaiheen laskurit
+   operations = vaiheen operaatioiden mr */
+void BenchmarkReport::addPerf(vector<double> &values,
+                              const PerfCounters &counters,
+                              double operations) {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (counters.isAvailable(i) && operations>0)
+      values.push_back(counters.getValue(i)/operations);
+    else values.push_back(numeric_limits<double>::quiet_NaN());
+}
+
+/* Tulostaa rivin. Arvo NaN tulostetaan tyhjn (CSV) tai null-arvona
+   (JSON).
+   values = arvot sarakkeiden jrjestyksess */
+void BenchmarkReport::row(const vector<double> &values) {
+  if (values.size()!=columns.size()) {
+    cerr << "row(): Wrong number of values." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (json) {
+    cout << (rows>0 ? ",\n" : "") << "  {";
+    for (unsigned int i=0; i<columns.size(); i++) {
+      cout << (i>0 ? ", " : "") << "\"" << columns[i] << "\": ";
+      if (values[i]!=values[i]) cout << "null";
+      else cout << values[i];
+    }
+    cout << "}" << flush;
+  }
+  else {
+    for (unsigned int i=0; i<values.size(); i++) {
+      cout << (i>0 ? "," : "");
+      if (values[i]==values[i]) cout << values[i];
+    }
+    cout << endl;
+  }
+  rows++;
+}
@@ -0,0 +1,167 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa mittausten apuvlineet: monotonisen kellon, toistettujen
+mittausten tunnusluvut (mediaani, 10. ja 90. persentiili, keskiarvo ja
+varianssi), yksittisten operaatioiden viiveiden histogrammin sek
+tulosten tulostuksen CSV- tai JSON-muodossa.
+
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+#include <vector>
+#include "perfcounters.h"
+#include "memory.h"
+
+/* Palauttaa monotonisen kellon ajan sekunteina nanosekunnin
+   tarkkuudella. */
+double monotonicSeconds();
+
+/* Palauttaa monotonisen kellon ajan nanosekunteina. */
+long long monotonicNanos();
+
+/* Viiveiden histogrammi, jonka lokeroiden leveys kasvaa arvon mukana
+   (log-lineaarinen, kuten HDR-histogrammissa): jokainen kahden potenssin
+   vli on jaettu LATENCY_SUB_BUCKETS yht leven lokeroon, joten
+   persentiilien suhteellinen virhe on enintn 1/LATENCY_SUB_BUCKETS.
+   Kunkin sikeen kannattaa kirjata omaan histogrammiinsa ja yhdist
+   histogrammit lopuksi merge()-metodilla. */
+#define LATENCY_SUB_BUCKET_BITS 5
+#define LATENCY_SUB_BUCKETS (1<<LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKETS (64*LATENCY_SUB_BUCKETS)
+
+class LatencyHistogram {
+  long long counts[LATENCY_BUCKETS];
+  long long total, minimum, maximum;
+  double sum;
+
+  /* Palauttaa lokeron, johon arvo kuuluu. */
+  static int bucketOf(long long value);
+
+  /* Palauttaa lokeron suurimman arvon. */
+  static long long highestOf(int bucket);
+
+public:
+  LatencyHistogram();
+
+  /* Tyhjent histogrammin. */
+  void reset();
+
+  /* Kirjaa viiveen.
+     nanos = viive nanosekunteina; negatiivinen kirjataan nollana */
+  void record(long long nanos);
+
+  /* Lis toisen histogrammin kirjaukset thn histogrammiin. */
+  void merge(const LatencyHistogram &other);
+
+  /* Palauttaa kirjausten lukumrn. */
+  long long getCount() const;
+
+  /* Palauttaa suurimman kirjatun viiveen. */
+  long long getMax() const;
+
+  /* Palauttaa viiveiden keskiarvon. */
+  double getMean() const;
+
+  /* Palauttaa persentiilin q (0...1) eli pienimmn lokeron ylrajan, jota
+     pienempi tai yht suuria on vhintn osuus q kirjauksista. */
+  long long percentile(double q) const;
+};
+
+/* Toistettujen mittausten tunnusluvut. */
+struct BenchmarkSummary {
+  double median;
+  double p10;
+  double p90;
+  double mean;
+  double variance;
+};
+
+/* Laskee mittausten tunnusluvut. Persentiilit interpoloidaan lineaarisesti
+   jrjestettyjen mittausten vlill.
+   samples = mittaukset */
+BenchmarkSummary summarize(std::vector<double> samples);
+
+/* Mittaustulosten taulukko, joka tulostetaan vakiotulosteeseen joko
+   CSV-muodossa otsakeriveineen tai JSON-taulukkona. */
+class BenchmarkReport {
+  const bool json;
+  std::vector<std::string> columns;
+  int rows;
+
+public:
+  /* json = true=JSON-muoto, false=CSV-muoto
+     columns = sarakkeiden nimet */
+  BenchmarkReport(bool json, const std::vector<std::string> &columns);
+
+  /* Ptt JSON-taulukon. */
+  ~BenchmarkReport();
+
+  /* Lis sarakkeiden nimet tunnusluvuille.
+     columns = sarakkeiden nimet
+     name = mitattavan operaation nimi */
+  static void addSummaryColumns(std::vector<std::string> &columns,
+                                const std::string &name);
+
+  /* Lis tunnusluvut riville addSummaryColumns()-metodin jrjestyksess.
+     values = rivin arvot
+     summary = tunnusluvut */
+  static void addSummary(std::vector<double> &values,
+                         const BenchmarkSummary &summary);
+
+  /* Lis sarakkeiden nimet muistinkytlle avainta kohden: varatut
+     tavut, hukka ja kekomuistin todellinen kytt.
+     columns = sarakkeiden nimet */
+  static void addMemoryColumns(std::vector<std::string> &columns);
+
+  /* Lis muistinkytn avainta kohden riville addMemoryColumns()-metodin
+     jrjestyksess.
+     values = rivin arvot
+     usage = rakenteen muistinkytt
+     heapBytes = rakenteen kekomuistin kytt
+     keys = avainten mr */
+  static void addMemory(std::vector<double> &values,
+                        const MemoryUsage &usage, long long heapBytes,
+                        double keys);
+
+  /* Lis sarakkeiden nimet viiveiden persentiileille p50, p90, p99,
+     p99.9 ja maksimille.
+     columns = sarakkeiden nimet
+     name = mitattavan operaation nimi */
+  static void addLatencyColumns(std::vector<std::string> &columns,
+                                const std::string &name);
+
+  /* Lis viiveiden persentiilit riville addLatencyColumns()-metodin
+     jrjestyksess.
+     values = rivin arvot
+     histogram = operaation viiveet */
+  static void addLatency(std::vector<double> &values,
+                         const LatencyHistogram &histogram);
+
+  /* Lis sarakkeiden nimet suorituskykylaskureille.
+     columns = sarakkeiden nimet
+     name = mitattavan operaation nimi */
+  static void addPerfColumns(std::vector<std::string> &columns,
+                             const std::string &name);
+
+  /* Lis laskurien arvot operaatiota kohden riville
+     addPerfColumns()-metodin jrjestyksess. Puuttuvat laskurit jtetn
+     tyhjiksi.
+     values = rivin arvot
+     counters = vaiheen laskurit
+     operations = vaiheen operaatioiden mr */
+  static void addPerf(std::vector<double> &values,
+                      const PerfCounters &counters, double operations);
+
+  /* Tulostaa rivin. Arvo NaN tulostetaan tyhjn (CSV) tai null-arvona
+     (JSON).
+     values = arvot sarakkeiden jrjestyksess */
+  void row(const std::vector<double> &values);
+};
+
+#endif
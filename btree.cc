@@ -12,9 +12,20 @@ L
 */
 
 #include <iostream>
+#include <fstream>
 #include <csignal>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include <queue>
+#include <sstream>
 #include "btree.h"
+#include "snapshot.h"
+#include "wal.h"
 #include "rng.h"
 
 using namespace std;
@@ -25,16 +36,27 @@ using namespace std;
    debug = 1=lausekattavuustulostus */
 template<typename T> BTreeNode<T>::BTreeNode<T>(int degree, bool leaf,
                                                 int debug=0) :
-  degree(degree), keys(0), leaf(leaf), maxKeys(2*degree-1),
+  degree(degree), keys(0), constructed(0), leaf(leaf), maxKeys(2*degree-1),
   maxChildren(2*degree), debug(debug) {
   if (degree<2) {
     cerr << "BTreeNode(): degree must be >= 2." << endl;
     raise(SIGABRT);
     return;
   }
-  key=new T[maxKeys];
-  child=new BTreeNode<T> *[maxChildren];
-  for (int i=0; i<maxChildren; i++) child[i]=NULL;
+  // Avaimet luodaan paikoilleen vasta setKey()- ja moveKeys()-metodeissa.
+  key=static_cast<T *>(::operator new(maxKeys*sizeof(T)));
+  dead=new bool[maxKeys];
+  for (int i=0; i<maxKeys; i++) dead[i]=false;
+  // Solmun lehtitieto ei muutu sen elinaikana, joten lehdille ei varata
+  // lapsiosoittimia lainkaan.
+  copies=NULL;
+  child=NULL;
+  childCount=NULL;
+  childTotal=NULL;
+  if (!leaf) {
+    child=new BTreeNode<T> *[maxChildren];
+    for (int i=0; i<maxChildren; i++) child[i]=NULL;
+  }
 }
 
 template<typename T> BTreeNode<T>::~BTreeNode<T>() {
@@ -43,8 +65,13 @@ template<typename T> BTreeNode<T>::~BTreeNode<T>() {
   //  raise(SIGABRT);
   //  return;
   //}
+  delete[] childTotal;
+  delete[] childCount;
   delete[] child;
-  delete[] key;
+  delete[] copies;
+  delete[] dead;
+  for (int i=0; i<constructed; i++) key[i].~T();
+  ::operator delete(key);
 }
 
 /* Palauttaa avainten lukumrn. */
@@ -57,13 +84,38 @@ template<typename T> int BTreeNode<T>::numChildren() const {
   return keys==0 ? 0 : keys+1;
 }
 
+/* Palauttaa solmun ja sen taulukoiden varaamat tavut. */
+template<typename T> long long BTreeNode<T>::allocatedBytes() const {
+  return sizeof(BTreeNode<T>)+maxKeys*(sizeof(T)+sizeof(bool))+
+    (copies ? maxKeys*sizeof(int) : 0)+
+    (leaf ? 0 : maxChildren*sizeof(BTreeNode<T> *))+
+    (childCount ? maxChildren*(sizeof(long long)+sizeof(double)) : 0);
+}
+
+/* Esihakee solmun kytss olevat avaimet ja lapsiosoittimet
+   vlimuistiin. */
+template<typename T> void BTreeNode<T>::prefetch() const {
+  const int perLine=sizeof(T)>=64 ? 1 : 64/sizeof(T),
+    childrenPerLine=64/sizeof(BTreeNode<T> *);
+  for (int i=0; i<keys; i+=perLine) __builtin_prefetch(key+i);
+  if (!leaf)
+    for (int i=0; i<=keys; i+=childrenPerLine) __builtin_prefetch(child+i);
+}
+
+/* Palauttaa kytss olevien avainten ja lapsiosoittimien tavut. */
+template<typename T> long long BTreeNode<T>::liveBytes() const {
+  return keys*sizeof(T)+(copies ? keys*sizeof(int) : 0)+
+    (leaf ? 0 : numChildren()*sizeof(BTreeNode<T> *))+
+    (childCount ? numChildren()*(sizeof(long long)+sizeof(double)) : 0);
+}
+
 /* Palautaan arvon true, jos solmu on lehti. */
 template<typename T> bool BTreeNode<T>::isLeaf() const {
   return leaf;
 }
 
 /* Palauttaa avaimen kohdasta index. */
-template<typename T> T BTreeNode<T>::getKey(int index) const {
+template<typename T> const T &BTreeNode<T>::getKey(int index) const {
   if (index<0 || index>=numKeys()) {
     cerr << "getKey(): Invalid key index." << endl;
     raise(SIGABRT);
@@ -89,20 +141,90 @@ template<typename T> BTreeNode<T> *BTreeNode<T>::getChild(int index) const {
   return child[index];
 }
 
+/* Palauttaa avaimettoman sissolmun ainoan lapsen. */
+template<typename T> BTreeNode<T> *BTreeNode<T>::getOnlyChild() const {
+  if (isLeaf() || keys!=0 || !child[0]) {
+    cerr << "getOnlyChild(): Node is not a keyless internal node." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+  return child[0];
+}
+
 /* Asettaa avaimelle uuden arvon. */
-template<typename T> void BTreeNode<T>::setKey(T newKey, int index) {
-  if (index<0 || index>=maxKeys) {
+template<typename T> void BTreeNode<T>::setKey(const T &newKey, int index) {
+  if (index<0 || index>=maxKeys || index>constructed) {
+    cerr << "setKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (index<constructed) key[index]=newKey;
+  else {
+    new (key+index) T(newKey);
+    constructed++;
+  }
+}
+
+/* Siirt uuden avaimen paikalleen. */
+template<typename T> void BTreeNode<T>::setKey(T &&newKey, int index) {
+  if (index<0 || index>=maxKeys || index>constructed) {
     cerr << "setKey(): Invalid key index." << endl;
     raise(SIGABRT);
     return;
   }
-  key[index]=newKey;
+  if (index<constructed) key[index]=std::move(newKey);
+  else {
+    new (key+index) T(std::move(newKey));
+    constructed++;
+  }
+}
+
+/* Palauttaa arvon true, jos avain kohdassa index on haudattu. */
+template<typename T> bool BTreeNode<T>::isDead(int index) const {
+  return dead[index];
+}
+
+/* Merkitsee avaimen haudatuksi tai elvksi. */
+template<typename T> void BTreeNode<T>::setDead(int index, bool isDead) {
+  if (index<0 || index>=maxKeys) {
+    cerr << "setDead(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  dead[index]=isDead;
+}
+
+/* Varaa solmulle avainten lukumrt. */
+template<typename T> void BTreeNode<T>::enableCopies() {
+  if (copies) return;
+  copies=new int[maxKeys];
+  for (int i=0; i<maxKeys; i++) copies[i]=1;
+}
+
+/* Palauttaa avaimen kohdasta index kappalemrn. */
+template<typename T> int BTreeNode<T>::getCopies(int index) const {
+  if (index<0 || index>=maxKeys) {
+    cerr << "getCopies(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  return copies ? copies[index] : 1;
+}
+
+/* Asettaa avaimen kappalemrn. */
+template<typename T> void BTreeNode<T>::setCopies(int index, int newCopies) {
+  if (index<0 || index>=maxKeys || newCopies<1) {
+    cerr << "setCopies(): Invalid key index or copies." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (copies) copies[index]=newCopies;
 }
 
 /* Asettaa uuden lapsiosoittimen. */
 template<typename T> void BTreeNode<T>::setChild(BTreeNode<T> *newChild,
                                                  int index) {
-  if (index<0 || index>=maxChildren) {
+  if (index<0 || index>=maxChildren || isLeaf()) {
     cerr << "setChild(): Invalid child index." << endl;
     raise(SIGABRT);
     return;
@@ -110,6 +232,55 @@ template<typename T> void BTreeNode<T>::setChild(BTreeNode<T> *newChild,
   child[index]=newChild;
 }
 
+/* Varaa sissolmulle lasten koosteet. */
+template<typename T> void BTreeNode<T>::enableAggregates() {
+  if (leaf || childCount) return;
+  childCount=new long long[maxChildren];
+  childTotal=new double[maxChildren];
+  for (int i=0; i<maxChildren; i++) {
+    childCount[i]=0;
+    childTotal[i]=0;
+  }
+}
+
+/* Palauttaa true, jos solmulla on lasten koosteet. */
+template<typename T> bool BTreeNode<T>::hasAggregates() const {
+  return childCount!=NULL;
+}
+
+/* Palauttaa lapsen kohdasta index alipuun elvien avainten mrn. */
+template<typename T> long long BTreeNode<T>::getCount(int index) const {
+  if (index<0 || index>=maxChildren || !childCount) {
+    cerr << "getCount(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  return childCount[index];
+}
+
+/* Palauttaa lapsen kohdasta index alipuun elvien avainten koosteen. */
+template<typename T> double BTreeNode<T>::getTotal(int index) const {
+  if (index<0 || index>=maxChildren || !childTotal) {
+    cerr << "getTotal(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  return childTotal[index];
+}
+
+/* Asettaa lapsen alipuun avainten mrn ja koosteen. */
+template<typename T> void BTreeNode<T>::setAggregate(int index,
+                                                     long long newCount,
+                                                     double newTotal) {
+  if (index<0 || index>=maxChildren || !childCount) {
+    cerr << "setAggregate(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  childCount[index]=newCount;
+  childTotal[index]=newTotal;
+}
+
 /* Asettaa avainten lukumrn. */
 template<typename T> void BTreeNode<T>::setNumKeys(int newNumKeys) {
   if (newNumKeys<0 || newNumKeys>maxKeys) {
@@ -117,16 +288,20 @@ template<typename T> void BTreeNode<T>::setNumKeys(int newNumKeys) {
     raise(SIGABRT);
     return;
   }
+  // Siirretyt ja poistetut avaimet tuhotaan heti, jotta ne eivt varaa
+  // muistia.
+  for (int i=newNumKeys; i<constructed; i++) key[i].~T();
+  if (newNumKeys<constructed) constructed=newNumKeys;
   keys=newNumKeys;
 }
 
 /* Palauttaa solmun ensimmisen (pienimmn) avaimen. */
-template<typename T> T BTreeNode<T>::getFirstKey() const {
+template<typename T> const T &BTreeNode<T>::getFirstKey() const {
   return getKey(0);
 }
 
 /* Palauttaa solmun viimeisen (suurimman) avaimen. */
-template<typename T> T BTreeNode<T>::getLastKey() const {
+template<typename T> const T &BTreeNode<T>::getLastKey() const {
   return getKey(numKeys()-1);
 }
 
@@ -140,19 +315,85 @@ template<typename T> BTreeNode<T> *BTreeNode<T>::getLastChild() const {
   return getChild(numChildren()-1);
 }
 
+/* Siirt avaimet hautausmerkintineen ja kappalemrineen solmusta
+   toiseen tai saman solmun sisll.
+   fromIndex = ensimminen siirrettv avain
+   count = siirrettvien avainten mr
+   toNode = kohdesolmu
+   toIndex = kohdesolmun indeksi, johon siirretn */
+template<typename T> void BTreeNode<T>::moveKeys(int fromIndex, int count,
+                                                 BTreeNode<T> *toNode,
+                                                 int toIndex) {
+  if (count<=0) return;
+  if (fromIndex<0 || fromIndex+count>constructed || toIndex<0 ||
+      toIndex>toNode->constructed || toIndex+count>toNode->maxKeys) {
+    cerr << "moveKeys(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // limit = kohdesolmun ensimminen paikka, jossa ei ole avainta; siit
+  // alkaen avaimet luodaan siirtokonstruktorilla.
+  int limit=toNode->constructed;
+  T *from=key+fromIndex, *to=toNode->key+toIndex;
+  if (std::is_trivially_copyable<T>::value) {
+    if (debug==1) cout << "moveKeys(): 1" << endl;
+    memmove(static_cast<void *>(to), from, count*sizeof(T));
+  }
+  else if (toNode!=this || toIndex<fromIndex) {
+    if (debug==1) cout << "moveKeys(): 2" << endl;
+    for (int i=0; i<count; i++)
+      if (toIndex+i<limit) to[i]=std::move(from[i]);
+      else new (to+i) T(std::move(from[i]));
+  }
+  else {
+    // Siirto eteenpin saman solmun sisll; aloitetaan lopusta, jottei
+    // siirrettvi avaimia korvata ennen niiden siirtoa.
+    if (debug==1) cout << "moveKeys(): 3" << endl;
+    for (int i=count-1; i>=0; i--)
+      if (toIndex+i<limit) to[i]=std::move(from[i]);
+      else new (to+i) T(std::move(from[i]));
+  }
+  if (toIndex+count>limit) toNode->constructed=toIndex+count;
+
+  memmove(toNode->dead+toIndex, dead+fromIndex, count*sizeof(bool));
+  if (copies && toNode->copies)
+    memmove(toNode->copies+toIndex, copies+fromIndex, count*sizeof(int));
+}
+
+/* Siirt lapsiosoittimet koosteineen solmusta toiseen tai saman solmun
+   sisll. */
+template<typename T> void BTreeNode<T>::moveChildren(int fromIndex,
+                                                     int count,
+                                                     BTreeNode<T> *toNode,
+                                                     int toIndex) {
+  if (count<=0) return;
+  if (isLeaf() || toNode->isLeaf() || fromIndex<0 ||
+      fromIndex+count>maxChildren || toIndex<0 ||
+      toIndex+count>toNode->maxChildren) {
+    cerr << "moveChildren(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  memmove(toNode->child+toIndex, child+fromIndex,
+          count*sizeof(BTreeNode<T> *));
+  if (childCount && toNode->childCount) {
+    memmove(toNode->childCount+toIndex, childCount+fromIndex,
+            count*sizeof(long long));
+    memmove(toNode->childTotal+toIndex, childTotal+fromIndex,
+            count*sizeof(double));
+  }
+}
+
 /* Siirt avaimia ja lapsiosoittimia eteenpin ja pivitt avainten
    lukumrn.
    fromIndex = indeksi, josta alkaen avaimet siirretn
    count = siirron pituus */
 template<typename T> void BTreeNode<T>::shift(int fromIndex, int count) {
-  for (int i=numKeys()-1; i>=fromIndex; i--) {
-    setKey(getKey(i), i+count);
-  }
+  moveKeys(fromIndex, numKeys()-fromIndex, this, fromIndex+count);
   if (!isLeaf()) {
-    for (int i=numKeys(); i>=fromIndex; i--) {
-      if (debug==1) cout << "shift(): 1" << endl;
-      setChild(getChild(i), i+count);
-    }
+    if (debug==1) cout << "shift(): 1" << endl;
+    moveChildren(fromIndex, numKeys()-fromIndex+1, this, fromIndex+count);
   }
   setNumKeys(numKeys()+count);
 }
@@ -179,7 +420,9 @@ template<typename T> void BTreeNode<T>::insert(T newKey,
     setNumKeys(numKeys()+1);
   }
 
-  setKey(newKey, index);
+  setKey(std::move(newKey), index);
+  setDead(index, false);
+  setCopies(index, 1);
   if (leftChild) {
     if (debug==1) cout << "insert(): 3" << endl;
     setChild(leftChild, index);
@@ -203,32 +446,32 @@ template<typename T> T BTreeNode<T>::remove(int index, bool leftChild,
     return key[0];
   }
 
-  T key=getKey(index);
-  for (int i=index; i<numKeys()-1; i++) {
-    if (debug==1) cout << "remove(): 1" << endl;
-    setKey(getKey(i+1), i);
+  if (index<0 || index>=numKeys()) {
+    cerr << "remove(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return key[0];
   }
+
+  T removed(std::move(key[index]));
+  if (debug==1 && index<numKeys()-1) cout << "remove(): 1" << endl;
+  moveKeys(index+1, numKeys()-index-1, this, index);
   if (!isLeaf()) {
     if (leftChild==true) {
-      for (int i=index; i<numChildren()-1; i++) {
-        if (debug==1) cout << "remove(): 2" << endl;
-        setChild(getChild(i+1), i);
-      }
+      if (debug==1) cout << "remove(): 2" << endl;
+      moveChildren(index+1, numChildren()-index-1, this, index);
     }
     else if (rightChild==true) {
-      for (int i=index+1; i<numChildren()-1; i++) {
-        if (debug==1) cout << "remove(): 3" << endl;
-        setChild(getChild(i+1), i);
-      }
+      if (debug==1) cout << "remove(): 3" << endl;
+      moveChildren(index+2, numChildren()-index-2, this, index+1);
     }
   }
   setNumKeys(numKeys()-1);
-  return key;
+  return removed;
 }
 
 /* Kopioi avaimet ja lapsiosoittimet solmusta toiseen. Pivitt kohdesolmun
    avainten lukumrn, jos viimeinen kopioitava indeksi ylitt solmun
-   viimeisen kytetyn indeksin.
+   viimeisen kytetyn indeksin. Avaimet siirretn.
    fromIndex = lhdeindeksi, josta kopioidaan
    count = kopioitavien indeksien mr
    toNode = kohdesolmu
@@ -236,15 +479,11 @@ template<typename T> T BTreeNode<T>::remove(int index, bool leftChild,
 template<typename T> void BTreeNode<T>::copy(int fromIndex, int count,
                                              BTreeNode<T> *toNode,
                                              int toIndex) {
-  for (int i=0; i<count; i++) {
-    if (debug==1) cout << "copy(): 1" << endl;
-    toNode->setKey(getKey(fromIndex+i), toIndex+i);
-  }
+  if (debug==1) cout << "copy(): 1" << endl;
+  moveKeys(fromIndex, count, toNode, toIndex);
   if (!isLeaf()) {
-    for (int i=0; i<count+1; i++) {
-      if (debug==1) cout << "copy(): 2" << endl;
-      toNode->setChild(getChild(fromIndex+i), toIndex+i);
-    }
+    if (debug==1) cout << "copy(): 2" << endl;
+    moveChildren(fromIndex, count+1, toNode, toIndex);
   }
 
   if (toIndex+count>toNode->numKeys()) {
@@ -293,6 +532,156 @@ template<typename T> void BTree<T>::destroyBranch(BTreeNode<T> *branch) {
   }
 }
 
+/* Luo solmun, jolla on lasten koosteet ja avainten lukumrt, jos ne
+   ovat puussa kytss. */
+template<typename T> BTreeNode<T> *BTree<T>::newNode(bool leaf) {
+  BTreeNode<T> *node=new BTreeNode<T>(degree, leaf, debug);
+  if (aggregateValue) node->enableAggregates();
+  if (multiset) node->enableCopies();
+  return node;
+}
+
+/* Laskee lapsen kohdasta index alipuun avainten mrn ja koosteen ja
+   tallentaa ne issolmuun. */
+template<typename T> void BTree<T>::updateAggregate(BTreeNode<T> *parent,
+                                                    int index) {
+  if (!aggregateValue) return;
+  BTreeNode<T> *child=parent->getChild(index);
+  long long count=0;
+  double total=aggregateIdentity;
+  for (int i=0; i<child->numKeys(); i++)
+    if (!child->isDead(i)) {
+      count++;
+      total=aggregateCombine(total, aggregateValue(child->getKey(i)));
+    }
+  if (!child->isLeaf())
+    for (int i=0; i<child->numChildren(); i++) {
+      count+=child->getCount(i);
+      total=aggregateCombine(total, child->getTotal(i));
+    }
+  parent->setAggregate(index, count, total);
+}
+
+/* Laskee alipuun kaikkien solmujen koosteet alhaalta yls. */
+template<typename T> void BTree<T>::updateBranch(BTreeNode<T> *node) {
+  if (!aggregateValue || node->isLeaf()) return;
+  node->enableAggregates();
+  for (int i=0; i<node->numChildren(); i++) {
+    updateBranch(node->getChild(i));
+    updateAggregate(node, i);
+  }
+}
+
+/* Pivitt koosteet avaimen hakupolulla alhaalta yls.
+   side = 0=polku pttyy avaimen sisltvn solmuun tai lehteen,
+          -1 tai 1=avaimen kohdalla jatketaan sen vasempaan tai oikeaan
+          alipuuhun lehteen asti */
+template<typename T> void BTree<T>::updatePath(const T &key, int side) {
+  if (!aggregateValue) return;
+  vector<BTreeNode<T> *> path;
+  vector<int> indices;
+  BTreeNode<T> *node=root;
+  while (!node->isLeaf()) {
+    int i=0;
+    while (i<node->numKeys() && compare(key, node->getKey(i))>0) i++;
+    if (i<node->numKeys() && compare(key, node->getKey(i))==0) {
+      if (side==0) break;
+      if (side>0) i++;
+    }
+    path.push_back(node);
+    indices.push_back(i);
+    node=node->getChild(i);
+  }
+  for (int i=path.size()-1; i>=0; i--) updateAggregate(path[i], indices[i]);
+}
+
+/* Palauttaa alipuun elvien avainten mrn, jotka ovat pienempi kuin
+   key tai, jos inclusive on true, pienempi tai yht suuria. */
+template<typename T> long long BTree<T>::rankBranch(BTreeNode<T> *node,
+                                                    const T &key,
+                                                    bool inclusive) {
+  long long rank=0;
+  while (true) {
+    int i=0;
+    for (; i<node->numKeys(); i++) {
+      int c=compare(node->getKey(i), key);
+      if (c>0 || (c==0 && !inclusive)) break;
+      if (!node->isLeaf()) rank+=node->getCount(i);
+      if (!node->isDead(i)) rank++;
+      // Avaimen oikean puolen alipuun avaimet ovat suurempia kuin key.
+      if (c==0) return rank;
+    }
+    if (node->isLeaf()) return rank;
+    node=node->getChild(i);
+  }
+}
+
+/* Yhdist alipuun elvien avainten koosteen vlilt [lo, hi].
+   lo, hi = vlin rajat tai NULL, jos alipuun avaimet ovat varmasti
+            rajan sispuolella */
+template<typename T> double BTree<T>::aggregateBranch(BTreeNode<T> *node,
+                                                      const T *lo,
+                                                      const T *hi) {
+  double total=aggregateIdentity;
+  int keys=node->numKeys();
+  for (int i=0; i<=keys; i++) {
+    if (!node->isLeaf()) {
+      // Lapsen i avaimet ovat avainten i-1 ja i vliss. Raja, jonka
+      // ympriv avain jo tytt, jtetn lapselta pois.
+      bool below=i<keys && lo && compare(node->getKey(i), *lo)<=0;
+      bool above=i>0 && hi && compare(node->getKey(i-1), *hi)>=0;
+      if (!below && !above) {
+        const T *childLo=lo, *childHi=hi;
+        if (i>0 && lo && compare(node->getKey(i-1), *lo)>=0) childLo=NULL;
+        if (i<keys && hi && compare(node->getKey(i), *hi)<=0) childHi=NULL;
+        if (!childLo && !childHi)
+          total=aggregateCombine(total, node->getTotal(i));
+        else
+          total=aggregateCombine(total,
+                                 aggregateBranch(node->getChild(i), childLo,
+                                                 childHi));
+      }
+    }
+    if (i==keys) break;
+    if (hi && compare(node->getKey(i), *hi)>0) break;
+    if (!node->isDead(i) && (!lo || compare(node->getKey(i), *lo)>=0))
+      total=aggregateCombine(total, aggregateValue(node->getKey(i)));
+  }
+  return total;
+}
+
+/* Tarkistaa alipuun koosteet ja palauttaa alipuun elvien avainten
+   mrn ja koosteen. */
+template<typename T> void BTree<T>::validateAggregates(BTreeNode<T> *node,
+                                                       long long *count,
+                                                       double *total) {
+  *count=0;
+  *total=aggregateIdentity;
+  for (int i=0; i<node->numKeys(); i++)
+    if (!node->isDead(i)) {
+      (*count)++;
+      *total=aggregateCombine(*total, aggregateValue(node->getKey(i)));
+    }
+  if (node->isLeaf()) return;
+
+  for (int i=0; i<node->numChildren(); i++) {
+    long long childCount;
+    double childTotal;
+    validateAggregates(node->getChild(i), &childCount, &childTotal);
+    // Koosteet voivat erota pyristyksen verran, jos ne on yhdistetty eri
+    // jrjestyksess.
+    if (!node->hasAggregates() || node->getCount(i)!=childCount ||
+        fabs(node->getTotal(i)-childTotal)>
+        1e-9*(fabs(childTotal)>1 ? fabs(childTotal) : 1)) {
+      cerr << "VALIDATE: Invalid aggregate." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    *count+=childCount;
+    *total=aggregateCombine(*total, childTotal);
+  }
+}
+
 /* Tulostaa avaimet esijrjestyksess.
    node = alipuu, jonka avaimet tulostetaan
    depth = rekursiivisesti laskettava alipuun korkeus */
@@ -327,40 +716,157 @@ template<typename T> void BTree<T>::printInorder(BTreeNode<T> *node,
    result = solmu, jossa lydetty avain on tai NULL, jos avainta ei
    lytynyt
    index = lydetyn avaimen indeksi
-   node = alipuu, josta avainta etsitn */
+   node = alipuu, josta avainta etsitn
+   depth = alipuun juuren syvyys */
 template<typename T> void BTree<T>::searchBranch(const T &key,
                                                  BTreeNode<T> **result,
                                                  int *index,
-                                                 BTreeNode<T> *node) {
+                                                 BTreeNode<T> *node,
+                                                 int depth) {
   if (node) {
     int i=0;
     while (i<node->numKeys() && compare(key, node->getKey(i))>0) i++;
+    TRACE_EVENT(trace, TRACE_SEARCH_STEP, depth, i+1);
     if (i<node->numKeys() && compare(key, node->getKey(i))==0) {
       *result=node;
       *index=i;
       return;
     }
     if (!node->isLeaf())
-      searchBranch(key, result, index, node->getChild(i));
+      searchBranch(key, result, index, node->getChild(i), depth+1);
+  }
+}
+
+/* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+   jrjestyksess.
+   node = alipuu, josta avaimia etsitn */
+template<typename T> void BTree<T>::rangeBranch(BTreeNode<T> *node,
+                                                const T &lo, const T &hi,
+                                                vector<T> &result) {
+  // Ohitetaan avaimet ja alipuut, jotka ovat kokonaan vlin alarajan
+  // alapuolella.
+  int i=0;
+  while (i<node->numKeys() && compare(node->getKey(i), lo)<0) i++;
+
+  if (!node->isLeaf()) rangeBranch(node->getChild(i), lo, hi, result);
+  for (; i<node->numKeys() && compare(node->getKey(i), hi)<=0; i++) {
+    if (!node->isDead(i)) result.push_back(node->getKey(i));
+    if (!node->isLeaf()) rangeBranch(node->getChild(i+1), lo, hi, result);
+  }
+}
+
+/* Ker alipuun avaimet nousevassa jrjestyksess.
+   node = alipuu, jonka avaimet kertn */
+template<typename T> void BTree<T>::collectBranch(BTreeNode<T> *node,
+                                                  vector<T> &keys) {
+  for (int i=0; i<node->numKeys(); i++) {
+    if (!node->isLeaf()) collectBranch(node->getChild(i), keys);
+    if (!node->isDead(i)) keys.push_back(node->getKey(i));
   }
+  if (!node->isLeaf() && node->numKeys()>0)
+    collectBranch(node->getLastChild(), keys);
 }
 
-/* Tarkistaa, ett puu tytt B-puun mritelmn.
+/* Etsii alipuusta pienimmn elvn avaimen, joka on suurempi tai yht
+   suuri kuin key, ohittaen haudatut avaimet. Palauttaa false, jos
+   sellaista ei ole.
+   node = alipuu, josta avainta etsitn */
+template<typename T> bool BTree<T>::ceilingBranch(BTreeNode<T> *node,
+                                                  const T &key, T *result) {
+  int i=0;
+  while (i<node->numKeys() && compare(node->getKey(i), key)<0) i++;
+  for (; i<=node->numKeys(); i++) {
+    if (!node->isLeaf() && node->numKeys()>0
+        && ceilingBranch(node->getChild(i), key, result))
+      return true;
+    if (i<node->numKeys() && !node->isDead(i)) {
+      *result=node->getKey(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Etsii alipuusta suurimman elvn avaimen, joka on pienempi tai yht
+   suuri kuin key, ohittaen haudatut avaimet. Palauttaa false, jos
+   sellaista ei ole.
+   node = alipuu, josta avainta etsitn */
+template<typename T> bool BTree<T>::floorBranch(BTreeNode<T> *node,
+                                                const T &key, T *result) {
+  int i=node->numKeys();
+  while (i>0 && compare(node->getKey(i-1), key)>0) i--;
+  for (; i>=0; i--) {
+    if (!node->isLeaf() && node->numKeys()>0
+        && floorBranch(node->getChild(i), key, result))
+      return true;
+    if (i>0 && !node->isDead(i-1)) {
+      *result=node->getKey(i-1);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Ker alipuusta haudattuja avaimia nousevassa jrjestyksess, kunnes
+   tulosvektorissa on budget avainta.
+   node = alipuu, josta avaimia etsitn
+   from = pienin kerttv avain
+   all = true=kertn alusta alkaen from-avaimesta vlittmtt */
+template<typename T> void BTree<T>::deadBranch(BTreeNode<T> *node,
+                                               const T &from, bool all,
+                                               unsigned int budget,
+                                               vector<T> &result) {
+  // Ohitetaan avaimet ja alipuut, jotka ovat kokonaan from-avaimen
+  // alapuolella.
+  int i=0;
+  if (!all)
+    while (i<node->numKeys() && compare(node->getKey(i), from)<0) i++;
+
+  for (; i<=node->numKeys() && result.size()<budget; i++) {
+    if (!node->isLeaf() && node->numKeys()>0)
+      deadBranch(node->getChild(i), from, all, budget, result);
+    if (i<node->numKeys() && node->isDead(i) && result.size()<budget)
+      result.push_back(node->getKey(i));
+  }
+}
+
+/* Laskee alipuun muistinkytn syvyyksittin.
+   node = alipuu
+   depth = alipuun juuren syvyys
+   nodes, live, allocated = sissolmujen (indeksi 2*depth) ja lehtien
+                            (2*depth+1) summat */
+template<typename T> void BTree<T>::memoryBranch(
+  BTreeNode<T> *node, int depth, vector<long long> &nodes,
+  vector<long long> &live, vector<long long> &allocated) {
+  unsigned int index=2*depth+(node->isLeaf() ? 1 : 0);
+  if (index>=nodes.size()) {
+    nodes.resize(index+1, 0);
+    live.resize(index+1, 0);
+    allocated.resize(index+1, 0);
+  }
+  nodes[index]++;
+  live[index]+=node->liveBytes();
+  allocated[index]+=node->allocatedBytes();
+  if (!node->isLeaf())
+    for (int i=0; i<node->numChildren(); i++)
+      memoryBranch(node->getChild(i), depth+1, nodes, live, allocated);
+}
+
+/* Tarkistaa alipuun solmujen avainten ja lasten mrt sek lehtien
+   syvyyden ja ker alipuun avaimet sisjrjestyksess. Avainten
+   jrjestys solmujen sisll ja alipuiden vlill tarkistetaan
+   sisjrjestyksest, joten jokainen avain ksitelln kerran.
    node = tarkistettava alipuu
-   depth = rekursiivisesti laskettava puun korkeus */
+   depth = alipuun juuren syvyys
+   found = vektori, johon avaimet listn
+   dead = haudattujen avainten mr listn thn
+   leafDepth = lehtien syvyys tai -1, jos lehte ei ole viel lydetty */
 template<typename T> void BTree<T>::validateBranch(BTreeNode<T> *node,
                                                    int depth,
-                                                   const vector<T> &keys,
-                                                   vector<bool> &checked) {
+                                                   vector<T> &found,
+                                                   int *dead,
+                                                   int *leafDepth) {
   if (node) {
-    // Merkitn avain, jos se on puussa.
-    for (int i=0; i<node->numKeys(); i++)
-      for (unsigned int j=0; j<keys.size(); j++)
-        if (compare(node->getKey(i), keys[j])==0) {
-          checked[j]=true;
-          break;
-        }
-
     if (depth>numDepth) numDepth=depth;
     numNodes++;
 
@@ -379,53 +885,36 @@ template<typename T> void BTree<T>::validateBranch(BTreeNode<T> *node,
     }
 
     numKeys+=node->numKeys();
-
-    // Tarkistetaan, ett avaimet ovat suuruusjrjestyksess pienimmst
-    // suurimpaan.
-    for (int i=0; i<node->numKeys()-1; i++)
-      if (compare(node->getKey(i+1), node->getKey(i))<0) {
-        cerr << "VALIDATE: Keys not in order." << endl;
+    for (int i=0; i<node->numKeys(); i++) {
+      if (node->isDead(i)) (*dead)++;
+      if (!multiset && node->getCopies(i)!=1) {
+        cerr << "VALIDATE: Multiple copies in a set." << endl;
         raise(SIGABRT);
         return;
       }
+    }
 
-    if (!node->isLeaf()) {
-      // Tarkistetaan, ett solmu ei sisll useita samoja lapsia.
-      for (int i=0; i<node->numChildren(); i++)
-        for (int j=0; j<node->numChildren(); j++)
-          if (i!=j && node->getChild(i)==node->getChild(j)) {
-            cerr << "VALIDATE: Multiple same children." << endl;
-            raise(SIGABRT);
-            return;
-          }
-
-      // Tarkistetaan, ett lasten avaimet ovat suuruusjrjestyksess solmun
-      // avaimiin verrattuna.
-      for (int i=0; i<node->numKeys(); i++) {
-        if (compare(node->getKey(i),
-                    node->getChild(i)->getLastKey())<=0) {
-          cerr << "VALIDATE: Left child key not in order." << endl;
-          raise(SIGABRT);
-          return;
-        }
-        if (compare(node->getKey(i),
-                    node->getChild(i+1)->getFirstKey())>=0) {
-          cerr << "VALIDATE: Right child key not in order." << endl;
-          raise(SIGABRT);
-          return;
-        }
+    if (node->isLeaf()) {
+      // Kaikkien lehtien on oltava samalla syvyydell.
+      if (*leafDepth<0) *leafDepth=depth;
+      else if (*leafDepth!=depth) {
+        cerr << "VALIDATE: Leaves at different depths." << endl;
+        raise(SIGABRT);
+        return;
       }
+      for (int i=0; i<node->numKeys(); i++) found.push_back(node->getKey(i));
+      return;
     }
 
-    if (!node->isLeaf())
-      for (int i=0; i<node->numChildren(); i++)
-        if (node->getChild(i))
-          validateBranch(node->getChild(i), depth+1, keys, checked);
-        else {
-          cerr << "VALIDATE: No child." << endl;
-          raise(SIGABRT);
-          return;
-        }
+    for (int i=0; i<node->numChildren(); i++) {
+      if (!node->getChild(i)) {
+        cerr << "VALIDATE: No child." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      validateBranch(node->getChild(i), depth+1, found, dead, leafDepth);
+      if (i<node->numKeys()) found.push_back(node->getKey(i));
+    }
   }
   else {
     cerr << "VALIDATE: Invalid branch." << endl;
@@ -447,8 +936,9 @@ template<typename T> void BTree<T>::splitChild(BTreeNode<T> *parent,
     return;
   }
 
+  TRACE_EVENT(trace, TRACE_SPLIT, 0, 1);
   // Luodaan uusi solmu, joka tulee vasemmanpuoleisen solmun sisareksi.
-  BTreeNode<T> *right=new BTreeNode<T>(degree, left->isLeaf(), debug);
+  BTreeNode<T> *right=newNode(left->isLeaf());
 
   // Jaetaan vasemmanpuoleinen solmu kahteen yht suureen osaan kopioimalla
   // oikea puoli sisarsolmuun.
@@ -458,13 +948,61 @@ template<typename T> void BTree<T>::splitChild(BTreeNode<T> *parent,
   // Siirretn keskimminen alkio issolmuun ja asetetaan oikeanpuoleinen
   // solmu issolmun lapseksi.
   parent->insert(left->getKey(degree-1), NULL, right, medianKey);
+  parent->setDead(medianKey, left->isDead(degree-1));
+  parent->setCopies(medianKey, left->getCopies(degree-1));
   left->remove(degree-1, false, false);
+  updateAggregate(parent, medianKey);
+  updateAggregate(parent, medianKey+1);
+}
+
+/* Tekee tyteen lapsisolmuun tilaa B*-puun tapaan: siirt avaimen
+   vajaalle viereiselle sisarelle tai, jos molemmat sisaret ovat tynn,
+   jakaa lapsen ja tyden sisaren kolmeen solmuun.
+   parent = vaillinainen issolmu
+   index = tyden lapsen indeksi */
+template<typename T> void BTree<T>::overflowChild(BTreeNode<T> *parent,
+                                                  int index) {
+  // Sisarella on oltava tilaa ainakin kahdelle avaimelle, jotta listtv
+  // avain mahtuu kumpaan tahansa solmuun siirron jlkeen. Siirretn puolet
+  // sisaren vapaasta tilasta, jottei lapsi tyty heti uudelleen.
+  if (index>0 && parent->getChild(index-1)->numKeys()<2*degree-2) {
+    if (debug==1) cout << "overflowChild(): 1" << endl;
+    // Vasen sisar lainaa lapselta ensimmiset avaimet.
+    int moves=(2*degree-parent->getChild(index-1)->numKeys())/2;
+    for (int i=0; i<moves; i++) rotateRight(parent, index-1);
+    return;
+  }
+  if (index<parent->numKeys() &&
+      parent->getChild(index+1)->numKeys()<2*degree-2) {
+    if (debug==1) cout << "overflowChild(): 2" << endl;
+    // Oikea sisar lainaa lapselta viimeiset avaimet.
+    int moves=(2*degree-parent->getChild(index+1)->numKeys())/2;
+    for (int i=0; i<moves; i++) rotateLeft(parent, index+1);
+    return;
+  }
+
+  // Sisaretkin ovat (lhes) tynn. Tytetn parin (vasen, oikea) oikea
+  // solmu tarvittaessa kierrolla ja puolitetaan se, jolloin oikeassa ja
+  // uudessa kolmannessa solmussa on t-1 avainta. Tasataan sitten avaimet
+  // kierroilla vasemmalta oikealle.
+  if (debug==1) cout << "overflowChild(): 3" << endl;
+  int left=index<parent->numKeys() ? index : index-1;
+  if (parent->getChild(left+1)->numKeys()<2*degree-1)
+    rotateLeft(parent, left+1);
+  splitChild(parent, left+1, parent->getChild(left+1));
+  int total=parent->getChild(left)->numKeys()+2*(degree-1);
+  int third=total/3, second=(total-third)/2;
+  for (int i=degree-1; i<second+third-(degree-1); i++)
+    rotateLeft(parent, left+1);
+  for (int i=degree-1; i<third; i++)
+    rotateLeft(parent, left+2);
 }
 
 /* Lis avaimen vaillinaiseen solmuun. [1]
    node = alipuu, johon avain tulee
    key = avain */
-template<typename T> void BTree<T>::insertNonfull(BTreeNode<T> *node, T key) {
+template<typename T> void BTree<T>::insertNonfull(BTreeNode<T> *node,
+                                                  T &key) {
   if (node==NULL) {
     cerr << "insertNonfull(): Invalid argument." << endl;
     raise(SIGABRT);
@@ -479,7 +1017,7 @@ template<typename T> void BTree<T>::insertNonfull(BTreeNode<T> *node, T key) {
       if (debug==1) cout << "insertNonfull(): 2" << endl;
       i--;
     }
-    node->insert(key, NULL, NULL, i+1);
+    node->insert(std::move(key), NULL, NULL, i+1);
   }
   else {
     if (debug==1) cout << "insertNonfull(): 3" << endl;
@@ -491,7 +1029,17 @@ template<typename T> void BTree<T>::insertNonfull(BTreeNode<T> *node, T key) {
     }
     i++;
 
-    if (node->getChild(i)->numKeys()==2*degree-1) {
+    if (node->getChild(i)->numKeys()==2*degree-1 && redistribute) {
+      if (debug==1) cout << "insertNonfull(): 7" << endl;
+      // Matkan varrella oleva solmu on tynn; tasataan avaimia sisarten
+      // kanssa ja etsitn lapsi uudelleen, koska issolmun avaimet ovat
+      // muuttuneet.
+      overflowChild(node, i);
+      i=node->numKeys()-1;
+      while (i>=0 && compare(key, node->getKey(i))<0) i--;
+      i++;
+    }
+    else if (node->getChild(i)->numKeys()==2*degree-1) {
       if (debug==1) cout << "insertNonfull(): 5" << endl;
       // Matkan varrella oleva solmu on tynn; puolitetaan se.
       splitChild(node, i, node->getChild(i));
@@ -502,54 +1050,70 @@ template<typename T> void BTree<T>::insertNonfull(BTreeNode<T> *node, T key) {
       }
     }
 
-    // Jatketaan etsint.
+    // Jatketaan etsint. Jaot ja siirrot on tehty ennen laskeutumista,
+    // joten lapsen koosteeseen riitt list avain; sen arvo otetaan
+    // talteen ennen laskeutumista, koska avain siirretn lehteen.
+    double value=aggregateValue ? aggregateValue(key) : 0;
     insertNonfull(node->getChild(i), key);
+    if (aggregateValue)
+      node->setAggregate(i, node->getCount(i)+1,
+                         aggregateCombine(node->getTotal(i), value));
   }
 }
 
 /* Poistaa ja palauttaa edellisen avaimen. Argumenttina on annettava se
    lapsisolmu, joka edelt avainta, jonka edeltjavain halutaan poistaa.
-   branch = alipuu, josta avain poistetaan */
-template<typename T> T BTree<T>::removePredecessorKey(BTreeNode<T> *branch) {
+   branch = alipuu, josta avain poistetaan
+   dead = palautetaan true, jos avain oli haudattu
+   copies = avaimen kappalemr palautetaan thn */
+template<typename T> T BTree<T>::removePredecessorKey(BTreeNode<T> *branch,
+                                                      bool *dead,
+                                                      int *copies) {
   if (branch==NULL) {
     cerr << "removePredecessorKey(): Invalid argument." << endl;
     raise(SIGABRT);
     return *new T;
   }
 
-  T key;
   if (!branch->isLeaf()) {
     if (debug==1) cout << "removePredecessorKey(): 1" << endl;
-    key=removePredecessorKey(branch->getLastChild());
-  }
-  else {
-    if (debug==1) cout << "removePredecessorKey(): 2" << endl;
-    key=branch->getLastKey();
-    removeBranch(key, root);
+    return removePredecessorKey(branch->getLastChild(), dead, copies);
   }
+
+  if (debug==1) cout << "removePredecessorKey(): 2" << endl;
+  // Avain kopioidaan, koska poisto etsii sen uudelleen juuresta.
+  T key=branch->getLastKey();
+  *dead=branch->isDead(branch->numKeys()-1);
+  *copies=branch->getCopies(branch->numKeys()-1);
+  removeBranch(key, root);
   return key;
 }
 
 /* Poistaa ja palauttaa seuraavan avaimen. Argumenttina on annettava se
    lapsisolmu, joka seuraa avainta, jonka seuraaja-avain halutaan poistaa.
-   branch = alipuu, josta avain poistetaan */
-template<typename T> T BTree<T>::removeSuccessorKey(BTreeNode<T> *branch) {
+   branch = alipuu, josta avain poistetaan
+   dead = palautetaan true, jos avain oli haudattu
+   copies = avaimen kappalemr palautetaan thn */
+template<typename T> T BTree<T>::removeSuccessorKey(BTreeNode<T> *branch,
+                                                    bool *dead,
+                                                    int *copies) {
   if (branch==NULL) {
     cerr << "removeSuccessorKey(): Invalid argument." << endl;
     raise(SIGABRT);
     return *new T;
   }
 
-  T key;
   if (!branch->isLeaf()) {
     if (debug==1) cout << "removeSuccessorKey(): 1" << endl;
-    key=removeSuccessorKey(branch->getFirstChild());
-  }
-  else {
-    if (debug==1) cout << "removeSuccessorKey(): 2" << endl;
-    key=branch->getFirstKey();
-    removeBranch(key, root);
+    return removeSuccessorKey(branch->getFirstChild(), dead, copies);
   }
+
+  if (debug==1) cout << "removeSuccessorKey(): 2" << endl;
+  // Avain kopioidaan, koska poisto etsii sen uudelleen juuresta.
+  T key=branch->getFirstKey();
+  *dead=branch->isDead(0);
+  *copies=branch->getCopies(0);
+  removeBranch(key, root);
   return key;
 }
 
@@ -561,9 +1125,21 @@ template<typename T> void BTree<T>::rotateRight(BTreeNode<T> *parent,
                                                 int index) {
   BTreeNode<T> *child=parent->getChild(index),
     *sibling=parent->getChild(index+1);
+  TRACE_EVENT(trace, TRACE_ROTATE_RIGHT, 0, 1);
   child->insert(parent->getKey(index), NULL, sibling->getFirstChild(),
                 child->numKeys());
+  child->setDead(child->numKeys()-1, parent->isDead(index));
+  child->setCopies(child->numKeys()-1, parent->getCopies(index));
+  if (child->hasAggregates())
+    child->setAggregate(child->numKeys(), sibling->getCount(0),
+                        sibling->getTotal(0));
+  bool dead=sibling->isDead(0);
+  int copies=sibling->getCopies(0);
   parent->setKey(sibling->remove(0, true, false), index);
+  parent->setDead(index, dead);
+  parent->setCopies(index, copies);
+  updateAggregate(parent, index);
+  updateAggregate(parent, index+1);
 }
 
 /* Lainaa vasemmanpuoleiselta sisarsolmulta avaimen siirten sen issolmuun
@@ -574,9 +1150,21 @@ template<typename T> void BTree<T>::rotateLeft(BTreeNode<T> *parent,
                                                int index) {
   BTreeNode<T> *child=parent->getChild(index),
     *sibling=parent->getChild(index-1);
+  TRACE_EVENT(trace, TRACE_ROTATE_LEFT, 0, 1);
   child->insert(parent->getKey(index-1), sibling->getLastChild(), NULL, 0);
+  child->setDead(0, parent->isDead(index-1));
+  child->setCopies(0, parent->getCopies(index-1));
+  if (child->hasAggregates())
+    child->setAggregate(0, sibling->getCount(sibling->numKeys()),
+                        sibling->getTotal(sibling->numKeys()));
+  bool dead=sibling->isDead(sibling->numKeys()-1);
+  int copies=sibling->getCopies(sibling->numKeys()-1);
   parent->setKey(sibling->remove(sibling->numKeys()-1, false, true),
                  index-1);
+  parent->setDead(index-1, dead);
+  parent->setCopies(index-1, copies);
+  updateAggregate(parent, index-1);
+  updateAggregate(parent, index);
 }
 
 /* Yhdist kaksi solmua, jotta olisi mahdollista tuhota avain yhdistyn
@@ -599,6 +1187,7 @@ template<typename T> BTreeNode<T> *BTree<T>::mergeChildren(
   BTreeNode<T> *merged=parent->getChild(mergeIndex);
   BTreeNode<T> *removed;
   int medianIndex=merged->numKeys();
+  TRACE_EVENT(trace, TRACE_MERGE, 0, 1);
 
   // Tarkistetaan voidaanko yhdist joko oikeanpuoleinen tai
   // vasemmanpuoleinen sisarsolmu. Jomman kumman nist on oltava olemassa.
@@ -608,6 +1197,8 @@ template<typename T> BTreeNode<T> *BTree<T>::mergeChildren(
 
     // Lainataan issolmusta mediaaniavain yhdistettyyn solmuun.
     merged->insert(parent->getKey(mergeIndex), NULL, NULL, medianIndex);
+    merged->setDead(medianIndex, parent->isDead(mergeIndex));
+    merged->setCopies(medianIndex, parent->getCopies(mergeIndex));
     parent->remove(mergeIndex, false, true);
 
     // Kopiodaan sisarsolmun avaimet ja lapsiosoittimet yhdistettvn
@@ -626,6 +1217,8 @@ template<typename T> BTreeNode<T> *BTree<T>::mergeChildren(
     merged->shift(0, removed->numKeys());
     // Lainataan issolmusta mediaaniavain yhdistettyyn solmuun.
     merged->insert(parent->getKey(mergeIndex-1), NULL, NULL, medianIndex);
+    merged->setDead(medianIndex, parent->isDead(mergeIndex-1));
+    merged->setCopies(medianIndex, parent->getCopies(mergeIndex-1));
     parent->remove(mergeIndex-1, true, false);
 
     // Kopiodaan sisarsolmun avaimet ja lapsiosoittimet yhdistettvn
@@ -634,6 +1227,7 @@ template<typename T> BTreeNode<T> *BTree<T>::mergeChildren(
 
     delete removed;
     removed=NULL;
+    mergeIndex--;
   }
 
   // Issolmusta lainattu avain tyhjensi juurisolmun. Tuhotaan solmu ja
@@ -641,12 +1235,14 @@ template<typename T> BTreeNode<T> *BTree<T>::mergeChildren(
   // yhdell.
   if (parent->numKeys()==0) {
     if (debug==1) cout << "mergeChildren(): 3" << endl;
+    TRACE_EVENT(trace, TRACE_ROOT_COLLAPSE, 0, 1);
     root=merged;
     delete parent;
     parent=NULL;
     return merged;
   }
 
+  updateAggregate(parent, mergeIndex);
   return parent;
 }
 
@@ -680,20 +1276,32 @@ template<typename T> void BTree<T>::removeBranch(const T &key, BTreeNode<T>
       // sill rekursion yhteydess on varmistettu, ett lehteen j
       // tarpeeksi avaimia (lukuunottamatta yhden solmun puita).
       branch->remove(i, false, false);
+      updatePath(key, 0);
     }
     else {
       // Jos avaimen lapsisolmuissa on tarpeeksi avaimia, voidaan lainata
       // joko oikeasta- tai vasemmasta alipuusta vastaavasti seuraaja- tai
-      // edeltjavain tuhottavan avaimen solmuun paikkaajaksi.
+      // edeltjavain tuhottavan avaimen solmuun paikkaajaksi. Paikkaaja
+      // silytt hautausmerkintns ja kappalemrns.
+      bool dead;
+      int copies;
       if (branch->getChild(i)->numKeys()>=degree) {
         // 2a. oikea puoli [1]
         if (debug==1) cout << "removeBranch(): 3" << endl;
-        branch->setKey(removePredecessorKey(branch->getChild(i)), i);
+        branch->setKey(removePredecessorKey(branch->getChild(i), &dead,
+                                            &copies), i);
+        branch->setDead(i, dead);
+        branch->setCopies(i, copies);
+        updatePath(branch->getKey(i), -1);
       }
       else if (branch->getChild(i+1)->numKeys()>=degree) {
         // 2a. vasen puoli [1]
         if (debug==1) cout << "removeBranch(): 4" << endl;
-        branch->setKey(removeSuccessorKey(branch->getChild(i+1)), i);
+        branch->setKey(removeSuccessorKey(branch->getChild(i+1), &dead,
+                                          &copies), i);
+        branch->setDead(i, dead);
+        branch->setCopies(i, copies);
+        updatePath(branch->getKey(i), 1);
       }
       else {
         // 2c. [1]
@@ -752,13 +1360,17 @@ template<typename T> void BTree<T>::removeBranch(const T &key, BTreeNode<T>
 template<typename T> BTree<T>::BTree<T>(int degree,
   int (*const compare)(const T &, const T &),
                                         int debug=0) :
-  degree(degree), compare(compare), debug(debug) {
+  degree(degree), compare(compare), numDepth(0), numNodes(0), numKeys(0),
+  lazyRemove(false), redistribute(false), tombstones(0),
+  hasCompactCursor(false), log(NULL), aggregateValue(NULL),
+  aggregateCombine(NULL), aggregateIdentity(0), multiset(false),
+  debug(debug) {
   if (degree<2) {
     cerr << "Degree must be >= 2." << endl;
     raise(SIGABRT);
     return;
   }
-  root=new BTreeNode<T>(degree, true, debug);
+  root=newNode(true);
 }
 
 template<typename T> BTree<T>::~BTree<T>() {
@@ -784,15 +1396,648 @@ template<typename T> void BTree<T>::search(const T &key,
                                            BTreeNode<T> **result,
                                            int *index) {
   *result=NULL;
-  searchBranch(key, result, index, root);
+  searchBranch(key, result, index, root, 0);
+  // Haudattu avain on poistettu.
+  if (tombstones>0 && *result && (*result)->isDead(*index)) *result=NULL;
+}
+
+/* Etsii puusta joukon avaimia.
+   keys = etsittvt avaimet
+   results = results[i] on true, jos avain keys[i] on puussa */
+template<typename T> void BTree<T>::searchBatch(const vector<T> &keys,
+                                                vector<bool> &results) {
+  results.assign(keys.size(), false);
+
+  // node[j] = ern haun j nykyinen solmu
+  // active = keskeneristen hakujen indeksit
+  BTreeNode<T> *node[SEARCH_BATCH];
+  int active[SEARCH_BATCH];
+  for (unsigned int first=0; first<keys.size(); first+=SEARCH_BATCH) {
+    int n=keys.size()-first;
+    if (n>SEARCH_BATCH) n=SEARCH_BATCH;
+    for (int j=0; j<n; j++) {
+      node[j]=root;
+      active[j]=j;
+    }
+
+    for (int depth=0; n>0; depth++) {
+      // Kynnistetn kaikkien hakujen avainten haut ennen kuin yhtkn
+      // avainta verrataan.
+      for (int a=0; a<n; a++) node[active[a]]->prefetch();
+
+      int remaining=0;
+      for (int a=0; a<n; a++) {
+        int j=active[a];
+        BTreeNode<T> *current=node[j];
+        const T &key=keys[first+j];
+        int i=0;
+        while (i<current->numKeys() && compare(key, current->getKey(i))>0)
+          i++;
+        TRACE_EVENT(trace, TRACE_SEARCH_STEP, depth, i+1);
+        if (i<current->numKeys() && compare(key, current->getKey(i))==0) {
+          if (debug==1) cout << "searchBatch(): 1" << endl;
+          results[first+j]=!current->isDead(i);
+          continue;
+        }
+        if (current->isLeaf()) continue;
+
+        // Lapsi esihaetaan jo nyt, jotta se on saapumassa, kun seuraavan
+        // tason avaimia esihaetaan.
+        node[j]=current->getChild(i);
+        __builtin_prefetch(node[j]);
+        active[remaining++]=j;
+      }
+      n=remaining;
+    }
+  }
+}
+
+/* Etsii puusta suurimman avaimen, joka on pienempi tai yht suuri kuin
+   key. Palauttaa false, jos sellaista ei ole.
+   key = etsittv avain
+   result = lydetty avain palautetaan thn */
+template<typename T> bool BTree<T>::floorKey(const T &key, T *result) {
+  if (tombstones>0)
+    return root->numKeys()>0 && floorBranch(root, key, result);
+
+  // Syvemmll reitill lytyv ehdokas on aina suurempi kuin ylempn
+  // lytynyt, joten viimeisin ehdokas on vastaus.
+  bool found=false;
+  BTreeNode<T> *node=root;
+  while (node) {
+    int i=0;
+    while (i<node->numKeys() && compare(node->getKey(i), key)<=0) i++;
+    if (i>0) {
+      *result=node->getKey(i-1);
+      found=true;
+      if (compare(*result, key)==0) return true;
+    }
+    if (node->isLeaf()) break;
+    node=node->getChild(i);
+  }
+  return found;
+}
+
+/* Etsii puusta pienimmn avaimen, joka on suurempi tai yht suuri kuin
+   key. Palauttaa false, jos sellaista ei ole.
+   key = etsittv avain
+   result = lydetty avain palautetaan thn */
+template<typename T> bool BTree<T>::ceilingKey(const T &key, T *result) {
+  if (tombstones>0)
+    return root->numKeys()>0 && ceilingBranch(root, key, result);
+
+  // Syvemmll reitill lytyv ehdokas on aina pienempi kuin ylempn
+  // lytynyt, joten viimeisin ehdokas on vastaus.
+  bool found=false;
+  BTreeNode<T> *node=root;
+  while (node) {
+    int i=0;
+    while (i<node->numKeys() && compare(node->getKey(i), key)<0) i++;
+    if (i<node->numKeys()) {
+      *result=node->getKey(i);
+      found=true;
+      if (compare(*result, key)==0) return true;
+    }
+    if (node->isLeaf()) break;
+    node=node->getChild(i);
+  }
+  return found;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi].
+   lo = vlin alaraja
+   hi = vlin ylraja
+   result = vektori, johon avaimet listn */
+template<typename T> void BTree<T>::range(const T &lo, const T &hi,
+                                          vector<T> &result) {
+  if (root->numKeys()>0) rangeBranch(root, lo, hi, result);
+}
+
+/* Lis tulosvektoriin puun kaikki avaimet nousevassa jrjestyksess.
+   result = vektori, johon avaimet listn */
+template<typename T> void BTree<T>::keys(vector<T> &result) {
+  collectBranch(root, result);
+}
+
+/* Lis puun muistinkytn erittelyyn sissolmuina ("internal d") ja
+   lehtin ("leaf d") syvyyksittin d.
+   usage = erittely, johon listn */
+template<typename T> void BTree<T>::memoryUsage(MemoryUsage &usage) {
+  vector<long long> nodes, live, allocated;
+  memoryBranch(root, 0, nodes, live, allocated);
+  for (unsigned int i=0; i<nodes.size(); i++)
+    if (nodes[i]>0) {
+      stringstream name;
+      name << (i%2 ? "leaf " : "internal ") << i/2;
+      usage.add(name.str(), nodes[i], live[i], allocated[i]);
+    }
 }
 
-/* Tarkistaa, ett puu tytt B-puun mritelmn. */
+/* Palauttaa alipuun korkeuden eli lehtien syvyyden alipuun juuresta. */
+template<typename T> int BTree<T>::branchHeight(BTreeNode<T> *node) {
+  int height=0;
+  for (; !node->isLeaf(); node=node->getFirstChild()) height++;
+  return height;
+}
+
+/* Liitt kaksi alipuuta ja niiden vliin tulevan avaimen yhdeksi
+   alipuuksi. Palauttaa liitetyn alipuun juuren.
+   left, right = alipuut tai NULL, jos alipuu on tyhj
+   leftHeight, rightHeight = alipuiden korkeudet, tyhjll -1
+   key = alipuiden vliin tuleva avain
+   height = liitetyn alipuun korkeus palautetaan thn */
+template<typename T> BTreeNode<T> *BTree<T>::joinBranches(
+  BTreeNode<T> *left, int leftHeight, const T &key, BTreeNode<T> *right,
+  int rightHeight, int *height) {
+  if (leftHeight==rightHeight) {
+    if (left==NULL) {
+      if (debug==1) cout << "joinBranches(): 1" << endl;
+      BTreeNode<T> *leaf=newNode(true);
+      leaf->insert(key, NULL, NULL, 0);
+      *height=0;
+      return leaf;
+    }
+    if (left->numKeys()+right->numKeys()<2*degree-1) {
+      if (debug==1) cout << "joinBranches(): 2" << endl;
+      // Avaimet mahtuvat yhteen solmuun.
+      left->insert(key, NULL, NULL, left->numKeys());
+      right->copy(0, right->numKeys(), left, left->numKeys());
+      delete right;
+      *height=leftHeight;
+      return left;
+    }
+
+    // Alipuista tulee uuden juuren lapset. Avaimia on yhteens ainakin
+    // 2*t-1, joten vajaa lapsi voi lainata sisareltaan.
+    if (debug==1) cout << "joinBranches(): 3" << endl;
+    TRACE_EVENT(trace, TRACE_ROOT_GROW, 0, 1);
+    BTreeNode<T> *parent=newNode(false);
+    parent->insert(key, left, right, 0);
+    while (left->numKeys()<degree-1) rotateRight(parent, 0);
+    while (right->numKeys()<degree-1) rotateLeft(parent, 1);
+    updateAggregate(parent, 0);
+    updateAggregate(parent, 1);
+    *height=leftHeight+1;
+    return parent;
+  }
+
+  if (leftHeight>rightHeight) {
+    if (debug==1) cout << "joinBranches(): 4" << endl;
+    if (left->numKeys()==2*degree-1) {
+      TRACE_EVENT(trace, TRACE_ROOT_GROW, 0, 1);
+      BTreeNode<T> *parent=newNode(false);
+      parent->setChild(left, 0);
+      splitChild(parent, 0, left);
+      left=parent;
+      leftHeight++;
+    }
+
+    // Laskeudutaan oikeaa reunaa oikean alipuun korkeuden ylpuolelle.
+    vector<BTreeNode<T> *> path;
+    BTreeNode<T> *node=left;
+    for (int h=leftHeight; h>rightHeight+1; h--) {
+      BTreeNode<T> *child=node->getLastChild();
+      if (child->numKeys()==2*degree-1) {
+        if (debug==1) cout << "joinBranches(): 5" << endl;
+        splitChild(node, node->numKeys(), child);
+        child=node->getLastChild();
+      }
+      path.push_back(node);
+      node=child;
+    }
+    int index=node->numKeys();
+    node->insert(key, NULL, right, index);
+    if (right!=NULL && right->numKeys()<degree-1) {
+      BTreeNode<T> *sibling=node->getChild(index);
+      if (sibling->numKeys()+right->numKeys()<2*degree-1) {
+        if (debug==1) cout << "joinBranches(): 6" << endl;
+        mergeChildren(node, index);
+      }
+      else {
+        if (debug==1) cout << "joinBranches(): 7" << endl;
+        while (right->numKeys()<degree-1) rotateLeft(node, index+1);
+      }
+    }
+
+    // Reunan solmujen koosteet pivitetn alhaalta yls.
+    if (!node->isLeaf()) updateAggregate(node, node->numKeys());
+    for (int i=path.size()-1; i>=0; i--)
+      updateAggregate(path[i], path[i]->numKeys());
+    *height=leftHeight;
+    return left;
+  }
+
+  if (debug==1) cout << "joinBranches(): 8" << endl;
+  if (right->numKeys()==2*degree-1) {
+    TRACE_EVENT(trace, TRACE_ROOT_GROW, 0, 1);
+    BTreeNode<T> *parent=newNode(false);
+    parent->setChild(right, 0);
+    splitChild(parent, 0, right);
+    right=parent;
+    rightHeight++;
+  }
+
+  // Laskeudutaan vasenta reunaa vasemman alipuun korkeuden ylpuolelle.
+  vector<BTreeNode<T> *> path;
+  BTreeNode<T> *node=right;
+  for (int h=rightHeight; h>leftHeight+1; h--) {
+    BTreeNode<T> *child=node->getFirstChild();
+    if (child->numKeys()==2*degree-1) {
+      if (debug==1) cout << "joinBranches(): 9" << endl;
+      splitChild(node, 0, child);
+      child=node->getFirstChild();
+    }
+    path.push_back(node);
+    node=child;
+  }
+  node->insert(key, left, NULL, 0);
+  if (left!=NULL && left->numKeys()<degree-1) {
+    BTreeNode<T> *sibling=node->getChild(1);
+    if (sibling->numKeys()+left->numKeys()<2*degree-1) {
+      if (debug==1) cout << "joinBranches(): 10" << endl;
+      mergeChildren(node, 0);
+    }
+    else {
+      if (debug==1) cout << "joinBranches(): 11" << endl;
+      while (left->numKeys()<degree-1) rotateRight(node, 0);
+    }
+  }
+  if (!node->isLeaf()) updateAggregate(node, 0);
+  for (int i=path.size()-1; i>=0; i--) updateAggregate(path[i], 0);
+  *height=rightHeight;
+  return right;
+}
+
+/* Jakaa alipuun kahteen alipuuhun, joista vasemmassa ovat avainta key
+   pienemmt ja oikeassa muut avaimet.
+   node = jaettava alipuu
+   height = alipuun korkeus
+   left, right = alipuut palautetaan thn, NULL, jos alipuu on tyhj
+   leftHeight, rightHeight = alipuiden korkeudet palautetaan thn */
+template<typename T> void BTree<T>::splitBranch(BTreeNode<T> *node,
+                                                int height, const T &key,
+                                                BTreeNode<T> **left,
+                                                int *leftHeight,
+                                                BTreeNode<T> **right,
+                                                int *rightHeight) {
+  // i = avainta key pienempien avainten mr
+  int i=0, keys=node->numKeys();
+  while (i<keys && compare(node->getKey(i), key)<0) i++;
+
+  if (node->isLeaf()) {
+    if (debug==1) cout << "splitBranch(): 1" << endl;
+    *left=*right=NULL;
+    *leftHeight=*rightHeight=-1;
+    if (i>0) {
+      *left=newNode(true);
+      node->copy(0, i, *left, 0);
+      *leftHeight=0;
+    }
+    if (i<keys) {
+      *right=newNode(true);
+      node->copy(i, keys-i, *right, 0);
+      *rightHeight=0;
+    }
+    delete node;
+    return;
+  }
+
+  // Lapsen i vasemmalle puolelle jvist avaimista ja lapsista tulee
+  // vasen puolikas ja oikealle puolelle jvist oikea. Puolikas, jossa on
+  // vain yksi lapsi, korvataan lapsellaan.
+  if (debug==1) cout << "splitBranch(): 2" << endl;
+  BTreeNode<T> *child=node->getChild(i), *leftPart=NULL, *rightPart=NULL;
+  int leftPartHeight=height-1, rightPartHeight=height-1;
+  T leftKey, rightKey;
+  if (i>1) {
+    leftPart=newNode(false);
+    node->copy(0, i-1, leftPart, 0);
+    leftPartHeight=height;
+  }
+  else if (i==1) leftPart=node->getChild(0);
+  if (i>0) leftKey=node->getKey(i-1);
+  if (i<keys-1) {
+    rightPart=newNode(false);
+    node->copy(i+1, keys-i-1, rightPart, 0);
+    rightPartHeight=height;
+  }
+  else if (i==keys-1) rightPart=node->getChild(keys);
+  if (i<keys) rightKey=node->getKey(i);
+  delete node;
+
+  splitBranch(child, height-1, key, left, leftHeight, right, rightHeight);
+  if (leftPart!=NULL)
+    *left=joinBranches(leftPart, leftPartHeight, leftKey, *left,
+                       *leftHeight, leftHeight);
+  if (rightPart!=NULL)
+    *right=joinBranches(*right, *rightHeight, rightKey, rightPart,
+                        rightPartHeight, rightHeight);
+}
+
+/* Korvaa puun sislln toisen puun kanssa tehdyn joukko-operaation
+   tuloksella.
+   other = toinen puu, joka ei muutu
+   operation = SET_UNION, SET_INTERSECTION tai SET_DIFFERENCE */
+template<typename T> void BTree<T>::combine(BTree<T> &other, int operation) {
+  if (multiset || other.multiset) {
+    cerr << "Set operations on multisets unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (log) {
+    cerr << "Set operations on logged trees unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  vector<T> a, b, result;
+  collectBranch(root, a);
+  other.collectBranch(other.root, b);
+  mergeKeys(a, b, operation, compare, result);
+  build(result);
+}
+
+/* Korvaa puun sislln annetuilla avaimilla rakentamalla puun alhaalta
+   yls.
+   sorted = nousevassa jrjestyksess olevat, keskenn erisuuret
+            avaimet */
+template<typename T> void BTree<T>::build(const vector<T> &sorted) {
+  // Lokista toistettu puu ei sisltisi rakennettuja avaimia.
+  if (log) {
+    cerr << "build(): Bulk builds of logged trees unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  destroyBranch(root);
+  tombstones=0;
+  hasCompactCursor=false;
+
+  // Lehti tehdn niin vhn kuin mahtuu: L lehteen ja niiden vliin
+  // mahtuu L*(2*t-1)+L-1 avainta. Avaimet jaetaan tasaisesti, jolloin
+  // kussakin lehdess on ainakin t-1 avainta.
+  int n=sorted.size(), count=(n+2*degree)/(2*degree);
+  int base=(n-count+1)/count, extra=(n-count+1)%count, next=0;
+  vector<BTreeNode<T> *> nodes;
+  vector<T> separators;
+  for (int i=0; i<count; i++) {
+    if (debug==1) cout << "build(): 1" << endl;
+    BTreeNode<T> *leaf=newNode(true);
+    int keys=base+(i<extra ? 1 : 0);
+    for (int j=0; j<keys; j++) leaf->setKey(sorted[next++], j);
+    leaf->setNumKeys(keys);
+    nodes.push_back(leaf);
+    if (i<count-1) separators.push_back(sorted[next++]);
+  }
+
+  // Ylemmt tasot: solmut jaetaan tasaisesti mahdollisimman harvoille
+  // issolmuille, joilla on enintn 2*t lasta. Ryhmien vliset avaimet
+  // siirtyvt seuraavalle tasolle.
+  while (nodes.size()>1) {
+    if (debug==1) cout << "build(): 2" << endl;
+    vector<BTreeNode<T> *> parents;
+    vector<T> parentSeparators;
+    count=(nodes.size()+2*degree-1)/(2*degree);
+    base=nodes.size()/count;
+    extra=nodes.size()%count;
+    next=0;
+    for (int i=0; i<count; i++) {
+      BTreeNode<T> *parent=newNode(false);
+      int children=base+(i<extra ? 1 : 0);
+      for (int j=0; j<children; j++) {
+        parent->setChild(nodes[next], j);
+        if (j<children-1) parent->setKey(std::move(separators[next]), j);
+        next++;
+      }
+      parent->setNumKeys(children-1);
+      parents.push_back(parent);
+      if (i<count-1)
+        parentSeparators.push_back(std::move(separators[next-1]));
+    }
+    nodes.swap(parents);
+    separators.swap(parentSeparators);
+  }
+  root=nodes[0];
+  updateBranch(root);
+}
+
+/* Lis puuhun toisen puun avaimet.
+   other = toinen puu, joka ei muutu */
+template<typename T> void BTree<T>::unionWith(BTree<T> &other) {
+  combine(other, SET_UNION);
+}
+
+/* Poistaa puusta avaimet, jotka eivt ole toisessa puussa.
+   other = toinen puu, joka ei muutu */
+template<typename T> void BTree<T>::intersect(BTree<T> &other) {
+  combine(other, SET_INTERSECTION);
+}
+
+/* Poistaa puusta avaimet, jotka ovat toisessa puussa.
+   other = toinen puu, joka ei muutu */
+template<typename T> void BTree<T>::difference(BTree<T> &other) {
+  combine(other, SET_DIFFERENCE);
+}
+
+/* Siirt puun avaimet, jotka ovat suurempia tai yht suuria kuin key,
+   toiseen puuhun.
+   key = jakokohta
+   right = puu, johon suuremmat avaimet siirretn */
+template<typename T> void BTree<T>::split(const T &key, BTree<T> &right) {
+  if (&right==this || right.degree!=degree || multiset) {
+    cerr << "split(): Invalid tree." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Kummankaan puun lokista toistettu puu ei sisltisi siirtoja.
+  if (log || right.log) {
+    cerr << "split(): Logged trees unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  compact(-1);
+  right.destroyBranch(right.root);
+  right.tombstones=0;
+  right.hasCompactCursor=false;
+  right.aggregateValue=aggregateValue;
+  right.aggregateCombine=aggregateCombine;
+  right.aggregateIdentity=aggregateIdentity;
+
+  BTreeNode<T> *left;
+  int leftHeight, rightHeight;
+  splitBranch(root, branchHeight(root), key, &left, &leftHeight,
+              &right.root, &rightHeight);
+  root=left ? left : newNode(true);
+  if (!right.root) right.root=newNode(true);
+}
+
+/* Siirt toisen puun kaikki avaimet tmn puun loppuun.
+   right = liitettv puu */
+template<typename T> void BTree<T>::join(BTree<T> &right) {
+  if (&right==this || right.degree!=degree ||
+      right.aggregateValue!=aggregateValue ||
+      right.aggregateCombine!=aggregateCombine || multiset ||
+      right.multiset) {
+    cerr << "join(): Invalid tree." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (log || right.log) {
+    cerr << "join(): Logged trees unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  compact(-1);
+  right.compact(-1);
+  if (right.root->numKeys()==0) return;
+
+  // Oikean puun pienin avain poistetaan ja siit tulee puiden vlinen
+  // avain.
+  BTreeNode<T> *node=right.root;
+  while (!node->isLeaf()) node=node->getFirstChild();
+  T key=node->getFirstKey();
+  if (root->numKeys()>0) {
+    node=root;
+    while (!node->isLeaf()) node=node->getLastChild();
+    if (compare(node->getLastKey(), key)>=0) {
+      cerr << "join(): Keys of the trees overlap." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+  right.removeBranch(key, right.root);
+
+  BTreeNode<T> *left=root, *other=right.root;
+  int leftHeight=branchHeight(left), rightHeight=branchHeight(other);
+  if (left->numKeys()==0) {
+    delete left;
+    left=NULL;
+    leftHeight=-1;
+  }
+  if (other->numKeys()==0) {
+    delete other;
+    other=NULL;
+    rightHeight=-1;
+  }
+  root=joinBranches(left, leftHeight, key, other, rightHeight, &leftHeight);
+  right.root=newNode(true);
+}
+
+/* Ottaa kyttn alipuiden koosteet.
+   value = avaimen arvo koosteessa
+   combine = liitnninen ja vaihdannainen yhdistmisfunktio
+   identity = yhdistmisen neutraalialkio */
+template<typename T> void BTree<T>::setAggregate(
+  double (*value)(const T &), double (*combine)(double, double),
+  double identity) {
+  if (value && multiset) {
+    cerr << "Aggregates of multisets unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  aggregateValue=value;
+  aggregateCombine=combine;
+  aggregateIdentity=identity;
+  updateBranch(root);
+}
+
+/* Palauttaa puun avainten mrn, jotka ovat pienempi kuin key. */
+template<typename T> long long BTree<T>::rank(const T &key) {
+  if (!aggregateValue) {
+    cerr << "rank(): Aggregates not enabled." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  return rankBranch(root, key, false);
+}
+
+/* Etsii avaimen, jota pienempi avaimia puussa on index kappaletta.
+   result = lydetty avain palautetaan thn */
+template<typename T> bool BTree<T>::select(long long index, T *result) {
+  if (!aggregateValue) {
+    cerr << "select(): Aggregates not enabled." << endl;
+    raise(SIGABRT);
+    return false;
+  }
+  if (index<0) return false;
+
+  // Ohitetaan lapset, joiden alipuissa on vhemmn avaimia kuin index, ja
+  // niiden vliset elvt avaimet.
+  BTreeNode<T> *node=root;
+  while (!node->isLeaf()) {
+    int i=0;
+    for (; i<node->numKeys(); i++) {
+      if (index<node->getCount(i)) break;
+      index-=node->getCount(i);
+      if (!node->isDead(i)) {
+        if (index==0) {
+          *result=node->getKey(i);
+          return true;
+        }
+        index--;
+      }
+    }
+    if (i==node->numKeys() && index>=node->getCount(i)) return false;
+    node=node->getChild(i);
+  }
+  for (int i=0; i<node->numKeys(); i++)
+    if (!node->isDead(i)) {
+      if (index==0) {
+        *result=node->getKey(i);
+        return true;
+      }
+      index--;
+    }
+  return false;
+}
+
+/* Palauttaa vlill [lo, hi] olevien avainten mrn. */
+template<typename T> long long BTree<T>::countInRange(const T &lo,
+                                                      const T &hi) {
+  if (!aggregateValue) {
+    cerr << "countInRange(): Aggregates not enabled." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  if (compare(lo, hi)>0) return 0;
+  return rankBranch(root, hi, true)-rankBranch(root, lo, false);
+}
+
+/* Palauttaa vlill [lo, hi] olevien avainten arvojen koosteen. */
+template<typename T> double BTree<T>::aggregateRange(const T &lo,
+                                                     const T &hi) {
+  if (!aggregateValue) {
+    cerr << "aggregateRange(): Aggregates not enabled." << endl;
+    raise(SIGABRT);
+    return 0;
+  }
+  if (compare(lo, hi)>0) return aggregateIdentity;
+  return aggregateBranch(root, &lo, &hi);
+}
+
+/* Luo puun avaimista muuttumattoman hakurakenteen, jossa haut ovat
+   nopeampia kuin puussa. Palautettu rakenne on tuhottava
+   delete-operaattorilla, eik puun myhemmt muutokset ny siin. */
+template<typename T> FrozenBTree<T> *BTree<T>::freeze() {
+  vector<T> keys;
+  collectBranch(root, keys);
+  return new FrozenBTree<T>(keys, compare);
+}
+
+/* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt
+   tsmlleen annetut avaimet. Tarkistus on lineaarinen, jos avaimet
+   annetaan nousevassa jrjestyksess.
+   keys = avaimet, jotka pitisi olla puussa */
 template<typename T> void BTree<T>::validate(const vector<T> &keys) {
-  vector<bool> checked(keys.size(), false);
+  vector<T> found;
+  found.reserve(keys.size()+tombstones);
+  int dead=0, leafDepth=-1;
 
   numDepth=numNodes=numKeys=0;
-  validateBranch(root, 0, keys, checked);
+  validateBranch(root, 0, found, &dead, &leafDepth);
 
   if (root->numKeys()<1 && numDepth>0) {
     cerr << "VALIDATE: Not enough keys in the root." << endl;
@@ -805,13 +2050,37 @@ template<typename T> void BTree<T>::validate(const vector<T> &keys) {
     return;
   }
 
-  // Tarkistaa, ett kaikki avaimet on merkitty ja nin ollen puussa.
-  for (unsigned int i=0; i<checked.size(); i++)
-    if (checked[i]==false) {
-      cerr << "VALIDATE: Missing key." << endl;
+  if (dead!=tombstones) {
+    cerr << "VALIDATE: Wrong number of tombstones." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (aggregateValue) {
+    long long count;
+    double total;
+    validateAggregates(root, &count, &total);
+    if (count!=(long long)found.size()-dead) {
+      cerr << "VALIDATE: Wrong aggregate count." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+  if (tombstones==0) {
+    validateKeys(found, keys, compare);
+    return;
+  }
+
+  // Haudatut avaimet ovat puussa muiden joukossa, joten jrjestys
+  // tarkistetaan kaikista avaimista ennen kuin haudatut poistetaan.
+  for (unsigned int i=1; i<found.size(); i++)
+    if (compare(found[i-1], found[i])>=0) {
+      cerr << "VALIDATE: Keys not in order." << endl;
       raise(SIGABRT);
       return;
     }
+  vector<T> live;
+  collectBranch(root, live);
+  validateKeys(live, keys, compare);
 }
 
 /* Tarkistaa, ett puu tytt B-puun mritelmn ja tulostaa
@@ -819,26 +2088,44 @@ template<typename T> void BTree<T>::validate(const vector<T> &keys) {
 template<typename T> void BTree<T>::printValidate(const vector<T> &keys) {
   validate(keys);
   cout << "VALIDATE: numDepth=" << numDepth << ", numNodes=" << numNodes
-       << ", numKeys=" << numKeys << endl;;
+       << ", numKeys=" << numKeys << ", fill=" << getFillFactor() << endl;
 }
 
 /* Lis avaimen puuhun.
-   key = listtva avain */
+   key = listtva avain, joka siirretn lehteen */
 template<typename T> void BTree<T>::insert(T key) {
   BTreeNode<T> *result=NULL;
   int index;
-  search(key, &result, &index);
-  if (result!=NULL) {
+  searchBranch(key, &result, &index, root, 0);
+  if (result!=NULL && !result->isDead(index) && !multiset) {
     cerr << "Insertion of multiple same keys unsupported." << endl;
     raise(SIGABRT);
     return;
   }
 
+  if (log) log->append(WAL_INSERT, &key);
+
+  if (result!=NULL && !result->isDead(index)) {
+    // Monijoukon avaimen uusi kappale vain lasketaan.
+    result->setCopies(index, result->getCopies(index)+1);
+    return;
+  }
+
+  if (result!=NULL) {
+    // Haudattu avain hertetn henkiin paikallaan ilman rakennemuutoksia.
+    result->setKey(key, index);
+    result->setDead(index, false);
+    tombstones--;
+    updatePath(key, 0);
+    return;
+  }
+
   if (root->numKeys()==2*degree-1) {
     if (debug==1) cout << "insert(): 1" << endl;
     // Juuri on tynn; luodaan uusi juuri.
+    TRACE_EVENT(trace, TRACE_ROOT_GROW, 0, 1);
     BTreeNode<T> *left=root;
-    root=new BTreeNode<T>(degree, false, debug);
+    root=newNode(false);
     // Asetetaan vanha juuri uuden juuren lapseksi.
     root->setChild(left, 0);
     // Tasapainotetaan puu ja listn avain oikeaan kohtaan.
@@ -851,8 +2138,307 @@ template<typename T> void BTree<T>::insert(T key) {
   }
 }
 
+/* Luo avaimen argumenteista ja lis sen puuhun. */
+template<typename T> template<typename... Args>
+void BTree<T>::emplace(Args &&...args) {
+  insert(T(std::forward<Args>(args)...));
+}
+
 /* Poistaa avaimen puusta.
    key = poistettava avain */
 template<typename T> void BTree<T>::remove(const T &key) {
+  if (log) log->append(WAL_REMOVE, &key);
+
+  if (lazyRemove || tombstones>0 || multiset) {
+    BTreeNode<T> *result=NULL;
+    int index;
+    searchBranch(key, &result, &index, root, 0);
+    if (result==NULL) return;
+    if (!result->isDead(index) && result->getCopies(index)>1) {
+      // Monijoukon avaimesta poistuu yksi kappale, eik puu muutu.
+      result->setCopies(index, result->getCopies(index)-1);
+      return;
+    }
+    if (lazyRemove) {
+      if (!result->isDead(index)) {
+        result->setDead(index, true);
+        tombstones++;
+        updatePath(key, 0);
+      }
+      return;
+    }
+    if (result->isDead(index)) tombstones--;
+  }
   removeBranch(key, root);
 }
+
+/* Valitsee poistotavan. Palattaessa vlittmn poistoon kaikki
+   haudatut avaimet poistetaan.
+   lazy = true=laiska poisto, false=vlitn poisto (oletus) */
+template<typename T> void BTree<T>::setLazyRemove(bool lazy) {
+  lazyRemove=lazy;
+  if (!lazy) compact(-1);
+}
+
+/* Valitsee, tallennetaanko puuhun joukko vai monijoukko.
+   multiset = true=monijoukko, false=joukko */
+template<typename T> void BTree<T>::setMultiset(bool multiset) {
+  if (root->numKeys()>0 || (multiset && aggregateValue)) {
+    cerr << "setMultiset(): The tree must be empty and without aggregates."
+         << endl;
+    raise(SIGABRT);
+    return;
+  }
+  this->multiset=multiset;
+  delete root;
+  root=newNode(true);
+}
+
+/* Palauttaa avaimen kappalemrn puussa. */
+template<typename T> int BTree<T>::count(const T &key) {
+  BTreeNode<T> *result;
+  int index;
+  search(key, &result, &index);
+  return result ? result->getCopies(index) : 0;
+}
+
+/* Palauttaa haudattujen avainten mrn. */
+template<typename T> int BTree<T>::numTombstones() const {
+  return tombstones;
+}
+
+/* Valitsee tyden solmun ksittelyn lisyksess.
+   redistribute = true=B*-puun tasaus ja kolmeen jako, false=puolitus */
+template<typename T> void BTree<T>::setRedistribute(bool redistribute) {
+  this->redistribute=redistribute;
+}
+
+/* Palauttaa edellisen tarkistuksen laskeman puun syvyyden. */
+template<typename T> int BTree<T>::getDepth() const {
+  return numDepth;
+}
+
+/* Palauttaa edellisen tarkistuksen laskeman tyttasteen. */
+template<typename T> double BTree<T>::getFillFactor() const {
+  return numNodes>0 ? numKeys/(double(numNodes)*(2*degree-1)) : 0;
+}
+
+/* Poistaa haudattuja avaimia vlittmn poiston tavoin ja tasapainottaa
+   puun. Tiivistys jatkuu siit avaimesta, johon edellinen kutsu ji.
+   Palauttaa poistettujen avainten mrn.
+   budget = poistettavien avainten enimmismr, <0=kaikki */
+template<typename T> int BTree<T>::compact(int budget) {
+  if (tombstones==0 || budget==0) return 0;
+  if (budget<0 || budget>tombstones) budget=tombstones;
+
+  // Kertn ensin poistettavat avaimet, koska poistot muuttavat puuta.
+  // Jos kohdistimen jlkeen ei lydy tarpeeksi, jatketaan puun alusta
+  // kohdistimeen asti.
+  vector<T> purge;
+  deadBranch(root, compactCursor, !hasCompactCursor, budget, purge);
+  if ((int)purge.size()<budget && hasCompactCursor) {
+    vector<T> wrapped;
+    deadBranch(root, compactCursor, true, budget-purge.size(), wrapped);
+    for (unsigned int i=0; i<wrapped.size() &&
+           compare(wrapped[i], compactCursor)<0; i++)
+      purge.push_back(wrapped[i]);
+  }
+
+  for (unsigned int i=0; i<purge.size(); i++) {
+    removeBranch(purge[i], root);
+    tombstones--;
+  }
+  if (!purge.empty()) {
+    compactCursor=purge.back();
+    hasCompactCursor=true;
+  }
+  if (tombstones==0) hasCompactCursor=false;
+  return purge.size();
+}
+
+/* Tallentaa puun vedokseksi, jossa solmut ovat leveyssuuntaisessa
+   jrjestyksess ja osoittimien sijaan lasten sijainnit tiedostossa.
+   Avaintyypin on oltava bitti bitilt kopioitava.
+   fileName = vedostiedosto */
+template<typename T> void BTree<T>::save(const char *fileName) {
+  if (multiset) {
+    cerr << "Snapshots of multisets unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Vedos kirjoitetaan ensin vliaikaistiedostoon, jotta kesken jnyt
+  // tallennus ei korvaa edellist vedosta.
+  string tempName=string(fileName)+".tmp";
+  ofstream ofs(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!ofs) {
+    cerr << "Could not open snapshot file '" << tempName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Vedoksessa ei ole hautausmerkintj, joten haudatut avaimet
+  // poistetaan ensin.
+  compact(-1);
+
+  BTreeSnapshotHeader header;
+  header.magic=BTREE_SNAPSHOT_MAGIC;
+  header.keySize=sizeof(T);
+  header.degree=degree;
+  header.numNodes=0;
+  header.numKeys=0;
+  header.root=sizeof(header);
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  // Solmun sijainti tiedostossa tiedetn jo, kun solmu listn jonoon,
+  // joten lapsen sijainti voidaan kirjoittaa issolmuun ennen lasta.
+  queue<BTreeNode<T> *> nodes;
+  long long next=header.root+snapshotNodeSize(root->numKeys(),
+                                              root->isLeaf(), sizeof(T));
+  nodes.push(root);
+  vector<char> record;
+  while (!nodes.empty()) {
+    BTreeNode<T> *node=nodes.front();
+    nodes.pop();
+
+    int keys=node->numKeys(), leaf=node->isLeaf() ? 1 : 0;
+    record.assign(snapshotNodeSize(keys, leaf, sizeof(T)), 0);
+    char *p=&record[0];
+    memcpy(p, &keys, sizeof(int));
+    memcpy(p+sizeof(int), &leaf, sizeof(int));
+    for (int i=0; i<keys; i++) {
+      T key=node->getKey(i);
+      memcpy(p+2*sizeof(int)+i*sizeof(T), &key, sizeof(T));
+    }
+    if (!leaf) {
+      char *child=p+snapshotNodeSize(keys, true, sizeof(T));
+      for (int i=0; i<node->numChildren(); i++) {
+        BTreeNode<T> *c=node->getChild(i);
+        memcpy(child+i*sizeof(long long), &next, sizeof(long long));
+        next+=snapshotNodeSize(c->numKeys(), c->isLeaf(), sizeof(T));
+        nodes.push(c);
+      }
+    }
+    ofs.write(p, record.size());
+    header.numNodes++;
+    header.numKeys+=keys;
+  }
+
+  // Pivitetn otsakkeeseen lopulliset lukumrt.
+  ofs.seekp(0);
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  ofs.close();
+  if (!ofs) {
+    cerr << "Could not write snapshot file '" << tempName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  replaceFileDurably(tempName.c_str(), fileName);
+}
+
+/* Liitt save()-metodilla tallennetun vedoksen muistiin vain luettavaksi.
+   Palautettu vedos on tuhottava delete-operaattorilla.
+   fileName = vedostiedosto
+   compare = metodi avainten vertailemiseksi */
+template<typename T> BTreeSnapshot<T> *BTree<T>::openReadOnly(
+  const char *fileName, int (*const compare)(const T &, const T &)) {
+  return new BTreeSnapshot<T>(fileName, compare);
+}
+
+/* Luo vedoksen solmua vastaavan alipuun.
+   snapshot = vedos
+   node = solmun sijainti vedoksessa */
+template<typename T> BTreeNode<T> *BTree<T>::loadBranch(
+  const BTreeSnapshot<T> *snapshot, long long node) {
+  bool leaf=snapshot->isLeaf(node);
+  BTreeNode<T> *branch=newNode(leaf);
+  const T *keys=snapshot->keys(node);
+  branch->setNumKeys(snapshot->numKeys(node));
+  for (int i=0; i<branch->numKeys(); i++) branch->setKey(keys[i], i);
+  if (!leaf)
+    for (int i=0; i<branch->numChildren(); i++)
+      branch->setChild(loadBranch(snapshot, snapshot->getChild(node, i)), i);
+  return branch;
+}
+
+/* Korvaa puun sislln save()-metodilla tallennetulla vedoksella. Vedoksen
+   asteen on oltava sama kuin puun.
+   fileName = vedostiedosto */
+template<typename T> void BTree<T>::load(const char *fileName) {
+  BTreeSnapshot<T> snapshot(fileName, compare);
+  if (snapshot.getDegree()!=degree) {
+    cerr << "Snapshot degree does not match." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Vedoksen solmut ovat valmiiksi B-puun mritelmn mukaisia, joten ne
+  // kopioidaan sellaisenaan.
+  destroyBranch(root);
+  root=loadBranch(&snapshot, snapshot.getRoot());
+  updateBranch(root);
+  tombstones=0;
+  hasCompactCursor=false;
+}
+
+/* Asettaa lokin, johon lisykset ja poistot kirjoitetaan ennen niiden
+   tekemist. Puu ei omista lokia.
+   log = loki tai NULL, jos lokia ei kytet */
+template<typename T> void BTree<T>::setLog(WriteAheadLog *log) {
+  this->log=log;
+}
+
+/* Palauttaa puun lokin tai NULL, jos lokia ei kytet. */
+template<typename T> WriteAheadLog *BTree<T>::getLog() {
+  return log;
+}
+
+/* Tallentaa puun vedokseksi ja tyhjent lokin, kun vedos on levyll.
+   fileName = vedostiedosto */
+template<typename T> void BTree<T>::checkpoint(const char *fileName) {
+  // save() palaa vasta, kun uusi vedos on kestvsti levyll, joten loki
+  // voidaan tyhjent vasta sen jlkeen; kaatuminen ennen tt jtt
+  // vanhan vedoksen ja lokin, jonka voi toistaa sen plle.
+  if (log) log->commit();
+  save(fileName);
+  if (log) log->truncate();
+}
+
+/* Palauttaa puun viimeisimpn kestvn tilaansa lataamalla vedoksen ja
+   toistamalla sen plle lokin tietueet.
+   snapshotFile = vedostiedosto tai NULL, jos vedosta ei ole
+   logFile = lokitiedosto */
+template<typename T> void BTree<T>::recover(const char *snapshotFile,
+                                            const char *logFile) {
+  // Toistettuja operaatioita ei kirjoiteta uudelleen lokiin.
+  WriteAheadLog *oldLog=log;
+  log=NULL;
+
+  if (snapshotFile) load(snapshotFile);
+  else {
+    destroyBranch(root);
+    root=newNode(true);
+  }
+
+  // Vedos voi sislt jo osan lokin muutoksista, joten toisto tehdn
+  // niin, ett sama tietue voidaan toistaa useasti.
+  WriteAheadLogReader reader(logFile, sizeof(T));
+  char op;
+  T key;
+  while (reader.next(&op, &key)) {
+    BTreeNode<T> *result=NULL;
+    int index;
+    search(key, &result, &index);
+    if (op==WAL_INSERT && result==NULL) insert(key);
+    else if (op==WAL_REMOVE && result!=NULL) remove(key);
+  }
+
+  log=oldLog;
+}
+
+#ifdef STRUCTURE_TRACE
+/* Palauttaa puun tapahtumalaskurit. Hakujen askeleet ovat avainten
+   vertailuja syvyyksittin. */
+template<typename T> StructureTrace &BTree<T>::getTrace() {
+  return trace;
+}
+#endif
@@ -15,19 +15,56 @@ L
 #define BTREE_H
 
 #include <iostream>
+#include <utility>
 #include <vector>
+#include "snapshot.h"
+#include "frozenbtree.h"
+#include "wal.h"
+#include "memory.h"
+#include "trace.h"
+#include "validate.h"
+#include "setalgebra.h"
+
+/* Samanaikaisesti etenevien hakujen enimmismr searchBatch()-metodissa.
+   Suurempi er ei nopeuta, koska esihaetut solmut alkavat poistua
+   vlimuistista ennen kuin niit ehditn kytt. */
+#define SEARCH_BATCH 32
 
 /* B-puun solmun toteuttava luokka, joka sislt avaimet ja osoittimet
-   lapsisolmuihin sek metodit solmujen ksittelyyn. */
+   lapsisolmuihin sek metodit solmujen ksittelyyn. Avaintaulukko varataan
+   alustamattomana, ja avain luodaan paikkaansa vasta, kun paikkaan
+   asetetaan ensimmisen kerran avain, joten kyttmttmi paikkoja ei
+   alusteta oletuskonstruktorilla. Avaimet siirretn paikasta toiseen
+   siirtosijoituksella, ja bitti bitilt kopioitavat avaimet koko alueena
+   memmove()-kutsulla. */
 template<typename T> class BTreeNode {
   T *key;
+  bool *dead;
+  int *copies;
   const int degree;
   int keys;
+  int constructed;
   bool leaf;
   BTreeNode<T> **child;
+  long long *childCount;
+  double *childTotal;
   const int maxKeys, maxChildren;
   const int debug;
 
+  /* Siirt avaimet hautausmerkintineen ja kappalemrineen solmusta
+     toiseen tai saman solmun sisll; alueet saavat olla pllekkin.
+     Lhdepaikkoihin j siirrettyj avaimia, jotka on korvattava tai
+     poistettava.
+     fromIndex = ensimminen siirrettv avain
+     count = siirrettvien avainten mr
+     toNode = kohdesolmu; kohdealue ei saa alkaa luotujen avainten jlkeen
+     toIndex = kohdesolmun indeksi, johon siirretn */
+  void moveKeys(int fromIndex, int count, BTreeNode<T> *toNode, int toIndex);
+
+  /* Siirt lapsiosoittimet koosteineen kuten moveKeys(). */
+  void moveChildren(int fromIndex, int count, BTreeNode<T> *toNode,
+                    int toIndex);
+
 public:
   BTreeNode<T>(int degree, bool leaf, int debug);
   ~BTreeNode<T>();
@@ -41,27 +78,88 @@ public:
   /* Palautaan arvon true, jos solmu on lehti. */
   bool isLeaf() const;
 
+  /* Palauttaa solmun ja sen taulukoiden varaamat tavut. */
+  long long allocatedBytes() const;
+
+  /* Esihakee solmun kytss olevat avaimet ja lapsiosoittimet
+     vlimuistiin. Solmu itse on esihaettava ennen kutsua, jottei kutsu
+     odota sit. */
+  void prefetch() const;
+
+  /* Palauttaa kytss olevien avainten ja lapsiosoittimien tavut. */
+  long long liveBytes() const;
+
   /* Palauttaa avaimen kohdasta index. */
-  T getKey(int index) const;
+  const T &getKey(int index) const;
 
   /* Palauttaa lapsiosoittimen kohdasta index tai NULL, jos solmulla ei ole
      lapsia. */
   BTreeNode<T> *getChild(int index) const;
 
-  /* Asettaa avaimelle uuden arvon. */
-  void setKey(T newKey, int index);
+  /* Palauttaa avaimettoman sissolmun ainoan lapsen. Yhdistminen voi
+     jtt sissolmun hetkeksi ilman avaimia, jolloin getChild() ei
+     laske sille lapsia. */
+  BTreeNode<T> *getOnlyChild() const;
+
+  /* Asettaa avaimelle uuden arvon. Paikkaan, jossa ei ole viel ollut
+     avainta, avain luodaan; sit ennen paikkaa edeltviss paikoissa on
+     oltava avain. */
+  void setKey(const T &newKey, int index);
+
+  /* Siirt uuden avaimen paikalleen kuten setKey(). */
+  void setKey(T &&newKey, int index);
+
+  /* Palauttaa arvon true, jos avain kohdassa index on haudattu eli
+     poistettu laiskasti. */
+  bool isDead(int index) const;
+
+  /* Merkitsee avaimen haudatuksi tai elvksi. Avainten siirrot solmun
+     sisll ja solmusta toiseen (shift, insert, remove ja copy) siirtvt
+     merkinnn avaimen mukana; insert lis avaimen elvn. */
+  void setDead(int index, bool isDead);
+
+  /* Varaa solmulle avainten lukumrt monijoukkoa varten. Lukumr
+     siirtyy avaimen mukana kuten hautausmerkint; insert lis avaimen
+     yhten kappaleena. */
+  void enableCopies();
+
+  /* Palauttaa avaimen kohdasta index kappalemrn tai 1, jos solmulla ei
+     ole lukumri. */
+  int getCopies(int index) const;
+
+  /* Asettaa avaimen kappalemrn. Ei tee mitn, jos solmulla ei ole
+     lukumri. */
+  void setCopies(int index, int newCopies);
 
   /* Asettaa uuden lapsiosoittimen. */
   void setChild(BTreeNode<T> *newChild, int index);
 
-  /* Asettaa avainten lukumrn. */
+  /* Varaa sissolmulle lasten koosteet. Koosteet siirtyvt lapsiosoittimien
+     mukana (shift, insert, remove ja copy), mutta niiden arvoista huolehtii
+     puu. */
+  void enableAggregates();
+
+  /* Palauttaa true, jos solmulla on lasten koosteet. */
+  bool hasAggregates() const;
+
+  /* Palauttaa lapsen kohdasta index alipuun elvien avainten mrn. */
+  long long getCount(int index) const;
+
+  /* Palauttaa lapsen kohdasta index alipuun elvien avainten koosteen. */
+  double getTotal(int index) const;
+
+  /* Asettaa lapsen alipuun avainten mrn ja koosteen. */
+  void setAggregate(int index, long long newCount, double newTotal);
+
+  /* Asettaa avainten lukumrn. Kytst poistuvien paikkojen avaimet
+     tuhotaan. */
   void setNumKeys(int newNumKeys);
 
   /* Palauttaa solmun ensimmisen (pienimmn) avaimen. */
-  T getFirstKey() const;
+  const T &getFirstKey() const;
 
   /* Palauttaa solmun viimeisen (suurimman) avaimen. */
-  T getLastKey() const;
+  const T &getLastKey() const;
 
   /* Palauttaa solmun ensimmisen lapsen. */
   BTreeNode<T> *getFirstChild() const;
@@ -78,7 +176,8 @@ public:
   /* Lis avaimen sek sen vasemman- ja oikeanpuoleiset lapsiosoittimet
      solmuun. Tarvittaessa siirt avaimia ja lapsiosoittimia yhdell
      eteenpin sek pivitt avainten lukumrn.
-     newKey = uusi avain
+     newKey = uusi avain; parametri on arvo, jotta solmun oma avain voidaan
+              list, ja se siirretn paikalleen
      leftChild = vasemmanpuoleinen lapsiosoitin; jos NULL ei muuta nykyist
                  osoitinta
      rightChild = oikeanpuoleinen lapsiosoitin: jos NULL ei muuta nykyist
@@ -88,7 +187,8 @@ public:
               int index);
 
   /* Poistaa avaimen ja mahdolliset lapsiosoittimen ja pivitt avainten
-     lukumrn. Kumpaakin avainta ei voi poistaa yhtaikaa.
+     lukumrn. Kumpaakin avainta ei voi poistaa yhtaikaa. Poistettu avain
+     siirretn paluuarvoon.
      keyIndex = avaimen indeksi
      leftChild = jos true, poistaa vasemmanpuolisen lapsiosoittimen
      rightChild = jos true, poistaa oikeanpuoleisen lapsiosoittimen */
@@ -96,7 +196,8 @@ public:
 
   /* Kopioi avaimet ja lapsiosoittimet solmusta toiseen. Pivitt kohdesolmun
      avainten lukumrn, jos viimeinen kopioitava indeksi ylitt solmun
-     viimeisen kytetyn indeksin.
+     viimeisen kytetyn indeksin. Avaimet siirretn, joten lhdesolmun
+     kopioidut avaimet on poistettava tai korvattava.
      fromIndex = lhdeindeksi, josta kopioidaan
      count = kopioitavien indeksien mr
      toNode = kohdesolmu
@@ -117,9 +218,59 @@ template<typename T> class BTree {
   BTreeNode<T> *root;
   int (*const compare)(const T &, const T &);
   int numDepth, numNodes, numKeys;
+  bool lazyRemove;
+  bool redistribute;
+  int tombstones;
+  T compactCursor;
+  bool hasCompactCursor;
+  WriteAheadLog *log;
+  double (*aggregateValue)(const T &);
+  double (*aggregateCombine)(double, double);
+  double aggregateIdentity;
+  bool multiset;
   const int debug;
+#ifdef STRUCTURE_TRACE
+  StructureTrace trace;
+#endif
 
 protected:
+  /* Luo solmun, jolla on lasten koosteet ja avainten lukumrt, jos ne
+     ovat puussa kytss. */
+  BTreeNode<T> *newNode(bool leaf);
+
+  /* Laskee lapsen kohdasta index alipuun avainten mrn ja koosteen
+     lapsen avaimista ja sen lasten koosteista ja tallentaa ne issolmuun.
+     Ei tee mitn, jos koosteet eivt ole kytss. */
+  void updateAggregate(BTreeNode<T> *parent, int index);
+
+  /* Laskee alipuun kaikkien solmujen koosteet alhaalta yls. */
+  void updateBranch(BTreeNode<T> *node);
+
+  /* Pivitt koosteet avaimen hakupolulla alhaalta yls, kun avain
+     haudataan tai poistetaan. Poistossa lehdest poistuu edeltj- tai
+     seuraaja-avain, jonka polku jatkuu avaimen solmusta sen vasempaan tai
+     oikeaan alipuuhun.
+     side = 0=polku pttyy avaimen sisltvn solmuun tai lehteen,
+            -1 tai 1=avaimen kohdalla jatketaan sen vasempaan tai oikeaan
+            alipuuhun lehteen asti */
+  void updatePath(const T &key, int side);
+
+  /* Palauttaa alipuun elvien avainten mrn, jotka ovat pienempi kuin
+     key tai, jos inclusive on true, pienempi tai yht suuria. */
+  long long rankBranch(BTreeNode<T> *node, const T &key, bool inclusive);
+
+  /* Yhdist alipuun elvien avainten koosteen vlilt [lo, hi]. Alipuun
+     kokonaan vlille osuvien lasten koosteet otetaan issolmusta, joten
+     vain vlin reunoille johtavat polut kydn lpi.
+     lo, hi = vlin rajat tai NULL, jos alipuun avaimet ovat varmasti
+              rajan sispuolella */
+  double aggregateBranch(BTreeNode<T> *node, const T *lo, const T *hi);
+
+  /* Tarkistaa alipuun koosteet ja palauttaa alipuun elvien avainten
+     mrn ja koosteen. */
+  void validateAggregates(BTreeNode<T> *node, long long *count,
+                          double *total);
+
   /* Tuhoaa alipuun.
      branch = tuhottava alipuu */
   void destroyBranch(BTreeNode<T> *branch);
@@ -139,16 +290,60 @@ protected:
      result = solmu, jossa lydetty avain on tai NULL, jos avainta ei
               lytynyt
      index = lydetyn avaimen indeksi
-     node = alipuu, josta avainta etsitn */
+     node = alipuu, josta avainta etsitn
+     depth = alipuun juuren syvyys */
   void searchBranch(const T &key, BTreeNode<T> **result, int *index,
-                    BTreeNode<T> *node);
+                    BTreeNode<T> *node, int depth);
+
+  /* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+     jrjestyksess.
+     node = alipuu, josta avaimia etsitn */
+  void rangeBranch(BTreeNode<T> *node, const T &lo, const T &hi,
+                   std::vector<T> &result);
+
+  /* Ker alipuun avaimet nousevassa jrjestyksess.
+     node = alipuu, jonka avaimet kertn */
+  void collectBranch(BTreeNode<T> *node, std::vector<T> &keys);
+
+  /* Etsii alipuusta pienimmn elvn avaimen, joka on suurempi tai yht
+     suuri kuin key, ohittaen haudatut avaimet. Palauttaa false, jos
+     sellaista ei ole.
+     node = alipuu, josta avainta etsitn */
+  bool ceilingBranch(BTreeNode<T> *node, const T &key, T *result);
 
-  /* Tarkistaa, ett puu tytt B-puun mritelmn.
+  /* Etsii alipuusta suurimman elvn avaimen, joka on pienempi tai yht
+     suuri kuin key, ohittaen haudatut avaimet. Palauttaa false, jos
+     sellaista ei ole.
+     node = alipuu, josta avainta etsitn */
+  bool floorBranch(BTreeNode<T> *node, const T &key, T *result);
+
+  /* Ker alipuusta haudattuja avaimia nousevassa jrjestyksess, kunnes
+     tulosvektorissa on budget avainta.
+     node = alipuu, josta avaimia etsitn
+     from = pienin kerttv avain
+     all = true=kertn alusta alkaen from-avaimesta vlittmtt */
+  void deadBranch(BTreeNode<T> *node, const T &from, bool all,
+                  unsigned int budget, std::vector<T> &result);
+
+  /* Laskee alipuun muistinkytn syvyyksittin.
+     node = alipuu
+     depth = alipuun juuren syvyys
+     nodes, live, allocated = sissolmujen (indeksi 2*depth) ja lehtien
+                              (2*depth+1) summat */
+  void memoryBranch(BTreeNode<T> *node, int depth,
+                    std::vector<long long> &nodes,
+                    std::vector<long long> &live,
+                    std::vector<long long> &allocated);
+
+  /* Tarkistaa alipuun solmujen avainten ja lasten mrt sek lehtien
+     syvyyden ja ker alipuun avaimet sisjrjestyksess.
      node = tarkistettava alipuu
-     depth = rekursiivisesti laskettava puun korkeus */
-  void validateBranch(BTreeNode<T> *node, int depth,
-                      const std::vector<T> &keys,
-                      std::vector<bool> &checked);
+     depth = alipuun juuren syvyys
+     found = vektori, johon avaimet listn
+     dead = haudattujen avainten mr listn thn
+     leafDepth = lehtien syvyys tai -1, jos lehte ei ole viel lydetty */
+  void validateBranch(BTreeNode<T> *node, int depth, std::vector<T> &found,
+                      int *dead, int *leafDepth);
 
   /* Jakaa solmun kahteen solmuun, jotta uusi avain voidaan list. [1]
      parent = issolmu, jonka lapsisolmu jaetaan
@@ -156,20 +351,32 @@ protected:
      left = solmu, joka jaetaan ja josta tulee vasemmanpuoleinen sisar */
   void splitChild(BTreeNode<T> *parent, int medianKey, BTreeNode<T> *left);
 
+  /* Tekee tyteen lapsisolmuun tilaa B*-puun tapaan: siirt avaimen
+     vajaalle viereiselle sisarelle tai, jos molemmat sisaret ovat tynn,
+     jakaa lapsen ja tyden sisaren kolmeen solmuun, joista kukin on noin
+     kaksi kolmasosaa tynn.
+     parent = vaillinainen issolmu
+     index = tyden lapsen indeksi */
+  void overflowChild(BTreeNode<T> *parent, int index);
+
   /* Lis avaimen vaillinaiseen solmuun. [1]
      node = alipuu, johon avain tulee
-     key = avain */
-  void insertNonfull(BTreeNode<T> *node, T key);
+     key = avain, joka siirretn lehteen */
+  void insertNonfull(BTreeNode<T> *node, T &key);
 
   /* Poistaa ja palauttaa edellisen avaimen. Argumenttina on annettava se
      lapsisolmu, joka edelt avainta, jonka edeltjavain halutaan poistaa.
-     branch = alipuu, josta avain poistetaan */
-  T removePredecessorKey(BTreeNode<T> *branch);
+     branch = alipuu, josta avain poistetaan
+     dead = palautetaan true, jos avain oli haudattu
+     copies = avaimen kappalemr palautetaan thn */
+  T removePredecessorKey(BTreeNode<T> *branch, bool *dead, int *copies);
 
   /* Poistaa ja palauttaa seuraavan avaimen. Argumenttina on annettava se
      lapsisolmu, joka seuraa avainta, jonka seuraaja-avain halutaan poistaa.
-     branch = alipuu, josta avain poistetaan */
-  T removeSuccessorKey(BTreeNode<T> *branch);
+     branch = alipuu, josta avain poistetaan
+     dead = palautetaan true, jos avain oli haudattu
+     copies = avaimen kappalemr palautetaan thn */
+  T removeSuccessorKey(BTreeNode<T> *branch, bool *dead, int *copies);
 
   /* Lainaa oikeanpuoleiselta sisarsolmulta avaimen siirten sen issolmuun
      ja pudottaa issolmusta avaimen lapsisolmuun.
@@ -195,6 +402,49 @@ protected:
      branch = alipuu, josta avain poistetaan */
   void removeBranch(const T &key, BTreeNode<T> *branch);
 
+  /* Palauttaa alipuun korkeuden eli lehtien syvyyden alipuun juuresta. */
+  int branchHeight(BTreeNode<T> *node);
+
+  /* Liitt kaksi alipuuta ja niiden vliin tulevan avaimen yhdeksi
+     alipuuksi. Matalampi alipuu liitetn korkeamman reunimmaiseksi
+     lapseksi sen korkeudelle, ja jos sen juuressa on liian vhn avaimia,
+     se yhdistetn sisareensa tai lainaa sisarelta avaimia. Korkeamman
+     alipuun reunan tydet solmut jaetaan matkalla kuten lisyksess.
+     Palauttaa liitetyn alipuun juuren.
+     left, right = alipuut tai NULL, jos alipuu on tyhj; alipuiden juurissa
+                   saa olla alle t-1 avainta
+     leftHeight, rightHeight = alipuiden korkeudet, tyhjll -1
+     key = avain, joka on suurempi kuin vasemman ja pienempi kuin oikean
+           alipuun avaimet
+     height = liitetyn alipuun korkeus palautetaan thn */
+  BTreeNode<T> *joinBranches(BTreeNode<T> *left, int leftHeight,
+                             const T &key, BTreeNode<T> *right,
+                             int rightHeight, int *height);
+
+  /* Jakaa alipuun kahteen alipuuhun, joista vasemmassa ovat avainta key
+     pienemmt ja oikeassa muut avaimet. Hakupolun solmut jaetaan kahtia,
+     ja puolikkaat liitetn alhaalta yls joinBranches()-metodilla.
+     Hakupolun solmut tuhotaan.
+     node = jaettava alipuu
+     height = alipuun korkeus
+     left, right = alipuut palautetaan thn, NULL, jos alipuu on tyhj
+     leftHeight, rightHeight = alipuiden korkeudet palautetaan thn */
+  void splitBranch(BTreeNode<T> *node, int height, const T &key,
+                   BTreeNode<T> **left, int *leftHeight,
+                   BTreeNode<T> **right, int *rightHeight);
+
+  /* Korvaa puun sislln toisen puun kanssa tehdyn joukko-operaation
+     tuloksella. Monijoukoille ja lokia kyttville puille ei ole
+     joukko-operaatioita.
+     other = toinen puu, joka ei muutu
+     operation = SET_UNION, SET_INTERSECTION tai SET_DIFFERENCE */
+  void combine(BTree<T> &other, int operation);
+
+  /* Luo vedoksen solmua vastaavan alipuun.
+     snapshot = vedos
+     node = solmun sijainti vedoksessa */
+  BTreeNode<T> *loadBranch(const BTreeSnapshot<T> *snapshot, long long node);
+
 public:
   /* Luo puun.
      degree = puun aste; oltava >= 2; mr avainten mrn solmuissa;
@@ -217,20 +467,239 @@ public:
      index = avaimen indeksi */
   void search(const T &key, BTreeNode<T> **result, int *index);
 
-  /* Tarkistaa, ett puu tytt B-puun mritelmn. */
+  /* Etsii puusta joukon avaimia. Enintn SEARCH_BATCH hakua etenee
+     puussa rinnakkain taso kerrallaan: kunkin tason aluksi esihaetaan
+     kaikkien hakujen solmujen avaimet ja jokaisen haun seuraava solmu
+     esihaetaan heti, kun se tunnetaan. Nin riippumattomien hakujen
+     vlimuistihudit ovat kynniss samanaikaisesti eivtk perkkin.
+     keys = etsittvt avaimet
+     results = results[i] on true, jos avain keys[i] on puussa */
+  void searchBatch(const std::vector<T> &keys, std::vector<bool> &results);
+
+  /* Etsii puusta suurimman avaimen, joka on pienempi tai yht suuri kuin
+     key. Palauttaa false, jos sellaista ei ole.
+     key = etsittv avain
+     result = lydetty avain palautetaan thn */
+  bool floorKey(const T &key, T *result);
+
+  /* Etsii puusta pienimmn avaimen, joka on suurempi tai yht suuri kuin
+     key. Palauttaa false, jos sellaista ei ole.
+     key = etsittv avain
+     result = lydetty avain palautetaan thn */
+  bool ceilingKey(const T &key, T *result);
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi].
+     lo = vlin alaraja
+     hi = vlin ylraja
+     result = vektori, johon avaimet listn */
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+
+  /* Lis tulosvektoriin puun kaikki avaimet nousevassa jrjestyksess.
+     result = vektori, johon avaimet listn */
+  void keys(std::vector<T> &result);
+
+  /* Lis puun muistinkytn erittelyyn sissolmuina ("internal d") ja
+     lehtin ("leaf d") syvyyksittin d.
+     usage = erittely, johon listn */
+  void memoryUsage(MemoryUsage &usage);
+
+  /* Korvaa puun sislln annetuilla avaimilla. Puu rakennetaan alhaalta
+     yls lineaarisessa ajassa: avaimet jaetaan tasaisesti mahdollisimman
+     harvoihin lehtiin, ja lehtien vliset avaimet muodostavat ylemmt
+     tasot samalla tavalla. Muutoksia ei kirjoiteta lokiin, joten puulla ei
+     saa olla lokia.
+     sorted = nousevassa jrjestyksess olevat, keskenn erisuuret
+              avaimet */
+  void build(const std::vector<T> &sorted);
+
+  /* Lis puuhun toisen puun avaimet. Molempien puiden avaimet kydn
+     lpi jrjestyksess kerran ja tulos rakennetaan build()-metodilla,
+     joten operaatio on lineaarinen; jos toinen puu on paljon pienempi,
+     sen avaimet haetaan laukkahaulla. Puulla ei saa olla lokia.
+     other = toinen puu, joka ei muutu */
+  void unionWith(BTree<T> &other);
+
+  /* Poistaa puusta avaimet, jotka eivt ole toisessa puussa. Toteutus on
+     kuten unionWith()-metodissa.
+     other = toinen puu, joka ei muutu */
+  void intersect(BTree<T> &other);
+
+  /* Poistaa puusta avaimet, jotka ovat toisessa puussa. Toteutus on kuten
+     unionWith()-metodissa.
+     other = toinen puu, joka ei muutu */
+  void difference(BTree<T> &other);
+
+  /* Siirt puun avaimet, jotka ovat suurempia tai yht suuria kuin key,
+     toiseen puuhun, jonka aiempi sislt tuhotaan. Vain hakupolun solmut
+     jaetaan ja puolikkaat liitetn uudelleen, joten jako vie ajan
+     O(log n). Haudatut avaimet poistetaan ensin. Muutoksia ei kirjoiteta
+     lokiin, joten kummallakaan puulla ei saa olla lokia. Monijoukkoa ei
+     voi jakaa.
+     key = jakokohta
+     right = puu, johon suuremmat avaimet siirretn; asteen on oltava
+             sama */
+  void split(const T &key, BTree<T> &right);
+
+  /* Siirt toisen puun kaikki avaimet tmn puun loppuun. Toisen puun
+     avainten on oltava suurempia kuin tmn puun avaimet. Matalampi puu
+     liitetn korkeamman reunaan, joten liitos vie ajan O(log n); toinen
+     puu j tyhjksi. Haudatut avaimet poistetaan ensin. Muutoksia ei
+     kirjoiteta lokiin, joten kummallakaan puulla ei saa olla lokia.
+     Monijoukkoja ei voi liitt.
+     right = liitettv puu; asteen on oltava sama */
+  void join(BTree<T> &right);
+
+  /* Ottaa kyttn alipuiden koosteet: sissolmuihin tallennetaan
+     kunkin lapsen alipuun elvien avainten mr ja avainten arvojen
+     kooste. Koosteet pidetn ajan tasalla kaikissa muutoksissa, ja niill
+     rank(), select(), countInRange() ja aggregateRange() toimivat ajassa
+     O(t log n). Olemassa olevan puun koosteet lasketaan lineaarisessa
+     ajassa. Monijoukolle koosteita ei voi ottaa kyttn.
+     value = avaimen arvo koosteessa; NULL=koosteet pois kytst
+     combine = liitnninen ja vaihdannainen yhdistmisfunktio, esim.
+               summa, minimi tai maksimi
+     identity = yhdistmisen neutraalialkio */
+  void setAggregate(double (*value)(const T &),
+                    double (*combine)(double, double), double identity);
+
+  /* Palauttaa puun avainten mrn, jotka ovat pienempi kuin key.
+     Koosteiden on oltava kytss. */
+  long long rank(const T &key);
+
+  /* Etsii avaimen, jota pienempi avaimia puussa on index kappaletta.
+     Palauttaa false, jos puussa on enintn index avainta. Koosteiden on
+     oltava kytss.
+     result = lydetty avain palautetaan thn */
+  bool select(long long index, T *result);
+
+  /* Palauttaa vlill [lo, hi] olevien avainten mrn. Koosteiden on
+     oltava kytss. */
+  long long countInRange(const T &lo, const T &hi);
+
+  /* Palauttaa vlill [lo, hi] olevien avainten arvojen koosteen tai
+     neutraalialkion, jos vlill ei ole avaimia. Koosteiden on oltava
+     kytss. */
+  double aggregateRange(const T &lo, const T &hi);
+
+  /* Luo puun avaimista muuttumattoman hakurakenteen, jossa haut ovat
+     nopeampia kuin puussa. Palautettu rakenne on tuhottava
+     delete-operaattorilla, eik puun myhemmt muutokset ny siin. */
+  FrozenBTree<T> *freeze();
+
+  /* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt
+     tsmlleen annetut avaimet. Tarkistus on lineaarinen, jos avaimet
+     annetaan nousevassa jrjestyksess.
+     keys = avaimet, jotka pitisi olla puussa */
   void validate(const std::vector<T> &keys);
 
   /* Tarkistaa, ett puu tytt B-puun mritelmn ja tulostaa
      listietoja. */
   void printValidate(const std::vector<T> &keys);
 
-  /* Lis avaimen puuhun.
-     key = listtva avain */
+  /* Lis avaimen puuhun. Monijoukossa puussa jo olevan avaimen
+     kappalemr kasvatetaan solmussa ilman rakennemuutoksia.
+     key = listtva avain; parametri on arvo, johon vliaikainen avain
+           siirretn, ja se siirretn edelleen lehteen, joten avain
+           kopioidaan enintn kerran */
   void insert(T key);
 
-  /* Poistaa avaimen puusta.
+  /* Luo avaimen argumenteista ja lis sen puuhun kuten insert() ilman
+     kopiointia. */
+  template<typename... Args> void emplace(Args &&...args);
+
+  /* Poistaa avaimen puusta. Laiskassa poistotilassa avain vain haudataan
+     paikalleen ilman rakennemuutoksia; haut ja lpikynnit ohittavat
+     haudatut avaimet, ja saman avaimen lisys hertt sen henkiin.
+     Monijoukossa avaimen kappalemr vhennetn, ja avain poistetaan
+     vasta viimeisen kappaleen mukana.
      key = poistettava avain */
   void remove(const T &key);
+
+  /* Valitsee, tallennetaanko puuhun joukko vai monijoukko. Monijoukossa
+     kullakin avaimella on solmussa avaimen vieress kappalemr, joten
+     toistuvat avaimet eivt vie lis avainpaikkoja. Haut, lpikynnit ja
+     validate() ksittelevt kunkin avaimen kerran; kappalemrt saadaan
+     count()-metodilla. Puun on oltava tyhj, eik koosteita saa olla
+     kytss.
+     multiset = true=monijoukko, false=joukko (oletus) */
+  void setMultiset(bool multiset);
+
+  /* Palauttaa avaimen kappalemrn puussa; joukossa 0 tai 1. */
+  int count(const T &key);
+
+  /* Valitsee poistotavan. Palattaessa vlittmn poistoon kaikki
+     haudatut avaimet poistetaan.
+     lazy = true=laiska poisto, false=vlitn poisto (oletus) */
+  void setLazyRemove(bool lazy);
+
+  /* Palauttaa haudattujen avainten mrn. */
+  int numTombstones() const;
+
+  /* Valitsee tyden solmun ksittelyn lisyksess.
+     redistribute = true=avaimia siirretn ensin sisarelle ja tydet
+                    sisarukset jaetaan kolmeen solmuun (B*-puu),
+                    false=tysi solmu puolitetaan (oletus) */
+  void setRedistribute(bool redistribute);
+
+  /* Palauttaa edellisen tarkistuksen (validate) laskeman puun syvyyden. */
+  int getDepth() const;
+
+  /* Palauttaa edellisen tarkistuksen (validate) laskeman tyttasteen eli
+     avainten mrn suhteessa solmujen avainpaikkoihin. */
+  double getFillFactor() const;
+
+  /* Poistaa haudattuja avaimia vlittmn poiston tavoin ja tasapainottaa
+     puun. Tiivistys jatkuu siit avaimesta, johon edellinen kutsu ji,
+     joten toistuvat pienet kutsut kyvt puun lpi kerran kierrosta kohden.
+     Palauttaa poistettujen avainten mrn.
+     budget = poistettavien avainten enimmismr, <0=kaikki */
+  int compact(int budget);
+
+  /* Tallentaa puun vedokseksi, jossa solmut ovat leveyssuuntaisessa
+     jrjestyksess ja osoittimien sijaan lasten sijainnit tiedostossa.
+     Avaintyypin on oltava bitti bitilt kopioitava. Vedoksessa ei ole
+     kappalemri, joten monijoukkoa ei voi tallentaa. Vedos kirjoitetaan
+     vliaikaistiedostoon, joka korvaa vanhan vedoksen vasta levylle
+     viennin jlkeen.
+     fileName = vedostiedosto */
+  void save(const char *fileName);
+
+  /* Liitt save()-metodilla tallennetun vedoksen muistiin vain luettavaksi.
+     Palautettu vedos on tuhottava delete-operaattorilla.
+     fileName = vedostiedosto
+     compare = metodi avainten vertailemiseksi */
+  static BTreeSnapshot<T> *openReadOnly(const char *fileName,
+    int (*const compare)(const T &, const T &));
+
+  /* Korvaa puun sislln save()-metodilla tallennetulla vedoksella. Vedoksen
+     asteen on oltava sama kuin puun.
+     fileName = vedostiedosto */
+  void load(const char *fileName);
+
+  /* Asettaa lokin, johon lisykset ja poistot kirjoitetaan ennen niiden
+     tekemist. Puu ei omista lokia.
+     log = loki tai NULL, jos lokia ei kytet */
+  void setLog(WriteAheadLog *log);
+
+  /* Palauttaa puun lokin tai NULL, jos lokia ei kytet. */
+  WriteAheadLog *getLog();
+
+  /* Tallentaa puun vedokseksi ja tyhjent lokin, kun vedos on levyll.
+     fileName = vedostiedosto */
+  void checkpoint(const char *fileName);
+
+#ifdef STRUCTURE_TRACE
+  /* Palauttaa puun tapahtumalaskurit. Hakujen askeleet ovat avainten
+     vertailuja syvyyksittin. */
+  StructureTrace &getTrace();
+#endif
+
+  /* Palauttaa puun viimeisimpn kestvn tilaansa lataamalla vedoksen ja
+     toistamalla sen plle lokin tietueet.
+     snapshotFile = vedostiedosto tai NULL, jos vedosta ei ole
+     logFile = lokitiedosto */
+  void recover(const char *snapshotFile, const char *logFile);
 };
 
 #endif
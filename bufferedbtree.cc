@@ -0,0 +1,787 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa kirjoituksille optimoidun puskuroidun B-puun (B^e-puu).
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <vector>
+#include <sstream>
+#include "bufferedbtree.h"
+#include "btree.h"
+#include "memory.h"
+#include "validate.h"
+
+using namespace std;
+
+template<typename T> BufferedBTreeNode<T>::BufferedBTreeNode<T>(
+  int degree, bool leaf, int debug) : BTreeNode<T>(degree, leaf, debug) {}
+
+/* Palauttaa puskurin. */
+template<typename T> vector<BufferedMessage<T> > &
+BufferedBTreeNode<T>::getBuffer() {
+  return buffer;
+}
+
+/* Palauttaa lapsen kohdasta index. */
+template<typename T> BufferedBTreeNode<T> *
+BufferedBTreeNode<T>::getBufferedChild(int index) const {
+  // Puun kaikki solmut ovat puskuroituja solmuja.
+  return static_cast<BufferedBTreeNode<T> *>(this->getChild(index));
+}
+
+/* Palauttaa solmun, sen taulukoiden ja puskurin varaamat tavut. */
+template<typename T> long long BufferedBTreeNode<T>::allocatedBytes() const {
+  return BTreeNode<T>::allocatedBytes()+sizeof(BufferedBTreeNode<T>)-
+    sizeof(BTreeNode<T>)+buffer.capacity()*sizeof(BufferedMessage<T>);
+}
+
+/* Palauttaa avaimettoman sissolmun ainoan lapsen. */
+template<typename T> BufferedBTreeNode<T> *
+BufferedBTreeNode<T>::getBufferedOnlyChild() const {
+  return static_cast<BufferedBTreeNode<T> *>(this->getOnlyChild());
+}
+
+/* Tuhoaa alipuun. */
+template<typename T> void BufferedBTree<T>::destroyBranch(
+  BufferedBTreeNode<T> *branch) {
+  if (branch) {
+    if (!branch->isLeaf())
+      for (int i=0; i<branch->numChildren(); i++)
+        destroyBranch(branch->getBufferedChild(i));
+    delete branch;
+  }
+}
+
+/* Tulostaa alipuun solmut ja puskurit esijrjestyksess. */
+template<typename T> void BufferedBTree<T>::printBranch(
+  BufferedBTreeNode<T> *node, int depth) {
+  cout << "depth=" << depth << ", " << (BTreeNode<T> *)node << ", buffer=";
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  for (unsigned int i=0; i<buffer.size(); i++)
+    cout << (buffer[i].insert ? "+" : "-") << buffer[i].key
+         << (i+1<buffer.size() ? " " : "");
+  cout << endl;
+  if (!node->isLeaf())
+    for (int i=0; i<node->numChildren(); i++)
+      printBranch(node->getBufferedChild(i), depth+1);
+}
+
+/* Palauttaa sen lapsen indeksin, johon avain kuuluu. */
+template<typename T> int BufferedBTree<T>::childIndex(
+  BufferedBTreeNode<T> *node, const T &key) {
+  int lo=0, hi=node->numKeys();
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    if (compare(node->getKey(mid), key)<=0) lo=mid+1;
+    else hi=mid;
+  }
+  return lo;
+}
+
+/* Palauttaa ensimmisen puskurin viestin indeksin, jonka avain on
+   vhintn key. */
+template<typename T> int BufferedBTree<T>::messageIndex(
+  const vector<BufferedMessage<T> > &buffer, const T &key) {
+  int lo=0, hi=buffer.size();
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    if (compare(buffer[mid].key, key)<0) lo=mid+1;
+    else hi=mid;
+  }
+  return lo;
+}
+
+/* Yhdist jrjestetyt viestit solmun puskuriin. Saman avaimen viesteist
+   silyy annettu, koska se on uudempi.
+   node = sissolmu
+   from, to = viestit from...to-1 */
+template<typename T> void BufferedBTree<T>::mergeMessages(
+  BufferedBTreeNode<T> *node, const BufferedMessage<T> *from,
+  const BufferedMessage<T> *to) {
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  vector<BufferedMessage<T> > merged;
+  merged.reserve(buffer.size()+(to-from));
+
+  unsigned int i=0;
+  while (i<buffer.size() && from<to) {
+    int order=compare(buffer[i].key, from->key);
+    if (order<0) merged.push_back(buffer[i++]);
+    else {
+      if (order==0) i++;
+      merged.push_back(*from++);
+    }
+  }
+  merged.insert(merged.end(), buffer.begin()+i, buffer.end());
+  merged.insert(merged.end(), from, to);
+  buffer.swap(merged);
+}
+
+/* Tekee viestin mukaisen muutoksen lehteen. Lehdess on oltava tilaa
+   listtvlle avaimelle. */
+template<typename T> void BufferedBTree<T>::applyMessage(
+  BufferedBTreeNode<T> *leaf, const BufferedMessage<T> &message) {
+  int lo=0, hi=leaf->numKeys();
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    if (compare(leaf->getKey(mid), message.key)<0) lo=mid+1;
+    else hi=mid;
+  }
+  bool found=lo<leaf->numKeys() && compare(leaf->getKey(lo), message.key)==0;
+
+  if (message.insert && !found) {
+    if (debug==1) cout << "applyMessage(): 1" << endl;
+    leaf->insert(message.key, NULL, NULL, lo);
+  }
+  else if (!message.insert && found) {
+    if (debug==1) cout << "applyMessage(): 2" << endl;
+    leaf->remove(lo, false, false);
+  }
+}
+
+/* Jakaa tyden lapsisolmun kahteen.
+   parent = issolmu, jossa on tilaa
+   index = lapsen indeksi
+   left = jaettava lapsi, josta tulee vasemmanpuoleinen puolisko */
+template<typename T> void BufferedBTree<T>::splitChild(
+  BufferedBTreeNode<T> *parent, int index, BufferedBTreeNode<T> *left) {
+  if (parent==NULL || left==NULL) {
+    cerr << "splitChild(): Invalid argument." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  BufferedBTreeNode<T> *right=
+    new BufferedBTreeNode<T>(degree, left->isLeaf(), debug);
+  left->copy(degree, degree-1, right, 0);
+  left->setNumKeys(degree);
+
+  if (left->isLeaf()) {
+    if (debug==1) cout << "splitChild(): 1" << endl;
+    // Lehdet silyttvt kaikki avaimet; issolmuun tulee kopio oikean
+    // puoliskon pienimmst avaimesta.
+    parent->insert(right->getFirstKey(), NULL, right, index);
+    return;
+  }
+
+  if (debug==1) cout << "splitChild(): 2" << endl;
+  T median=left->remove(degree-1, false, false);
+  parent->insert(median, NULL, right, index);
+
+  // Mediaania suuremmat tai yht suuret viestit kuuluvat oikeaan
+  // puoliskoon.
+  vector<BufferedMessage<T> > &buffer=left->getBuffer();
+  int split=messageIndex(buffer, median);
+  right->getBuffer().assign(buffer.begin()+split, buffer.end());
+  buffer.erase(buffer.begin()+split, buffer.end());
+}
+
+/* Korjaa vajaan lapsisolmun yhdistmll sen sisarsolmuun tai lainaamalla
+   sisarsolmulta avaimia. Palauttaa issolmun tai yhdistetyn solmun, jos
+   juuresta tuli tyhj ja se tuhottiin.
+   parent = issolmu
+   index = vajaan lapsen indeksi */
+template<typename T> BufferedBTreeNode<T> *BufferedBTree<T>::fixChild(
+  BufferedBTreeNode<T> *parent, int index) {
+  // Ksitelln lapsi ja sen sisar vasemmalta oikealle; oikeanpuoleista
+  // sisarta kytetn, jos se on olemassa.
+  int l=index<parent->numKeys() ? index : index-1;
+  BufferedBTreeNode<T> *left=parent->getBufferedChild(l),
+    *right=parent->getBufferedChild(l+1);
+
+  // Avaimettoman sissolmun ainoa lapsi voi olla vajaa, joten avaimeton
+  // solmu tydennetn yli minimin, jotta lapsen korjaus ei tee siit
+  // vajaata. Sisarelle riitt minimi; muuten kierrot voisivat vied
+  // silt avaimia takaisin.
+  BufferedBTreeNode<T> *only=NULL;
+  int leftMin=degree-1, rightMin=degree-1;
+  if (!left->isLeaf() && left->numKeys()==0) {
+    only=left->getBufferedOnlyChild();
+    leftMin=degree;
+  }
+  if (!right->isLeaf() && right->numKeys()==0) {
+    only=right->getBufferedOnlyChild();
+    rightMin=degree;
+  }
+
+  if (left->isLeaf()) {
+    if (left->numKeys()+right->numKeys()<=2*degree-1) {
+      if (debug==1) cout << "fixChild(): 1" << endl;
+      right->copy(0, right->numKeys(), left, left->numKeys());
+      parent->remove(l, false, true);
+      delete right;
+    }
+    else {
+      if (debug==1) cout << "fixChild(): 2" << endl;
+      // Jaetaan avaimet tasan sisarusten kesken.
+      vector<T> all;
+      for (int i=0; i<left->numKeys(); i++) all.push_back(left->getKey(i));
+      for (int i=0; i<right->numKeys(); i++) all.push_back(right->getKey(i));
+      int half=all.size()/2;
+      left->setNumKeys(half);
+      right->setNumKeys(all.size()-half);
+      for (int i=0; i<half; i++) left->setKey(all[i], i);
+      for (unsigned int i=half; i<all.size(); i++)
+        right->setKey(all[i], i-half);
+      parent->setKey(right->getFirstKey(), l);
+      return parent;
+    }
+  }
+  else if (left->numKeys()+right->numKeys()+1<=2*degree-1) {
+    if (debug==1) cout << "fixChild(): 3" << endl;
+    // Yhdistetn kuten B-puussa; puskurit voidaan liitt perkkin,
+    // koska vasemman sisaren viestit ovat ohjausavainta pienempi.
+    if (right->numKeys()==0)
+      left->insert(parent->getKey(l), NULL, right->getBufferedOnlyChild(),
+                   left->numKeys());
+    else {
+      left->insert(parent->getKey(l), NULL, NULL, left->numKeys());
+      right->copy(0, right->numKeys(), left, left->numKeys());
+    }
+    parent->remove(l, false, true);
+    vector<BufferedMessage<T> > &buffer=right->getBuffer();
+    left->getBuffer().insert(left->getBuffer().end(), buffer.begin(),
+                             buffer.end());
+    delete right;
+  }
+  else {
+    // Kierretn sisarelta lapsia yksi kerrallaan. Siirtyvn lapsen viestit
+    // siirtyvt puskurista toiseen.
+    while (left->numKeys()<leftMin) {
+      if (debug==1) cout << "fixChild(): 4" << endl;
+      T newKey=right->getFirstKey();
+      left->insert(parent->getKey(l), NULL, right->getFirstChild(),
+                   left->numKeys());
+      right->remove(0, true, false);
+      parent->setKey(newKey, l);
+      vector<BufferedMessage<T> > &buffer=right->getBuffer();
+      int moved=messageIndex(buffer, newKey);
+      left->getBuffer().insert(left->getBuffer().end(), buffer.begin(),
+                               buffer.begin()+moved);
+      buffer.erase(buffer.begin(), buffer.begin()+moved);
+    }
+    while (right->numKeys()<rightMin) {
+      if (debug==1) cout << "fixChild(): 5" << endl;
+      T newKey=left->getLastKey();
+      if (right->numKeys()==0) {
+        // Avaimettoman solmun ainoasta lapsesta tulee oikeanpuoleinen lapsi.
+        right->insert(parent->getKey(l), NULL, right->getBufferedOnlyChild(),
+                      0);
+        right->setChild(left->getLastChild(), 0);
+      }
+      else right->insert(parent->getKey(l), left->getLastChild(), NULL, 0);
+      left->remove(left->numKeys()-1, false, true);
+      parent->setKey(newKey, l);
+      vector<BufferedMessage<T> > &buffer=left->getBuffer();
+      int moved=messageIndex(buffer, newKey);
+      right->getBuffer().insert(right->getBuffer().begin(),
+                                buffer.begin()+moved, buffer.end());
+      buffer.erase(buffer.begin()+moved, buffer.end());
+    }
+  }
+
+  // Yhdistminen tyhjensi juuren, joten yhdistetyst solmusta tulee juuri.
+  // Vanhan juuren viestit ovat uudempia kuin yhdistetyn solmun viestit.
+  // Lehdell ei ole puskuria, joten viestit listn silloin uudelleen.
+  // Muu avaimeton solmu korjataan sen issolmussa.
+  if (parent==root && parent->numKeys()==0) {
+    vector<BufferedMessage<T> > &buffer=parent->getBuffer();
+    if (left->isLeaf()) {
+      if (debug==1) cout << "fixChild(): 6" << endl;
+      orphans.insert(orphans.end(), buffer.begin(), buffer.end());
+    }
+    else if (!buffer.empty()) {
+      if (debug==1) cout << "fixChild(): 7" << endl;
+      mergeMessages(left, &buffer[0], &buffer[0]+buffer.size());
+    }
+    root=left;
+    delete parent;
+    parent=left;
+  }
+
+  // Korjataan avaimettoman solmun ainoa lapsi sen uudessa issolmussa,
+  // jossa sen sisaret ovat ehji.
+  if (only && only->numKeys()<degree-1) {
+    if (debug==1) cout << "fixChild(): 8" << endl;
+    BufferedBTreeNode<T> *holder=left;
+    int i=0;
+    while (i<left->numChildren() && left->getBufferedChild(i)!=only) i++;
+    if (i==left->numChildren()) {
+      holder=right;
+      i=0;
+      while (right->getBufferedChild(i)!=only) i++;
+    }
+    BufferedBTreeNode<T> *fixed=fixChild(holder, i);
+    if (holder==parent) return fixed;
+
+    // Jos lapsen korjaus kuitenkin tyhjensi sisaren, se korjataan heti,
+    // jottei avaimetonta solmua valita issolmussa lapseksi.
+    if (holder->numKeys()==0) {
+      if (debug==1) cout << "fixChild(): 9" << endl;
+      return fixChild(parent, holder==left ? l : l+1);
+    }
+  }
+  return parent;
+}
+
+/* Palauttaa solmun puskurin enimmiskoon. */
+template<typename T> unsigned int BufferedBTree<T>::bufferLimit(
+  BufferedBTreeNode<T> *node) {
+  // Lehtien issolmun lehtiin mahtuu vain noin t*t avainta lis ennen
+  // kuin solmu tyttyy, joten sit suurempaa puskuria ei voisi tyhjent
+  // kerralla.
+  if (node->getBufferedChild(0)->isLeaf() &&
+      bufferSize>(unsigned int)(degree*degree))
+    return degree*degree;
+  return bufferSize;
+}
+
+/* Siirt solmun puskurista viestej eriss lapsille, kunnes puskuri ei
+   ylit kokoaan tai lapsia ei voi en jakaa, koska solmu on tynn.
+   node = sissolmu */
+template<typename T> void BufferedBTree<T>::flushNode(
+  BufferedBTreeNode<T> *node) {
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  vector<int> bounds;
+
+  while (buffer.size()>bufferLimit(node)) {
+    // Tytt solmua ei voi tyhjent, koska sen lapsia ei voi jakaa.
+    // Puskuri j odottamaan, kunnes issolmu jakaa solmun; juuri
+    // kasvatetaan. Nin tydet solmut eivt ker viestej, joita ei voi
+    // vied alemmas.
+    if (node->numKeys()==2*degree-1) {
+      if (debug==1) cout << "flushNode(): 2" << endl;
+      break;
+    }
+    if (node->getBufferedChild(0)->isLeaf()) {
+      if (debug==1) cout << "flushNode(): 3" << endl;
+      // Viestit viedn lehtiin yksi kerrallaan. Tyttyv lehti jaetaan,
+      // jolloin loput viestit voivat kuulua uudelle sisarelle. Jos solmu
+      // on tynn, tysien lehtien lisykset jvt puskuriin odottamaan
+      // solmun jakoa, mutta muiden lehtien viestit viedn.
+      flushes++;
+      unsigned int kept=0;
+      for (unsigned int j=0; j<buffer.size(); j++) {
+        int i=childIndex(node, buffer[j].key);
+        BufferedBTreeNode<T> *leaf=node->getBufferedChild(i);
+        if (buffer[j].insert && leaf->numKeys()==2*degree-1) {
+          if (node->numKeys()==2*degree-1) {
+            buffer[kept++]=buffer[j];
+            continue;
+          }
+          splitChild(node, i, leaf);
+          leaf=node->getBufferedChild(childIndex(node, buffer[j].key));
+        }
+        applyMessage(leaf, buffer[j]);
+      }
+      flushedMessages+=buffer.size()-kept;
+      buffer.resize(kept);
+      break;
+    }
+
+    // Valitaan lapsi, jolle on eniten viestej. Viestit ovat
+    // jrjestyksess, joten lasten viestien rajat haetaan puskurista
+    // binrihaulla ohjausavaimilla.
+    bounds.resize(node->numChildren()+1);
+    bounds[0]=0;
+    for (int i=0; i<node->numKeys(); i++)
+      bounds[i+1]=messageIndex(buffer, node->getKey(i));
+    bounds[node->numChildren()]=buffer.size();
+    int best=0;
+    for (int i=1; i<node->numChildren(); i++)
+      if (bounds[i+1]-bounds[i]>bounds[best+1]-bounds[best]) best=i;
+
+    BufferedBTreeNode<T> *child=node->getBufferedChild(best);
+    if (child->numKeys()==2*degree-1) {
+      if (debug==1) cout << "flushNode(): 1" << endl;
+      splitChild(node, best, child);
+      continue;
+    }
+    // Er rajataan lapsen puskurin kokoon, jottei lapsi saa kerralla
+    // enemp viestej kuin sen alipuu ehtii ottaa vastaan ennen kuin
+    // lapsi on jaettava.
+    int start=bounds[best], end=bounds[best+1];
+    if (end-start>(int)bufferLimit(child)) end=start+bufferLimit(child);
+
+    flushes++;
+    if (debug==1) cout << "flushNode(): 4" << endl;
+    mergeMessages(child, &buffer[0]+start, &buffer[0]+end);
+    flushedMessages+=end-start;
+    buffer.erase(buffer.begin()+start, buffer.begin()+end);
+    if (child->getBuffer().size()>bufferLimit(child)) flushNode(child);
+    // Vajaa lapsi korjataan heti, jotta sit ei valita uudelleen vajaana.
+    // Jos solmusta tuli avaimeton, sen ainoa lapsi on ehj ja solmu
+    // korjataan issolmussa.
+    // Tyttynyt lapsi jaetaan heti, jotta sen puskuri puolittuu eik j
+    // odottamaan, kunnes lapsi valitaan uudelleen.
+    if (child->numKeys()<degree-1) {
+      if (fixChild(node, best)!=node || node->numKeys()==0) return;
+    }
+    else if (child->numKeys()==2*degree-1 && node->numKeys()<2*degree-1) {
+      if (debug==1) cout << "flushNode(): 6" << endl;
+      splitChild(node, best, child);
+    }
+  }
+
+  // Ruuhkan aikana kasvanut puskuri kutistetaan, jottei sen varaama muisti
+  // j pysyvsti kyttmtt.
+  if (buffer.capacity()>4*bufferSize && buffer.size()<=bufferLimit(node))
+    vector<BufferedMessage<T> >(buffer).swap(buffer);
+
+  // Poistot ja alempien tasojen yhdistmiset ovat voineet jtt lapsia
+  // vajaiksi.
+  for (int i=0; i<node->numChildren(); ) {
+    if (node->getBufferedChild(i)->numKeys()>=degree-1) {
+      i++;
+      continue;
+    }
+    if (debug==1) cout << "flushNode(): 5" << endl;
+    if (fixChild(node, i)!=node) return;
+  }
+}
+
+/* Kasvattaa puuta jakamalla tyden juuren. */
+template<typename T> void BufferedBTree<T>::growRoot() {
+  BufferedBTreeNode<T> *left=root;
+  root=new BufferedBTreeNode<T>(degree, false, debug);
+  root->setChild(left, 0);
+  splitChild(root, 0, left);
+}
+
+/* Kirjaa viestin puuhun. */
+template<typename T> void BufferedBTree<T>::put(
+  const BufferedMessage<T> &message) {
+  if (root->isLeaf()) {
+    if (root->numKeys()<2*degree-1 || !message.insert) {
+      if (debug==1) cout << "put(): 1" << endl;
+      // Pelkk lehti muutetaan suoraan.
+      applyMessage(root, message);
+      return;
+    }
+    if (debug==1) cout << "put(): 2" << endl;
+    growRoot();
+  }
+
+  vector<BufferedMessage<T> > &buffer=root->getBuffer();
+  int i=messageIndex(buffer, message.key);
+  if (i<(int)buffer.size() && compare(buffer[i].key, message.key)==0)
+    buffer[i]=message;
+  else buffer.insert(buffer.begin()+i, message);
+
+  if (buffer.size()>bufferLimit(root)) {
+    if (debug==1) cout << "put(): 3" << endl;
+    flushNode(root);
+  }
+  if (root->numKeys()==2*degree-1) {
+    if (debug==1) cout << "put(): 4" << endl;
+    growRoot();
+  }
+}
+
+/* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+   jrjestyksess ottaen huomioon ylempien puskurien viestit. Palauttaa
+   true, jos tulosvektoriin kertyi limit avainta.
+   lo, hi = vlin rajat tai NULL, jos vli on rajoittamaton
+   pending = ylempien solmujen viestit alipuulle jrjestyksess
+   limit = avainten enimmismr tulosvektorissa, 0=rajoittamaton */
+template<typename T> bool BufferedBTree<T>::rangeBranch(
+  BufferedBTreeNode<T> *node, const T *lo, const T *hi,
+  const vector<BufferedMessage<T> > &pending, unsigned int limit,
+  vector<T> &result) {
+  if (node->isLeaf()) {
+    // Yhdistetn lehden avaimet ja ylempien puskurien viestit; viesti
+    // ratkaisee avaimen, jos sille on viesti.
+    int i=0;
+    if (lo)
+      while (i<node->numKeys() && compare(node->getKey(i), *lo)<0) i++;
+    unsigned int j=0;
+    for (;;) {
+      bool key=i<node->numKeys() &&
+        (!hi || compare(node->getKey(i), *hi)<=0);
+      if (!key && j>=pending.size()) break;
+      int order=!key ? 1 : j>=pending.size() ? -1 :
+        compare(node->getKey(i), pending[j].key);
+      if (order<0) result.push_back(node->getKey(i++));
+      else {
+        if (pending[j].insert) result.push_back(pending[j].key);
+        if (order==0) i++;
+        j++;
+      }
+      if (limit>0 && result.size()>=limit) return true;
+    }
+    return false;
+  }
+
+  // Listn solmun vlille osuvat viestit ylempien viestien joukkoon;
+  // ylempi viesti on uudempi.
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  vector<BufferedMessage<T> > messages;
+  unsigned int i=lo ? messageIndex(buffer, *lo) : 0, j=0;
+  for (;;) {
+    bool message=i<buffer.size() && (!hi || compare(buffer[i].key, *hi)<=0);
+    if (!message && j>=pending.size()) break;
+    int order=!message ? 1 : j>=pending.size() ? -1 :
+      compare(buffer[i].key, pending[j].key);
+    if (order<0) messages.push_back(buffer[i++]);
+    else {
+      messages.push_back(pending[j++]);
+      if (order==0) i++;
+    }
+  }
+
+  int first=lo ? childIndex(node, *lo) : 0,
+    last=hi ? childIndex(node, *hi) : node->numKeys();
+  vector<BufferedMessage<T> > childMessages;
+  unsigned int k=0;
+  for (int c=first; c<=last; c++) {
+    childMessages.clear();
+    while (k<messages.size() &&
+           (c==node->numKeys() ||
+            compare(messages[k].key, node->getKey(c))<0))
+      childMessages.push_back(messages[k++]);
+    if (rangeBranch(node->getBufferedChild(c), lo, hi, childMessages, limit,
+                    result))
+      return true;
+  }
+  return false;
+}
+
+/* Laskee alipuun muistinkytn syvyyksittin. */
+template<typename T> void BufferedBTree<T>::memoryBranch(
+  BufferedBTreeNode<T> *node, int depth, vector<long long> &nodes,
+  vector<long long> &live, vector<long long> &allocated) {
+  unsigned int index=3*depth+(node->isLeaf() ? 1 : 0);
+  if (3*depth+2>=nodes.size()) {
+    nodes.resize(3*depth+3, 0);
+    live.resize(3*depth+3, 0);
+    allocated.resize(3*depth+3, 0);
+  }
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  long long bufferBytes=buffer.capacity()*sizeof(BufferedMessage<T>);
+  nodes[index]++;
+  live[index]+=node->liveBytes();
+  allocated[index]+=node->allocatedBytes()-bufferBytes;
+  if (node->isLeaf()) return;
+
+  nodes[3*depth+2]++;
+  live[3*depth+2]+=buffer.size()*sizeof(BufferedMessage<T>);
+  allocated[3*depth+2]+=bufferBytes;
+  for (int i=0; i<node->numChildren(); i++)
+    memoryBranch(node->getBufferedChild(i), depth+1, nodes, live, allocated);
+}
+
+/* Tarkistaa alipuun solmujen avainten mrt ja jrjestyksen, lehtien
+   syvyyden sek sen, ett avaimet ja puskurien viestit kuuluvat
+   alipuulle.
+   lo, hi = alipuun avainten vli [lo, hi) tai NULL, jos vli on
+            rajoittamaton
+   leafDepth = lehtien syvyys tai -1, jos lehte ei ole viel lydetty */
+template<typename T> void BufferedBTree<T>::validateBranch(
+  BufferedBTreeNode<T> *node, int depth, const T *lo, const T *hi,
+  int *leafDepth) {
+  if (depth>0 && node->numKeys()<degree-1) {
+    cerr << "VALIDATE: Not enough keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (node->numKeys()>2*degree-1) {
+    cerr << "VALIDATE: Too many keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  if (!node->isLeaf() && node->numKeys()<1) {
+    cerr << "VALIDATE: No keys in an internal node." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  for (int i=0; i<node->numKeys(); i++)
+    if ((i>0 && compare(node->getKey(i-1), node->getKey(i))>=0) ||
+        (lo && compare(node->getKey(i), *lo)<0) ||
+        (hi && compare(node->getKey(i), *hi)>=0)) {
+      cerr << "VALIDATE: Keys not in order." << endl;
+      raise(SIGABRT);
+      return;
+    }
+
+  vector<BufferedMessage<T> > &buffer=node->getBuffer();
+  for (unsigned int i=0; i<buffer.size(); i++)
+    if ((i>0 && compare(buffer[i-1].key, buffer[i].key)>=0) ||
+        (lo && compare(buffer[i].key, *lo)<0) ||
+        (hi && compare(buffer[i].key, *hi)>=0)) {
+      cerr << "VALIDATE: Messages not in order." << endl;
+      raise(SIGABRT);
+      return;
+    }
+
+  if (node->isLeaf()) {
+    if (!buffer.empty()) {
+      cerr << "VALIDATE: Messages in a leaf." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    if (*leafDepth<0) *leafDepth=depth;
+    else if (*leafDepth!=depth) {
+      cerr << "VALIDATE: Leaves at different depths." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    return;
+  }
+
+  for (int i=0; i<node->numChildren(); i++) {
+    T childLo, childHi;
+    if (i>0) childLo=node->getKey(i-1);
+    if (i<node->numKeys()) childHi=node->getKey(i);
+    validateBranch(node->getBufferedChild(i), depth+1, i>0 ? &childLo : lo,
+                   i<node->numKeys() ? &childHi : hi, leafDepth);
+  }
+}
+
+/* degree = puun aste; oltava >= 2
+   bufferSize = sissolmun puskurin koko viestein; oltava >= 1
+   compare = metodi avainten vertailemiseksi
+   debug = 1=lausekattavuustulostus */
+template<typename T> BufferedBTree<T>::BufferedBTree<T>(
+  int degree, int bufferSize, int (*const compare)(const T &, const T &),
+  int debug=0) :
+  degree(degree), bufferSize(bufferSize), root(NULL), compare(compare),
+  flushes(0), flushedMessages(0), debug(debug) {
+  if (degree<2 || bufferSize<1) {
+    cerr << "BufferedBTree(): degree must be >= 2 and buffer size >= 1."
+         << endl;
+    raise(SIGABRT);
+    return;
+  }
+  root=new BufferedBTreeNode<T>(degree, true, debug);
+}
+
+template<typename T> BufferedBTree<T>::~BufferedBTree<T>() {
+  destroyBranch(root);
+}
+
+/* Tulostaa puun solmut ja puskurit esijrjestyksess. */
+template<typename T> void BufferedBTree<T>::print() {
+  printBranch(root, 0);
+}
+
+/* Palauttaa true, jos avain on puussa. */
+template<typename T> bool BufferedBTree<T>::search(const T &key) {
+  BufferedBTreeNode<T> *node=root;
+  while (!node->isLeaf()) {
+    // Ylin viesti on uusin, joten se ratkaisee.
+    vector<BufferedMessage<T> > &buffer=node->getBuffer();
+    int i=messageIndex(buffer, key);
+    if (i<(int)buffer.size() && compare(buffer[i].key, key)==0)
+      return buffer[i].insert;
+    node=node->getBufferedChild(childIndex(node, key));
+  }
+
+  int lo=0, hi=node->numKeys();
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    if (compare(node->getKey(mid), key)<0) lo=mid+1;
+    else hi=mid;
+  }
+  return lo<node->numKeys() && compare(node->getKey(lo), key)==0;
+}
+
+/* Etsii puusta pienimmn avaimen, joka on suurempi tai yht suuri kuin
+   key. Palauttaa false, jos sellaista ei ole. */
+template<typename T> bool BufferedBTree<T>::ceilingKey(const T &key,
+                                                       T *result) {
+  vector<T> found;
+  vector<BufferedMessage<T> > pending;
+  if (!rangeBranch(root, &key, NULL, pending, 1, found)) return false;
+  *result=found[0];
+  return true;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+template<typename T> void BufferedBTree<T>::range(const T &lo, const T &hi,
+                                                  vector<T> &result) {
+  vector<BufferedMessage<T> > pending;
+  if (compare(lo, hi)<=0) rangeBranch(root, &lo, &hi, pending, 0, result);
+}
+
+/* Lis tulosvektoriin puun kaikki avaimet nousevassa jrjestyksess. */
+template<typename T> void BufferedBTree<T>::keys(vector<T> &result) {
+  vector<BufferedMessage<T> > pending;
+  rangeBranch(root, NULL, NULL, pending, 0, result);
+}
+
+/* Lis puun muistinkytn erittelyyn sissolmuina ("internal d"),
+   lehtin ("leaf d") ja puskureina ("buffer d") syvyyksittin d. */
+template<typename T> void BufferedBTree<T>::memoryUsage(MemoryUsage &usage) {
+  vector<long long> nodes, live, allocated;
+  memoryBranch(root, 0, nodes, live, allocated);
+  const char *names[3]={"internal ", "leaf ", "buffer "};
+  for (unsigned int i=0; i<nodes.size(); i++)
+    if (nodes[i]>0) {
+      stringstream ss;
+      ss << names[i%3] << i/3;
+      usage.add(ss.str(), nodes[i], live[i], allocated[i]);
+    }
+}
+
+/* Tarkistaa, ett puu tytt mritelmns ja sislt tsmlleen
+   annetut avaimet. */
+template<typename T> void BufferedBTree<T>::validate(const vector<T> &keys) {
+  int leafDepth=-1;
+  validateBranch(root, 0, NULL, NULL, &leafDepth);
+  if (!orphans.empty()) {
+    cerr << "VALIDATE: Orphaned messages." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  vector<T> found;
+  found.reserve(keys.size());
+  this->keys(found);
+  validateKeys(found, keys, compare);
+}
+
+/* Lis avaimen puuhun. */
+template<typename T> void BufferedBTree<T>::insert(const T &key) {
+  BufferedMessage<T> message;
+  message.key=key;
+  message.insert=true;
+  put(message);
+
+  // Juuren tuhoutuessa sen viestit listn uudelleen. Viesteiss kukin
+  // avain esiintyy vain kerran, joten niiden jrjestyksell ei ole vli.
+  while (!orphans.empty()) {
+    vector<BufferedMessage<T> > messages;
+    messages.swap(orphans);
+    for (unsigned int i=0; i<messages.size(); i++) put(messages[i]);
+  }
+}
+
+/* Poistaa avaimen puusta. */
+template<typename T> void BufferedBTree<T>::remove(const T &key) {
+  BufferedMessage<T> message;
+  message.key=key;
+  message.insert=false;
+  put(message);
+
+  while (!orphans.empty()) {
+    vector<BufferedMessage<T> > messages;
+    messages.swap(orphans);
+    for (unsigned int i=0; i<messages.size(); i++) put(messages[i]);
+  }
+}
+
+/* Palauttaa puskurien tyhjennyserien mrn. */
+template<typename T> long long BufferedBTree<T>::getFlushes() const {
+  return flushes;
+}
+
+/* Palauttaa eriss lapsille siirrettyjen viestien mrn. */
+template<typename T> long long BufferedBTree<T>::getFlushedMessages() const {
+  return flushedMessages;
+}
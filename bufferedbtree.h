@@ -0,0 +1,207 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa kirjoituksille optimoidun puskuroidun B-puun (B^e-puu). Puun
+sissolmuissa on viestipuskuri, johon lisykset ja poistot kirjataan
+viestein sen sijaan, ett ne vietisiin heti lehteen asti. Kun puskuri
+tyttyy, viestit siirretn eriss sille lapselle, jolle niit on eniten,
+joten yksi laskeutuminen vie monta viesti kerralla alemmas. Haut
+tarkistavat hakupolun puskurit juuresta alkaen; ylempi viesti on uudempi
+ja ratkaisee, onko avain puussa.
+
+Avaimet ovat lehdiss (B+-puu), ja sissolmujen avaimet ovat pelkki
+ohjausavaimia: avain kuuluu lapseen, jonka indeksi on sit pienempien tai
+yht suurten ohjausavainten mr. Solmujen jaot, yhdistmiset ja kierrot
+tehdn BTreeNode-luokan avainten ja lapsiosoittimien siirtometodeilla.
+
+*/
+
+#ifndef BUFFEREDBTREE_H
+#define BUFFEREDBTREE_H
+
+#include <iostream>
+#include <vector>
+#include "btree.h"
+#include "memory.h"
+
+/* Puskuriin kirjattu lisys tai poisto. */
+template<typename T> struct BufferedMessage {
+  T key;
+  bool insert;
+};
+
+/* Puskuroidun B-puun solmu. Lehtien puskuri on aina tyhj. */
+template<typename T> class BufferedBTreeNode : public BTreeNode<T> {
+  std::vector<BufferedMessage<T> > buffer;
+
+public:
+  BufferedBTreeNode<T>(int degree, bool leaf, int debug);
+
+  /* Palauttaa puskurin. Viestit ovat avainten mukaan nousevassa
+     jrjestyksess, ja kukin avain esiintyy puskurissa enintn kerran. */
+  std::vector<BufferedMessage<T> > &getBuffer();
+
+  /* Palauttaa lapsen kohdasta index. */
+  BufferedBTreeNode<T> *getBufferedChild(int index) const;
+
+  /* Palauttaa avaimettoman sissolmun ainoan lapsen. */
+  BufferedBTreeNode<T> *getBufferedOnlyChild() const;
+
+  /* Palauttaa solmun, sen taulukoiden ja puskurin varaamat tavut. */
+  long long allocatedBytes() const;
+};
+
+/* Puskuroidun B-puun toteuttava luokka. Lisys ja poisto eivt tarkista,
+   onko avain jo puussa: olemassa olevan avaimen lisys ja puuttuvan
+   avaimen poisto eivt muuta puuta. */
+template<typename T> class BufferedBTree {
+  const int degree;
+  const unsigned int bufferSize;
+  BufferedBTreeNode<T> *root;
+  int (*const compare)(const T &, const T &);
+  std::vector<BufferedMessage<T> > orphans;
+  long long flushes, flushedMessages;
+  const int debug;
+
+protected:
+  /* Tuhoaa alipuun. */
+  void destroyBranch(BufferedBTreeNode<T> *branch);
+
+  /* Tulostaa alipuun solmut ja puskurit esijrjestyksess. */
+  void printBranch(BufferedBTreeNode<T> *node, int depth);
+
+  /* Palauttaa sen lapsen indeksin, johon avain kuuluu. */
+  int childIndex(BufferedBTreeNode<T> *node, const T &key);
+
+  /* Palauttaa ensimmisen puskurin viestin indeksin, jonka avain on
+     vhintn key. */
+  int messageIndex(const std::vector<BufferedMessage<T> > &buffer,
+                   const T &key);
+
+  /* Yhdist jrjestetyt viestit solmun puskuriin. Saman avaimen viesteist
+     silyy annettu, koska se on uudempi.
+     node = sissolmu
+     from, to = viestit from...to-1 */
+  void mergeMessages(BufferedBTreeNode<T> *node,
+                     const BufferedMessage<T> *from,
+                     const BufferedMessage<T> *to);
+
+  /* Tekee viestin mukaisen muutoksen lehteen. Lehdess on oltava tilaa
+     listtvlle avaimelle. */
+  void applyMessage(BufferedBTreeNode<T> *leaf,
+                    const BufferedMessage<T> &message);
+
+  /* Jakaa tyden lapsisolmun kahteen. Lehti jaetaan B+-puun tapaan niin,
+     ett oikean puoliskon pienin avain kopioidaan issolmuun; sissolmun
+     keskimminen avain siirretn issolmuun kuten B-puussa, ja puskurin
+     viestit jaetaan sen mukaan puoliskoille.
+     parent = issolmu, jossa on tilaa
+     index = lapsen indeksi
+     left = jaettava lapsi, josta tulee vasemmanpuoleinen puolisko */
+  void splitChild(BufferedBTreeNode<T> *parent, int index,
+                  BufferedBTreeNode<T> *left);
+
+  /* Korjaa vajaan lapsisolmun yhdistmll sen sisarsolmuun tai lainaamalla
+     sisarsolmulta avaimia. Palauttaa issolmun tai yhdistetyn solmun, jos
+     juuresta tuli tyhj ja se tuhottiin. Jos yhdistetty solmu on lehti,
+     juuren puskurin viestit siirretn orphans-vektoriin listtviksi
+     uudelleen.
+     parent = issolmu
+     index = vajaan lapsen indeksi */
+  BufferedBTreeNode<T> *fixChild(BufferedBTreeNode<T> *parent, int index);
+
+  /* Palauttaa sissolmun puskurin enimmiskoon. Lehtien issolmun
+     puskuri on enintn t*t viesti, jotta lehdet voivat ottaa sen vastaan
+     ilman, ett solmu tyttyy kesken tyhjennyksen. */
+  unsigned int bufferLimit(BufferedBTreeNode<T> *node);
+
+  /* Siirt solmun puskurista viestej eriss lapsille, kunnes puskuri ei
+     ylit kokoaan tai lapsia ei voi en jakaa, koska solmu on tynn.
+     Lehtien issolmun koko puskuri viedn kerralla lehtiin. Lopuksi korjaa vajaiksi jneet lapset.
+     node = sissolmu */
+  void flushNode(BufferedBTreeNode<T> *node);
+
+  /* Kasvattaa puuta jakamalla tyden juuren. */
+  void growRoot();
+
+  /* Kirjaa viestin puuhun. */
+  void put(const BufferedMessage<T> &message);
+
+  /* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+     jrjestyksess ottaen huomioon ylempien puskurien viestit. Palauttaa
+     true, jos tulosvektoriin kertyi limit avainta.
+     lo, hi = vlin rajat tai NULL, jos vli on rajoittamaton
+     pending = ylempien solmujen viestit alipuulle jrjestyksess
+     limit = avainten enimmismr tulosvektorissa, 0=rajoittamaton */
+  bool rangeBranch(BufferedBTreeNode<T> *node, const T *lo, const T *hi,
+                   const std::vector<BufferedMessage<T> > &pending,
+                   unsigned int limit, std::vector<T> &result);
+
+  /* Laskee alipuun muistinkytn syvyyksittin.
+     nodes, live, allocated = sissolmujen (indeksi 3*depth), lehtien
+                              (3*depth+1) ja puskurien (3*depth+2) summat */
+  void memoryBranch(BufferedBTreeNode<T> *node, int depth,
+                    std::vector<long long> &nodes,
+                    std::vector<long long> &live,
+                    std::vector<long long> &allocated);
+
+  /* Tarkistaa alipuun solmujen avainten mrt ja jrjestyksen, lehtien
+     syvyyden sek sen, ett avaimet ja puskurien viestit kuuluvat
+     alipuulle.
+     lo, hi = alipuun avainten vli [lo, hi) tai NULL, jos vli on
+              rajoittamaton
+     leafDepth = lehtien syvyys tai -1, jos lehte ei ole viel lydetty */
+  void validateBranch(BufferedBTreeNode<T> *node, int depth, const T *lo,
+                      const T *hi, int *leafDepth);
+
+public:
+  /* degree = puun aste; oltava >= 2; solmuissa on t-1...2*t-1 avainta
+     bufferSize = sissolmun puskurin koko viestein; oltava >= 1
+     compare = metodi avainten vertailemiseksi
+     debug = 1=lausekattavuustulostus */
+  BufferedBTree<T>(int degree, int bufferSize,
+                   int (*const compare)(const T &, const T &), int debug);
+
+  ~BufferedBTree<T>();
+
+  /* Tulostaa puun solmut ja puskurit esijrjestyksess. */
+  void print();
+
+  /* Palauttaa true, jos avain on puussa. */
+  bool search(const T &key);
+
+  /* Etsii puusta pienimmn avaimen, joka on suurempi tai yht suuri kuin
+     key. Palauttaa false, jos sellaista ei ole. */
+  bool ceilingKey(const T &key, T *result);
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+
+  /* Lis tulosvektoriin puun kaikki avaimet nousevassa jrjestyksess. */
+  void keys(std::vector<T> &result);
+
+  /* Lis puun muistinkytn erittelyyn sissolmuina ("internal d"),
+     lehtin ("leaf d") ja puskureina ("buffer d") syvyyksittin d. */
+  void memoryUsage(MemoryUsage &usage);
+
+  /* Tarkistaa, ett puu tytt mritelmns ja sislt tsmlleen
+     annetut avaimet. */
+  void validate(const std::vector<T> &keys);
+
+  /* Lis avaimen puuhun. */
+  void insert(const T &key);
+
+  /* Poistaa avaimen puusta. */
+  void remove(const T &key);
+
+  /* Palauttaa puskurien tyhjennyserien mrn. */
+  long long getFlushes() const;
+
+  /* Palauttaa eriss lapsille siirrettyjen viestien mrn. */
+  long long getFlushedMessages() const;
+};
+
+#endif
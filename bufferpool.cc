@@ -0,0 +1,199 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa levylle tallennettujen kiinten kokoisten sivujen puskurivarannon,
+jossa sivut poistetaan muistista kello-algoritmilla (second chance).
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bufferpool.h"
+
+using namespace std;
+
+/* fileName = tiedosto, johon sivut tallennetaan
+   pageSize = sivun koko tavuina
+   numFrames = muistissa pidettvien sivujen enimmismr
+   create = true=luo uuden tyhjn tiedoston, false=avaa olemassa olevan */
+BufferPool::BufferPool(const char *fileName, int pageSize, int numFrames,
+                       bool create) :
+  pageSize(pageSize), numFrames(numFrames), numPages(0), clockHand(0),
+  numReads(0), numWrites(0), numHits(0), numMisses(0) {
+  if (pageSize<1 || numFrames<1) {
+    cerr << "BufferPool(): Invalid page size or number of frames." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  fd=open(fileName, create ? O_RDWR|O_CREAT|O_TRUNC : O_RDWR, 0644);
+  if (fd<0) {
+    cerr << "Could not open page file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st)==0) numPages=st.st_size/pageSize;
+  pageTable.assign(numPages, -1);
+
+  data=new char[(long)pageSize*numFrames];
+  frame=new Frame[numFrames];
+  for (int i=0; i<numFrames; i++) {
+    frame[i].page=-1;
+    frame[i].pins=0;
+    frame[i].dirty=false;
+    frame[i].referenced=false;
+  }
+}
+
+/* Kirjoittaa likaiset sivut levylle ja sulkee tiedoston. */
+BufferPool::~BufferPool() {
+  flush();
+  close(fd);
+  delete[] frame;
+  delete[] data;
+}
+
+/* Kirjoittaa kehyksen sivun levylle.
+   index = kehyksen indeksi */
+void BufferPool::writeFrame(int index) {
+  if (pwrite(fd, data+(long)index*pageSize, pageSize,
+             (off_t)frame[index].page*pageSize)!=pageSize) {
+    cerr << "BufferPool: Could not write page " << frame[index].page << "."
+         << endl;
+    raise(SIGABRT);
+    return;
+  }
+  frame[index].dirty=false;
+  numWrites++;
+}
+
+/* Etsii kello-algoritmilla vapaan kehyksen ja kirjoittaa sen sislln
+   tarvittaessa levylle. Palauttaa kehyksen indeksin. */
+int BufferPool::victim() {
+  // Kierretn kehykset enintn kahdesti: ensimmisell kierroksella
+  // viittausbitit nollataan, toisella lytyy viimeistn vapaa kehys.
+  for (int n=0; n<2*numFrames; n++) {
+    int i=clockHand;
+    clockHand=(clockHand+1)%numFrames;
+    if (frame[i].pins>0) continue;
+    if (frame[i].referenced) {
+      frame[i].referenced=false;
+      continue;
+    }
+    if (frame[i].page>=0) {
+      if (frame[i].dirty) writeFrame(i);
+      pageTable[frame[i].page]=-1;
+      frame[i].page=-1;
+    }
+    return i;
+  }
+
+  cerr << "BufferPool: All frames are pinned." << endl;
+  raise(SIGABRT);
+  return -1;
+}
+
+/* Kiinnitt sivun muistiin ja palauttaa osoittimen sen sisltn.
+   page = sivun numero */
+char *BufferPool::pin(int page) {
+  if (page<0 || page>=numPages) {
+    cerr << "pin(): Invalid page " << page << "." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+
+  int i=pageTable[page];
+  if (i>=0) numHits++;
+  else {
+    numMisses++;
+    i=victim();
+    if (pread(fd, data+(long)i*pageSize, pageSize,
+              (off_t)page*pageSize)!=pageSize) {
+      cerr << "BufferPool: Could not read page " << page << "." << endl;
+      raise(SIGABRT);
+      return NULL;
+    }
+    numReads++;
+    frame[i].page=page;
+    frame[i].dirty=false;
+    pageTable[page]=i;
+  }
+  frame[i].pins++;
+  frame[i].referenced=true;
+  return data+(long)i*pageSize;
+}
+
+/* Vapauttaa sivun kiinnityksen.
+   page = sivun numero
+   dirty = true, jos sivun sislt on muutettu */
+void BufferPool::unpin(int page, bool dirty) {
+  int i=(page>=0 && page<numPages) ? pageTable[page] : -1;
+  if (i<0 || frame[i].pins<1) {
+    cerr << "unpin(): Page " << page << " is not pinned." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  frame[i].pins--;
+  if (dirty) frame[i].dirty=true;
+}
+
+/* Varaa tiedoston loppuun uuden nollatun sivun ja kiinnitt sen.
+   page = uuden sivun numero palautetaan thn */
+char *BufferPool::allocate(int *page) {
+  int i=victim();
+  *page=numPages++;
+  pageTable.push_back(i);
+  frame[i].page=*page;
+  frame[i].pins=1;
+  frame[i].referenced=true;
+  frame[i].dirty=true;
+  memset(data+(long)i*pageSize, 0, pageSize);
+  return data+(long)i*pageSize;
+}
+
+/* Kirjoittaa kaikki likaiset sivut levylle. */
+void BufferPool::flush() {
+  for (int i=0; i<numFrames; i++)
+    if (frame[i].page>=0 && frame[i].dirty) writeFrame(i);
+}
+
+/* Palauttaa sivun koon tavuina. */
+int BufferPool::getPageSize() const {
+  return pageSize;
+}
+
+/* Palauttaa tiedoston sivujen lukumrn. */
+int BufferPool::getNumPages() const {
+  return numPages;
+}
+
+/* Palauttaa levylt luettujen sivujen lukumrn. */
+long long BufferPool::getReads() const {
+  return numReads;
+}
+
+/* Palauttaa levylle kirjoitettujen sivujen lukumrn. */
+long long BufferPool::getWrites() const {
+  return numWrites;
+}
+
+/* Palauttaa osumasuhteen eli muistista lytyneiden sivujen osuuden
+   kaikista kiinnityksist. */
+double BufferPool::getHitRatio() const {
+  if (numHits+numMisses==0) return 0;
+  return double(numHits)/(numHits+numMisses);
+}
+
+/* Nollaa luku-, kirjoitus- ja osumalaskurit. */
+void BufferPool::resetStats() {
+  numReads=numWrites=numHits=numMisses=0;
+}
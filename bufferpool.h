@@ -0,0 +1,93 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa levylle tallennettujen kiinten kokoisten sivujen puskurivarannon,
+jossa sivut poistetaan muistista kello-algoritmilla (second chance).
+
+*/
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <vector>
+
+/* Puskurivarannon toteuttava luokka. Sivut luetaan tiedostosta kehyksiin,
+   joita on kiinte mr. Kiinnitetty (pin) sivua ei poisteta muistista,
+   ja likainen (dirty) sivu kirjoitetaan levylle ennen kehyksen
+   uudelleenkytt. */
+class BufferPool {
+  struct Frame {
+    int page;
+    int pins;
+    bool dirty;
+    bool referenced;
+  };
+
+  int fd;
+  const int pageSize;
+  const int numFrames;
+  char *data;
+  Frame *frame;
+  std::vector<int> pageTable;
+  int numPages;
+  int clockHand;
+  long long numReads, numWrites, numHits, numMisses;
+
+protected:
+  /* Etsii kello-algoritmilla vapaan kehyksen ja kirjoittaa sen sislln
+     tarvittaessa levylle. Palauttaa kehyksen indeksin. */
+  int victim();
+
+  /* Kirjoittaa kehyksen sivun levylle.
+     index = kehyksen indeksi */
+  void writeFrame(int index);
+
+public:
+  /* fileName = tiedosto, johon sivut tallennetaan
+     pageSize = sivun koko tavuina
+     numFrames = muistissa pidettvien sivujen enimmismr
+     create = true=luo uuden tyhjn tiedoston, false=avaa olemassa olevan */
+  BufferPool(const char *fileName, int pageSize, int numFrames, bool create);
+
+  /* Kirjoittaa likaiset sivut levylle ja sulkee tiedoston. */
+  ~BufferPool();
+
+  /* Kiinnitt sivun muistiin ja palauttaa osoittimen sen sisltn.
+     page = sivun numero */
+  char *pin(int page);
+
+  /* Vapauttaa sivun kiinnityksen.
+     page = sivun numero
+     dirty = true, jos sivun sislt on muutettu */
+  void unpin(int page, bool dirty);
+
+  /* Varaa tiedoston loppuun uuden nollatun sivun ja kiinnitt sen.
+     page = uuden sivun numero palautetaan thn */
+  char *allocate(int *page);
+
+  /* Kirjoittaa kaikki likaiset sivut levylle. */
+  void flush();
+
+  /* Palauttaa sivun koon tavuina. */
+  int getPageSize() const;
+
+  /* Palauttaa tiedoston sivujen lukumrn. */
+  int getNumPages() const;
+
+  /* Palauttaa levylt luettujen sivujen lukumrn. */
+  long long getReads() const;
+
+  /* Palauttaa levylle kirjoitettujen sivujen lukumrn. */
+  long long getWrites() const;
+
+  /* Palauttaa osumasuhteen eli muistista lytyneiden sivujen osuuden
+     kaikista kiinnityksist. */
+  double getHitRatio() const;
+
+  /* Nollaa luku-, kirjoitus- ja osumalaskurit. */
+  void resetStats();
+};
+
+#endif
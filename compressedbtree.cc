@@ -0,0 +1,496 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa kokonaislukuavaimille B-puun, jonka lehdet on pakattu
+viitearvokoodauksella (frame of reference): lehti tallentaa pienimmn
+avaimen sek muiden avainten erotukset siihen kiinten levyisin (1, 2, 4
+tai 8 tavua). Lehtien kapasiteetti mrytyy tavumrn eik puun asteen
+mukaan. Lehtien hakemistona kytetn tavallista B-puuta.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "compressedbtree.h"
+#include "btree.h"
+
+using namespace std;
+
+/* Palauttaa pienimmn tavumrn, jolla erotus voidaan esitt. */
+template<typename T> int PackedLeaf<T>::widthFor(unsigned long long delta) {
+  if (delta<=0xffULL) return 1;
+  if (delta<=0xffffULL) return 2;
+  if (delta<=0xffffffffULL) return 4;
+  return 8;
+}
+
+/* bytes = lehden avaimille varattu tavumr */
+template<typename T> PackedLeaf<T>::PackedLeaf<T>(int bytes) :
+  base(0), count(0), width(1), bytes(bytes), next(NULL) {
+  if (bytes<16) {
+    cerr << "PackedLeaf(): Leaf must have at least 16 bytes." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Varataan tila 16 tavun kerrannaisena, jotta SIMD-vertailu voi lukea
+  // viimeisenkin lohkon kokonaan.
+  data=new unsigned char[(bytes+15)&~15];
+}
+
+template<typename T> PackedLeaf<T>::~PackedLeaf<T>() {
+  delete[] data;
+}
+
+/* Palauttaa erotuksen kohdasta index. */
+template<typename T> unsigned long long PackedLeaf<T>::getDelta(
+  int index) const {
+  switch (width) {
+  case 1:
+    return data[index];
+  case 2: {
+    unsigned short d;
+    memcpy(&d, data+2*index, 2);
+    return d;
+  }
+  case 4: {
+    unsigned int d;
+    memcpy(&d, data+4*index, 4);
+    return d;
+  }
+  default: {
+    unsigned long long d;
+    memcpy(&d, data+8*index, 8);
+    return d;
+  }
+  }
+}
+
+/* Asettaa erotuksen kohtaan index. */
+template<typename T> void PackedLeaf<T>::setDelta(unsigned long long delta,
+                                                  int index) {
+  switch (width) {
+  case 1:
+    data[index]=(unsigned char)delta;
+    break;
+  case 2: {
+    unsigned short d=(unsigned short)delta;
+    memcpy(data+2*index, &d, 2);
+    break;
+  }
+  case 4: {
+    unsigned int d=(unsigned int)delta;
+    memcpy(data+4*index, &d, 4);
+    break;
+  }
+  default:
+    memcpy(data+8*index, &delta, 8);
+  }
+}
+
+/* Palauttaa avainten lukumrn. */
+template<typename T> int PackedLeaf<T>::numKeys() const {
+  return count;
+}
+
+/* Palauttaa erotusten leveyden tavuina. */
+template<typename T> int PackedLeaf<T>::getWidth() const {
+  return width;
+}
+
+/* Palauttaa lehden avaimille varatun tavumrn. */
+template<typename T> int PackedLeaf<T>::getBytes() const {
+  return bytes;
+}
+
+/* Palauttaa avaimen kohdasta index. */
+template<typename T> T PackedLeaf<T>::getKey(int index) const {
+  if (index<0 || index>=count) {
+    cerr << "getKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return base;
+  }
+  return T((unsigned long long)base+getDelta(index));
+}
+
+/* Palauttaa seuraavan lehden tai NULL, jos lehti on viimeinen. */
+template<typename T> PackedLeaf<T> *PackedLeaf<T>::getNext() const {
+  return next;
+}
+
+/* Asettaa seuraavan lehden. */
+template<typename T> void PackedLeaf<T>::setNext(PackedLeaf<T> *newNext) {
+  next=newNext;
+}
+
+/* Palauttaa avaimen indeksin tai -1, jos avainta ei ole lehdess. Vertailu
+   tehdn erotuksille SIMD-kskyill, jos ne ovat kytettviss. */
+template<typename T> int PackedLeaf<T>::find(const T &key) const {
+  if (count==0 || key<base) return -1;
+  unsigned long long delta=(unsigned long long)key-(unsigned long long)base;
+  if (widthFor(delta)>width) return -1;
+
+#ifdef __SSE2__
+  // Verrataan 16 tavua kerrallaan. Vertailun tuloksen bittimaskissa on yksi
+  // bitti tavua kohden, joten erotuksen indeksi saadaan jakamalla
+  // ensimmisen asetetun bitin paikka leveydell.
+  if (width<8) {
+    __m128i target;
+    if (width==1) target=_mm_set1_epi8((char)delta);
+    else if (width==2) target=_mm_set1_epi16((short)delta);
+    else target=_mm_set1_epi32((int)delta);
+
+    int total=count*width;
+    for (int offset=0; offset<total; offset+=16) {
+      __m128i chunk=_mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data+offset));
+      __m128i eq;
+      if (width==1) eq=_mm_cmpeq_epi8(chunk, target);
+      else if (width==2) eq=_mm_cmpeq_epi16(chunk, target);
+      else eq=_mm_cmpeq_epi32(chunk, target);
+      int mask=_mm_movemask_epi8(eq);
+      if (total-offset<16) mask&=(1<<(total-offset))-1;
+      if (mask) return (offset+__builtin_ctz(mask))/width;
+    }
+    return -1;
+  }
+#endif
+
+  int i=lowerBound(key);
+  if (i<count && getDelta(i)==delta) return i;
+  return -1;
+}
+
+/* Palauttaa ensimmisen indeksin, jonka avain on vhintn key. */
+template<typename T> int PackedLeaf<T>::lowerBound(const T &key) const {
+  if (count==0 || key<=base) return 0;
+  unsigned long long delta=(unsigned long long)key-(unsigned long long)base;
+  int lo=0, hi=count;
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    if (getDelta(mid)<delta) lo=mid+1;
+    else hi=mid;
+  }
+  return lo;
+}
+
+/* Purkaa lehden avaimet vektoriin. */
+template<typename T> void PackedLeaf<T>::decode(vector<T> &keys) const {
+  for (int i=0; i<count; i++) keys.push_back(getKey(i));
+}
+
+/* Koodaa lehteen avaimet keys[from]...keys[to-1]. Palauttaa false ja
+   jtt lehden ennalleen, jos avaimet eivt mahdu lehteen. */
+template<typename T> bool PackedLeaf<T>::encode(const vector<T> &keys,
+                                                int from, int to) {
+  if (to<=from) {
+    count=0;
+    return true;
+  }
+  int w=widthFor((unsigned long long)keys[to-1]-
+                 (unsigned long long)keys[from]);
+  if ((to-from)*w>bytes) return false;
+
+  base=keys[from];
+  width=w;
+  count=to-from;
+  for (int i=0; i<count; i++)
+    setDelta((unsigned long long)keys[from+i]-(unsigned long long)base, i);
+  return true;
+}
+
+/* Lis avaimen oikeaan kohtaan. Palauttaa false ja jtt lehden
+   ennalleen, jos avain ei mahdu lehteen. */
+template<typename T> bool PackedLeaf<T>::insert(const T &key) {
+  int index=lowerBound(key);
+
+  // Jos erotus mahtuu nykyiseen leveyteen, siirretn vain perss olevia
+  // erotuksia eik lehte tarvitse koodata uudelleen.
+  if (count>0 && !(key<base) && (count+1)*width<=bytes) {
+    unsigned long long delta=(unsigned long long)key-
+      (unsigned long long)base;
+    if (widthFor(delta)<=width) {
+      memmove(data+(index+1)*width, data+index*width,
+              (count-index)*width);
+      setDelta(delta, index);
+      count++;
+      return true;
+    }
+  }
+
+  vector<T> keys;
+  decode(keys);
+  keys.insert(keys.begin()+index, key);
+  return encode(keys, 0, keys.size());
+}
+
+/* Poistaa avaimen kohdasta index. */
+template<typename T> void PackedLeaf<T>::remove(int index) {
+  if (index<0 || index>=count) {
+    cerr << "remove(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Pohja-arvo j ennalleen, sill se on edelleen pienempi tai yht suuri
+  // kuin jljelle jvt avaimet.
+  memmove(data+index*width, data+(index+1)*width, (count-index-1)*width);
+  count--;
+}
+
+/* Vertailee hakemiston alkioita alarajojen perusteella. */
+template<typename T> int CompressedBTree<T>::compareEntries(
+  const PackedLeafEntry<T> &a, const PackedLeafEntry<T> &b) {
+  if (a.fence<b.fence) return -1;
+  if (a.fence>b.fence) return 1;
+  return 0;
+}
+
+/* degree = hakemistona kytettvn B-puun aste
+   leafBytes = lehden avaimille varattu tavumr; oltava >= 16
+   debug = 1=lausekattavuustulostus */
+template<typename T> CompressedBTree<T>::CompressedBTree<T>(int degree,
+                                                            int leafBytes,
+                                                            int debug=0) :
+  leafBytes(leafBytes), index(degree, &compareEntries, 0), numLeaves(1),
+  numKeys(0), debug(debug) {
+  if (!numeric_limits<T>::is_integer) {
+    cerr << "CompressedBTree(): Keys must be integers." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Ensimminen lehti kattaa kaikki avaimet, jotka ovat pienempi kuin
+  // toisen lehden alaraja, joten sit ei koskaan poisteta.
+  first=new PackedLeaf<T>(leafBytes);
+  PackedLeafEntry<T> entry;
+  entry.fence=numeric_limits<T>::min();
+  entry.leaf=first;
+  index.insert(entry);
+}
+
+template<typename T> CompressedBTree<T>::~CompressedBTree<T>() {
+  PackedLeaf<T> *leaf=first;
+  while (leaf) {
+    PackedLeaf<T> *tmp=leaf->getNext();
+    delete leaf;
+    leaf=tmp;
+  }
+}
+
+/* Palauttaa hakemiston alkion, jonka lehteen avain kuuluu. */
+template<typename T> PackedLeafEntry<T> CompressedBTree<T>::findEntry(
+  const T &key) {
+  PackedLeafEntry<T> probe, result;
+  probe.fence=key;
+  probe.leaf=NULL;
+  index.floorKey(probe, &result);
+  return result;
+}
+
+/* Lis lehden hakemistoon ja lehtien ketjuun annetun lehden pern.
+   previous = lehti, jonka pern uusi lehti listn
+   leaf = listtv lehti; sen alarajaksi tulee sen pienin avain */
+template<typename T> void CompressedBTree<T>::linkLeaf(
+  PackedLeaf<T> *previous, PackedLeaf<T> *leaf) {
+  leaf->setNext(previous->getNext());
+  previous->setNext(leaf);
+  PackedLeafEntry<T> entry;
+  entry.fence=leaf->getKey(0);
+  entry.leaf=leaf;
+  index.insert(entry);
+  numLeaves++;
+}
+
+/* Poistaa lehden hakemistosta ja lehtien ketjusta ja tuhoaa sen.
+   previous = lehte edeltv lehti
+   entry = poistettavan lehden hakemiston alkio */
+template<typename T> void CompressedBTree<T>::unlinkLeaf(
+  PackedLeaf<T> *previous, const PackedLeafEntry<T> &entry) {
+  previous->setNext(entry.leaf->getNext());
+  index.remove(entry);
+  delete entry.leaf;
+  numLeaves--;
+}
+
+/* Palauttaa true, jos avain on puussa. */
+template<typename T> bool CompressedBTree<T>::search(const T &key) {
+  return findEntry(key).leaf->find(key)>=0;
+}
+
+/* Lis avaimen puuhun. */
+template<typename T> void CompressedBTree<T>::insert(const T &key) {
+  PackedLeaf<T> *leaf=findEntry(key).leaf;
+  if (leaf->find(key)>=0) {
+    cerr << "Insertion of multiple same keys unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  numKeys++;
+  if (leaf->insert(key)) {
+    if (debug==1) cout << "insert(): 1" << endl;
+    return;
+  }
+
+  // Avain ei mahtunut lehteen. Jaetaan avaimet ensisijaisesti kahteen
+  // yht suureen lehteen. Jos erotukset vaativat jommassakummassa
+  // puoliskossa liian leven esityksen, tytetn lehti jrjestyksess
+  // niin tyteen kuin mahdollista.
+  if (debug==1) cout << "insert(): 2" << endl;
+  vector<T> keys;
+  leaf->decode(keys);
+  keys.insert(keys.begin()+leaf->lowerBound(key), key);
+
+  int n=keys.size(), mid=n/2;
+  vector<int> bounds;
+  PackedLeaf<T> probe(leafBytes);
+  if (probe.encode(keys, 0, mid) && probe.encode(keys, mid, n)) {
+    bounds.push_back(mid);
+    bounds.push_back(n);
+  }
+  else {
+    if (debug==1) cout << "insert(): 3" << endl;
+    int from=0;
+    while (from<n) {
+      int to=from+1;
+      while (to<n && probe.encode(keys, from, to+1)) to++;
+      bounds.push_back(to);
+      from=to;
+    }
+  }
+
+  leaf->encode(keys, 0, bounds[0]);
+  for (unsigned int i=1; i<bounds.size(); i++) {
+    PackedLeaf<T> *right=new PackedLeaf<T>(leafBytes);
+    right->encode(keys, bounds[i-1], bounds[i]);
+    linkLeaf(leaf, right);
+    leaf=right;
+  }
+}
+
+/* Poistaa avaimen puusta. */
+template<typename T> void CompressedBTree<T>::remove(const T &key) {
+  PackedLeafEntry<T> entry=findEntry(key);
+  PackedLeaf<T> *leaf=entry.leaf;
+  int i=leaf->find(key);
+  if (i<0) return;
+  leaf->remove(i);
+  numKeys--;
+
+  if (leaf->numKeys()==0 && leaf!=first) {
+    // Tyhj lehti poistetaan. Lehden alaraja on suurempi kuin ensimmisen
+    // lehden, joten sit pienempi avain johtaa edeltvn lehteen.
+    if (debug==1) cout << "remove(): 1" << endl;
+    unlinkLeaf(findEntry(entry.fence-1).leaf, entry);
+    return;
+  }
+
+  // Vajaaksi jnyt lehti yhdistetn seuraavaan lehteen, jos avaimet
+  // mahtuvat samaan lehteen.
+  PackedLeaf<T> *next=leaf->getNext();
+  if (next && leaf->numKeys()*leaf->getWidth()<leafBytes/4) {
+    vector<T> keys;
+    leaf->decode(keys);
+    next->decode(keys);
+    PackedLeafEntry<T> nextEntry=findEntry(next->getKey(0));
+    if (leaf->encode(keys, 0, keys.size())) {
+      if (debug==1) cout << "remove(): 2" << endl;
+      unlinkLeaf(leaf, nextEntry);
+    }
+  }
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+template<typename T> void CompressedBTree<T>::range(const T &lo, const T &hi,
+                                                    vector<T> &result) {
+  PackedLeaf<T> *leaf=findEntry(lo).leaf;
+  for (int i=leaf->lowerBound(lo); leaf; leaf=leaf->getNext(), i=0)
+    for (; i<leaf->numKeys(); i++) {
+      T key=leaf->getKey(i);
+      if (hi<key) return;
+      result.push_back(key);
+    }
+}
+
+/* Palauttaa lehtien lukumrn. */
+template<typename T> int CompressedBTree<T>::getLeaves() const {
+  return numLeaves;
+}
+
+/* Palauttaa lehtien avaimille varattujen tavujen mrn. */
+template<typename T> long long CompressedBTree<T>::getLeafBytes() const {
+  return (long long)numLeaves*leafBytes;
+}
+
+/* Tarkistaa, ett lehdet ovat jrjestyksess ja hakemiston mukaisia ja
+   ett puu sislt tsmlleen annetut avaimet. */
+template<typename T> void CompressedBTree<T>::validate(
+  const vector<T> &keys) {
+  int leaves=0, total=0;
+  bool previous=false;
+  T last=T();
+  for (PackedLeaf<T> *leaf=first; leaf; leaf=leaf->getNext()) {
+    leaves++;
+    total+=leaf->numKeys();
+
+    if (leaf!=first && leaf->numKeys()==0) {
+      cerr << "VALIDATE: Empty leaf." << endl;
+      raise(SIGABRT);
+      return;
+    }
+
+    // Tarkistetaan, ett avaimet ovat kasvavassa jrjestyksess mys
+    // lehtien rajojen yli.
+    for (int i=0; i<leaf->numKeys(); i++) {
+      if (previous && !(last<leaf->getKey(i))) {
+        cerr << "VALIDATE: Keys not in order." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      last=leaf->getKey(i);
+      previous=true;
+    }
+
+    // Tarkistetaan, ett hakemisto ohjaa lehden avaimet thn lehteen.
+    if (leaf->numKeys()>0 &&
+        (findEntry(leaf->getKey(0)).leaf!=leaf ||
+         findEntry(leaf->getKey(leaf->numKeys()-1)).leaf!=leaf)) {
+      cerr << "VALIDATE: Leaf not in index." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+
+  if (leaves!=numLeaves || total!=numKeys ||
+      (unsigned int)total!=keys.size()) {
+    cerr << "VALIDATE: Wrong number of keys or leaves." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  for (unsigned int i=0; i<keys.size(); i++)
+    if (!search(keys[i])) {
+      cerr << "VALIDATE: Missing key." << endl;
+      raise(SIGABRT);
+      return;
+    }
+}
+
+/* Tulostaa lehdet ja niiden avaimet. */
+template<typename T> void CompressedBTree<T>::print() {
+  for (PackedLeaf<T> *leaf=first; leaf; leaf=leaf->getNext()) {
+    cout << "address=" << reinterpret_cast<const void *>(leaf)
+         << ", width=" << leaf->getWidth() << ", keys=";
+    for (int i=0; i<leaf->numKeys(); i++)
+      cout << leaf->getKey(i) << (i<leaf->numKeys()-1 ? " " : "");
+    cout << endl;
+  }
+}
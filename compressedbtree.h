@@ -0,0 +1,154 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa kokonaislukuavaimille B-puun, jonka lehdet on pakattu
+viitearvokoodauksella (frame of reference): lehti tallentaa pienimmn
+avaimen sek muiden avainten erotukset siihen kiinten levyisin (1, 2, 4
+tai 8 tavua). Lehtien kapasiteetti mrytyy tavumrn eik puun asteen
+mukaan. Lehtien hakemistona kytetn tavallista B-puuta.
+
+*/
+
+#ifndef COMPRESSEDBTREE_H
+#define COMPRESSEDBTREE_H
+
+#include <iostream>
+#include <vector>
+#include "btree.h"
+
+/* Pakattu lehti, joka sislt nousevassa jrjestyksess olevat avaimet.
+   Lehdet on linkitetty jrjestyksess toisiinsa. */
+template<typename T> class PackedLeaf {
+  T base;
+  int count;
+  int width;
+  const int bytes;
+  unsigned char *data;
+  PackedLeaf<T> *next;
+
+  /* Palauttaa erotuksen kohdasta index. */
+  unsigned long long getDelta(int index) const;
+
+  /* Asettaa erotuksen kohtaan index. */
+  void setDelta(unsigned long long delta, int index);
+
+public:
+  /* Palauttaa pienimmn tavumrn, jolla erotus voidaan esitt. */
+  static int widthFor(unsigned long long delta);
+
+  /* bytes = lehden avaimille varattu tavumr */
+  PackedLeaf<T>(int bytes);
+  ~PackedLeaf<T>();
+
+  /* Palauttaa avainten lukumrn. */
+  int numKeys() const;
+
+  /* Palauttaa erotusten leveyden tavuina. */
+  int getWidth() const;
+
+  /* Palauttaa lehden avaimille varatun tavumrn. */
+  int getBytes() const;
+
+  /* Palauttaa avaimen kohdasta index. */
+  T getKey(int index) const;
+
+  /* Palauttaa seuraavan lehden tai NULL, jos lehti on viimeinen. */
+  PackedLeaf<T> *getNext() const;
+
+  /* Asettaa seuraavan lehden. */
+  void setNext(PackedLeaf<T> *newNext);
+
+  /* Palauttaa avaimen indeksin tai -1, jos avainta ei ole lehdess. Vertailu
+     tehdn erotuksille SIMD-kskyill, jos ne ovat kytettviss. */
+  int find(const T &key) const;
+
+  /* Palauttaa ensimmisen indeksin, jonka avain on vhintn key. */
+  int lowerBound(const T &key) const;
+
+  /* Purkaa lehden avaimet vektoriin. */
+  void decode(std::vector<T> &keys) const;
+
+  /* Koodaa lehteen avaimet keys[from]...keys[to-1]. Palauttaa false ja
+     jtt lehden ennalleen, jos avaimet eivt mahdu lehteen. */
+  bool encode(const std::vector<T> &keys, int from, int to);
+
+  /* Lis avaimen oikeaan kohtaan. Palauttaa false ja jtt lehden
+     ennalleen, jos avain ei mahdu lehteen. */
+  bool insert(const T &key);
+
+  /* Poistaa avaimen kohdasta index. */
+  void remove(int index);
+};
+
+/* Hakemiston alkio, joka liitt lehden alarajan (fence) lehteen. Lehden
+   kaikki avaimet ovat vhintn alaraja ja pienempi kuin seuraavan lehden
+   alaraja. */
+template<typename T> struct PackedLeafEntry {
+  T fence;
+  PackedLeaf<T> *leaf;
+};
+
+/* Pakattujen lehtien B-puun toteuttava luokka. */
+template<typename T> class CompressedBTree {
+  const int leafBytes;
+  BTree<PackedLeafEntry<T> > index;
+  PackedLeaf<T> *first;
+  int numLeaves, numKeys;
+  const int debug;
+
+  /* Vertailee hakemiston alkioita alarajojen perusteella. */
+  static int compareEntries(const PackedLeafEntry<T> &a,
+                            const PackedLeafEntry<T> &b);
+
+protected:
+  /* Palauttaa hakemiston alkion, jonka lehteen avain kuuluu. */
+  PackedLeafEntry<T> findEntry(const T &key);
+
+  /* Lis lehden hakemistoon ja lehtien ketjuun annetun lehden pern.
+     previous = lehti, jonka pern uusi lehti listn
+     leaf = listtv lehti; sen alarajaksi tulee sen pienin avain */
+  void linkLeaf(PackedLeaf<T> *previous, PackedLeaf<T> *leaf);
+
+  /* Poistaa lehden hakemistosta ja lehtien ketjusta ja tuhoaa sen.
+     previous = lehte edeltv lehti
+     entry = poistettavan lehden hakemiston alkio */
+  void unlinkLeaf(PackedLeaf<T> *previous, const PackedLeafEntry<T> &entry);
+
+public:
+  /* degree = hakemistona kytettvn B-puun aste
+     leafBytes = lehden avaimille varattu tavumr; oltava >= 16
+     debug = 1=lausekattavuustulostus */
+  CompressedBTree<T>(int degree, int leafBytes, int debug);
+
+  ~CompressedBTree<T>();
+
+  /* Palauttaa true, jos avain on puussa. */
+  bool search(const T &key);
+
+  /* Lis avaimen puuhun. */
+  void insert(const T &key);
+
+  /* Poistaa avaimen puusta. */
+  void remove(const T &key);
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+
+  /* Palauttaa lehtien lukumrn. */
+  int getLeaves() const;
+
+  /* Palauttaa lehtien avaimille varattujen tavujen mrn. */
+  long long getLeafBytes() const;
+
+  /* Tarkistaa, ett lehdet ovat jrjestyksess ja hakemiston mukaisia ja
+     ett puu sislt tsmlleen annetut avaimet. */
+  void validate(const std::vector<T> &keys);
+
+  /* Tulostaa lehdet ja niiden avaimet. */
+  void print();
+};
+
+#endif
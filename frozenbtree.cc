@@ -0,0 +1,118 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa B-puusta jdytetyn, muuttumattoman hakurakenteen. Avaimet
+ovat taulukossa Eytzingerin jrjestyksess eli tydellisen binripuun
+leveyssuuntaisessa jrjestyksess, jolloin solmun k lapset ovat kohdissa
+2k ja 2k+1. Haun ensimmiset tasot osuvat samoille vlimuistiriveille, ja
+myhempien tasojen rivit haetaan etukteen.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <vector>
+#include "frozenbtree.h"
+
+using namespace std;
+
+/* Sijoittaa jrjestetyt avaimet taulukkoon sisjrjestyksess.
+   sorted = avaimet nousevassa jrjestyksess
+   next = seuraavan sijoitettavan avaimen indeksi
+   k = alipuun juuren sijainti */
+template<typename T> void FrozenBTree<T>::build(const vector<T> &sorted,
+                                                int *next, int k) {
+  if (k<=n) {
+    build(sorted, next, 2*k);
+    key[k]=sorted[(*next)++];
+    build(sorted, next, 2*k+1);
+  }
+}
+
+/* sorted = avaimet nousevassa jrjestyksess
+   compare = metodi avainten vertailemiseksi */
+template<typename T> FrozenBTree<T>::FrozenBTree<T>(
+  const vector<T> &sorted, int (*const compare)(const T &, const T &)) :
+  n(sorted.size()), compare(compare) {
+  for (int i=1; i<n; i++)
+    if (compare(sorted[i-1], sorted[i])>=0) {
+      cerr << "FrozenBTree(): Keys not in order." << endl;
+      raise(SIGABRT);
+      return;
+    }
+
+  // Kohta 0 jtetn kyttmtt, jotta lasten sijainnit saadaan
+  // kertomalla kahdella.
+  key=new T[n+1];
+  int next=0;
+  build(sorted, &next, 1);
+}
+
+template<typename T> FrozenBTree<T>::~FrozenBTree<T>() {
+  delete[] key;
+}
+
+/* Palauttaa avainten lukumrn. */
+template<typename T> int FrozenBTree<T>::size() const {
+  return n;
+}
+
+/* Palauttaa ensimmisen avaimen, joka on vhintn key, sijainnin tai 0,
+   jos sellaista ei ole. */
+template<typename T> int FrozenBTree<T>::lowerBound(const T &key) const {
+  // Vlimuistirivill on perLine avainta, joten log2(perLine) tason pss
+  // olevat jlkeliset ovat yhdell rivill kohdasta perLine*k alkaen.
+  const int perLine=sizeof(T)>=64 ? 1 : 64/sizeof(T);
+  int k=1;
+  while (k<=n) {
+    if (perLine*k<=n) __builtin_prefetch(this->key+perLine*k);
+    k=2*k+(compare(this->key[k], key)<0);
+  }
+
+  // Polku pttyi lehden alle. Viimeinen vasemmalle knns kertoo
+  // vastauksen: poistetaan oikealle knnsten bitit ja yksi vasemmalle
+  // knnksen bitti.
+  k>>=__builtin_ffs(~k);
+  return k;
+}
+
+/* Palauttaa true, jos avain on rakenteessa. */
+template<typename T> bool FrozenBTree<T>::contains(const T &key) const {
+  int k=lowerBound(key);
+  return k!=0 && compare(this->key[k], key)==0;
+}
+
+/* Palauttaa avaimen sijainnista position. */
+template<typename T> const T &FrozenBTree<T>::getKey(int position) const {
+  if (position<1 || position>n) {
+    cerr << "getKey(): Invalid position." << endl;
+    raise(SIGABRT);
+    return key[1];
+  }
+  return key[position];
+}
+
+/* Palauttaa seuraavaksi suurimman avaimen sijainnin tai 0, jos avain on
+   suurin. */
+template<typename T> int FrozenBTree<T>::next(int position) const {
+  int k=position;
+  if (2*k+1<=n) {
+    // Seuraaja on oikean alipuun vasemmanpuoleisin solmu.
+    k=2*k+1;
+    while (2*k<=n) k=2*k;
+    return k;
+  }
+  // Noustaan, kunnes tullaan vasemmasta lapsesta.
+  while (k&1) k>>=1;
+  return k>>1;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+template<typename T> void FrozenBTree<T>::range(const T &lo, const T &hi,
+                                                vector<T> &result) const {
+  for (int k=lowerBound(lo); k!=0 && compare(key[k], hi)<=0; k=next(k))
+    result.push_back(key[k]);
+}
@@ -0,0 +1,62 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa B-puusta jdytetyn, muuttumattoman hakurakenteen. Avaimet
+ovat taulukossa Eytzingerin jrjestyksess eli tydellisen binripuun
+leveyssuuntaisessa jrjestyksess, jolloin solmun k lapset ovat kohdissa
+2k ja 2k+1. Haun ensimmiset tasot osuvat samoille vlimuistiriveille, ja
+myhempien tasojen rivit haetaan etukteen.
+
+*/
+
+#ifndef FROZENBTREE_H
+#define FROZENBTREE_H
+
+#include <vector>
+
+/* Jdytetyn hakurakenteen toteuttava luokka. Sijainnit ovat taulukon
+   indeksej 1...size(); sijainti 0 tarkoittaa loppua. */
+template<typename T> class FrozenBTree {
+  T *key;
+  int n;
+  int (*const compare)(const T &, const T &);
+
+  /* Sijoittaa jrjestetyt avaimet taulukkoon sisjrjestyksess.
+     sorted = avaimet nousevassa jrjestyksess
+     next = seuraavan sijoitettavan avaimen indeksi
+     k = alipuun juuren sijainti */
+  void build(const std::vector<T> &sorted, int *next, int k);
+
+public:
+  /* sorted = avaimet nousevassa jrjestyksess
+     compare = metodi avainten vertailemiseksi */
+  FrozenBTree<T>(const std::vector<T> &sorted,
+                 int (*const compare)(const T &, const T &));
+
+  ~FrozenBTree<T>();
+
+  /* Palauttaa avainten lukumrn. */
+  int size() const;
+
+  /* Palauttaa ensimmisen avaimen, joka on vhintn key, sijainnin tai 0,
+     jos sellaista ei ole. */
+  int lowerBound(const T &key) const;
+
+  /* Palauttaa true, jos avain on rakenteessa. */
+  bool contains(const T &key) const;
+
+  /* Palauttaa avaimen sijainnista position. */
+  const T &getKey(int position) const;
+
+  /* Palauttaa seuraavaksi suurimman avaimen sijainnin tai 0, jos avain on
+     suurin. */
+  int next(int position) const;
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const T &lo, const T &hi, std::vector<T> &result) const;
+};
+
+#endif
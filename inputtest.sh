@@ -12,6 +12,8 @@ echo -e "\nTEST 1.5:"
 ./test btree 2 1 invalid.txt 0
 echo -e "\nTEST 1.6:"
 ./test btree 2 1 nonexistent 0
+echo -e "\nTEST 1.7:"
+./test btree 2 1 keys.txt 1 0
 
 echo -e "\nTEST 2.1:"
 ./test skiplist 0 .5 1 keys.txt 0
@@ -29,3 +31,78 @@ echo -e "\nTEST 2.7:"
 ./test skiplist 1 .5 1 lastkey.txt 0
 echo -e "\nTEST 2.8:"
 ./test skiplist 1 .5 1 nonexistent 0
+echo -e "\nTEST 2.9:"
+./test skiplist 1 .5 1 keys.txt 1 0
+
+echo -e "\nTEST 3.1:"
+./test pagedbtree 1024 64 1 keys.txt 0
+echo -e "\nTEST 3.2:"
+./test pagedbtree 4096 4 1 keys.txt 0
+echo -e "\nTEST 3.3:"
+./test pagedbtree 4096 64 1 duplicate.txt 0
+echo -e "\nTEST 3.4:"
+./test pagedbtree 4096 64 1 nonexistent 0
+
+echo -e "\nTEST 4.1:"
+printf 'I 1\nX 2\n' | ./test stream btree 2 -
+echo -e "\nTEST 4.2:"
+printf 'Q 1\n' | ./test stream skiplist 10 .5 -
+echo -e "\nTEST 4.3:"
+./test stream btree 2 nonexistent
+echo -e "\nTEST 4.4:"
+printf 'I 1\nX 2\n' | ./test stream vector -
+
+echo -e "\nTEST 5.1:"
+./test compressed 2 8 1 keys.txt 0
+echo -e "\nTEST 5.2:"
+./test compressed 2 16 1 duplicate.txt 0
+
+echo -e "\nTEST 6.1:"
+./test strings 1 1 urls.txt 0
+echo -e "\nTEST 6.2:"
+./test strings 2 1 duplicate.txt 0
+
+echo -e "\nTEST 7.1:"
+./test frozen 2 1 nonexistent
+
+echo -e "\nTEST 8.1:"
+./test bench btree keys.txt 1 0 csv
+echo -e "\nTEST 8.2:"
+./test bench skiplist keys.txt 1 1 xml
+echo -e "\nTEST 8.3:"
+./test bench btree keys.txt 1 1 csv counters
+
+echo -e "\nTEST 9.1:"
+./test workload btree 2 insert=1,dist=pareto
+
+echo -e "\nTEST 10.1:"
+./test memory btree 1 keys.txt
+
+echo -e "\nTEST 11.1:"
+./test tune btree keys.txt tuning.txt again
+
+echo -e "\nTEST 12.1:"
+./test lazyremove 3 keys.txt 1 0 16
+
+echo -e "\nTEST 13.1:"
+./test buffered 2 0 1 keys.txt 0
+echo -e "\nTEST 13.2:"
+./test workload buffered 1 64 insert=1
+
+echo -e "\nTEST 14.1:"
+./test fill 1 keys.txt
+
+echo -e "\nTEST 15.1:"
+./test setops 1 16 0.5 keys.txt
+
+echo -e "\nTEST 16.1:"
+./test splitjoin 1 16 0.5 keys.txt
+
+echo -e "\nTEST 17.1:"
+./test aggregate 1 keys.txt
+
+echo -e "\nTEST 18.1:"
+./test batch 1 32 keys.txt
+
+echo -e "\nTEST 19.1:"
+./test multiset 1 16 0.5 keys.txt
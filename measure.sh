@@ -1,19 +1,107 @@
 #!/bin/bash
 
-rm -f btree.csv skiplist.csv
+rm -f btree.csv skiplist.csv set.csv vector.csv
+
+# Kaikki asteet ja tasot mitataan samassa prosessissa toistetusti.
+echo Benchmarking B-tree degrees...
+./test bench btree keys.txt 10 100 csv > btree.csv
+echo Benchmarking Skiplist levels and probabilities...
+./test bench skiplist keys.txt 10 100 csv > skiplist.csv
+echo Benchmarking std::set and sorted vector baselines...
+./test bench set keys.txt 10 100 csv > set.csv
+./test bench vector keys.txt 10 100 csv > vector.csv
+
+# Viritetn aste sek taso ja todennkisyys uudelleen; myhemmt ajot
+# kyttvt tallennettuja arvoja (ks. test workload ... auto).
+echo Tuning B-tree degree and Skiplist level and probability...
+./test tune btree keys.txt tuning.txt retune > tune_btree.csv
+./test tune skiplist keys.txt tuning.txt retune > tune_skiplist.csv
+
+rm -f frozen.csv
 
 for ((degree=2; degree<41; degree+=1))
 do
-  echo Testing B-tree degree $degree, iteration $i...
-  ./test btree $degree 1000 keys.txt 0 >> btree.csv
+  echo Testing frozen B-tree degree $degree...
+  ./test frozen $degree 1000 keys.txt >> frozen.csv
+done
+
+rm -f pagedbtree.csv
+
+for ((pagesize=4096; pagesize<=65536; pagesize*=2))
+do
+  for memory in 64 256 1024
+  do
+    echo Testing paged B-tree page size $pagesize, memory $memory kB...
+    ./test pagedbtree $pagesize $memory 100 keys.txt 0 >> pagedbtree.csv
+  done
+done
+
+rm -f wal.csv
+
+for window in 0 100 1000 10000 100000
+do
+  echo Testing B-tree log window $window us...
+  ./test wal 25 $window 65536 keys.txt >> wal.csv
 done
 
-for ((level=1; level<41; level+=1))
+echo Comparing eager and lazy B-tree removals...
+./test lazyremove 25 keys.txt 100 64 16 > lazyremove.csv
+
+rm -f buffered.csv
+
+for degree in 4 8 16 32
 do
-  #for p in 0 0.3 0.5 0.7 1.0
-  for p in 0.5
+  for buffer in 16 64 256 1024
   do
-    echo Testing Skiplist level $level, probability $p, iteration $i...
-    ./test skiplist $level $p 1000 keys.txt 0 >> skiplist.csv
+    echo Testing buffered B-tree degree $degree, buffer $buffer...
+    ./test buffered $degree $buffer 10 keys.txt 0 >> buffered.csv
   done
 done
+
+rm -f fill.csv
+
+for degree in 2 4 8 16 32
+do
+  echo Comparing B-tree splits and redistribution, degree $degree...
+  ./test fill $degree keys.txt >> fill.csv
+done
+
+rm -f setops.csv
+
+for degree in 4 16 64
+do
+  echo Testing set operations, B-tree degree $degree...
+  ./test setops $degree 16 0.5 keys.txt >> setops.csv
+done
+
+rm -f splitjoin.csv
+
+for degree in 4 16 64
+do
+  echo Testing split and join, B-tree degree $degree...
+  ./test splitjoin $degree 16 0.5 keys.txt >> splitjoin.csv
+done
+
+rm -f aggregate.csv
+
+for degree in 2 4 8 16 32
+do
+  echo Testing B-tree aggregates, degree $degree...
+  ./test aggregate $degree keys.txt >> aggregate.csv
+done
+
+rm -f batch.csv
+
+for batch in 1 16 32 64 256
+do
+  echo Testing B-tree batch search, batch size $batch...
+  ./test batch 16 $batch keys.txt >> batch.csv
+done
+
+rm -f multiset.csv
+
+for degree in 2 4 8 16 32
+do
+  echo Testing multisets, B-tree degree $degree...
+  ./test multiset $degree 16 0.5 keys.txt >> multiset.csv
+done
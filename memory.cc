@@ -0,0 +1,177 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden muistinkytn kirjanpidon sek new- ja
+delete-operaattorien vaihdettavat koukut.
+
+*/
+
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "memory.h"
+
+using namespace std;
+
+/* Lis solmuja nimettyyn erittelyyn. Saman nimen lisykset
+   yhdistetn.
+   name = solmutyyppi tai taso
+   nodes = solmujen mr
+   live = kytss olevat tavut
+   allocated = varatut tavut */
+void MemoryUsage::add(const string &name, long long nodes, long long live,
+                      long long allocated) {
+  for (unsigned int i=0; i<entries.size(); i++)
+    if (entries[i].name==name) {
+      entries[i].nodes+=nodes;
+      entries[i].live+=live;
+      entries[i].allocated+=allocated;
+      return;
+    }
+  MemoryUsageEntry entry;
+  entry.name=name;
+  entry.nodes=nodes;
+  entry.live=live;
+  entry.allocated=allocated;
+  entries.push_back(entry);
+}
+
+/* Palauttaa erittelyjen mrn. */
+int MemoryUsage::size() const {
+  return entries.size();
+}
+
+/* Palauttaa erittelyn. */
+const MemoryUsageEntry &MemoryUsage::getEntry(int index) const {
+  return entries[index];
+}
+
+/* Palauttaa kytss olevat tavut yhteens. */
+long long MemoryUsage::getLive() const {
+  long long live=0;
+  for (unsigned int i=0; i<entries.size(); i++) live+=entries[i].live;
+  return live;
+}
+
+/* Palauttaa varatut tavut yhteens. */
+long long MemoryUsage::getAllocated() const {
+  long long allocated=0;
+  for (unsigned int i=0; i<entries.size(); i++)
+    allocated+=entries[i].allocated;
+  return allocated;
+}
+
+/* Palauttaa hukan eli varattujen ja kytss olevien tavujen erotuksen. */
+long long MemoryUsage::getSlack() const {
+  return getAllocated()-getLive();
+}
+
+/* Tulostaa erittelyt CSV-muodossa otsakeriveineen. */
+void MemoryUsage::print(ostream &os) const {
+  os << "name,nodes,live,allocated,slack" << endl;
+  for (unsigned int i=0; i<entries.size(); i++)
+    os << entries[i].name << "," << entries[i].nodes << ","
+       << entries[i].live << "," << entries[i].allocated << ","
+       << entries[i].allocated-entries[i].live << endl;
+}
+
+static long long heapBytes=0;
+
+static void *defaultAllocate(size_t bytes) {
+  return malloc(bytes);
+}
+
+static void defaultRelease(void *memory) {
+  free(memory);
+}
+
+static void *countingAllocate(size_t bytes) {
+  void *memory=malloc(bytes);
+  if (memory) heapBytes+=malloc_usable_size(memory);
+  return memory;
+}
+
+static void countingRelease(void *memory) {
+  if (memory) heapBytes-=malloc_usable_size(memory);
+  free(memory);
+}
+
+// Koukut alustetaan vakioina, jotta ne ovat kytss jo ennen muiden
+// knnsyksikiden staattisten olioiden luontia.
+static AllocationHooks hooks={&defaultAllocate, &defaultRelease};
+
+/* Asettaa koukut ja palauttaa edelliset. Koukut on vaihdettava takaisin
+   ennen kuin niiden kautta varattu muisti vapautetaan muulla tavalla. */
+AllocationHooks setAllocationHooks(const AllocationHooks &newHooks) {
+  AllocationHooks previous=hooks;
+  hooks=newHooks;
+  return previous;
+}
+
+/* Palauttaa oletuskoukut, jotka kyttvt malloc()- ja free()-kutsuja. */
+AllocationHooks defaultAllocationHooks() {
+  AllocationHooks result;
+  result.allocate=&defaultAllocate;
+  result.release=&defaultRelease;
+  return result;
+}
+
+/* Palauttaa koukut, jotka kyttvt malloc()- ja free()-kutsuja ja
+   laskevat kekomuistin kytn lohkojen todellisen koon mukaan. Laskuri ei
+   ole sieturvallinen. */
+AllocationHooks countingAllocationHooks() {
+  AllocationHooks result;
+  result.allocate=&countingAllocate;
+  result.release=&countingRelease;
+  return result;
+}
+
+/* Palauttaa laskevien koukkujen kautta varattujen lohkojen koon
+   vhennettyn niiden kautta vapautettujen lohkojen koolla. Kahden
+   lukeman erotus on kekomuistin muutos niiden vlill. */
+long long getHeapBytes() {
+  return heapBytes;
+}
+
+// Korvataan ohjelman new- ja delete-operaattorit. Molemmat koukut
+// kyttvt samaa malloc()-kekoa, joten lohkon voi vapauttaa eri koukulla
+// kuin sen varannut; laskevat koukut vhentvt silloin lohkon koon,
+// vaikkei sit ole laskettu, mutta erotukset pysyvt oikeina.
+
+void *operator new(size_t bytes) {
+  void *memory=hooks.allocate(bytes>0 ? bytes : 1);
+  if (!memory) throw bad_alloc();
+  return memory;
+}
+
+void *operator new[](size_t bytes) {
+  void *memory=hooks.allocate(bytes>0 ? bytes : 1);
+  if (!memory) throw bad_alloc();
+  return memory;
+}
+
+void *operator new(size_t bytes, const nothrow_t &) noexcept {
+  return hooks.allocate(bytes>0 ? bytes : 1);
+}
+
+void *operator new[](size_t bytes, const nothrow_t &) noexcept {
+  return hooks.allocate(bytes>0 ? bytes : 1);
+}
+
+void operator delete(void *memory) noexcept {
+  hooks.release(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+  hooks.release(memory);
+}
+
+void operator delete(void *memory, const nothrow_t &) noexcept {
+  hooks.release(memory);
+}
+
+void operator delete[](void *memory, const nothrow_t &) noexcept {
+  hooks.release(memory);
+}
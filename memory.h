@@ -0,0 +1,90 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden muistinkytn kirjanpidon. Rakenteet raportoivat
+muistinkyttns solmutyypeittin ja tasoittain: kytss olevat tavut
+(avaimet ja osoittimet, joilla on arvo), varatut tavut (solmut ja niiden
+taulukot kokonaisuudessaan) sek niiden erotuksen eli hukan. Lisksi
+ohjelman kaikki new- ja delete-operaattorien varaukset kulkevat
+vaihdettavien koukkujen kautta, jolloin laskevilla koukuilla saadaan
+kekomuistin todellinen kytt varaajan pyristykset mukaan lukien.
+
+*/
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Yhden solmutyypin tai tason muistinkytt. */
+struct MemoryUsageEntry {
+  std::string name;
+  long long nodes;
+  long long live;
+  long long allocated;
+};
+
+/* Rakenteen muistinkytt. Avainten omistamaa muistia (esim.
+   merkkijonojen sislt) ei lasketa; avaimesta lasketaan vain sizeof(T). */
+class MemoryUsage {
+  std::vector<MemoryUsageEntry> entries;
+
+public:
+  /* Lis solmuja nimettyyn erittelyyn. Saman nimen lisykset
+     yhdistetn.
+     name = solmutyyppi tai taso
+     nodes = solmujen mr
+     live = kytss olevat tavut
+     allocated = varatut tavut */
+  void add(const std::string &name, long long nodes, long long live,
+           long long allocated);
+
+  /* Palauttaa erittelyjen mrn. */
+  int size() const;
+
+  /* Palauttaa erittelyn. */
+  const MemoryUsageEntry &getEntry(int index) const;
+
+  /* Palauttaa kytss olevat tavut yhteens. */
+  long long getLive() const;
+
+  /* Palauttaa varatut tavut yhteens. */
+  long long getAllocated() const;
+
+  /* Palauttaa hukan eli varattujen ja kytss olevien tavujen erotuksen. */
+  long long getSlack() const;
+
+  /* Tulostaa erittelyt CSV-muodossa otsakeriveineen. */
+  void print(std::ostream &os) const;
+};
+
+/* Muistinvarauksen koukut, joiden kautta kaikki new- ja
+   delete-operaattorien varaukset kulkevat. */
+struct AllocationHooks {
+  void *(*allocate)(std::size_t bytes);
+  void (*release)(void *memory);
+};
+
+/* Asettaa koukut ja palauttaa edelliset. Koukut on vaihdettava takaisin
+   ennen kuin niiden kautta varattu muisti vapautetaan muulla tavalla. */
+AllocationHooks setAllocationHooks(const AllocationHooks &hooks);
+
+/* Palauttaa oletuskoukut, jotka kyttvt malloc()- ja free()-kutsuja. */
+AllocationHooks defaultAllocationHooks();
+
+/* Palauttaa koukut, jotka kyttvt malloc()- ja free()-kutsuja ja
+   laskevat kekomuistin kytn lohkojen todellisen koon mukaan. Laskuri ei
+   ole sieturvallinen. */
+AllocationHooks countingAllocationHooks();
+
+/* Palauttaa laskevien koukkujen kautta varattujen lohkojen koon
+   vhennettyn niiden kautta vapautettujen lohkojen koolla. Kahden
+   lukeman erotus on kekomuistin muutos niiden vlill. */
+long long getHeapBytes();
+
+#endif
@@ -0,0 +1,254 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa jrjestetyn joukon sovittimet b-puulle, puskuroidulle b-puulle,
+hyppylistalle, std::set-joukolle ja jrjestetylle vektorille.
+
+*/
+
+#include <set>
+#include <vector>
+#include <algorithm>
+#include "orderedset.h"
+
+using namespace std;
+
+template<typename T> KeyLess<T>::KeyLess<T>(
+  int (*const compare)(const T &, const T &)) : compare(compare) {}
+
+template<typename T> bool KeyLess<T>::operator()(const T &a,
+                                                 const T &b) const {
+  return compare(a, b)<0;
+}
+
+/* degree = puun aste
+   compare = avainten vertailufunktio */
+template<typename T> BTreeSet<T>::BTreeSet<T>(
+  int degree, int (*const compare)(const T &, const T &)) :
+  tree(degree, compare, 0) {}
+
+template<typename T> BTree<T> &BTreeSet<T>::getStructure() {
+  return tree;
+}
+
+template<typename T> void BTreeSet<T>::insert(const T &key) {
+  // B-puu keskeytt ohjelman, jos avain on jo puussa.
+  if (!contains(key)) tree.insert(key);
+}
+
+template<typename T> void BTreeSet<T>::remove(const T &key) {
+  tree.remove(key);
+}
+
+template<typename T> bool BTreeSet<T>::contains(const T &key) {
+  BTreeNode<T> *result;
+  int index;
+  tree.search(key, &result, &index);
+  return result!=NULL;
+}
+
+template<typename T> bool BTreeSet<T>::lowerBound(const T &key, T *result) {
+  return tree.ceilingKey(key, result);
+}
+
+template<typename T> void BTreeSet<T>::range(const T &lo, const T &hi,
+                                             vector<T> &result) {
+  tree.range(lo, hi, result);
+}
+
+template<typename T> void BTreeSet<T>::keys(vector<T> &result) {
+  tree.keys(result);
+}
+
+template<typename T> void BTreeSet<T>::memoryUsage(MemoryUsage &usage) {
+  tree.memoryUsage(usage);
+}
+
+#ifdef STRUCTURE_TRACE
+template<typename T> StructureTrace &BTreeSet<T>::getTrace() {
+  return tree.getTrace();
+}
+#endif
+
+/* degree = puun aste
+   bufferSize = sissolmun puskurin koko viestein
+   compare = avainten vertailufunktio */
+template<typename T> BufferedBTreeSet<T>::BufferedBTreeSet<T>(
+  int degree, int bufferSize, int (*const compare)(const T &, const T &)) :
+  tree(degree, bufferSize, compare, 0) {}
+
+template<typename T> void BufferedBTreeSet<T>::insert(const T &key) {
+  // Puskuroitu puu ohittaa jo puussa olevan avaimen lisyksen itse, joten
+  // avainta ei haeta ensin.
+  tree.insert(key);
+}
+
+template<typename T> void BufferedBTreeSet<T>::remove(const T &key) {
+  tree.remove(key);
+}
+
+template<typename T> bool BufferedBTreeSet<T>::contains(const T &key) {
+  return tree.search(key);
+}
+
+template<typename T> bool BufferedBTreeSet<T>::lowerBound(const T &key,
+                                                          T *result) {
+  return tree.ceilingKey(key, result);
+}
+
+template<typename T> void BufferedBTreeSet<T>::range(const T &lo,
+                                                     const T &hi,
+                                                     vector<T> &result) {
+  tree.range(lo, hi, result);
+}
+
+template<typename T> void BufferedBTreeSet<T>::keys(vector<T> &result) {
+  tree.keys(result);
+}
+
+template<typename T> void BufferedBTreeSet<T>::memoryUsage(
+  MemoryUsage &usage) {
+  tree.memoryUsage(usage);
+}
+
+/* level = listan maksimitaso
+   probability = todennkisyys, jolla solmujen taso valitaan
+   lastKey = suurempi kuin mikn listtv avain
+   compare = avainten vertailufunktio */
+template<typename T> SkipListSet<T>::SkipListSet<T>(
+  int level, double probability, const T &lastKey,
+  int (*const compare)(const T &, const T &)) :
+  list(level, probability, lastKey, compare, 0) {}
+
+template<typename T> SkipList<T> &SkipListSet<T>::getStructure() {
+  return list;
+}
+
+template<typename T> void SkipListSet<T>::insert(const T &key) {
+  // Hyppylista keskeytt ohjelman, jos avain on jo listassa.
+  if (!contains(key)) list.insert(key);
+}
+
+template<typename T> void SkipListSet<T>::remove(const T &key) {
+  list.remove(key);
+}
+
+template<typename T> bool SkipListSet<T>::contains(const T &key) {
+  return list.search(key)!=NULL;
+}
+
+template<typename T> bool SkipListSet<T>::lowerBound(const T &key,
+                                                     T *result) {
+  return list.ceilingKey(key, result);
+}
+
+template<typename T> void SkipListSet<T>::range(const T &lo, const T &hi,
+                                                vector<T> &result) {
+  list.range(lo, hi, result);
+}
+
+template<typename T> void SkipListSet<T>::keys(vector<T> &result) {
+  list.keys(result);
+}
+
+template<typename T> void SkipListSet<T>::memoryUsage(MemoryUsage &usage) {
+  list.memoryUsage(usage);
+}
+
+#ifdef STRUCTURE_TRACE
+template<typename T> StructureTrace &SkipListSet<T>::getTrace() {
+  return list.getTrace();
+}
+#endif
+
+/* compare = avainten vertailufunktio */
+template<typename T> StdSet<T>::StdSet<T>(
+  int (*const compare)(const T &, const T &)) :
+  keySet(KeyLess<T>(compare)), compare(compare) {}
+
+template<typename T> void StdSet<T>::insert(const T &key) {
+  keySet.insert(key);
+}
+
+template<typename T> void StdSet<T>::remove(const T &key) {
+  keySet.erase(key);
+}
+
+template<typename T> bool StdSet<T>::contains(const T &key) {
+  return keySet.find(key)!=keySet.end();
+}
+
+template<typename T> bool StdSet<T>::lowerBound(const T &key, T *result) {
+  typename std::set<T, KeyLess<T> >::iterator i=keySet.lower_bound(key);
+  if (i==keySet.end()) return false;
+  *result=*i;
+  return true;
+}
+
+template<typename T> void StdSet<T>::range(const T &lo, const T &hi,
+                                           vector<T> &result) {
+  typename std::set<T, KeyLess<T> >::iterator i=keySet.lower_bound(lo);
+  for (; i!=keySet.end() && compare(*i, hi)<=0; i++) result.push_back(*i);
+}
+
+template<typename T> void StdSet<T>::keys(vector<T> &result) {
+  result.insert(result.end(), keySet.begin(), keySet.end());
+}
+
+template<typename T> void StdSet<T>::memoryUsage(MemoryUsage &usage) {
+  // Puna-mustan puun solmussa on avaimen lisksi vri sek is-, vasen ja
+  // oikea osoitin; vri vie tasauksen vuoksi osoittimen verran.
+  long long n=keySet.size();
+  usage.add("node", n, n*(sizeof(T)+3*sizeof(void *)),
+            n*(sizeof(T)+4*sizeof(void *)));
+}
+
+/* compare = avainten vertailufunktio */
+template<typename T> SortedVectorSet<T>::SortedVectorSet<T>(
+  int (*const compare)(const T &, const T &)) : compare(compare) {}
+
+template<typename T> void SortedVectorSet<T>::insert(const T &key) {
+  typename std::vector<T>::iterator i=
+    lower_bound(sorted.begin(), sorted.end(), key, KeyLess<T>(compare));
+  if (i==sorted.end() || compare(*i, key)!=0) sorted.insert(i, key);
+}
+
+template<typename T> void SortedVectorSet<T>::remove(const T &key) {
+  typename std::vector<T>::iterator i=
+    lower_bound(sorted.begin(), sorted.end(), key, KeyLess<T>(compare));
+  if (i!=sorted.end() && compare(*i, key)==0) sorted.erase(i);
+}
+
+template<typename T> bool SortedVectorSet<T>::contains(const T &key) {
+  typename std::vector<T>::iterator i=
+    lower_bound(sorted.begin(), sorted.end(), key, KeyLess<T>(compare));
+  return i!=sorted.end() && compare(*i, key)==0;
+}
+
+template<typename T> bool SortedVectorSet<T>::lowerBound(const T &key,
+                                                         T *result) {
+  typename std::vector<T>::iterator i=
+    lower_bound(sorted.begin(), sorted.end(), key, KeyLess<T>(compare));
+  if (i==sorted.end()) return false;
+  *result=*i;
+  return true;
+}
+
+template<typename T> void SortedVectorSet<T>::range(const T &lo, const T &hi,
+                                                    std::vector<T> &result) {
+  typename std::vector<T>::iterator i=
+    lower_bound(sorted.begin(), sorted.end(), lo, KeyLess<T>(compare));
+  for (; i!=sorted.end() && compare(*i, hi)<=0; i++) result.push_back(*i);
+}
+
+template<typename T> void SortedVectorSet<T>::keys(std::vector<T> &result) {
+  result.insert(result.end(), sorted.begin(), sorted.end());
+}
+
+template<typename T> void SortedVectorSet<T>::memoryUsage(
+  MemoryUsage &usage) {
+  usage.add("array", 1, sorted.size()*sizeof(T),
+            sorted.capacity()*sizeof(T));
+}
@@ -0,0 +1,159 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa jrjestetyn joukon yhteisen rajapinnan b-puulle, puskuroidulle
+b-puulle, hyppylistalle, std::set-joukolle ja jrjestetylle vektorille,
+jotta samat mittaukset
+voidaan ajaa kaikille. Rajapinta on sovitinluokkien yhteinen metodijoukko
+eik kantaluokka, joten kutsut eivt ole virtuaalisia ja mittaukset
+kirjoitetaan malleina, joiden parametrina on sovitin:
+
+  void insert(const T &key)       lis avaimen, jos sit ei ole joukossa
+  void remove(const T &key)       poistaa avaimen, jos se on joukossa
+  bool contains(const T &key)     palauttaa true, jos avain on joukossa
+  bool lowerBound(const T &key, T *result)
+                                  palauttaa pienimmn avaimen >= key
+  void range(const T &lo, const T &hi, std::vector<T> &result)
+                                  lis vlin [lo, hi] avaimet
+  void keys(std::vector<T> &result)
+                                  lis kaikki avaimet nousevassa
+                                  jrjestyksess
+  void memoryUsage(MemoryUsage &usage)
+                                  lis muistinkytn erittelyyn
+
+*/
+
+#ifndef ORDEREDSET_H
+#define ORDEREDSET_H
+
+#include <set>
+#include <vector>
+#include "btree.h"
+#include "bufferedbtree.h"
+#include "skiplist.h"
+#include "memory.h"
+
+/* Vertailufunktiosta muodostettu jrjestysehto standardikirjaston
+   siliille. */
+template<typename T> class KeyLess {
+  int (*compare)(const T &, const T &);
+
+public:
+  KeyLess<T>(int (*const compare)(const T &, const T &));
+
+  bool operator()(const T &a, const T &b) const;
+};
+
+/* B-puun sovitin. */
+template<typename T> class BTreeSet {
+  BTree<T> tree;
+
+public:
+  /* degree = puun aste
+     compare = avainten vertailufunktio */
+  BTreeSet<T>(int degree, int (*const compare)(const T &, const T &));
+
+  /* Palauttaa sovitettavan puun operaatioille, joita sovittimessa ei ole
+     (esim. joukko-operaatiot, jako ja liitos). */
+  BTree<T> &getStructure();
+
+  void insert(const T &key);
+  void remove(const T &key);
+  bool contains(const T &key);
+  bool lowerBound(const T &key, T *result);
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+  void keys(std::vector<T> &result);
+  void memoryUsage(MemoryUsage &usage);
+#ifdef STRUCTURE_TRACE
+  StructureTrace &getTrace();
+#endif
+};
+
+/* Puskuroidun b-puun sovitin. */
+template<typename T> class BufferedBTreeSet {
+  BufferedBTree<T> tree;
+
+public:
+  /* degree = puun aste
+     bufferSize = sissolmun puskurin koko viestein
+     compare = avainten vertailufunktio */
+  BufferedBTreeSet<T>(int degree, int bufferSize,
+                      int (*const compare)(const T &, const T &));
+
+  void insert(const T &key);
+  void remove(const T &key);
+  bool contains(const T &key);
+  bool lowerBound(const T &key, T *result);
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+  void keys(std::vector<T> &result);
+  void memoryUsage(MemoryUsage &usage);
+};
+
+/* Hyppylistan sovitin. */
+template<typename T> class SkipListSet {
+  SkipList<T> list;
+
+public:
+  /* level = listan maksimitaso
+     probability = todennkisyys, jolla solmujen taso valitaan
+     lastKey = suurempi kuin mikn listtv avain
+     compare = avainten vertailufunktio */
+  SkipListSet<T>(int level, double probability, const T &lastKey,
+                 int (*const compare)(const T &, const T &));
+
+  /* Palauttaa sovitettavan listan operaatioille, joita sovittimessa ei
+     ole. */
+  SkipList<T> &getStructure();
+
+  void insert(const T &key);
+  void remove(const T &key);
+  bool contains(const T &key);
+  bool lowerBound(const T &key, T *result);
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+  void keys(std::vector<T> &result);
+  void memoryUsage(MemoryUsage &usage);
+#ifdef STRUCTURE_TRACE
+  StructureTrace &getTrace();
+#endif
+};
+
+/* Standardikirjaston std::set-joukon (puna-musta puu) sovitin. */
+template<typename T> class StdSet {
+  std::set<T, KeyLess<T> > keySet;
+  int (*const compare)(const T &, const T &);
+
+public:
+  /* compare = avainten vertailufunktio */
+  StdSet<T>(int (*const compare)(const T &, const T &));
+
+  void insert(const T &key);
+  void remove(const T &key);
+  bool contains(const T &key);
+  bool lowerBound(const T &key, T *result);
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+  void keys(std::vector<T> &result);
+  void memoryUsage(MemoryUsage &usage);
+};
+
+/* Jrjestetty vektori, josta haetaan binrihaulla. Lisys ja poisto
+   siirtvt avaimia, joten ne ovat lineaarisia. */
+template<typename T> class SortedVectorSet {
+  std::vector<T> sorted;
+  int (*const compare)(const T &, const T &);
+
+public:
+  /* compare = avainten vertailufunktio */
+  SortedVectorSet<T>(int (*const compare)(const T &, const T &));
+
+  void insert(const T &key);
+  void remove(const T &key);
+  bool contains(const T &key);
+  bool lowerBound(const T &key, T *result);
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+  void keys(std::vector<T> &result);
+  void memoryUsage(MemoryUsage &usage);
+};
+
+#endif
@@ -0,0 +1,745 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa levylle tallennettavan B-puun lhteess [1] mainituilla
+algoritmeilla. Jokainen solmu on kiinten kokoinen sivu, jota ksitelln
+puskurivarannon kautta.
+
+Lhteet:
+[1] Introduction to Algorithms Thomas H. Cormen, Charles E. Leiserson, and
+    Ronald L. Rivest. MIT-Press, 2001; Chapter 18, B-Trees.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include "pagedbtree.h"
+#include "bufferpool.h"
+
+using namespace std;
+
+/* Tunniste, jolla puun tiedosto tunnistetaan. */
+#define PAGEDBTREE_MAGIC 0x50425431
+
+/* Palauttaa suurimman asteen, jolla solmu mahtuu sivulle.
+   pageSize = sivun koko tavuina */
+template<typename T> int PagedBTreeNode<T>::degreeFor(int pageSize) {
+  int t=(pageSize-int(sizeof(Header)))/(2*(int(sizeof(T))+int(sizeof(int))))
+    +1;
+  // Avaintaulukon pern listtv tasaus voi vaatia asteen pienentmist.
+  while (t>1 && int(sizeof(Header))+(((2*t-1)*int(sizeof(T))+3)&~3)
+         +2*t*int(sizeof(int))>pageSize) t--;
+  return t;
+}
+
+/* Kiinnitt olemassa olevan solmun.
+   pool = puskurivaranto
+   id = solmun sivun numero
+   degree = puun aste */
+template<typename T> PagedBTreeNode<T>::PagedBTreeNode<T>(BufferPool *pool,
+                                                          int id,
+                                                          int degree) :
+  pool(pool), id(id), degree(degree), maxKeys(2*degree-1),
+  maxChildren(2*degree), dirty(false) {
+  page=pool->pin(id);
+}
+
+/* Ksittelee jo kiinnitetty sivua.
+   page = sivun sislt */
+template<typename T> PagedBTreeNode<T>::PagedBTreeNode<T>(BufferPool *pool,
+                                                          int id,
+                                                          char *page,
+                                                          int degree) :
+  pool(pool), id(id), page(page), degree(degree), maxKeys(2*degree-1),
+  maxChildren(2*degree), dirty(true) {
+}
+
+/* Vapauttaa sivun kiinnityksen. */
+template<typename T> void PagedBTreeNode<T>::release() {
+  if (page) {
+    pool->unpin(id, dirty);
+    page=NULL;
+  }
+}
+
+/* Palauttaa solmun sivun numeron. */
+template<typename T> int PagedBTreeNode<T>::getId() const {
+  return id;
+}
+
+template<typename T> typename PagedBTreeNode<T>::Header *
+PagedBTreeNode<T>::header() const {
+  return reinterpret_cast<Header *>(page);
+}
+
+template<typename T> T *PagedBTreeNode<T>::keyArray() const {
+  return reinterpret_cast<T *>(page+sizeof(Header));
+}
+
+template<typename T> int *PagedBTreeNode<T>::childArray() const {
+  return reinterpret_cast<int *>(page+sizeof(Header)
+                                 +((maxKeys*sizeof(T)+3)&~3));
+}
+
+/* Alustaa tyhjn solmun.
+   leaf = true=solmu on lehti */
+template<typename T> void PagedBTreeNode<T>::init(bool leaf) {
+  header()->keys=0;
+  header()->leaf=leaf ? 1 : 0;
+  for (int i=0; i<maxChildren; i++) childArray()[i]=-1;
+  dirty=true;
+}
+
+/* Palauttaa avainten lukumrn. */
+template<typename T> int PagedBTreeNode<T>::numKeys() const {
+  return header()->keys;
+}
+
+/* Palauttaa lasten lukumrn. */
+template<typename T> int PagedBTreeNode<T>::numChildren() const {
+  return header()->keys==0 ? 0 : header()->keys+1;
+}
+
+/* Palautaan arvon true, jos solmu on lehti. */
+template<typename T> bool PagedBTreeNode<T>::isLeaf() const {
+  return header()->leaf!=0;
+}
+
+/* Palauttaa avaimen kohdasta index. */
+template<typename T> T PagedBTreeNode<T>::getKey(int index) const {
+  if (index<0 || index>=numKeys()) {
+    cerr << "getKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return keyArray()[0];
+  }
+  return keyArray()[index];
+}
+
+/* Palauttaa lapsisivun numeron kohdasta index. */
+template<typename T> int PagedBTreeNode<T>::getChild(int index) const {
+  if (index<0 || index>=numChildren() || isLeaf()) {
+    cerr << "getChild(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return -1;
+  }
+  return childArray()[index];
+}
+
+/* Asettaa avaimelle uuden arvon. */
+template<typename T> void PagedBTreeNode<T>::setKey(const T &newKey,
+                                                    int index) {
+  if (index<0 || index>=maxKeys) {
+    cerr << "setKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  keyArray()[index]=newKey;
+  dirty=true;
+}
+
+/* Asettaa lapsisivun numeron. */
+template<typename T> void PagedBTreeNode<T>::setChild(int newChild,
+                                                      int index) {
+  if (index<0 || index>=maxChildren) {
+    cerr << "setChild(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  childArray()[index]=newChild;
+  dirty=true;
+}
+
+/* Asettaa avainten lukumrn. */
+template<typename T> void PagedBTreeNode<T>::setNumKeys(int newNumKeys) {
+  if (newNumKeys<0 || newNumKeys>maxKeys) {
+    cerr << "setNumKeys(): Invalid number of keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  header()->keys=newNumKeys;
+  dirty=true;
+}
+
+/* Siirt avaimia ja lapsia eteenpin ja pivitt avainten lukumrn.
+   fromIndex = indeksi, josta alkaen avaimet siirretn
+   count = siirron pituus */
+template<typename T> void PagedBTreeNode<T>::shift(int fromIndex,
+                                                   int count) {
+  if (numKeys()+count>maxKeys) {
+    cerr << "shift(): Node overflow." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Avaimet ja lapset ovat sivulla perkkin, joten siirto voidaan tehd
+  // yhdell muistinsiirrolla kummallekin.
+  memmove(keyArray()+fromIndex+count, keyArray()+fromIndex,
+          (numKeys()-fromIndex)*sizeof(T));
+  if (!isLeaf())
+    memmove(childArray()+fromIndex+count, childArray()+fromIndex,
+            (numKeys()+1-fromIndex)*sizeof(int));
+  setNumKeys(numKeys()+count);
+}
+
+/* Lis avaimen sek sen vasemman- ja oikeanpuoleiset lapset solmuun.
+   newKey = uusi avain
+   leftChild = vasemmanpuoleinen lapsi; jos -1 ei muuta nykyist
+   rightChild = oikeanpuoleinen lapsi; jos -1 ei muuta nykyist
+   index = paikka, johon avain ja lapset listn */
+template<typename T> void PagedBTreeNode<T>::insert(const T &newKey,
+                                                    int leftChild,
+                                                    int rightChild,
+                                                    int index) {
+  if (index<numKeys()) shift(index, 1);
+  else setNumKeys(numKeys()+1);
+
+  setKey(newKey, index);
+  if (leftChild>=0) setChild(leftChild, index);
+  if (rightChild>=0) setChild(rightChild, index+1);
+}
+
+/* Poistaa avaimen ja mahdollisesti toisen sen lapsista.
+   index = avaimen indeksi
+   leftChild = jos true, poistaa vasemmanpuolisen lapsen
+   rightChild = jos true, poistaa oikeanpuoleisen lapsen */
+template<typename T> T PagedBTreeNode<T>::remove(int index, bool leftChild,
+                                                 bool rightChild) {
+  if (leftChild==true && rightChild==true) {
+    cerr << "Can't remove both children." << endl;
+    raise(SIGABRT);
+    return keyArray()[0];
+  }
+
+  T key=getKey(index);
+  memmove(keyArray()+index, keyArray()+index+1,
+          (numKeys()-index-1)*sizeof(T));
+  if (!isLeaf()) {
+    if (leftChild==true)
+      memmove(childArray()+index, childArray()+index+1,
+              (numChildren()-index-1)*sizeof(int));
+    else if (rightChild==true)
+      memmove(childArray()+index+1, childArray()+index+2,
+              (numChildren()-index-2)*sizeof(int));
+  }
+  setNumKeys(numKeys()-1);
+  return key;
+}
+
+/* Kopioi avaimet ja lapset solmusta toiseen.
+   fromIndex = lhdeindeksi, josta kopioidaan
+   count = kopioitavien indeksien mr
+   toNode = kohdesolmu
+   toIndex = kohdesolmun indeksi, johon kopioidaan */
+template<typename T> void PagedBTreeNode<T>::copy(int fromIndex, int count,
+                                                  PagedBTreeNode<T> &toNode,
+                                                  int toIndex) {
+  memcpy(toNode.keyArray()+toIndex, keyArray()+fromIndex, count*sizeof(T));
+  if (!isLeaf())
+    memcpy(toNode.childArray()+toIndex, childArray()+fromIndex,
+           (count+1)*sizeof(int));
+  toNode.dirty=true;
+  if (toIndex+count>toNode.numKeys()) toNode.setNumKeys(toIndex+count);
+}
+
+/* Varaa uuden sivun joko vapaiden sivujen listalta tai tiedoston lopusta
+   ja palauttaa sen kiinnitettyn solmuna.
+   leaf = true=solmu on lehti */
+template<typename T> PagedBTreeNode<T> PagedBTree<T>::allocateNode(
+  bool leaf) {
+  int id;
+  char *page;
+  if (freeList>=0) {
+    id=freeList;
+    page=pool->pin(id);
+    memcpy(&freeList, page, sizeof(int));
+  }
+  else page=pool->allocate(&id);
+
+  PagedBTreeNode<T> node(pool, id, page, degree);
+  node.init(leaf);
+  return node;
+}
+
+/* Vapauttaa solmun sivun vapaiden sivujen listalle.
+   node = vapautettava solmu; solmun kiinnitys vapautetaan */
+template<typename T> void PagedBTree<T>::freeNode(PagedBTreeNode<T> &node) {
+  // Vapaa sivu ei ole en solmu, joten sen alkuun tallennetaan vain
+  // seuraavan vapaan sivun numero.
+  node.setNumKeys(0);
+  char *page=pool->pin(node.getId());
+  memcpy(page, &freeList, sizeof(int));
+  pool->unpin(node.getId(), true);
+  freeList=node.getId();
+  node.release();
+}
+
+/* Kirjoittaa puun otsakkeen sivulle 0. */
+template<typename T> void PagedBTree<T>::writeHeader() {
+  FileHeader header;
+  header.magic=PAGEDBTREE_MAGIC;
+  header.pageSize=pool->getPageSize();
+  header.degree=degree;
+  header.keySize=sizeof(T);
+  header.root=root;
+  header.freeList=freeList;
+  char *page=pool->pin(0);
+  memcpy(page, &header, sizeof(header));
+  pool->unpin(0, true);
+}
+
+/* Tarkistaa alipuun solmujen avainten mrt ja ker alipuun avaimet
+   sisjrjestyksess. Avainten jrjestys tarkistetaan sisjrjestyksest,
+   joten jokainen sivu kiinnitetn vain kerran.
+   id = tarkistettavan alipuun juuren sivu
+   depth = alipuun juuren syvyys
+   found = vektori, johon avaimet listn */
+template<typename T> void PagedBTree<T>::validateBranch(int id, int depth,
+                                                        vector<T> &found) {
+  PagedBTreeNode<T> node(pool, id, degree);
+
+  if (depth>numDepth) numDepth=depth;
+  numNodes++;
+  numKeys+=node.numKeys();
+
+  // Tarkistetetaan, ett solmussa on tarpeeksi avaimia.
+  if (depth>0 && node.numKeys()<degree-1) {
+    cerr << "VALIDATE: Not enough keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (node.isLeaf()) {
+    for (int i=0; i<node.numKeys(); i++) found.push_back(node.getKey(i));
+    node.release();
+    return;
+  }
+
+  vector<int> children;
+  for (int i=0; i<node.numChildren(); i++)
+    children.push_back(node.getChild(i));
+  vector<T> separators;
+  for (int i=0; i<node.numKeys(); i++)
+    separators.push_back(node.getKey(i));
+  // Vapautetaan solmu ennen rekursiota, jotta kiinnitettyj sivuja on
+  // kerrallaan vain yksi puun tasoa kohden.
+  node.release();
+
+  for (unsigned int i=0; i<children.size(); i++) {
+    validateBranch(children[i], depth+1, found);
+    if (i<separators.size()) found.push_back(separators[i]);
+  }
+}
+
+/* Tulostaa avaimet esijrjestyksess. */
+template<typename T> void PagedBTree<T>::printPreorder(int id, int depth) {
+  PagedBTreeNode<T> node(pool, id, degree);
+  cout << "depth=" << depth << ", page=" << id << ", leaf="
+       << node.isLeaf() << ", keys=";
+  for (int i=0; i<node.numKeys(); i++)
+    cout << node.getKey(i) << (i<node.numKeys()-1 ? " " : "");
+  cout << endl;
+  vector<int> children;
+  if (!node.isLeaf())
+    for (int i=0; i<node.numChildren(); i++)
+      children.push_back(node.getChild(i));
+  node.release();
+  for (unsigned int i=0; i<children.size(); i++)
+    printPreorder(children[i], depth+1);
+}
+
+/* Jakaa tyden solmun kahteen solmuun. [1]
+   parent = issolmu, jonka lapsisolmu jaetaan
+   medianKey = keskimmisen avaimen paikka issolmussa
+   left = solmu, joka jaetaan ja josta tulee vasemmanpuoleinen sisar */
+template<typename T> void PagedBTree<T>::splitChild(
+  PagedBTreeNode<T> &parent, int medianKey, PagedBTreeNode<T> &left) {
+  // Luodaan uusi solmu, joka tulee vasemmanpuoleisen solmun sisareksi.
+  PagedBTreeNode<T> right=allocateNode(left.isLeaf());
+
+  // Jaetaan vasemmanpuoleinen solmu kahteen yht suureen osaan kopioimalla
+  // oikea puoli sisarsolmuun.
+  left.copy(degree, degree-1, right, 0);
+  left.setNumKeys(degree);
+
+  // Siirretn keskimminen alkio issolmuun ja asetetaan oikeanpuoleinen
+  // solmu issolmun lapseksi.
+  parent.insert(left.getKey(degree-1), -1, right.getId(), medianKey);
+  left.remove(degree-1, false, false);
+  right.release();
+}
+
+/* Lis avaimen vaillinaiseen alipuuhun. [1]
+   id = alipuun juuren sivu
+   key = avain */
+template<typename T> void PagedBTree<T>::insertNonfull(int id,
+                                                       const T &key) {
+  // Laskeudutaan silmukassa, jotta kerrallaan on kiinnitettyn vain
+  // issolmu ja lapsisolmu.
+  for (;;) {
+    PagedBTreeNode<T> node(pool, id, degree);
+    int i=node.numKeys()-1;
+    while (i>=0 && compare(key, node.getKey(i))<0) i--;
+
+    if (node.isLeaf()) {
+      if (debug==1) cout << "insertNonfull(): 1" << endl;
+      node.insert(key, -1, -1, i+1);
+      node.release();
+      return;
+    }
+    i++;
+
+    PagedBTreeNode<T> child(pool, node.getChild(i), degree);
+    if (child.numKeys()==2*degree-1) {
+      if (debug==1) cout << "insertNonfull(): 2" << endl;
+      // Matkan varrella oleva solmu on tynn; puolitetaan se.
+      splitChild(node, i, child);
+      if (compare(key, node.getKey(i))>0) i++;
+    }
+    child.release();
+    id=node.getChild(i);
+    node.release();
+  }
+}
+
+/* Lainaa oikeanpuoleiselta sisarsolmulta avaimen issolmun kautta.
+   parent = issolmu
+   index = lapsisolmun indeksi */
+template<typename T> void PagedBTree<T>::rotateRight(
+  PagedBTreeNode<T> &parent, int index) {
+  PagedBTreeNode<T> child(pool, parent.getChild(index), degree);
+  PagedBTreeNode<T> sibling(pool, parent.getChild(index+1), degree);
+  child.insert(parent.getKey(index), -1,
+               sibling.isLeaf() ? -1 : sibling.getChild(0),
+               child.numKeys());
+  parent.setKey(sibling.remove(0, true, false), index);
+  sibling.release();
+  child.release();
+}
+
+/* Lainaa vasemmanpuoleiselta sisarsolmulta avaimen issolmun kautta.
+   parent = issolmu
+   index = lapsisolmun indeksi */
+template<typename T> void PagedBTree<T>::rotateLeft(
+  PagedBTreeNode<T> &parent, int index) {
+  PagedBTreeNode<T> child(pool, parent.getChild(index), degree);
+  PagedBTreeNode<T> sibling(pool, parent.getChild(index-1), degree);
+  child.insert(parent.getKey(index-1),
+               sibling.isLeaf() ? -1 : sibling.getChild(sibling.numKeys()),
+               -1, 0);
+  parent.setKey(sibling.remove(sibling.numKeys()-1, false, true), index-1);
+  sibling.release();
+  child.release();
+}
+
+/* Yhdist lapsisolmun ja sen oikeanpuoleisen sisaren sek niiden vlisen
+   avaimen yhdeksi solmuksi. Palauttaa yhdistetyn solmun sivun.
+   parent = issolmu
+   mergeIndex = vasemmanpuoleisen lapsisolmun indeksi */
+template<typename T> int PagedBTree<T>::mergeChildren(
+  PagedBTreeNode<T> &parent, int mergeIndex) {
+  PagedBTreeNode<T> merged(pool, parent.getChild(mergeIndex), degree);
+  PagedBTreeNode<T> removed(pool, parent.getChild(mergeIndex+1), degree);
+
+  // Lainataan issolmusta mediaaniavain ja kopioidaan sisarsolmun avaimet
+  // ja lapset yhdistettvn solmuun.
+  merged.insert(parent.getKey(mergeIndex), -1, -1, merged.numKeys());
+  parent.remove(mergeIndex, false, true);
+  removed.copy(0, removed.numKeys(), merged, merged.numKeys());
+  freeNode(removed);
+
+  int id=merged.getId();
+  merged.release();
+
+  // Issolmusta lainattu avain tyhjensi juurisolmun. Tehdn yhdistetyst
+  // solmusta uusi juurisolmu.
+  if (parent.numKeys()==0 && parent.getId()==root) {
+    if (debug==1) cout << "mergeChildren(): 1" << endl;
+    root=id;
+    freeNode(parent);
+  }
+  return id;
+}
+
+/* Palauttaa alipuun suurimman avaimen.
+   id = alipuun juuren sivu */
+template<typename T> T PagedBTree<T>::maxKey(int id) {
+  for (;;) {
+    PagedBTreeNode<T> node(pool, id, degree);
+    if (node.isLeaf()) {
+      T key=node.getKey(node.numKeys()-1);
+      node.release();
+      return key;
+    }
+    id=node.getChild(node.numKeys());
+    node.release();
+  }
+}
+
+/* Palauttaa alipuun pienimmn avaimen.
+   id = alipuun juuren sivu */
+template<typename T> T PagedBTree<T>::minKey(int id) {
+  for (;;) {
+    PagedBTreeNode<T> node(pool, id, degree);
+    if (node.isLeaf()) {
+      T key=node.getKey(0);
+      node.release();
+      return key;
+    }
+    id=node.getChild(0);
+    node.release();
+  }
+}
+
+/* Poistaa avaimen alipuusta. [1]
+   key = poistettava avain
+   id = alipuun juuren sivu */
+template<typename T> void PagedBTree<T>::removeBranch(const T &key, int id) {
+  PagedBTreeNode<T> node(pool, id, degree);
+
+  int i=0;
+  while (i<node.numKeys() && compare(key, node.getKey(i))>0) i++;
+
+  if (i<node.numKeys() && compare(key, node.getKey(i))==0) {
+    if (node.isLeaf()) {
+      // 1. [1]
+      if (debug==1) cout << "removeBranch(): 1" << endl;
+      node.remove(i, false, false);
+      node.release();
+      return;
+    }
+
+    int leftId=node.getChild(i), rightId=node.getChild(i+1);
+    PagedBTreeNode<T> left(pool, leftId, degree);
+    PagedBTreeNode<T> right(pool, rightId, degree);
+    int leftKeys=left.numKeys(), rightKeys=right.numKeys();
+    left.release();
+    right.release();
+
+    if (leftKeys>=degree) {
+      // 2a. [1]
+      if (debug==1) cout << "removeBranch(): 2" << endl;
+      T predecessor=maxKey(leftId);
+      node.setKey(predecessor, i);
+      node.release();
+      removeBranch(predecessor, leftId);
+    }
+    else if (rightKeys>=degree) {
+      // 2b. [1]
+      if (debug==1) cout << "removeBranch(): 3" << endl;
+      T successor=minKey(rightId);
+      node.setKey(successor, i);
+      node.release();
+      removeBranch(successor, rightId);
+    }
+    else {
+      // 2c. [1]
+      if (debug==1) cout << "removeBranch(): 4" << endl;
+      int merged=mergeChildren(node, i);
+      node.release();
+      removeBranch(key, merged);
+    }
+    return;
+  }
+
+  if (node.isLeaf()) {
+    node.release();
+    return;
+  }
+
+  PagedBTreeNode<T> child(pool, node.getChild(i), degree);
+  int childKeys=child.numKeys();
+  child.release();
+
+  if (childKeys<degree) {
+    int rightKeys=0, leftKeys=0;
+    if (i<node.numKeys()) {
+      PagedBTreeNode<T> sibling(pool, node.getChild(i+1), degree);
+      rightKeys=sibling.numKeys();
+      sibling.release();
+    }
+    if (i>0) {
+      PagedBTreeNode<T> sibling(pool, node.getChild(i-1), degree);
+      leftKeys=sibling.numKeys();
+      sibling.release();
+    }
+
+    if (rightKeys>=degree) {
+      // 3a. oikea puoli [1]
+      if (debug==1) cout << "removeBranch(): 5" << endl;
+      rotateRight(node, i);
+    }
+    else if (leftKeys>=degree) {
+      // 3a. vasen puoli [1]
+      if (debug==1) cout << "removeBranch(): 6" << endl;
+      rotateLeft(node, i);
+    }
+    else {
+      // 3b. [1]
+      if (debug==1) cout << "removeBranch(): 7" << endl;
+      if (i<node.numKeys()) {
+        int merged=mergeChildren(node, i);
+        node.release();
+        removeBranch(key, merged);
+      }
+      else {
+        int merged=mergeChildren(node, i-1);
+        node.release();
+        removeBranch(key, merged);
+      }
+      return;
+    }
+  }
+
+  int next=node.getChild(i);
+  node.release();
+  removeBranch(key, next);
+}
+
+/* Luo uuden puun tai avaa olemassa olevan.
+   fileName = tiedosto, johon puu tallennetaan
+   pageSize = sivun koko tavuina; mr puun asteen
+   numFrames = muistissa pidettvien sivujen enimmismr
+   compare = metodi avainten vertailemiseksi
+   create = true=luo uuden puun, false=avaa olemassa olevan
+   debug = 1=lausekattavuustulostus */
+template<typename T> PagedBTree<T>::PagedBTree<T>(
+  const char *fileName, int pageSize, int numFrames,
+  int (*const compare)(const T &, const T &), bool create, int debug=0) :
+  degree(PagedBTreeNode<T>::degreeFor(pageSize)), root(-1), freeList(-1),
+  compare(compare), debug(debug) {
+  if (degree<2 || pageSize<int(sizeof(FileHeader))) {
+    cerr << "Page size too small for the key type." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Solmuja kiinnitetn kerrallaan enintn nelj: issolmu, lapsi,
+  // sisar ja otsakesivu.
+  if (numFrames<4) {
+    cerr << "Buffer pool must hold at least 4 pages." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  pool=new BufferPool(fileName, pageSize, numFrames, create);
+  if (create) {
+    int id;
+    pool->allocate(&id);
+    pool->unpin(id, true);
+    PagedBTreeNode<T> node=allocateNode(true);
+    root=node.getId();
+    node.release();
+    writeHeader();
+  }
+  else {
+    FileHeader header;
+    char *page=pool->pin(0);
+    memcpy(&header, page, sizeof(header));
+    pool->unpin(0, false);
+    if (header.magic!=PAGEDBTREE_MAGIC || header.pageSize!=pageSize ||
+        header.keySize!=int(sizeof(T))) {
+      cerr << "Invalid page file." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    degree=header.degree;
+    root=header.root;
+    freeList=header.freeList;
+  }
+}
+
+/* Kirjoittaa muuttuneet sivut levylle ja sulkee tiedoston. */
+template<typename T> PagedBTree<T>::~PagedBTree<T>() {
+  writeHeader();
+  delete pool;
+}
+
+/* Palauttaa puun asteen. */
+template<typename T> int PagedBTree<T>::getDegree() const {
+  return degree;
+}
+
+/* Palauttaa puun puskurivarannon. */
+template<typename T> BufferPool *PagedBTree<T>::getPool() {
+  return pool;
+}
+
+/* Tulostaa puun avaimet esijrjestyksess. */
+template<typename T> void PagedBTree<T>::printDebug() {
+  printPreorder(root, 0);
+}
+
+/* Etsii avaimen puusta. Palauttaa true, jos avain lytyi.
+   key = etsittv avain */
+template<typename T> bool PagedBTree<T>::search(const T &key) {
+  int id=root;
+  for (;;) {
+    PagedBTreeNode<T> node(pool, id, degree);
+    int i=0;
+    while (i<node.numKeys() && compare(key, node.getKey(i))>0) i++;
+    if (i<node.numKeys() && compare(key, node.getKey(i))==0) {
+      node.release();
+      return true;
+    }
+    if (node.isLeaf()) {
+      node.release();
+      return false;
+    }
+    id=node.getChild(i);
+    node.release();
+  }
+}
+
+/* Lis avaimen puuhun.
+   key = listtva avain */
+template<typename T> void PagedBTree<T>::insert(const T &key) {
+  if (search(key)) {
+    cerr << "Insertion of multiple same keys unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  PagedBTreeNode<T> oldRoot(pool, root, degree);
+  if (oldRoot.numKeys()==2*degree-1) {
+    if (debug==1) cout << "insert(): 1" << endl;
+    // Juuri on tynn; luodaan uusi juuri.
+    PagedBTreeNode<T> newRoot=allocateNode(false);
+    newRoot.setChild(root, 0);
+    splitChild(newRoot, 0, oldRoot);
+    root=newRoot.getId();
+    newRoot.release();
+  }
+  oldRoot.release();
+  insertNonfull(root, key);
+}
+
+/* Poistaa avaimen puusta.
+   key = poistettava avain */
+template<typename T> void PagedBTree<T>::remove(const T &key) {
+  removeBranch(key, root);
+}
+
+/* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt
+   tsmlleen annetut avaimet. Tarkistus on lineaarinen, jos avaimet
+   annetaan nousevassa jrjestyksess.
+   keys = avaimet, jotka pitisi olla puussa */
+template<typename T> void PagedBTree<T>::validate(const vector<T> &keys) {
+  vector<T> found;
+  found.reserve(keys.size());
+
+  numDepth=numNodes=numKeys=0;
+  PagedBTreeNode<T> node(pool, root, degree);
+  int rootKeys=node.numKeys();
+  node.release();
+  if (rootKeys>0) validateBranch(root, 0, found);
+
+  validateKeys(found, keys, compare);
+}
+
+/* Kirjoittaa muuttuneet sivut levylle. */
+template<typename T> void PagedBTree<T>::flush() {
+  writeHeader();
+  pool->flush();
+}
@@ -0,0 +1,253 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa levylle tallennettavan B-puun lhteess [1] mainituilla
+algoritmeilla. Jokainen solmu on kiinten kokoinen sivu, jota ksitelln
+puskurivarannon kautta.
+
+Lhteet:
+[1] Introduction to Algorithms Thomas H. Cormen, Charles E. Leiserson, and
+    Ronald L. Rivest. MIT-Press, 2001; Chapter 18, B-Trees.
+
+*/
+
+#ifndef PAGEDBTREE_H
+#define PAGEDBTREE_H
+
+#include <iostream>
+#include <vector>
+#include "bufferpool.h"
+#include "validate.h"
+
+/* Sivulle tallennetun B-puun solmun ksittelyyn tarkoitettu luokka. Olio
+   kiinnitt sivun luotaessa ja vapauttaa sen kutsuttaessa release()-metodia.
+   Avaimet ja lapsisivujen numerot sijaitsevat suoraan sivulla, joten
+   avaintyypin T on oltava kiinten kokoinen ja bitti bitilt kopioitava. */
+template<typename T> class PagedBTreeNode {
+  BufferPool *pool;
+  int id;
+  char *page;
+  const int degree;
+  const int maxKeys, maxChildren;
+  bool dirty;
+
+  /* Sivun alussa oleva otsake. */
+  struct Header {
+    int keys;
+    int leaf;
+  };
+
+  Header *header() const;
+  T *keyArray() const;
+  int *childArray() const;
+
+public:
+  /* Palauttaa suurimman asteen, jolla solmu mahtuu sivulle.
+     pageSize = sivun koko tavuina */
+  static int degreeFor(int pageSize);
+
+  /* Kiinnitt olemassa olevan solmun.
+     pool = puskurivaranto
+     id = solmun sivun numero
+     degree = puun aste */
+  PagedBTreeNode<T>(BufferPool *pool, int id, int degree);
+
+  /* Ksittelee jo kiinnitetty sivua.
+     page = sivun sislt */
+  PagedBTreeNode<T>(BufferPool *pool, int id, char *page, int degree);
+
+  /* Vapauttaa sivun kiinnityksen. */
+  void release();
+
+  /* Palauttaa solmun sivun numeron. */
+  int getId() const;
+
+  /* Alustaa tyhjn solmun.
+     leaf = true=solmu on lehti */
+  void init(bool leaf);
+
+  /* Palauttaa avainten lukumrn. */
+  int numKeys() const;
+
+  /* Palauttaa lasten lukumrn. */
+  int numChildren() const;
+
+  /* Palautaan arvon true, jos solmu on lehti. */
+  bool isLeaf() const;
+
+  /* Palauttaa avaimen kohdasta index. */
+  T getKey(int index) const;
+
+  /* Palauttaa lapsisivun numeron kohdasta index. */
+  int getChild(int index) const;
+
+  /* Asettaa avaimelle uuden arvon. */
+  void setKey(const T &newKey, int index);
+
+  /* Asettaa lapsisivun numeron. */
+  void setChild(int newChild, int index);
+
+  /* Asettaa avainten lukumrn. */
+  void setNumKeys(int newNumKeys);
+
+  /* Siirt avaimia ja lapsia eteenpin ja pivitt avainten lukumrn.
+     fromIndex = indeksi, josta alkaen avaimet siirretn
+     count = siirron pituus */
+  void shift(int fromIndex, int count);
+
+  /* Lis avaimen sek sen vasemman- ja oikeanpuoleiset lapset solmuun.
+     newKey = uusi avain
+     leftChild = vasemmanpuoleinen lapsi; jos -1 ei muuta nykyist
+     rightChild = oikeanpuoleinen lapsi; jos -1 ei muuta nykyist
+     index = paikka, johon avain ja lapset listn */
+  void insert(const T &newKey, int leftChild, int rightChild, int index);
+
+  /* Poistaa avaimen ja mahdollisesti toisen sen lapsista.
+     index = avaimen indeksi
+     leftChild = jos true, poistaa vasemmanpuolisen lapsen
+     rightChild = jos true, poistaa oikeanpuoleisen lapsen */
+  T remove(int index, bool leftChild, bool rightChild);
+
+  /* Kopioi avaimet ja lapset solmusta toiseen.
+     fromIndex = lhdeindeksi, josta kopioidaan
+     count = kopioitavien indeksien mr
+     toNode = kohdesolmu
+     toIndex = kohdesolmun indeksi, johon kopioidaan */
+  void copy(int fromIndex, int count, PagedBTreeNode<T> &toNode,
+            int toIndex);
+};
+
+/* Levylle tallennettavan B-puun toteuttava luokka. Sivu 0 sislt puun
+   otsakkeen ja muut sivut solmuja tai vapaita sivuja. */
+template<typename T> class PagedBTree {
+  BufferPool *pool;
+  int degree;
+  int root;
+  int freeList;
+  int (*const compare)(const T &, const T &);
+  int numDepth, numNodes, numKeys;
+  const int debug;
+
+  /* Tiedoston ensimmisen sivun sislt. */
+  struct FileHeader {
+    int magic;
+    int pageSize;
+    int degree;
+    int keySize;
+    int root;
+    int freeList;
+  };
+
+protected:
+  /* Varaa uuden sivun joko vapaiden sivujen listalta tai tiedoston lopusta
+     ja palauttaa sen kiinnitettyn solmuna.
+     leaf = true=solmu on lehti */
+  PagedBTreeNode<T> allocateNode(bool leaf);
+
+  /* Vapauttaa solmun sivun vapaiden sivujen listalle.
+     node = vapautettava solmu; solmun kiinnitys vapautetaan */
+  void freeNode(PagedBTreeNode<T> &node);
+
+  /* Kirjoittaa puun otsakkeen sivulle 0. */
+  void writeHeader();
+
+  /* Tarkistaa alipuun solmujen avainten mrt ja ker alipuun avaimet
+     sisjrjestyksess.
+     id = tarkistettavan alipuun juuren sivu
+     depth = alipuun juuren syvyys
+     found = vektori, johon avaimet listn */
+  void validateBranch(int id, int depth, std::vector<T> &found);
+
+  /* Tulostaa avaimet esijrjestyksess. */
+  void printPreorder(int id, int depth);
+
+  /* Jakaa tyden solmun kahteen solmuun. [1]
+     parent = issolmu, jonka lapsisolmu jaetaan
+     medianKey = keskimmisen avaimen paikka issolmussa
+     left = solmu, joka jaetaan ja josta tulee vasemmanpuoleinen sisar */
+  void splitChild(PagedBTreeNode<T> &parent, int medianKey,
+                  PagedBTreeNode<T> &left);
+
+  /* Lis avaimen vaillinaiseen alipuuhun. [1]
+     id = alipuun juuren sivu
+     key = avain */
+  void insertNonfull(int id, const T &key);
+
+  /* Lainaa oikeanpuoleiselta sisarsolmulta avaimen issolmun kautta.
+     parent = issolmu
+     index = lapsisolmun indeksi */
+  void rotateRight(PagedBTreeNode<T> &parent, int index);
+
+  /* Lainaa vasemmanpuoleiselta sisarsolmulta avaimen issolmun kautta.
+     parent = issolmu
+     index = lapsisolmun indeksi */
+  void rotateLeft(PagedBTreeNode<T> &parent, int index);
+
+  /* Yhdist lapsisolmun ja sen oikeanpuoleisen sisaren sek niiden vlisen
+     avaimen yhdeksi solmuksi. Palauttaa yhdistetyn solmun sivun.
+     parent = issolmu
+     mergeIndex = vasemmanpuoleisen lapsisolmun indeksi */
+  int mergeChildren(PagedBTreeNode<T> &parent, int mergeIndex);
+
+  /* Palauttaa alipuun suurimman avaimen.
+     id = alipuun juuren sivu */
+  T maxKey(int id);
+
+  /* Palauttaa alipuun pienimmn avaimen.
+     id = alipuun juuren sivu */
+  T minKey(int id);
+
+  /* Poistaa avaimen alipuusta. [1]
+     key = poistettava avain
+     id = alipuun juuren sivu */
+  void removeBranch(const T &key, int id);
+
+public:
+  /* Luo uuden puun tai avaa olemassa olevan.
+     fileName = tiedosto, johon puu tallennetaan
+     pageSize = sivun koko tavuina; mr puun asteen
+     numFrames = muistissa pidettvien sivujen enimmismr
+     compare = metodi avainten vertailemiseksi
+     create = true=luo uuden puun, false=avaa olemassa olevan
+     debug = 1=lausekattavuustulostus */
+  PagedBTree<T>(const char *fileName, int pageSize, int numFrames,
+                int (*const compare)(const T &, const T &), bool create,
+                int debug);
+
+  /* Kirjoittaa muuttuneet sivut levylle ja sulkee tiedoston. */
+  ~PagedBTree<T>();
+
+  /* Palauttaa puun asteen. */
+  int getDegree() const;
+
+  /* Palauttaa puun puskurivarannon. */
+  BufferPool *getPool();
+
+  /* Tulostaa puun avaimet esijrjestyksess. */
+  void printDebug();
+
+  /* Etsii avaimen puusta. Palauttaa true, jos avain lytyi.
+     key = etsittv avain */
+  bool search(const T &key);
+
+  /* Lis avaimen puuhun.
+     key = listtva avain */
+  void insert(const T &key);
+
+  /* Poistaa avaimen puusta.
+     key = poistettava avain */
+  void remove(const T &key);
+
+  /* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt
+     tsmlleen annetut avaimet. Tarkistus on lineaarinen, jos avaimet
+     annetaan nousevassa jrjestyksess.
+     keys = avaimet, jotka pitisi olla puussa */
+  void validate(const std::vector<T> &keys);
+
+  /* Kirjoittaa muuttuneet sivut levylle. */
+  void flush();
+};
+
+#endif
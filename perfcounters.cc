@@ -0,0 +1,122 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa suorittimen suorituskykylaskurien (kellojaksot, kskyt,
+L1-datavlimuistin ja viimeisen tason vlimuistin hudit, hyppyjen
+ennustusvirheet ja dTLB-hudit) lukemisen Linuxin perf_event_open()-
+kutsulla. Laskuri, jota ei voida avata (esim. virtuaalikoneessa tai
+kyttoikeuksien puuttuessa), jtetn pois, eik sen puuttuminen est
+muiden laskurien kytt.
+
+*/
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perfcounters.h"
+
+/* Avaa kaikki kytettviss olevat laskurit. */
+PerfCounters::PerfCounters() {
+  // Vlimuistilaskurien asetus: vlimuisti | operaatio << 8 | tulos << 16.
+  const unsigned int types[PERF_COUNTERS]={
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+  };
+  const unsigned long long configs[PERF_COUNTERS]={
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+    (PERF_COUNT_HW_CACHE_RESULT_MISS<<16),
+    PERF_COUNT_HW_CACHE_LL|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+    (PERF_COUNT_HW_CACHE_RESULT_MISS<<16),
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+    (PERF_COUNT_HW_CACHE_RESULT_MISS<<16)
+  };
+
+  for (int i=0; i<PERF_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size=sizeof(attr);
+    attr.type=types[i];
+    attr.config=configs[i];
+    attr.disabled=1;
+    attr.exclude_kernel=1;
+    attr.exclude_hv=1;
+    attr.read_format=PERF_FORMAT_TOTAL_TIME_ENABLED|
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd[i]=syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    value[i]=0;
+  }
+}
+
+/* Sulkee laskurit. */
+PerfCounters::~PerfCounters() {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (fd[i]>=0) close(fd[i]);
+}
+
+/* Palauttaa laskurin nimen. */
+const char *PerfCounters::getName(int counter) {
+  const char *names[PERF_COUNTERS]={
+    "Cycles", "Instructions", "L1dMisses", "LlcMisses", "BranchMisses",
+    "DtlbMisses"
+  };
+  return counter>=0 && counter<PERF_COUNTERS ? names[counter] : "";
+}
+
+/* Palauttaa true, jos laskuri on kytettviss. */
+bool PerfCounters::isAvailable(int counter) const {
+  return counter>=0 && counter<PERF_COUNTERS && fd[counter]>=0;
+}
+
+/* Palauttaa true, jos jokin laskureista on kytettviss. */
+bool PerfCounters::anyAvailable() const {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (fd[i]>=0) return true;
+  return false;
+}
+
+/* Lukee laskurin arvon skaalattuna koko mittausajalle, jos ydin on
+   jakanut laskurin muiden kanssa (multiplexing). */
+long long PerfCounters::readCounter(int counter) const {
+  // count, time_enabled, time_running
+  unsigned long long data[3];
+  if (read(fd[counter], data, sizeof(data))!=sizeof(data) || data[2]==0)
+    return 0;
+  if (data[2]<data[1])
+    return (long long)(data[0]*((double)data[1]/data[2]));
+  return data[0];
+}
+
+/* Nollaa ja kynnist laskurit. */
+void PerfCounters::start() {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (fd[i]>=0) {
+      ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/* Pysytt laskurit ja lis niiden arvot kertyneisiin arvoihin. */
+void PerfCounters::stop() {
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (fd[i]>=0) ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  for (int i=0; i<PERF_COUNTERS; i++)
+    if (fd[i]>=0) value[i]+=readCounter(i);
+}
+
+/* Nollaa kertyneet arvot. */
+void PerfCounters::reset() {
+  for (int i=0; i<PERF_COUNTERS; i++) value[i]=0;
+}
+
+/* Palauttaa laskurin kertyneen arvon tai -1, jos laskuri ei ole
+   kytettviss. */
+long long PerfCounters::getValue(int counter) const {
+  return isAvailable(counter) ? value[counter] : -1;
+}
@@ -0,0 +1,69 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa suorittimen suorituskykylaskurien (kellojaksot, kskyt,
+L1-datavlimuistin ja viimeisen tason vlimuistin hudit, hyppyjen
+ennustusvirheet ja dTLB-hudit) lukemisen Linuxin perf_event_open()-
+kutsulla. Laskuri, jota ei voida avata (esim. virtuaalikoneessa tai
+kyttoikeuksien puuttuessa), jtetn pois, eik sen puuttuminen est
+muiden laskurien kytt.
+
+*/
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/* Laskurien indeksit. */
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_L1D_MISSES 2
+#define PERF_LLC_MISSES 3
+#define PERF_BRANCH_MISSES 4
+#define PERF_DTLB_MISSES 5
+#define PERF_COUNTERS 6
+
+/* Suorituskykylaskureita lukeva luokka. Laskurit lasketaan vain
+   start()- ja stop()-kutsujen vlill, ja arvot kertyvt, kunnes ne
+   nollataan reset()-metodilla. Laskurit mittaavat vain kutsuvaa siett
+   kyttjtilassa. */
+class PerfCounters {
+  int fd[PERF_COUNTERS];
+  long long value[PERF_COUNTERS];
+
+  /* Lukee laskurin arvon skaalattuna koko mittausajalle, jos ydin on
+     jakanut laskurin muiden kanssa (multiplexing). */
+  long long readCounter(int counter) const;
+
+public:
+  /* Avaa kaikki kytettviss olevat laskurit. */
+  PerfCounters();
+
+  /* Sulkee laskurit. */
+  ~PerfCounters();
+
+  /* Palauttaa laskurin nimen. */
+  static const char *getName(int counter);
+
+  /* Palauttaa true, jos laskuri on kytettviss. */
+  bool isAvailable(int counter) const;
+
+  /* Palauttaa true, jos jokin laskureista on kytettviss. */
+  bool anyAvailable() const;
+
+  /* Nollaa ja kynnist laskurit. */
+  void start();
+
+  /* Pysytt laskurit ja lis niiden arvot kertyneisiin arvoihin. */
+  void stop();
+
+  /* Nollaa kertyneet arvot. */
+  void reset();
+
+  /* Palauttaa laskurin kertyneen arvon tai -1, jos laskuri ei ole
+     kytettviss. */
+  long long getValue(int counter) const;
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden joukko-operaatioiden yhteisen osan: jrjestettyjen
+avainjonojen yhdisteen, leikkauksen ja erotuksen.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <vector>
+#include "setalgebra.h"
+
+using namespace std;
+
+/* Etsii jrjestetyst vektorista kohdasta from alkaen ensimmisen avaimen,
+   joka on suurempi tai yht suuri kuin key. */
+template<typename T> int gallopKeys(const vector<T> &keys, int from,
+                                    const T &key,
+                                    int (*compare)(const T &, const T &)) {
+  // Kohdan lo edell olevat avaimet ovat pienempi kuin key, ja kohdan hi
+  // avain on vhintn key tai vektori loppuu.
+  int lo=from, hi=from, step=1, size=keys.size();
+  while (hi<size && compare(keys[hi], key)<0) {
+    lo=hi+1;
+    hi+=step;
+    step*=2;
+  }
+  if (hi>size) hi=size;
+  while (lo<hi) {
+    int middle=lo+(hi-lo)/2;
+    if (compare(keys[middle], key)<0) lo=middle+1;
+    else hi=middle;
+  }
+  return lo;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess kahden jrjestetyn
+   avainjonon yhdisteen, leikkauksen tai erotuksen a-b. */
+template<typename T> void mergeKeys(const vector<T> &a, const vector<T> &b,
+                                    int operation,
+                                    int (*compare)(const T &, const T &),
+                                    vector<T> &result) {
+  if (operation<SET_UNION || operation>SET_DIFFERENCE) {
+    cerr << "mergeKeys(): Invalid operation." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Operaatio mrytyy siit, silytetnk vain a:ssa, vain b:ss ja
+  // molemmissa olevat avaimet.
+  bool onlyA=operation!=SET_INTERSECTION, onlyB=operation==SET_UNION,
+    both=operation!=SET_DIFFERENCE;
+
+  const vector<T> *small=&a, *large=&b;
+  bool onlySmall=onlyA, onlyLarge=onlyB;
+  if (a.size()>b.size()) {
+    small=&b;
+    large=&a;
+    onlySmall=onlyB;
+    onlyLarge=onlyA;
+  }
+
+  if (large->size()>=GALLOP_RATIO*small->size()) {
+    // Haetaan lyhyemmn jonon avaimet pidemmst laukkahaulla; vliin
+    // jvt avaimet ovat vain pidemmss jonossa.
+    int j=0;
+    for (unsigned int i=0; i<small->size(); i++) {
+      int k=gallopKeys(*large, j, (*small)[i], compare);
+      if (onlyLarge)
+        result.insert(result.end(), large->begin()+j, large->begin()+k);
+      if (k<(int)large->size() && compare((*large)[k], (*small)[i])==0) {
+        if (both) result.push_back((*small)[i]);
+        k++;
+      }
+      else if (onlySmall) result.push_back((*small)[i]);
+      j=k;
+    }
+    if (onlyLarge) result.insert(result.end(), large->begin()+j, large->end());
+    return;
+  }
+
+  unsigned int i=0, j=0;
+  while (i<a.size() && j<b.size()) {
+    int c=compare(a[i], b[j]);
+    if (c<0) {
+      if (onlyA) result.push_back(a[i]);
+      i++;
+    }
+    else if (c>0) {
+      if (onlyB) result.push_back(b[j]);
+      j++;
+    }
+    else {
+      if (both) result.push_back(a[i]);
+      i++;
+      j++;
+    }
+  }
+  if (onlyA) result.insert(result.end(), a.begin()+i, a.end());
+  if (onlyB) result.insert(result.end(), b.begin()+j, b.end());
+}
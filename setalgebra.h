@@ -0,0 +1,46 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden joukko-operaatioiden yhteisen osan: kahden
+nousevassa jrjestyksess olevan avainjonon yhdisteen, leikkauksen ja
+erotuksen yhdell lpikynnill. Jos toinen jono on paljon lyhyempi, sen
+avaimet haetaan pidemmst laukkahaulla (exponential search), jolloin
+vertailuja tarvitaan vain O(m log(n/m)).
+
+*/
+
+#ifndef SETALGEBRA_H
+#define SETALGEBRA_H
+
+#include <vector>
+
+/* Joukko-operaatiot. */
+#define SET_UNION 0
+#define SET_INTERSECTION 1
+#define SET_DIFFERENCE 2
+
+/* Kokoero, josta alkaen lyhyemmn jonon avaimet haetaan pidemmst
+   laukkahaulla. */
+#define GALLOP_RATIO 8
+
+/* Etsii jrjestetyst vektorista kohdasta from alkaen ensimmisen avaimen,
+   joka on suurempi tai yht suuri kuin key. Askelta kaksinkertaistetaan,
+   kunnes key ohitetaan, ja vli puolitetaan lopuksi binrihaulla.
+   Palauttaa indeksin tai vektorin koon, jos sellaista avainta ei ole. */
+template<typename T> int gallopKeys(const std::vector<T> &keys, int from,
+                                    const T &key,
+                                    int (*compare)(const T &, const T &));
+
+/* Lis tulosvektoriin nousevassa jrjestyksess kahden jrjestetyn
+   avainjonon yhdisteen, leikkauksen tai erotuksen a-b.
+   a, b = nousevassa jrjestyksess olevat, keskenn erisuuret avaimet
+   operation = SET_UNION, SET_INTERSECTION tai SET_DIFFERENCE
+   compare = avainten vertailufunktio */
+template<typename T> void mergeKeys(const std::vector<T> &a,
+                                    const std::vector<T> &b, int operation,
+                                    int (*compare)(const T &, const T &),
+                                    std::vector<T> &result);
+
+#endif
@@ -13,9 +13,14 @@ L
 */
 
 #include <iostream>
+#include <fstream>
 #include <csignal>
 #include <vector>
+#include <string>
+#include <sstream>
 #include "skiplist.h"
+#include "snapshot.h"
+#include "wal.h"
 #include "rng.h"
 
 using namespace std;
@@ -28,7 +33,7 @@ template<typename T> SkipListNode<T>::SkipListNode<T>(SkipListNode<T> *footer,
                                                       int level,
                                                       const T key,
                                                       int debug=0) :
-  level(level), key(key), debug(debug) {
+  level(level), key(key), debug(debug), copies(1) {
   if (level<1) {
     cerr << "SkipListNode<T>(): Invalid level." << endl;
     raise(SIGABRT);
@@ -48,6 +53,29 @@ template<typename T> const T &SkipListNode<T>::getKey() { return key; }
 /* Palauttaa solmun tason. */
 template<typename T> int SkipListNode<T>::getLevel() { return level; }
 
+/* Palauttaa avaimen kappalemrn. */
+template<typename T> int SkipListNode<T>::getCopies() const { return copies; }
+
+/* Asettaa avaimen kappalemrn. */
+template<typename T> void SkipListNode<T>::setCopies(int newCopies) {
+  if (newCopies<1) {
+    cerr << "setCopies(): Invalid copies." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  copies=newCopies;
+}
+
+/* Palauttaa solmun ja sen seuraajataulukon varaamat tavut. */
+template<typename T> long long SkipListNode<T>::allocatedBytes() const {
+  return sizeof(SkipListNode<T>)+level*sizeof(SkipListNode<T> *);
+}
+
+/* Palauttaa avaimen, sen kappalemrn ja seuraajaosoittimien tavut. */
+template<typename T> long long SkipListNode<T>::liveBytes() const {
+  return sizeof(T)+sizeof(int)+level*sizeof(SkipListNode<T> *);
+}
+
 /* Palauttaa seuraajaosoittimen.
    index = seuraajaosoittimen taso */
 template<typename T> SkipListNode<T> *SkipListNode<T>::getForward(int index) {
@@ -107,7 +135,7 @@ template<typename T> SkipList<T>::SkipList<T>(int maxLevel, double p,
   int (*const compare)(const T &, const T &),
                                               int debug=0) :
   maxLevel(maxLevel), p(p), lastKey(lastKey), compare(compare), level(1),
-  debug(debug) {
+  multiset(false), debug(debug) {
   if (maxLevel<1 || p<0 || p>1) {
     cerr << "Level must be >= 1 and probability must be between 0 and 1."
          << endl;
@@ -131,14 +159,88 @@ template<typename T> SkipList<T>::~SkipList<T>() {
 /* Etsii avaimen listasta ja palauttaa osoittimen avaimen solmuun. */
 template<typename T> SkipListNode<T> *SkipList<T>::search(const T &key) {
   SkipListNode<T> *node=header;
-  for (int i=level-1; i>=0; i--)
-    while (compare(node->getForward(i)->getKey(), key)<0)
+  for (int i=level-1; i>=0; i--) {
+    int steps=0;
+    while (compare(node->getForward(i)->getKey(), key)<0) {
       node=node->getForward(i);
+      steps++;
+    }
+    TRACE_EVENT(trace, TRACE_SEARCH_STEP, i, steps);
+  }
   node=node->getForward(0);
   if (compare(node->getKey(), key)==0) return node;
   else return NULL;
 }
 
+/* Etsii listasta pienimmn avaimen, joka on suurempi tai yht suuri
+   kuin key. Palauttaa false, jos sellaista ei ole.
+   key = etsittv avain
+   result = lydetty avain palautetaan thn */
+template<typename T> bool SkipList<T>::ceilingKey(const T &key,
+                                                  T *result) {
+  SkipListNode<T> *node=header;
+  for (int i=level-1; i>=0; i--)
+    while (compare(node->getForward(i)->getKey(), key)<0)
+      node=node->getForward(i);
+  node=node->getForward(0);
+  if (node==footer) return false;
+  *result=node->getKey();
+  return true;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi].
+   lo = vlin alaraja
+   hi = vlin ylraja
+   result = vektori, johon avaimet listn */
+template<typename T> void SkipList<T>::range(const T &lo, const T &hi,
+                                             vector<T> &result) {
+  // Etsitn ensimminen solmu, jonka avain on vhintn alaraja, ja
+  // kuljetaan siit eteenpin tasolla 0.
+  SkipListNode<T> *node=header;
+  for (int i=level-1; i>=0; i--)
+    while (compare(node->getForward(i)->getKey(), lo)<0)
+      node=node->getForward(i);
+  node=node->getForward(0);
+  while (node!=footer && compare(node->getKey(), hi)<=0) {
+    result.push_back(node->getKey());
+    node=node->getForward(0);
+  }
+}
+
+/* Lis tulosvektoriin listan kaikki avaimet nousevassa jrjestyksess.
+   result = vektori, johon avaimet listn */
+template<typename T> void SkipList<T>::keys(vector<T> &result) {
+  for (SkipListNode<T> *node=header->getForward(0); node!=footer;
+       node=node->getForward(0))
+    result.push_back(node->getKey());
+}
+
+/* Lis listan muistinkytn erittelyyn solmujen tasoittain
+   ("level k") sek alku- ja loppusolmuna ("sentinel").
+   usage = erittely, johon listn */
+template<typename T> void SkipList<T>::memoryUsage(MemoryUsage &usage) {
+  vector<long long> nodes(maxLevel+1, 0), live(maxLevel+1, 0),
+    allocated(maxLevel+1, 0);
+  for (SkipListNode<T> *node=header->getForward(0); node!=footer;
+       node=node->getForward(0)) {
+    int k=node->getLevel();
+    nodes[k]++;
+    live[k]+=node->liveBytes();
+    allocated[k]+=node->allocatedBytes();
+  }
+  // Alku- ja loppusolmun avaimilla ei ole arvoa, joten koko solmu on
+  // hukkaa lukuun ottamatta alkusolmun kytss olevia tasoja.
+  usage.add("sentinel", 2, level*sizeof(SkipListNode<T> *),
+            header->allocatedBytes()+footer->allocatedBytes());
+  for (int k=1; k<=maxLevel; k++)
+    if (nodes[k]>0) {
+      stringstream name;
+      name << "level " << k;
+      usage.add(name.str(), nodes[k], live[k], allocated[k]);
+    }
+}
+
 /* Lis avaimen listaan. */
 template<typename T> void SkipList<T>::insert(const T &key) {
   if (compare(key, lastKey)==0) {
@@ -147,7 +249,13 @@ template<typename T> void SkipList<T>::insert(const T &key) {
     return;
   }
 
-  if (search(key)!=NULL) {
+  SkipListNode<T> *found=search(key);
+  if (found!=NULL && multiset) {
+    // Monijoukon avaimen uusi kappale vain lasketaan.
+    found->setCopies(found->getCopies()+1);
+    return;
+  }
+  if (found!=NULL) {
     cerr << "Insertion of multiple same keys unsupported." << endl;
     raise(SIGABRT);
     return;
@@ -177,6 +285,7 @@ template<typename T> void SkipList<T>::insert(const T &key) {
       if (debug==1) cout << "insert(): 2" << endl;
       update[i]=header;
     }
+    TRACE_EVENT(trace, TRACE_LEVEL_RAISE, lvl, lvl-level);
     level=lvl;
   }
 
@@ -187,6 +296,184 @@ template<typename T> void SkipList<T>::insert(const T &key) {
     node->setForward(i, update[i]->getForward(i));
     update[i]->setForward(i, node);
   }
+  delete[] update;
+}
+
+/* Korvaa listan sislln annetuilla avaimilla.
+   sorted = nousevassa jrjestyksess olevat, keskenn erisuuret
+            avaimet */
+template<typename T> void SkipList<T>::build(const vector<T> &sorted) {
+  SkipListNode<T> *node=header->getForward(0);
+  while (node!=footer) {
+    SkipListNode<T> *tmp=node->getForward(0);
+    delete node;
+    node=tmp;
+  }
+
+  // Kunkin tason viimeinen solmu, jonka pern seuraava solmu liitetn.
+  SkipListNode<T> **last=new SkipListNode<T> *[maxLevel];
+  for (int i=0; i<maxLevel; i++) {
+    header->setForward(i, footer);
+    last[i]=header;
+  }
+  level=1;
+
+  for (unsigned int j=0; j<sorted.size(); j++) {
+    if (debug==1) cout << "build(): 1" << endl;
+    int lvl=randomLevel();
+    if (lvl>level) level=lvl;
+    node=new SkipListNode<T>(footer, lvl, sorted[j]);
+    for (int i=0; i<lvl; i++) {
+      last[i]->setForward(i, node);
+      last[i]=node;
+    }
+  }
+  delete[] last;
+}
+
+/* Korvaa listan sislln toisen listan kanssa tehdyn joukko-operaation
+   tuloksella.
+   other = toinen lista, joka ei muutu
+   operation = SET_UNION, SET_INTERSECTION tai SET_DIFFERENCE */
+template<typename T> void SkipList<T>::combine(SkipList<T> &other,
+                                               int operation) {
+  if (multiset || other.multiset) {
+    cerr << "Set operations on multisets unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  vector<T> a, b, result;
+  keys(a);
+  other.keys(b);
+  mergeKeys(a, b, operation, compare, result);
+  build(result);
+}
+
+/* Lis listaan toisen listan avaimet.
+   other = toinen lista, joka ei muutu */
+template<typename T> void SkipList<T>::unionWith(SkipList<T> &other) {
+  combine(other, SET_UNION);
+}
+
+/* Poistaa listasta avaimet, jotka eivt ole toisessa listassa.
+   other = toinen lista, joka ei muutu */
+template<typename T> void SkipList<T>::intersect(SkipList<T> &other) {
+  combine(other, SET_INTERSECTION);
+}
+
+/* Poistaa listasta avaimet, jotka ovat toisessa listassa.
+   other = toinen lista, joka ei muutu */
+template<typename T> void SkipList<T>::difference(SkipList<T> &other) {
+  combine(other, SET_DIFFERENCE);
+}
+
+/* Siirt listan avaimet, jotka ovat suurempia tai yht suuria kuin key,
+   toiseen listaan.
+   key = jakokohta
+   right = lista, johon suuremmat avaimet siirretn */
+template<typename T> void SkipList<T>::split(const T &key,
+                                             SkipList<T> &right) {
+  if (&right==this || right.maxLevel!=maxLevel ||
+      compare(right.footer->getKey(), footer->getKey())!=0) {
+    cerr << "split(): Invalid list." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  right.multiset=multiset;
+
+  SkipListNode<T> *node=right.header->getForward(0);
+  while (node!=right.footer) {
+    SkipListNode<T> *tmp=node->getForward(0);
+    delete node;
+    node=tmp;
+  }
+
+  // Tallennetaan kunkin tason viimeinen solmu, jonka avain on pienempi
+  // kuin key. Sen seuraajasta alkaa tason oikea osa.
+  SkipListNode<T> **update=new SkipListNode<T> *[maxLevel];
+  node=header;
+  for (int i=maxLevel-1; i>=0; i--) {
+    while (i<level && compare(node->getForward(i)->getKey(), key)<0) {
+      if (debug==1) cout << "split(): 1" << endl;
+      node=node->getForward(i);
+    }
+    update[i]=node;
+  }
+
+  // Oikea osa pttyy tmn listan pttsolmuun, joten se annetaan
+  // oikealle listalle ja vasen osa ptetn oikean listan entiseen
+  // pttsolmuun.
+  SkipListNode<T> *oldFooter=footer;
+  for (int i=0; i<maxLevel; i++) {
+    right.header->setForward(i, update[i]->getForward(i));
+    update[i]->setForward(i, right.footer);
+  }
+  footer=right.footer;
+  right.footer=oldFooter;
+  delete[] update;
+
+  right.level=level;
+  while (right.level>1 &&
+         right.header->getForward(right.level-1)==right.footer) {
+    if (debug==1) cout << "split(): 2" << endl;
+    right.level--;
+  }
+  while (level>1 && header->getForward(level-1)==footer) {
+    if (debug==1) cout << "split(): 3" << endl;
+    level--;
+    TRACE_EVENT(trace, TRACE_LEVEL_LOWER, level, 1);
+  }
+}
+
+/* Siirt toisen listan kaikki avaimet tmn listan loppuun.
+   right = liitettv lista */
+template<typename T> void SkipList<T>::join(SkipList<T> &right) {
+  if (&right==this || right.maxLevel!=maxLevel ||
+      right.multiset!=multiset ||
+      compare(right.footer->getKey(), footer->getKey())!=0) {
+    cerr << "join(): Invalid list." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Etsitn kunkin tason viimeinen solmu.
+  SkipListNode<T> **last=new SkipListNode<T> *[maxLevel];
+  SkipListNode<T> *node=header;
+  for (int i=maxLevel-1; i>=0; i--) {
+    while (i<level && node->getForward(i)!=footer) {
+      if (debug==1) cout << "join(): 1" << endl;
+      node=node->getForward(i);
+    }
+    last[i]=node;
+  }
+
+  SkipListNode<T> *first=right.header->getForward(0);
+  if (node!=header && first!=right.footer &&
+      compare(node->getKey(), first->getKey())>=0) {
+    cerr << "join(): Keys of the lists overlap." << endl;
+    raise(SIGABRT);
+    delete[] last;
+    return;
+  }
+
+  // Linkitetn tasojen viimeiset solmut oikean listan tasojen
+  // ensimmisiin solmuihin, jotka pttyvt oikean listan pttsolmuun.
+  // Listat vaihtavat pttsolmuja.
+  SkipListNode<T> *oldFooter=footer;
+  for (int i=0; i<maxLevel; i++) {
+    last[i]->setForward(i, right.header->getForward(i));
+    right.header->setForward(i, oldFooter);
+  }
+  footer=right.footer;
+  right.footer=oldFooter;
+  delete[] last;
+
+  if (right.level>level) {
+    TRACE_EVENT(trace, TRACE_LEVEL_RAISE, right.level, right.level-level);
+    level=right.level;
+  }
+  right.level=1;
 }
 
 /* Poistaa avaimen listasta. */
@@ -207,7 +494,12 @@ template<typename T> void SkipList<T>::remove(const T &key) {
   }
 
   node=node->getForward(0);
-  if (compare(node->getKey(), key)==0) {
+  if (compare(node->getKey(), key)==0 && node->getCopies()>1) {
+    // Monijoukon avaimesta poistuu yksi kappale, eik lista muutu.
+    if (debug==1) cout << "remove(): 5" << endl;
+    node->setCopies(node->getCopies()-1);
+  }
+  else if (compare(node->getKey(), key)==0) {
     for (int i=0; i<level; i++) {
       if (update[i]->getForward(i)!=node) {
         // Reitill ollut solmu ei viittaa poistettavaan solmuun, joten
@@ -226,62 +518,88 @@ template<typename T> void SkipList<T>::remove(const T &key) {
     while (level>1 && header->getForward(level-1)==footer) {
       if (debug==1) cout << "remove(): 4" << endl;
       level--;
+      TRACE_EVENT(trace, TRACE_LEVEL_LOWER, level, 1);
     }
   }
+  delete[] update;
 }
 
-/* Tarkistaa, ett lista tytt hyppylistan vaatimukset. */
-template<typename T> void SkipList<T>::validate(const vector<T> &keys) {
-  vector<bool> checked(keys.size(), false);
+/* Valitsee, tallennetaanko listaan joukko vai monijoukko.
+   multiset = true=monijoukko, false=joukko */
+template<typename T> void SkipList<T>::setMultiset(bool multiset) {
+  if (header->getForward(0)!=footer) {
+    cerr << "setMultiset(): The list must be empty." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  this->multiset=multiset;
+}
 
-  SkipListNode<T> *node=header;
-  while (node!=NULL) {
+/* Palauttaa avaimen kappalemrn listassa. */
+template<typename T> int SkipList<T>::count(const T &key) {
+  SkipListNode<T> *node=search(key);
+  return node ? node->getCopies() : 0;
+}
 
-    // Merkitn avain, jos se on listassa.
-    for (unsigned int i=0; i<keys.size(); i++)
-      if (compare(node->getKey(), keys[i])==0) {
-        checked[i]=true;
-        break;
-      }
+/* Tarkistaa, ett lista tytt hyppylistan vaatimukset ja sislt
+   tsmlleen annetut avaimet. Jokaisen tason ketju kydn lpi yhdell
+   kertaa alimman tason mukana, joten tarkistus on lineaarinen solmujen
+   tasojen summan suhteen, jos avaimet annetaan nousevassa jrjestyksess.
+   keys = avaimet, jotka pitisi olla listassa */
+template<typename T> void SkipList<T>::validate(const vector<T> &keys) {
+  vector<T> found;
+  found.reserve(keys.size());
+
+  // Kunkin tason viimeisin solmu, jonka seuraajaksi seuraavan tmn tason
+  // solmun on oltava linkitetty.
+  int levels=header->getLevel();
+  vector<SkipListNode<T> *> last(levels, header);
+
+  SkipListNode<T> *node=header->getForward(0);
+  while (node!=footer) {
+    if (node==NULL) {
+      cerr << "VALIDATE: List not terminated." << endl;
+      raise(SIGABRT);
+      return;
+    }
 
     // Tarkistetaan, ett yhdenkn solmun taso ei ylit listan tasoa.
-    if (node!=header && node!=footer && node->getLevel()>level) {
+    if (node->getLevel()>level) {
       cerr << "VALIDATE: Invalid level in the node." << endl;
       raise(SIGABRT);
       return;
     }
 
-    // Tarkistetaan, ett seuraajasolmujen avaimet ovat suurempia kuin tmn
-    // solmun.
-    if (node!=header && node!=footer)
-      for (int i=node->getLevel()-1; i>=0; i--)
-        if (compare(node->getForward(i)->getKey(), node->getKey())<0) {
-          cerr << "VALIDATE: Nodes not in order." << endl;
-          raise(SIGABRT);
-          return;
-        }
-
-    // Tarkistetaan, ett ylemmn tason seuraajasolmun avain on suurempi kuin
-    // alemman tason seuraajasolmun.
-    if (node!=footer)
-      for (int i=node->getLevel()-1; i>0; i--)
-        if (compare(node->getForward(i)->getKey(),
-                    node->getForward(i-1)->getKey())<0) {
-          cerr << "VALIDATE: Forward pointers not in order." << endl;
-          raise(SIGABRT);
-          return;
-        }
+    // Tarkistetaan, ett solmu on linkitetty jokaisella tasollaan
+    // edellisen saman tason solmun seuraajaksi.
+    for (int i=0; i<node->getLevel(); i++) {
+      if (last[i]->getForward(i)!=node) {
+        cerr << "VALIDATE: Forward pointer skips a node." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      last[i]=node;
+    }
+
+    if (!multiset && node->getCopies()!=1) {
+      cerr << "VALIDATE: Multiple copies in a set." << endl;
+      raise(SIGABRT);
+      return;
+    }
 
+    found.push_back(node->getKey());
     node=node->getForward(0);
   }
 
-  // Tarkistetaan, ett kaikki avaimet on merkitty ja nin ollen listassa.
-  for (unsigned int i=0; i<checked.size(); i++)
-    if (checked[i]==false) {
-      cerr << "VALIDATE: Missing key." << endl;
+  // Tarkistetaan, ett jokaisen tason ketju pttyy loppusolmuun.
+  for (int i=0; i<levels; i++)
+    if (last[i]->getForward(i)!=footer) {
+      cerr << "VALIDATE: Forward pointers not in order." << endl;
       raise(SIGABRT);
       return;
     }
+
+  validateKeys(found, keys, compare);
 }
 
 /* Tulostaa listan nousevassa avainjrjestyksess. */
@@ -293,3 +611,102 @@ template<typename T> void SkipList<T>::print() {
     node=node->getForward(0);
   }
 }
+
+/* Tallentaa listan vedokseksi, jossa avaimet ovat tason 0 jrjestyksess
+   ja seuraajaosoittimien sijaan seuraajien indeksit. Avaintyypin on
+   oltava bitti bitilt kopioitava.
+   fileName = vedostiedosto */
+template<typename T> void SkipList<T>::save(const char *fileName) {
+  if (multiset) {
+    cerr << "Snapshots of multisets unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  // Vedos kirjoitetaan ensin vliaikaistiedostoon, jotta kesken jnyt
+  // tallennus ei korvaa edellist vedosta.
+  string tempName=string(fileName)+".tmp";
+  ofstream ofs(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!ofs) {
+    cerr << "Could not open snapshot file '" << tempName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Kydn lista lpi tasolla 0 ja pidetn kullakin tasolla kirjaa
+  // viimeisest solmusta, jonka seuraaja on viel asettamatta. Otsakesolmu
+  // on indeksi -1.
+  vector<T> keys;
+  vector<int> first, forward, headerForward(level), last(level, -1);
+  for (SkipListNode<T> *node=header->getForward(0); node!=footer;
+       node=node->getForward(0)) {
+    int index=keys.size(), lvl=node->getLevel();
+    keys.push_back(node->getKey());
+    first.push_back(forward.size());
+    for (int i=0; i<lvl; i++) {
+      forward.push_back(0);
+      if (last[i]<0) headerForward[i]=index;
+      else forward[first[last[i]]+i]=index;
+      last[i]=index;
+    }
+  }
+  first.push_back(forward.size());
+
+  // Tasojen viimeiset solmut osoittavat listan ptteeseen.
+  int n=keys.size();
+  for (int i=0; i<level; i++)
+    if (last[i]<0) headerForward[i]=n;
+    else forward[first[last[i]]+i]=n;
+
+  SkipListSnapshotHeader h;
+  h.magic=SKIPLIST_SNAPSHOT_MAGIC;
+  h.keySize=sizeof(T);
+  h.maxLevel=maxLevel;
+  h.level=level;
+  h.numKeys=n;
+  h.numForward=forward.size();
+
+  // Osat tasataan kahdeksalla jaollisiin kohtiin kuten vedosta luettaessa.
+  const char pad[8]={0, 0, 0, 0, 0, 0, 0, 0};
+  long long offset=sizeof(h);
+  ofs.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  ofs.write(pad, (8-offset%8)%8);
+  offset+=(8-offset%8)%8;
+  ofs.write(reinterpret_cast<const char *>(&headerForward[0]),
+            level*sizeof(int));
+  offset+=level*sizeof(int);
+  ofs.write(pad, (8-offset%8)%8);
+  offset+=(8-offset%8)%8;
+  if (n>0)
+    ofs.write(reinterpret_cast<const char *>(&keys[0]), n*sizeof(T));
+  offset+=(long long)n*sizeof(T);
+  ofs.write(pad, (8-offset%8)%8);
+  ofs.write(reinterpret_cast<const char *>(&first[0]),
+            first.size()*sizeof(int));
+  if (!forward.empty())
+    ofs.write(reinterpret_cast<const char *>(&forward[0]),
+              forward.size()*sizeof(int));
+  ofs.close();
+  if (!ofs) {
+    cerr << "Could not write snapshot file '" << tempName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  replaceFileDurably(tempName.c_str(), fileName);
+}
+
+/* Liitt save()-metodilla tallennetun vedoksen muistiin vain luettavaksi.
+   Palautettu vedos on tuhottava delete-operaattorilla.
+   fileName = vedostiedosto
+   compare = metodi avainten vertailemiseksi */
+template<typename T> SkipListSnapshot<T> *SkipList<T>::openReadOnly(
+  const char *fileName, int (*const compare)(const T &, const T &)) {
+  return new SkipListSnapshot<T>(fileName, compare);
+}
+
+#ifdef STRUCTURE_TRACE
+/* Palauttaa listan tapahtumalaskurit. Hakujen askeleet ovat siirtymi
+   seuraajaan tasoittain. */
+template<typename T> StructureTrace &SkipList<T>::getTrace() {
+  return trace;
+}
+#endif
@@ -18,6 +18,11 @@ L
 #include <iostream>
 #include <vector>
 #include "rng.h"
+#include "snapshot.h"
+#include "memory.h"
+#include "trace.h"
+#include "validate.h"
+#include "setalgebra.h"
 
 /* Hyppylistan solmun toteuttava luokka. */
 template<typename T> class SkipListNode {
@@ -25,6 +30,7 @@ template<typename T> class SkipListNode {
   T key;
   SkipListNode<T> **forward;
   const int debug;
+  int copies;
 
 public:
   /* footer = listan pttsolmu
@@ -40,6 +46,18 @@ public:
   /* Palauttaa solmun tason. */
   int getLevel();
 
+  /* Palauttaa avaimen kappalemrn; joukossa aina 1. */
+  int getCopies() const;
+
+  /* Asettaa avaimen kappalemrn. */
+  void setCopies(int newCopies);
+
+  /* Palauttaa solmun ja sen seuraajataulukon varaamat tavut. */
+  long long allocatedBytes() const;
+
+  /* Palauttaa avaimen, sen kappalemrn ja seuraajaosoittimien tavut. */
+  long long liveBytes() const;
+
   /* Palauttaa seuraajaosoittimen.
      index = seuraajaosoittimen taso */
   SkipListNode<T> *getForward(int index);
@@ -62,12 +80,22 @@ template<typename T> class SkipList {
   SkipListNode<T> *header, *footer;
   int level;
   RandomNumberGenerator random;
+  bool multiset;
   const int debug;
+#ifdef STRUCTURE_TRACE
+  StructureTrace trace;
+#endif
 
 protected:
   /* Palauttaa satunnaisen tason uudelle solmulle. */
   int randomLevel();
 
+  /* Korvaa listan sislln toisen listan kanssa tehdyn joukko-operaation
+     tuloksella.
+     other = toinen lista, joka ei muutu
+     operation = SET_UNION, SET_INTERSECTION tai SET_DIFFERENCE */
+  void combine(SkipList<T> &other, int operation);
+
 public:
   /* maxLevel = listan solmujen maksimitaso
      p = todennkisyys, jonka mukaan solmujen taso valitaan
@@ -87,18 +115,120 @@ public:
   /* Etsii avaimen listasta ja palauttaa osoittimen avaimen solmuun. */
   SkipListNode<T> *search(const T &key);
 
-  /* Lis avaimen listaan. */
+  /* Etsii listasta pienimmn avaimen, joka on suurempi tai yht suuri
+     kuin key. Palauttaa false, jos sellaista ei ole.
+     key = etsittv avain
+     result = lydetty avain palautetaan thn */
+  bool ceilingKey(const T &key, T *result);
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi].
+     lo = vlin alaraja
+     hi = vlin ylraja
+     result = vektori, johon avaimet listn */
+  void range(const T &lo, const T &hi, std::vector<T> &result);
+
+  /* Lis tulosvektoriin listan kaikki avaimet nousevassa jrjestyksess.
+     result = vektori, johon avaimet listn */
+  void keys(std::vector<T> &result);
+
+  /* Lis avaimen listaan. Monijoukossa listassa jo olevan avaimen
+     kappalemr kasvatetaan solmussa. */
   void insert(const T &key);
 
-  /* Poistaa avaimen listasta. */
+  /* Korvaa listan sislln annetuilla avaimilla. Solmut linkitetn
+     jrjestyksess kunkin tason viimeisen solmun pern, joten hakuja ei
+     tarvita ja rakentaminen on lineaarinen.
+     sorted = nousevassa jrjestyksess olevat, keskenn erisuuret
+              avaimet */
+  void build(const std::vector<T> &sorted);
+
+  /* Lis listaan toisen listan avaimet. Molempien listojen avaimet
+     kydn lpi jrjestyksess kerran ja tulos rakennetaan
+     build()-metodilla; jos toinen lista on paljon pienempi, sen avaimet
+     haetaan laukkahaulla. Monijoukoille ei ole joukko-operaatioita.
+     other = toinen lista, joka ei muutu */
+  void unionWith(SkipList<T> &other);
+
+  /* Poistaa listasta avaimet, jotka eivt ole toisessa listassa.
+     other = toinen lista, joka ei muutu */
+  void intersect(SkipList<T> &other);
+
+  /* Poistaa listasta avaimet, jotka ovat toisessa listassa.
+     other = toinen lista, joka ei muutu */
+  void difference(SkipList<T> &other);
+
+  /* Siirt listan avaimet, jotka ovat suurempia tai yht suuria kuin key,
+     toiseen listaan, jonka aiempi sislt tuhotaan. Jakokohta etsitn
+     kuten haussa, ja kullakin tasolla katkaistaan vain yksi
+     seuraajaosoitin, joten jako vie odotetusti ajan O(log n). Listat
+     vaihtavat pttsolmuja, jottei oikean osan tasojen viimeisi solmuja
+     tarvitse etsi.
+     key = jakokohta
+     right = lista, johon suuremmat avaimet siirretn; maksimitason ja
+             pttsolmun avaimen on oltava samat */
+  void split(const T &key, SkipList<T> &right);
+
+  /* Siirt toisen listan kaikki avaimet tmn listan loppuun. Toisen
+     listan avainten on oltava suurempia kuin tmn listan avaimet. Tmn
+     listan kunkin tason viimeinen solmu linkitetn toisen listan saman
+     tason ensimmiseen solmuun, joten liitos vie odotetusti ajan
+     O(log n); toinen lista j tyhjksi.
+     right = liitettv lista; maksimitason ja pttsolmun avaimen on
+             oltava samat */
+  void join(SkipList<T> &right);
+
+  /* Poistaa avaimen listasta. Monijoukossa avaimen kappalemr
+     vhennetn, ja solmu poistetaan vasta viimeisen kappaleen mukana. */
   void remove(const T &key);
 
-  /* Tarkistaa, ett lista tytt hyppylistan vaatimukset.
+  /* Valitsee, tallennetaanko listaan joukko vai monijoukko. Monijoukossa
+     kunkin avaimen solmussa on kappalemr, joten toistuva avain ei vie
+     lis solmuja. Haut, lpikynnit ja validate() ksittelevt kunkin
+     avaimen kerran; kappalemrt saadaan count()-metodilla. Jako ja
+     liitos siirtvt kappalemrt solmujen mukana. Listan on oltava
+     tyhj.
+     multiset = true=monijoukko, false=joukko (oletus) */
+  void setMultiset(bool multiset);
+
+  /* Palauttaa avaimen kappalemrn listassa; joukossa 0 tai 1. */
+  int count(const T &key);
+
+  /* Lis listan muistinkytn erittelyyn solmujen tasoittain
+     ("level k") sek alku- ja loppusolmuna ("sentinel").
+     usage = erittely, johon listn */
+  void memoryUsage(MemoryUsage &usage);
+
+  /* Tarkistaa, ett lista tytt hyppylistan vaatimukset ja sislt
+     tsmlleen annetut avaimet. Tarkistus on lineaarinen, jos avaimet
+     annetaan nousevassa jrjestyksess.
      keys = avaimet, jotka pitisi olla listassa */
   void validate(const std::vector<T> &keys);
 
   /* Tulostaa listan nousevassa avainjrjestyksess. */
   void print();
+
+  /* Tallentaa listan vedokseksi, jossa avaimet ovat tason 0 jrjestyksess
+     ja seuraajaosoittimien sijaan seuraajien indeksit. Avaintyypin on
+     oltava bitti bitilt kopioitava. Vedoksessa ei ole kappalemri,
+     joten monijoukkoa ei voi tallentaa. Vedos kirjoitetaan
+     vliaikaistiedostoon, joka korvaa vanhan vedoksen vasta levylle
+     viennin jlkeen.
+     fileName = vedostiedosto */
+  void save(const char *fileName);
+
+  /* Liitt save()-metodilla tallennetun vedoksen muistiin vain luettavaksi.
+     Palautettu vedos on tuhottava delete-operaattorilla.
+     fileName = vedostiedosto
+     compare = metodi avainten vertailemiseksi */
+  static SkipListSnapshot<T> *openReadOnly(const char *fileName,
+    int (*const compare)(const T &, const T &));
+
+#ifdef STRUCTURE_TRACE
+  /* Palauttaa listan tapahtumalaskurit. Hakujen askeleet ovat siirtymi
+     seuraajaan tasoittain. */
+  StructureTrace &getTrace();
+#endif
 };
 
 #endif
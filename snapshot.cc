@@ -0,0 +1,236 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa B-puun ja hyppylistan tiedostoon tallennettujen vedosten
+lukemisen. Vedos liitetn muistiin mmap():lla, ja haut tehdn suoraan
+liitetyst tiedostosta ilman rakenteen purkamista. Vedos ei sisll
+osoittimia, joten se voidaan liitt mihin tahansa osoitteeseen.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+using namespace std;
+
+/* Liitt tiedoston muistiin vain luettavaksi. Palauttaa tiedoston alun tai
+   NULL, jos liittminen eponnistui.
+   fileName = liitettv tiedosto
+   fd = tiedostokuvaaja palautetaan thn
+   length = tiedoston pituus palautetaan thn */
+static char *mapSnapshot(const char *fileName, int *fd, long long *length) {
+  *fd=open(fileName, O_RDONLY);
+  if (*fd<0) {
+    cerr << "Could not open snapshot file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(*fd, &st)!=0 || st.st_size==0) {
+    cerr << "Invalid snapshot file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+  *length=st.st_size;
+
+  void *base=mmap(NULL, *length, PROT_READ, MAP_SHARED, *fd, 0);
+  if (base==MAP_FAILED) {
+    cerr << "Could not map snapshot file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+  return static_cast<char *>(base);
+}
+
+/* Pyrist sijainnin seuraavaan kahdeksalla jaolliseen kohtaan. */
+static long long alignSnapshot(long long offset) {
+  return (offset+7)/8*8;
+}
+
+/* Liitt vedoksen muistiin.
+   fileName = vedostiedosto
+   compare = metodi avainten vertailemiseksi */
+template<typename T> BTreeSnapshot<T>::BTreeSnapshot<T>(
+  const char *fileName, int (*const compare)(const T &, const T &)) :
+  compare(compare) {
+  base=mapSnapshot(fileName, &fd, &length);
+  header=reinterpret_cast<const BTreeSnapshotHeader *>(base);
+  if (length<(long long)sizeof(BTreeSnapshotHeader) ||
+      header->magic!=BTREE_SNAPSHOT_MAGIC ||
+      header->keySize!=int(sizeof(T))) {
+    cerr << "Invalid B-tree snapshot '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+}
+
+/* Irrottaa vedoksen muistista. */
+template<typename T> BTreeSnapshot<T>::~BTreeSnapshot<T>() {
+  munmap(base, length);
+  close(fd);
+}
+
+/* Palauttaa solmun avainten lukumrn. */
+template<typename T> int BTreeSnapshot<T>::numKeys(long long node) const {
+  return reinterpret_cast<const int *>(base+node)[0];
+}
+
+/* Palauttaa true, jos solmu on lehti. */
+template<typename T> bool BTreeSnapshot<T>::isLeaf(long long node) const {
+  return reinterpret_cast<const int *>(base+node)[1]!=0;
+}
+
+/* Palauttaa osoittimen solmun avaimiin. */
+template<typename T> const T *BTreeSnapshot<T>::keys(long long node) const {
+  return reinterpret_cast<const T *>(base+node+2*sizeof(int));
+}
+
+/* Palauttaa solmun lapsen sijainnin. */
+template<typename T> long long BTreeSnapshot<T>::getChild(long long node,
+                                                          int index) const {
+  const long long *child=reinterpret_cast<const long long *>(
+    base+node+2*sizeof(int)+alignSnapshot((long long)numKeys(node)*sizeof(T)));
+  return child[index];
+}
+
+/* Ker alipuusta vlille [lo, hi] osuvat avaimet. */
+template<typename T> void BTreeSnapshot<T>::rangeBranch(
+  long long node, const T &lo, const T &hi, vector<T> &result) const {
+  const T *key=keys(node);
+  int n=numKeys(node);
+
+  // Ohitetaan avaimet, jotka ovat pienempi kuin vlin alaraja.
+  int i=0;
+  while (i<n && compare(key[i], lo)<0) i++;
+
+  if (!isLeaf(node)) rangeBranch(getChild(node, i), lo, hi, result);
+  for (; i<n && compare(key[i], hi)<=0; i++) {
+    result.push_back(key[i]);
+    if (!isLeaf(node)) rangeBranch(getChild(node, i+1), lo, hi, result);
+  }
+}
+
+/* Palauttaa vedoksen avainten lukumrn. */
+template<typename T> long long BTreeSnapshot<T>::size() const {
+  return header->numKeys;
+}
+
+/* Palauttaa puun asteen. */
+template<typename T> int BTreeSnapshot<T>::getDegree() const {
+  return header->degree;
+}
+
+/* Palauttaa juurisolmun sijainnin. */
+template<typename T> long long BTreeSnapshot<T>::getRoot() const {
+  return header->root;
+}
+
+/* Etsii avaimen vedoksesta. Palauttaa true, jos avain lytyi. */
+template<typename T> bool BTreeSnapshot<T>::search(const T &key) const {
+  long long node=header->root;
+  for (;;) {
+    const T *k=keys(node);
+    int n=numKeys(node);
+
+    // Solmun avaimet ovat perkkin, joten kytetn binrihakua.
+    int lo=0, hi=n;
+    while (lo<hi) {
+      int mid=(lo+hi)/2;
+      if (compare(k[mid], key)<0) lo=mid+1;
+      else hi=mid;
+    }
+    if (lo<n && compare(k[lo], key)==0) return true;
+    if (isLeaf(node)) return false;
+    node=getChild(node, lo);
+  }
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+template<typename T> void BTreeSnapshot<T>::range(const T &lo, const T &hi,
+                                                  vector<T> &result) const {
+  if (header->numKeys>0) rangeBranch(header->root, lo, hi, result);
+}
+
+/* Liitt vedoksen muistiin.
+   fileName = vedostiedosto
+   compare = metodi avainten vertailemiseksi */
+template<typename T> SkipListSnapshot<T>::SkipListSnapshot<T>(
+  const char *fileName, int (*const compare)(const T &, const T &)) :
+  compare(compare) {
+  base=mapSnapshot(fileName, &fd, &length);
+  header=reinterpret_cast<const SkipListSnapshotHeader *>(base);
+  if (length<(long long)sizeof(SkipListSnapshotHeader) ||
+      header->magic!=SKIPLIST_SNAPSHOT_MAGIC ||
+      header->keySize!=int(sizeof(T))) {
+    cerr << "Invalid skip list snapshot '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  long long offset=alignSnapshot(sizeof(SkipListSnapshotHeader));
+  headerForward=reinterpret_cast<const int *>(base+offset);
+  offset=alignSnapshot(offset+header->level*sizeof(int));
+  key=reinterpret_cast<const T *>(base+offset);
+  offset=alignSnapshot(offset+(long long)header->numKeys*sizeof(T));
+  first=reinterpret_cast<const int *>(base+offset);
+  offset+=(long long)(header->numKeys+1)*sizeof(int);
+  forward=reinterpret_cast<const int *>(base+offset);
+}
+
+/* Irrottaa vedoksen muistista. */
+template<typename T> SkipListSnapshot<T>::~SkipListSnapshot<T>() {
+  munmap(base, length);
+  close(fd);
+}
+
+/* Palauttaa solmun seuraajan tasolla index. Solmu -1 on otsakesolmu. */
+template<typename T> int SkipListSnapshot<T>::getForward(int node,
+                                                         int index) const {
+  if (node<0) return headerForward[index];
+  return forward[first[node]+index];
+}
+
+/* Palauttaa ensimmisen solmun, jonka avain on vhintn key. */
+template<typename T> int SkipListSnapshot<T>::lowerBound(const T &k) const {
+  int node=-1;
+  for (int i=header->level-1; i>=0; i--) {
+    int next=getForward(node, i);
+    while (next<header->numKeys && compare(key[next], k)<0) {
+      node=next;
+      next=getForward(node, i);
+    }
+  }
+  return getForward(node, 0);
+}
+
+/* Palauttaa vedoksen avainten lukumrn. */
+template<typename T> long long SkipListSnapshot<T>::size() const {
+  return header->numKeys;
+}
+
+/* Etsii avaimen vedoksesta. Palauttaa true, jos avain lytyi. */
+template<typename T> bool SkipListSnapshot<T>::search(const T &k) const {
+  int node=lowerBound(k);
+  return node<header->numKeys && compare(key[node], k)==0;
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+template<typename T> void SkipListSnapshot<T>::range(
+  const T &lo, const T &hi, vector<T> &result) const {
+  // Tason 0 avaimet ovat vedoksessa perkkin, joten alarajan lydytty
+  // vli luetaan suoraan taulukosta.
+  for (int i=lowerBound(lo); i<header->numKeys && compare(key[i], hi)<=0;
+       i++)
+    result.push_back(key[i]);
+}
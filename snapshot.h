@@ -0,0 +1,152 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa B-puun ja hyppylistan tiedostoon tallennettujen vedosten
+lukemisen. Vedos liitetn muistiin mmap():lla, ja haut tehdn suoraan
+liitetyst tiedostosta ilman rakenteen purkamista. Vedos ei sisll
+osoittimia, joten se voidaan liitt mihin tahansa osoitteeseen.
+
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+
+/* B-puun vedoksen tunniste. */
+#define BTREE_SNAPSHOT_MAGIC 0x42545331
+
+/* Hyppylistan vedoksen tunniste. */
+#define SKIPLIST_SNAPSHOT_MAGIC 0x534c5331
+
+/* B-puun vedoksen otsake. Otsaketta seuraavat solmut leveyssuuntaisessa
+   jrjestyksess. Solmu sislt avainten lukumrn, lehtitiedon ja avaimet
+   sek sissolmussa lasten sijainnit tiedoston alusta laskettuina. */
+struct BTreeSnapshotHeader {
+  int magic;
+  int keySize;
+  int degree;
+  int numNodes;
+  long long numKeys;
+  long long root;
+};
+
+/* Hyppylistan vedoksen otsake. Otsaketta seuraavat listan otsakesolmun
+   seuraajat (level kpl), avaimet tason 0 jrjestyksess, jokaisen solmun
+   ensimmisen seuraajan indeksi seuraajataulukossa (numKeys+1 kpl) sek
+   seuraajataulukko. Seuraajat ovat avainten indeksej; numKeys tarkoittaa
+   listan ptett. */
+struct SkipListSnapshotHeader {
+  int magic;
+  int keySize;
+  int maxLevel;
+  int level;
+  int numKeys;
+  int numForward;
+};
+
+/* Palauttaa B-puun vedoksen solmun koon tavuina.
+   keys = solmun avainten lukumr
+   leaf = true=solmu on lehti
+   keySize = avaimen koko tavuina */
+inline long long snapshotNodeSize(int keys, bool leaf, int keySize) {
+  long long size=2*sizeof(int)+((long long)keys*keySize+7)/8*8;
+  if (!leaf) size+=(keys+1)*sizeof(long long);
+  return size;
+}
+
+/* Muistiin liitetty, vain luettava B-puun vedos. */
+template<typename T> class BTreeSnapshot {
+  int fd;
+  char *base;
+  long long length;
+  int (*const compare)(const T &, const T &);
+  const BTreeSnapshotHeader *header;
+
+protected:
+  /* Ker alipuusta vlille [lo, hi] osuvat avaimet. */
+  void rangeBranch(long long node, const T &lo, const T &hi,
+                   std::vector<T> &result) const;
+
+public:
+  /* Liitt vedoksen muistiin.
+     fileName = vedostiedosto
+     compare = metodi avainten vertailemiseksi */
+  BTreeSnapshot<T>(const char *fileName,
+                   int (*const compare)(const T &, const T &));
+
+  /* Irrottaa vedoksen muistista. */
+  ~BTreeSnapshot<T>();
+
+  /* Palauttaa vedoksen avainten lukumrn. */
+  long long size() const;
+
+  /* Palauttaa puun asteen. */
+  int getDegree() const;
+
+  /* Palauttaa juurisolmun sijainnin. */
+  long long getRoot() const;
+
+  /* Palauttaa solmun avainten lukumrn. */
+  int numKeys(long long node) const;
+
+  /* Palauttaa true, jos solmu on lehti. */
+  bool isLeaf(long long node) const;
+
+  /* Palauttaa osoittimen solmun avaimiin. */
+  const T *keys(long long node) const;
+
+  /* Palauttaa solmun lapsen sijainnin. */
+  long long getChild(long long node, int index) const;
+
+  /* Etsii avaimen vedoksesta. Palauttaa true, jos avain lytyi. */
+  bool search(const T &key) const;
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const T &lo, const T &hi, std::vector<T> &result) const;
+};
+
+/* Muistiin liitetty, vain luettava hyppylistan vedos. */
+template<typename T> class SkipListSnapshot {
+  int fd;
+  char *base;
+  long long length;
+  int (*const compare)(const T &, const T &);
+  const SkipListSnapshotHeader *header;
+  const int *headerForward;
+  const T *key;
+  const int *first;
+  const int *forward;
+
+protected:
+  /* Palauttaa solmun seuraajan tasolla index. Solmu -1 on otsakesolmu. */
+  int getForward(int node, int index) const;
+
+  /* Palauttaa ensimmisen solmun, jonka avain on vhintn key. */
+  int lowerBound(const T &key) const;
+
+public:
+  /* Liitt vedoksen muistiin.
+     fileName = vedostiedosto
+     compare = metodi avainten vertailemiseksi */
+  SkipListSnapshot<T>(const char *fileName,
+                      int (*const compare)(const T &, const T &));
+
+  /* Irrottaa vedoksen muistista. */
+  ~SkipListSnapshot<T>();
+
+  /* Palauttaa vedoksen avainten lukumrn. */
+  long long size() const;
+
+  /* Etsii avaimen vedoksesta. Palauttaa true, jos avain lytyi. */
+  bool search(const T &key) const;
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const T &lo, const T &hi, std::vector<T> &result) const;
+};
+
+#endif
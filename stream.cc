@@ -0,0 +1,195 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa tiedoston tai sytevirran lukemisen riveittin kahden puskurin
+avulla. Taustasie lukee seuraavaa lohkoa toiseen puskuriin sill aikaa,
+kun edellisen lohkon rivej ksitelln, joten muistinkytt ei riipu
+sytteen koosta. Taustasie odottaa sytett poll()-kutsulla, jotta
+kesken jtetty luku putkesta tai vakiosytteest voidaan keskeytt.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "stream.h"
+
+using namespace std;
+
+/* Avaa sytteen ja kynnist taustasikeen.
+   fileName = luettava tiedosto tai "-", jos luetaan vakiosytett
+   chunkSize = yhden puskurin koko tavuina */
+LineStream::LineStream(const char *fileName, int chunkSize) :
+  chunkSize(chunkSize), eof(false), current(0), position(0) {
+  if (chunkSize<1) {
+    cerr << "LineStream(): Invalid chunk size." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (strcmp(fileName, "-")==0) {
+    fd=0;
+    ownFd=false;
+  }
+  else {
+    fd=open(fileName, O_RDONLY);
+    ownFd=true;
+  }
+  if (fd<0) {
+    cerr << "Could not open input file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Putken kautta taustasie hertetn odottamasta sytett.
+  if (pipe(wake)!=0) {
+    cerr << "Could not create pipe." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  for (int i=0; i<2; i++) {
+    buffer[i]=new char[chunkSize];
+    length[i]=0;
+    filled[i]=false;
+  }
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  pthread_create(&thread, NULL, readAhead, this);
+
+  // Odotetaan ensimmist lohkoa, jotta nextLine() voi aloittaa siit.
+  pthread_mutex_lock(&mutex);
+  while (!filled[0]) pthread_cond_wait(&cond, &mutex);
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Pysytt taustasikeen mys kesken luvun ja sulkee sytteen. */
+LineStream::~LineStream() {
+  // Kesken jtetyn sytteen tapauksessa vapautetaan molemmat puskurit ja
+  // merkitn syte loppuneeksi, jotta taustasie pttyy. Sytett
+  // odottava sie hertetn putken kautta.
+  pthread_mutex_lock(&mutex);
+  eof=true;
+  filled[0]=filled[1]=false;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+  char c=0;
+  while (write(wake[1], &c, 1)<0 && errno==EINTR);
+  pthread_join(thread, NULL);
+  close(wake[0]);
+  close(wake[1]);
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+  for (int i=0; i<2; i++) delete[] buffer[i];
+  if (ownFd) close(fd);
+}
+
+/* Taustasikeen aloitusfunktio. */
+void *LineStream::readAhead(void *stream) {
+  static_cast<LineStream *>(stream)->run();
+  return NULL;
+}
+
+/* Lukee lohkoja vuorotellen kumpaankin puskuriin, kunnes syte loppuu
+   tai luokka tuhotaan. */
+void LineStream::run() {
+  for (int i=0; ; i^=1) {
+    pthread_mutex_lock(&mutex);
+    while (filled[i] && !eof) pthread_cond_wait(&cond, &mutex);
+    bool stop=eof;
+    pthread_mutex_unlock(&mutex);
+    if (stop) return;
+
+    // Luetaan puskuriin niin kauan kuin sytett on heti saatavilla, jotta
+    // lyhyet lukukerrat (esim. putkesta) eivt pienenn lohkoja. Jos
+    // sytett ei ole, vajaa lohko annetaan ksiteltvksi odottamatta.
+    int n=0;
+    while (n<chunkSize) {
+      struct pollfd fds[2];
+      fds[0].fd=fd;
+      fds[1].fd=wake[0];
+      fds[0].events=fds[1].events=POLLIN;
+      int ready=poll(fds, 2, n>0 ? 0 : -1);
+      if (ready<0) {
+        if (errno==EINTR) continue;
+        cerr << "Could not poll input." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      if (fds[1].revents) return;
+      if (ready==0) break;
+
+      ssize_t r=read(fd, buffer[i]+n, chunkSize-n);
+      if (r<0) {
+        if (errno==EINTR || errno==EAGAIN) continue;
+        cerr << "Could not read input." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      if (r==0) break;
+      n+=r;
+    }
+
+    pthread_mutex_lock(&mutex);
+    length[i]=n;
+    filled[i]=true;
+    if (n==0) eof=true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    if (n==0) return;
+  }
+}
+
+/* Vapauttaa ksitellyn puskurin ja odottaa, ett seuraava on luettu.
+   Palauttaa false, jos syte on loppunut. */
+bool LineStream::nextChunk() {
+  pthread_mutex_lock(&mutex);
+  if (length[current]==0) {
+    pthread_mutex_unlock(&mutex);
+    return false;
+  }
+  filled[current]=false;
+  pthread_cond_broadcast(&cond);
+  current^=1;
+  while (!filled[current]) pthread_cond_wait(&cond, &mutex);
+  pthread_mutex_unlock(&mutex);
+  position=0;
+  return length[current]>0;
+}
+
+/* Lukee seuraavan rivin ilman rivinvaihtomerkki. Palauttaa false, jos
+   rivej ei ole en.
+   result = rivi palautetaan thn */
+bool LineStream::nextLine(string &result) {
+  // Lohkon rajalle osuva rivi kootaan kahdesta osasta.
+  line.clear();
+  for (;;) {
+    if (position>=length[current]) {
+      if (!nextChunk()) {
+        if (line.empty()) return false;
+        result=line;
+        return true;
+      }
+    }
+    char *begin=buffer[current]+position;
+    char *end=static_cast<char *>(memchr(begin, '\n',
+                                         length[current]-position));
+    if (end) {
+      line.append(begin, end-begin);
+      position+=end-begin+1;
+      result=line;
+      return true;
+    }
+    line.append(begin, length[current]-position);
+    position=length[current];
+  }
+}
@@ -0,0 +1,63 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa tiedoston tai sytevirran lukemisen riveittin kahden puskurin
+avulla. Taustasie lukee seuraavaa lohkoa toiseen puskuriin sill aikaa,
+kun edellisen lohkon rivej ksitelln, joten muistinkytt ei riipu
+sytteen koosta. Taustasie odottaa sytett poll()-kutsulla, jotta
+kesken jtetty luku putkesta tai vakiosytteest voidaan keskeytt.
+
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <string>
+#include <pthread.h>
+
+/* Sytevirtaa riveittin lukeva luokka. */
+class LineStream {
+  int fd;
+  bool ownFd;
+  int wake[2];
+  const int chunkSize;
+  char *buffer[2];
+  int length[2];
+  bool filled[2];
+  bool eof;
+  int current, position;
+  std::string line;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* Taustasikeen aloitusfunktio. */
+  static void *readAhead(void *stream);
+
+protected:
+  /* Lukee lohkoja vuorotellen kumpaankin puskuriin, kunnes syte loppuu
+     tai luokka tuhotaan. */
+  void run();
+
+  /* Vapauttaa ksitellyn puskurin ja odottaa, ett seuraava on luettu.
+     Palauttaa false, jos syte on loppunut. */
+  bool nextChunk();
+
+public:
+  /* Avaa sytteen ja kynnist taustasikeen.
+     fileName = luettava tiedosto tai "-", jos luetaan vakiosytett
+     chunkSize = yhden puskurin koko tavuina */
+  LineStream(const char *fileName, int chunkSize);
+
+  /* Pysytt taustasikeen mys kesken luvun ja sulkee sytteen. */
+  ~LineStream();
+
+  /* Lukee seuraavan rivin ilman rivinvaihtomerkki. Palauttaa false, jos
+     rivej ei ole en.
+     result = rivi palautetaan thn */
+  bool nextLine(std::string &result);
+};
+
+#endif
@@ -0,0 +1,806 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa vaihtelevan mittaisille merkkijonoavaimille B-puun lhteen [1]
+algoritmeilla. Solmun avainten yhteinen alku (prefix) tallennetaan
+solmuun vain kerran, ja avainten loppuosat ovat solmun omassa
+tavupuskurissa. Jokaisella paikalla (slot) on lisksi loppuosan nelj
+ensimmist tavua kokonaislukuna, joten useimmat vertailut ratkeavat
+lukematta avainta puskurista.
+
+Lhteet:
+[1] Introduction to Algorithms Thomas H. Cormen, Charles E. Leiserson, and
+    Ronald L. Rivest. MIT-Press, 2001; Chapter 18, B-Trees.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "stringbtree.h"
+
+using namespace std;
+
+/* Palauttaa merkkijonon nelj ensimmist tavua nollilla tydennettyn
+   kokonaislukuna, jonka jrjestys vastaa merkkijonojen jrjestyst. */
+unsigned int StringBTreeNode::headOf(const char *s, int length) {
+  unsigned int head=0;
+  for (int i=0; i<4; i++)
+    head=(head<<8)|(i<length ? (unsigned char)s[i] : 0);
+  return head;
+}
+
+/* degree = puun aste
+   leaf = true, jos solmu on lehti
+   stats = tilastot, joihin vertailut lasketaan */
+StringBTreeNode::StringBTreeNode(int degree, bool leaf,
+                                 StringBTreeStats *stats) :
+  degree(degree), keys(0), leaf(leaf), hasPrefix(false), heapUsed(0),
+  heapSize(STRING_HEAP_MIN), maxKeys(2*degree-1), maxChildren(2*degree),
+  stats(stats) {
+  slot=new StringSlot[maxKeys];
+  // Puskuri varataan heti, jotta tyhjtkin loppuosat osoittavat
+  // varattuun muistiin memcpy()- ja memcmp()-kutsuissa.
+  heap=new char[heapSize];
+  child=NULL;
+  if (!leaf) {
+    child=new StringBTreeNode *[maxChildren];
+    for (int i=0; i<maxChildren; i++) child[i]=NULL;
+  }
+}
+
+StringBTreeNode::~StringBTreeNode() {
+  delete[] child;
+  delete[] heap;
+  delete[] slot;
+}
+
+/* Palauttaa avainten lukumrn. */
+int StringBTreeNode::numKeys() const {
+  return keys;
+}
+
+/* Palauttaa lasten lukumrn. */
+int StringBTreeNode::numChildren() const {
+  return keys==0 ? 0 : keys+1;
+}
+
+/* Palautaan arvon true, jos solmu on lehti. */
+bool StringBTreeNode::isLeaf() const {
+  return leaf;
+}
+
+/* Palauttaa solmun avainten yhteisen alun. */
+const string &StringBTreeNode::getPrefix() const {
+  return prefix;
+}
+
+/* Palauttaa avaimen kohdasta index. */
+string StringBTreeNode::getKey(int index) const {
+  if (index<0 || index>=numKeys()) {
+    cerr << "getKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return string();
+  }
+  string key(prefix);
+  key.append(heap+slot[index].offset, slot[index].length);
+  return key;
+}
+
+/* Palauttaa lapsiosoittimen kohdasta index tai NULL, jos solmu on
+   lehti. */
+StringBTreeNode *StringBTreeNode::getChild(int index) const {
+  if (index<0 || index>=numChildren()) {
+    cerr << "getChild(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+  if (isLeaf()) return NULL;
+  if (!child[index]) {
+    cerr << "getChild(): Invalid child." << endl;
+    raise(SIGABRT);
+    return NULL;
+  }
+  return child[index];
+}
+
+/* Kopioi avainten loppuosat uuteen puskuriin ja vaihtaa yhteisen alun.
+   newPrefix = uusi yhteinen alku; oltava kaikkien avainten alku
+   extra = puskuriin lisksi tarvittava tila tavuina */
+void StringBTreeNode::rebuild(const string &newPrefix, int extra) {
+  // Lyhenevn alun pudotettu osa siirtyy loppuosien eteen; pitenevn alun
+  // lisosa poistetaan loppuosien alusta.
+  string dropped;
+  int skip=0;
+  if (newPrefix.size()<prefix.size())
+    dropped=prefix.substr(newPrefix.size());
+  else skip=newPrefix.size()-prefix.size();
+
+  int live=0;
+  for (int i=0; i<keys; i++)
+    live+=dropped.size()+slot[i].length-skip;
+  int newSize=2*(live+extra);
+  if (newSize<STRING_HEAP_MIN) newSize=STRING_HEAP_MIN;
+
+  char *newHeap=new char[newSize];
+  int used=0;
+  for (int i=0; i<keys; i++) {
+    int offset=used;
+    memcpy(newHeap+used, dropped.data(), dropped.size());
+    used+=dropped.size();
+    memcpy(newHeap+used, heap+slot[i].offset+skip, slot[i].length-skip);
+    used+=slot[i].length-skip;
+    slot[i].offset=offset;
+    slot[i].length=used-offset;
+    slot[i].head=headOf(newHeap+offset, slot[i].length);
+  }
+
+  delete[] heap;
+  heap=newHeap;
+  heapUsed=used;
+  heapSize=newSize;
+  prefix=newPrefix;
+}
+
+/* Asettaa avaimelle uuden arvon. */
+void StringBTreeNode::setKey(const string &newKey, int index) {
+  if (index<0 || index>=maxKeys) {
+    cerr << "setKey(): Invalid key index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (!hasPrefix) {
+    // Ensimminen avain on kokonaan yhteist alkua.
+    prefix=newKey;
+    hasPrefix=true;
+  }
+  else if (newKey.compare(0, prefix.size(), prefix)!=0) {
+    // Avain ei ala yhteisell alulla; lyhennetn alkua.
+    unsigned int n=0;
+    while (n<prefix.size() && n<newKey.size() && prefix[n]==newKey[n]) n++;
+    rebuild(prefix.substr(0, n), newKey.size()-n);
+  }
+
+  int length=newKey.size()-prefix.size();
+  if (heapUsed+length>heapSize) rebuild(prefix, length);
+  memcpy(heap+heapUsed, newKey.data()+prefix.size(), length);
+  slot[index].offset=heapUsed;
+  slot[index].length=length;
+  slot[index].head=headOf(heap+heapUsed, length);
+  heapUsed+=length;
+}
+
+/* Asettaa uuden lapsiosoittimen. */
+void StringBTreeNode::setChild(StringBTreeNode *newChild, int index) {
+  if (index<0 || index>=maxChildren || isLeaf()) {
+    cerr << "setChild(): Invalid child index." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  child[index]=newChild;
+}
+
+/* Asettaa avainten lukumrn. Uudet paikat alustetaan tyhjiksi. */
+void StringBTreeNode::setNumKeys(int newNumKeys) {
+  if (newNumKeys<0 || newNumKeys>maxKeys) {
+    cerr << "setNumKeys(): Invalid number of keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  for (int i=keys; i<newNumKeys; i++) {
+    slot[i].head=0;
+    slot[i].offset=0;
+    slot[i].length=0;
+  }
+  keys=newNumKeys;
+
+  // Tyhjn solmun yhteinen alku valitaan uudelleen seuraavasta avaimesta.
+  if (keys==0) {
+    hasPrefix=false;
+    prefix.clear();
+    heapUsed=0;
+  }
+}
+
+/* Palauttaa solmun ensimmisen (pienimmn) avaimen. */
+string StringBTreeNode::getFirstKey() const {
+  return getKey(0);
+}
+
+/* Palauttaa solmun viimeisen (suurimman) avaimen. */
+string StringBTreeNode::getLastKey() const {
+  return getKey(numKeys()-1);
+}
+
+/* Palauttaa solmun ensimmisen lapsen. */
+StringBTreeNode *StringBTreeNode::getFirstChild() const {
+  return getChild(0);
+}
+
+/* Palauttaa solmun viimeisen lapsen. */
+StringBTreeNode *StringBTreeNode::getLastChild() const {
+  return getChild(numChildren()-1);
+}
+
+/* Vertailee avaimen loppuosaa paikan avaimeen. Palauttaa <0, 0 tai >0.
+   suffix = avaimen loppuosa solmun yhteisen alun jlkeen
+   length = loppuosan pituus
+   head = loppuosan nelj ensimmist tavua
+   index = paikan indeksi */
+int StringBTreeNode::compareSlot(const char *suffix, int length,
+                                 unsigned int head, int index) const {
+  stats->compares++;
+  if (head!=slot[index].head) return head<slot[index].head ? -1 : 1;
+
+  // Etutavut ovat samat; verrataan loppuosia puskurista.
+  stats->fullCompares++;
+  int n=length<slot[index].length ? length : slot[index].length;
+  int result=memcmp(suffix, heap+slot[index].offset, n);
+  if (result!=0) return result;
+  return length-slot[index].length;
+}
+
+/* Palauttaa ensimmisen indeksin, jonka avain on vhintn key.
+   key = etsittv avain
+   found = asetetaan true, jos indeksin avain on key */
+int StringBTreeNode::find(const string &key, bool *found) const {
+  *found=false;
+  if (keys==0) return 0;
+
+  // Avain, joka ei ala yhteisell alulla, on joko kaikkia solmun avaimia
+  // pienempi tai suurempi.
+  int p=prefix.size();
+  int n=(int)key.size()<p ? key.size() : p;
+  int result=memcmp(key.data(), prefix.data(), n);
+  if (result<0) return 0;
+  if (result>0) return keys;
+  if ((int)key.size()<p) return 0;
+
+  const char *suffix=key.data()+p;
+  int length=key.size()-p;
+  unsigned int head=headOf(suffix, length);
+  int lo=0, hi=keys;
+  while (lo<hi) {
+    int mid=(lo+hi)/2;
+    int c=compareSlot(suffix, length, head, mid);
+    if (c>0) lo=mid+1;
+    else {
+      if (c==0) *found=true;
+      hi=mid;
+    }
+  }
+  return lo;
+}
+
+/* Pident yhteisen alun ensimmisen ja viimeisen avaimen yhteiseksi
+   aluksi ja vapauttaa puskurista kyttmttmn tilan. */
+void StringBTreeNode::compact() {
+  if (keys==0) {
+    setNumKeys(0);
+    return;
+  }
+
+  // Avaimet ovat jrjestyksess, joten ensimmisen ja viimeisen avaimen
+  // yhteinen alku on kaikkien avainten yhteinen alku.
+  string first=getFirstKey(), last=getLastKey();
+  unsigned int n=0;
+  while (n<first.size() && n<last.size() && first[n]==last[n]) n++;
+  rebuild(first.substr(0, n), 0);
+}
+
+/* Palauttaa solmuun tallennettujen avaintavujen mrn. */
+int StringBTreeNode::storedBytes() const {
+  int bytes=prefix.size();
+  for (int i=0; i<keys; i++) bytes+=slot[i].length;
+  return bytes;
+}
+
+/* Siirt avainpaikkoja ja lapsiosoittimia eteenpin ja pivitt
+   avainten lukumrn.
+   fromIndex = indeksi, josta alkaen avaimet siirretn
+   count = siirron pituus */
+void StringBTreeNode::shift(int fromIndex, int count) {
+  if (keys+count>maxKeys) {
+    cerr << "shift(): Too many keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  memmove(slot+fromIndex+count, slot+fromIndex,
+          (keys-fromIndex)*sizeof(StringSlot));
+  if (!isLeaf())
+    memmove(child+fromIndex+count, child+fromIndex,
+            (keys-fromIndex+1)*sizeof(StringBTreeNode *));
+  keys+=count;
+}
+
+/* Lis avaimen sek sen vasemman- ja oikeanpuoleiset lapsiosoittimet
+   solmuun.
+   newKey = uusi avain
+   leftChild = vasemmanpuoleinen lapsiosoitin; jos NULL ei muuta nykyist
+   osoitinta
+   rightChild = oikeanpuoleinen lapsiosoitin: jos NULL ei muuta nykyist
+   osoitinta
+   index = paikka, johon avain ja lapsiosoittimet listn */
+void StringBTreeNode::insert(const string &newKey,
+                             StringBTreeNode *leftChild,
+                             StringBTreeNode *rightChild, int index) {
+  if (index<numKeys()) shift(index, 1);
+  else setNumKeys(numKeys()+1);
+
+  setKey(newKey, index);
+  if (leftChild) setChild(leftChild, index);
+  if (rightChild) setChild(rightChild, index+1);
+}
+
+/* Poistaa ja palauttaa avaimen sek poistaa mahdollisen lapsiosoittimen.
+   index = avaimen indeksi
+   leftChild = jos true, poistaa vasemmanpuolisen lapsiosoittimen
+   rightChild = jos true, poistaa oikeanpuoleisen lapsiosoittimen */
+string StringBTreeNode::remove(int index, bool leftChild, bool rightChild) {
+  if (leftChild==true && rightChild==true) {
+    cerr << "Can't remove both children." << endl;
+    raise(SIGABRT);
+    return string();
+  }
+
+  string key=getKey(index);
+  memmove(slot+index, slot+index+1, (keys-index-1)*sizeof(StringSlot));
+  if (!isLeaf()) {
+    int from=leftChild ? index : index+1;
+    if (leftChild || rightChild)
+      memmove(child+from, child+from+1,
+              (keys-from)*sizeof(StringBTreeNode *));
+  }
+  setNumKeys(numKeys()-1);
+  return key;
+}
+
+/* Kopioi avaimet ja lapsiosoittimet solmusta toiseen.
+   fromIndex = lhdeindeksi, josta kopioidaan
+   count = kopioitavien indeksien mr
+   toNode = kohdesolmu
+   toIndex = kohdesolmun indeksi, johon kopioidaan */
+void StringBTreeNode::copy(int fromIndex, int count, StringBTreeNode *toNode,
+                           int toIndex) {
+  if (toIndex+count>toNode->numKeys()) toNode->setNumKeys(toIndex+count);
+  for (int i=0; i<count; i++)
+    toNode->setKey(getKey(fromIndex+i), toIndex+i);
+  if (!isLeaf())
+    for (int i=0; i<count+1; i++)
+      toNode->setChild(getChild(fromIndex+i), toIndex+i);
+}
+
+/* Tarkistaa, ett avaimet alkavat yhteisell alulla ja ett paikkojen
+   etutavut vastaavat avaimia. */
+bool StringBTreeNode::validateSlots() const {
+  for (int i=0; i<keys; i++) {
+    if (slot[i].offset<0 || slot[i].length<0 ||
+        slot[i].offset+slot[i].length>heapUsed)
+      return false;
+    if (slot[i].head!=headOf(heap+slot[i].offset, slot[i].length))
+      return false;
+  }
+  return true;
+}
+
+/* Luo puun.
+   degree = puun aste; oltava >= 2
+   debug = 1=lausekattavuustulostus */
+StringBTree::StringBTree(int degree, int debug=0) :
+  degree(degree), debug(debug) {
+  if (degree<2) {
+    cerr << "Degree must be >= 2." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  resetStats();
+  root=new StringBTreeNode(degree, true, &stats);
+}
+
+StringBTree::~StringBTree() {
+  destroyBranch(root);
+}
+
+/* Tuhoaa alipuun.
+   branch = tuhottava alipuu */
+void StringBTree::destroyBranch(StringBTreeNode *branch) {
+  if (branch) {
+    if (!branch->isLeaf())
+      for (int i=0; i<branch->numChildren(); i++)
+        destroyBranch(branch->getChild(i));
+    delete branch;
+  }
+}
+
+/* Tulostaa avaimet sisjrjestyksess.
+   node = alipuu, jonka avaimet tulostetaan
+   depth = rekursiivisesti laskettava alipuun korkeus */
+void StringBTree::printInorder(StringBTreeNode *node, int depth) {
+  if (node) {
+    if (!node->isLeaf()) printInorder(node->getFirstChild(), depth+1);
+    for (int i=1; i<node->numChildren(); i++) {
+      cout << "depth=" << depth << ", prefix=" << node->getPrefix()
+           << ", key=" << node->getKey(i-1) << endl;
+      if (!node->isLeaf())
+        printInorder(node->getChild(i), depth+1);
+    }
+  }
+}
+
+/* Tarkistaa, ett alipuu tytt B-puun mritelmn.
+   node = tarkistettava alipuu
+   depth = rekursiivisesti laskettava puun korkeus */
+void StringBTree::validateBranch(StringBTreeNode *node, int depth) {
+  if (node==NULL) {
+    cerr << "VALIDATE: Invalid branch." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Kaikkien lehtien on oltava samalla syvyydell.
+  if (node->isLeaf()) {
+    if (numDepth<0) numDepth=depth;
+    else if (depth!=numDepth) {
+      cerr << "VALIDATE: Leaves not on the same level." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+  numNodes++;
+  numKeys+=node->numKeys();
+
+  // Tarkistetetaan, ett solmussa on tarpeeksi avaimia.
+  if (depth>0 && node->numKeys()<degree-1) {
+    cerr << "VALIDATE: Not enough keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (!node->validateSlots()) {
+    cerr << "VALIDATE: Invalid slots." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Tarkistetaan, ett avaimet ovat suuruusjrjestyksess ja alkavat
+  // solmun yhteisell alulla.
+  const string &prefix=node->getPrefix();
+  for (int i=0; i<node->numKeys(); i++) {
+    if (node->getKey(i).compare(0, prefix.size(), prefix)!=0) {
+      cerr << "VALIDATE: Key does not start with prefix." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    if (i>0 && node->getKey(i-1)>=node->getKey(i)) {
+      cerr << "VALIDATE: Keys not in order." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+
+  if (!node->isLeaf()) {
+    // Tarkistetaan, ett lasten avaimet ovat suuruusjrjestyksess solmun
+    // avaimiin verrattuna.
+    for (int i=0; i<node->numKeys(); i++) {
+      if (node->getKey(i)<=node->getChild(i)->getLastKey()) {
+        cerr << "VALIDATE: Left child key not in order." << endl;
+        raise(SIGABRT);
+        return;
+      }
+      if (node->getKey(i)>=node->getChild(i+1)->getFirstKey()) {
+        cerr << "VALIDATE: Right child key not in order." << endl;
+        raise(SIGABRT);
+        return;
+      }
+    }
+
+    for (int i=0; i<node->numChildren(); i++)
+      validateBranch(node->getChild(i), depth+1);
+  }
+}
+
+/* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+   jrjestyksess.
+   node = alipuu, josta avaimia etsitn */
+void StringBTree::rangeBranch(StringBTreeNode *node, const string &lo,
+                              const string &hi, vector<string> &result) {
+  bool found;
+  int i=node->find(lo, &found);
+  if (!node->isLeaf()) rangeBranch(node->getChild(i), lo, hi, result);
+  for (; i<node->numKeys(); i++) {
+    string key=node->getKey(i);
+    if (hi<key) return;
+    result.push_back(key);
+    if (!node->isLeaf()) rangeBranch(node->getChild(i+1), lo, hi, result);
+  }
+}
+
+/* Laskee alipuun solmuihin tallennettujen avaintavujen mrn. */
+long long StringBTree::storedBranch(StringBTreeNode *node) {
+  long long bytes=node->storedBytes();
+  if (!node->isLeaf())
+    for (int i=0; i<node->numChildren(); i++)
+      bytes+=storedBranch(node->getChild(i));
+  return bytes;
+}
+
+/* Jakaa solmun kahteen solmuun, jotta uusi avain voidaan list. [1]
+   parent = issolmu, jonka lapsisolmu jaetaan
+   medianKey = keskimmisen avaimen paikka issolmussa
+   left = solmu, joka jaetaan ja josta tulee vasemmanpuoleinen sisar */
+void StringBTree::splitChild(StringBTreeNode *parent, int medianKey,
+                             StringBTreeNode *left) {
+  StringBTreeNode *right=new StringBTreeNode(degree, left->isLeaf(),
+                                             &stats);
+
+  // Jaetaan vasemmanpuoleinen solmu kahteen yht suureen osaan kopioimalla
+  // oikea puoli sisarsolmuun.
+  left->copy(degree, degree-1, right, 0);
+  left->setNumKeys(degree);
+
+  // Siirretn keskimminen alkio issolmuun ja asetetaan oikeanpuoleinen
+  // solmu issolmun lapseksi.
+  parent->insert(left->getKey(degree-1), NULL, right, medianKey);
+  left->remove(degree-1, false, false);
+
+  // Puolikkaiden yhteinen alku on yleens pidempi kuin jaetun solmun.
+  if (debug==1) cout << "splitChild(): 1" << endl;
+  left->compact();
+  right->compact();
+}
+
+/* Lis avaimen vaillinaiseen solmuun. [1]
+   node = alipuu, johon avain tulee
+   key = avain */
+void StringBTree::insertNonfull(StringBTreeNode *node, const string &key) {
+  bool found;
+  int i=node->find(key, &found);
+  if (node->isLeaf()) {
+    if (debug==1) cout << "insertNonfull(): 1" << endl;
+    node->insert(key, NULL, NULL, i);
+  }
+  else {
+    if (debug==1) cout << "insertNonfull(): 2" << endl;
+    if (node->getChild(i)->numKeys()==2*degree-1) {
+      if (debug==1) cout << "insertNonfull(): 3" << endl;
+      // Matkan varrella oleva solmu on tynn; puolitetaan se.
+      splitChild(node, i, node->getChild(i));
+      if (key>node->getKey(i)) i++;
+    }
+    insertNonfull(node->getChild(i), key);
+  }
+}
+
+/* Poistaa ja palauttaa edellisen avaimen.
+   branch = alipuu, josta avain poistetaan */
+string StringBTree::removePredecessorKey(StringBTreeNode *branch) {
+  while (!branch->isLeaf()) branch=branch->getLastChild();
+  string key=branch->getLastKey();
+  removeBranch(key, root);
+  return key;
+}
+
+/* Poistaa ja palauttaa seuraavan avaimen.
+   branch = alipuu, josta avain poistetaan */
+string StringBTree::removeSuccessorKey(StringBTreeNode *branch) {
+  while (!branch->isLeaf()) branch=branch->getFirstChild();
+  string key=branch->getFirstKey();
+  removeBranch(key, root);
+  return key;
+}
+
+/* Lainaa oikeanpuoleiselta sisarsolmulta avaimen.
+   parent = issolmu
+   index = lapsisolmun indeksi */
+void StringBTree::rotateRight(StringBTreeNode *parent, int index) {
+  StringBTreeNode *child=parent->getChild(index),
+    *sibling=parent->getChild(index+1);
+  child->insert(parent->getKey(index), NULL, sibling->getFirstChild(),
+                child->numKeys());
+  parent->setKey(sibling->remove(0, true, false), index);
+}
+
+/* Lainaa vasemmanpuoleiselta sisarsolmulta avaimen.
+   parent = issolmu
+   index = lapsisolmun indeksi */
+void StringBTree::rotateLeft(StringBTreeNode *parent, int index) {
+  StringBTreeNode *child=parent->getChild(index),
+    *sibling=parent->getChild(index-1);
+  child->insert(parent->getKey(index-1), sibling->getLastChild(), NULL, 0);
+  parent->setKey(sibling->remove(sibling->numKeys()-1, false, true),
+                 index-1);
+}
+
+/* Yhdist kaksi solmua. Palauttaa issolmun tai yhdistetyn solmun, jos
+   issolmu tuhotaan.
+   parent = issolmu, jonka kaksi lapsisolmua yhdistetn
+   mergeIndex = lapsisolmun, johon yhdistetn sisarsolmu, indeksi */
+StringBTreeNode *StringBTree::mergeChildren(StringBTreeNode *parent,
+                                            int mergeIndex) {
+  StringBTreeNode *merged=parent->getChild(mergeIndex);
+  StringBTreeNode *removed;
+  int medianIndex=merged->numKeys();
+
+  if (mergeIndex+1<parent->numKeys()+1) {
+    if (debug==1) cout << "mergeChildren(): 1" << endl;
+    removed=parent->getChild(mergeIndex+1);
+    merged->insert(parent->getKey(mergeIndex), NULL, NULL, medianIndex);
+    parent->remove(mergeIndex, false, true);
+    removed->copy(0, removed->numKeys(), merged, merged->numKeys());
+  }
+  else {
+    if (debug==1) cout << "mergeChildren(): 2" << endl;
+    removed=parent->getChild(mergeIndex-1);
+    merged->shift(0, removed->numKeys());
+    merged->insert(parent->getKey(mergeIndex-1), NULL, NULL,
+                   removed->numKeys());
+    parent->remove(mergeIndex-1, true, false);
+    removed->copy(0, removed->numKeys(), merged, 0);
+  }
+  delete removed;
+
+  // Issolmusta lainattu avain tyhjensi juurisolmun; yhdistetyst
+  // solmusta tulee uusi juuri.
+  if (parent->numKeys()==0) {
+    if (debug==1) cout << "mergeChildren(): 3" << endl;
+    root=merged;
+    delete parent;
+    return merged;
+  }
+  return parent;
+}
+
+/* Poistaa avaimen alipuusta.
+   key = poistettava avain
+   branch = alipuu, josta avain poistetaan */
+void StringBTree::removeBranch(const string &key, StringBTreeNode *branch) {
+  bool found;
+  int i=branch->find(key, &found);
+
+  if (found) {
+    if (branch->isLeaf()) {
+      // 1. [1]
+      if (debug==1) cout << "removeBranch(): 1" << endl;
+      branch->remove(i, false, false);
+    }
+    else if (branch->getChild(i)->numKeys()>=degree) {
+      // 2a. [1]
+      if (debug==1) cout << "removeBranch(): 2" << endl;
+      branch->setKey(removePredecessorKey(branch->getChild(i)), i);
+    }
+    else if (branch->getChild(i+1)->numKeys()>=degree) {
+      // 2b. [1]
+      if (debug==1) cout << "removeBranch(): 3" << endl;
+      branch->setKey(removeSuccessorKey(branch->getChild(i+1)), i);
+    }
+    else {
+      // 2c. [1]
+      if (debug==1) cout << "removeBranch(): 4" << endl;
+      branch=mergeChildren(branch, i);
+      removeBranch(key, branch);
+    }
+    return;
+  }
+
+  if (!branch->isLeaf()) {
+    StringBTreeNode *child=branch->getChild(i);
+    if (child->numKeys()>=degree) {
+      // 3. [1]
+      if (debug==1) cout << "removeBranch(): 5" << endl;
+      removeBranch(key, child);
+    }
+    else {
+      if (i+1<branch->numKeys()+1 &&
+          branch->getChild(i+1)->numKeys()>=degree) {
+        // 3a. oikea puoli [1]
+        if (debug==1) cout << "removeBranch(): 6" << endl;
+        rotateRight(branch, i);
+      }
+      else if (i-1>=0 && branch->getChild(i-1)->numKeys()>=degree) {
+        // 3a. vasen puoli [1]
+        if (debug==1) cout << "removeBranch(): 7" << endl;
+        rotateLeft(branch, i);
+      }
+      else {
+        // 3b. [1]
+        if (debug==1) cout << "removeBranch(): 8" << endl;
+        branch=mergeChildren(branch, i);
+      }
+      removeBranch(key, branch);
+    }
+  }
+}
+
+/* Tulostaa puun avaimet nousevassa jrjestykses. */
+void StringBTree::print() {
+  printInorder(root, 0);
+}
+
+/* Palauttaa true, jos avain on puussa. */
+bool StringBTree::search(const string &key) {
+  StringBTreeNode *node=root;
+  for (;;) {
+    bool found;
+    int i=node->find(key, &found);
+    if (found) return true;
+    if (node->isLeaf()) return false;
+    node=node->getChild(i);
+  }
+}
+
+/* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+   vlill [lo, hi]. */
+void StringBTree::range(const string &lo, const string &hi,
+                        vector<string> &result) {
+  if (root->numKeys()>0) rangeBranch(root, lo, hi, result);
+}
+
+/* Lis avaimen puuhun. */
+void StringBTree::insert(const string &key) {
+  if (search(key)) {
+    cerr << "Insertion of multiple same keys unsupported." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  if (root->numKeys()==2*degree-1) {
+    if (debug==1) cout << "insert(): 1" << endl;
+    // Juuri on tynn; luodaan uusi juuri.
+    StringBTreeNode *left=root;
+    root=new StringBTreeNode(degree, false, &stats);
+    root->setChild(left, 0);
+    splitChild(root, 0, left);
+  }
+  insertNonfull(root, key);
+}
+
+/* Poistaa avaimen puusta. */
+void StringBTree::remove(const string &key) {
+  removeBranch(key, root);
+}
+
+/* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt tsmlleen
+   annetut avaimet. */
+void StringBTree::validate(const vector<string> &keys) {
+  numDepth=-1;
+  numNodes=numKeys=0;
+  validateBranch(root, 0);
+
+  if ((unsigned int)numKeys!=keys.size()) {
+    cerr << "VALIDATE: Wrong number of keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  for (unsigned int i=0; i<keys.size(); i++)
+    if (!search(keys[i])) {
+      cerr << "VALIDATE: Missing key." << endl;
+      raise(SIGABRT);
+      return;
+    }
+}
+
+/* Palauttaa avainvertailujen mrn. */
+long long StringBTree::getCompares() const {
+  return stats.compares;
+}
+
+/* Palauttaa vertailujen mrn, joissa etutavut eivt riittneet ja
+   avainta luettiin puskurista. */
+long long StringBTree::getFullCompares() const {
+  return stats.fullCompares;
+}
+
+/* Nollaa vertailutilastot. */
+void StringBTree::resetStats() {
+  stats.compares=stats.fullCompares=0;
+}
+
+/* Palauttaa solmuihin tallennettujen avaintavujen mrn. */
+long long StringBTree::getStoredBytes() {
+  return storedBranch(root);
+}
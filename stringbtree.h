@@ -0,0 +1,285 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa vaihtelevan mittaisille merkkijonoavaimille B-puun lhteen [1]
+algoritmeilla. Solmun avainten yhteinen alku (prefix) tallennetaan
+solmuun vain kerran, ja avainten loppuosat ovat solmun omassa
+tavupuskurissa. Jokaisella paikalla (slot) on lisksi loppuosan nelj
+ensimmist tavua kokonaislukuna, joten useimmat vertailut ratkeavat
+lukematta avainta puskurista.
+
+Lhteet:
+[1] Introduction to Algorithms Thomas H. Cormen, Charles E. Leiserson, and
+    Ronald L. Rivest. MIT-Press, 2001; Chapter 18, B-Trees.
+
+*/
+
+#ifndef STRINGBTREE_H
+#define STRINGBTREE_H
+
+#include <string>
+#include <vector>
+
+/* Solmun tavupuskurin vhimmiskoko tavuina. */
+#define STRING_HEAP_MIN 64
+
+/* Avainvertailujen tilastot. */
+struct StringBTreeStats {
+  long long compares;
+  long long fullCompares;
+};
+
+/* Solmun avainpaikka: loppuosan nelj ensimmist tavua, sijainti
+   tavupuskurissa ja pituus. */
+struct StringSlot {
+  unsigned int head;
+  int offset;
+  int length;
+};
+
+/* Merkkijono-B-puun solmun toteuttava luokka. Avainten lisys ja poisto
+   siirtvt vain avainpaikkoja; loppuosat kopioidaan uuteen puskuriin
+   vasta, kun puskuri tyttyy tai yhteinen alku muuttuu. */
+class StringBTreeNode {
+  const int degree;
+  int keys;
+  bool leaf;
+  bool hasPrefix;
+  std::string prefix;
+  StringSlot *slot;
+  char *heap;
+  int heapUsed, heapSize;
+  StringBTreeNode **child;
+  const int maxKeys, maxChildren;
+  StringBTreeStats *stats;
+
+  /* Vertailee avaimen loppuosaa paikan avaimeen. Palauttaa <0, 0 tai >0.
+     suffix = avaimen loppuosa solmun yhteisen alun jlkeen
+     length = loppuosan pituus
+     head = loppuosan nelj ensimmist tavua
+     index = paikan indeksi */
+  int compareSlot(const char *suffix, int length, unsigned int head,
+                  int index) const;
+
+  /* Kopioi avainten loppuosat uuteen puskuriin ja vaihtaa yhteisen alun.
+     newPrefix = uusi yhteinen alku; oltava kaikkien avainten alku
+     extra = puskuriin lisksi tarvittava tila tavuina */
+  void rebuild(const std::string &newPrefix, int extra);
+
+public:
+  /* Palauttaa merkkijonon nelj ensimmist tavua nollilla tydennettyn
+     kokonaislukuna, jonka jrjestys vastaa merkkijonojen jrjestyst. */
+  static unsigned int headOf(const char *s, int length);
+
+  /* degree = puun aste
+     leaf = true, jos solmu on lehti
+     stats = tilastot, joihin vertailut lasketaan */
+  StringBTreeNode(int degree, bool leaf, StringBTreeStats *stats);
+  ~StringBTreeNode();
+
+  /* Palauttaa avainten lukumrn. */
+  int numKeys() const;
+
+  /* Palauttaa lasten lukumrn. */
+  int numChildren() const;
+
+  /* Palautaan arvon true, jos solmu on lehti. */
+  bool isLeaf() const;
+
+  /* Palauttaa solmun avainten yhteisen alun. */
+  const std::string &getPrefix() const;
+
+  /* Palauttaa avaimen kohdasta index. */
+  std::string getKey(int index) const;
+
+  /* Palauttaa lapsiosoittimen kohdasta index tai NULL, jos solmu on
+     lehti. */
+  StringBTreeNode *getChild(int index) const;
+
+  /* Asettaa avaimelle uuden arvon. */
+  void setKey(const std::string &newKey, int index);
+
+  /* Asettaa uuden lapsiosoittimen. */
+  void setChild(StringBTreeNode *newChild, int index);
+
+  /* Asettaa avainten lukumrn. Uudet paikat alustetaan tyhjiksi. */
+  void setNumKeys(int newNumKeys);
+
+  /* Palauttaa solmun ensimmisen (pienimmn) avaimen. */
+  std::string getFirstKey() const;
+
+  /* Palauttaa solmun viimeisen (suurimman) avaimen. */
+  std::string getLastKey() const;
+
+  /* Palauttaa solmun ensimmisen lapsen. */
+  StringBTreeNode *getFirstChild() const;
+
+  /* Palauttaa solmun viimeisen lapsen. */
+  StringBTreeNode *getLastChild() const;
+
+  /* Palauttaa ensimmisen indeksin, jonka avain on vhintn key.
+     key = etsittv avain
+     found = asetetaan true, jos indeksin avain on key */
+  int find(const std::string &key, bool *found) const;
+
+  /* Pident yhteisen alun ensimmisen ja viimeisen avaimen yhteiseksi
+     aluksi ja vapauttaa puskurista kyttmttmn tilan. */
+  void compact();
+
+  /* Palauttaa solmuun tallennettujen avaintavujen mrn. */
+  int storedBytes() const;
+
+  /* Siirt avainpaikkoja ja lapsiosoittimia eteenpin ja pivitt
+     avainten lukumrn.
+     fromIndex = indeksi, josta alkaen avaimet siirretn
+     count = siirron pituus */
+  void shift(int fromIndex, int count);
+
+  /* Lis avaimen sek sen vasemman- ja oikeanpuoleiset lapsiosoittimet
+     solmuun.
+     newKey = uusi avain
+     leftChild = vasemmanpuoleinen lapsiosoitin; jos NULL ei muuta nykyist
+                 osoitinta
+     rightChild = oikeanpuoleinen lapsiosoitin: jos NULL ei muuta nykyist
+                  osoitinta
+     index = paikka, johon avain ja lapsiosoittimet listn */
+  void insert(const std::string &newKey, StringBTreeNode *leftChild,
+              StringBTreeNode *rightChild, int index);
+
+  /* Poistaa ja palauttaa avaimen sek poistaa mahdollisen lapsiosoittimen.
+     index = avaimen indeksi
+     leftChild = jos true, poistaa vasemmanpuolisen lapsiosoittimen
+     rightChild = jos true, poistaa oikeanpuoleisen lapsiosoittimen */
+  std::string remove(int index, bool leftChild, bool rightChild);
+
+  /* Kopioi avaimet ja lapsiosoittimet solmusta toiseen.
+     fromIndex = lhdeindeksi, josta kopioidaan
+     count = kopioitavien indeksien mr
+     toNode = kohdesolmu
+     toIndex = kohdesolmun indeksi, johon kopioidaan */
+  void copy(int fromIndex, int count, StringBTreeNode *toNode, int toIndex);
+
+  /* Tarkistaa, ett avaimet alkavat yhteisell alulla ja ett paikkojen
+     etutavut vastaavat avaimia. */
+  bool validateSlots() const;
+};
+
+/* Merkkijono-B-puun toteuttava luokka. */
+class StringBTree {
+  const int degree;
+  StringBTreeNode *root;
+  StringBTreeStats stats;
+  int numDepth, numNodes, numKeys;
+  const int debug;
+
+protected:
+  /* Tuhoaa alipuun.
+     branch = tuhottava alipuu */
+  void destroyBranch(StringBTreeNode *branch);
+
+  /* Tulostaa avaimet sisjrjestyksess.
+     node = alipuu, jonka avaimet tulostetaan
+     depth = rekursiivisesti laskettava alipuun korkeus */
+  void printInorder(StringBTreeNode *node, int depth);
+
+  /* Tarkistaa, ett alipuu tytt B-puun mritelmn.
+     node = tarkistettava alipuu
+     depth = rekursiivisesti laskettava puun korkeus */
+  void validateBranch(StringBTreeNode *node, int depth);
+
+  /* Ker alipuusta vlille [lo, hi] osuvat avaimet nousevassa
+     jrjestyksess.
+     node = alipuu, josta avaimia etsitn */
+  void rangeBranch(StringBTreeNode *node, const std::string &lo,
+                   const std::string &hi, std::vector<std::string> &result);
+
+  /* Laskee alipuun solmuihin tallennettujen avaintavujen mrn. */
+  long long storedBranch(StringBTreeNode *node);
+
+  /* Jakaa solmun kahteen solmuun, jotta uusi avain voidaan list. [1]
+     parent = issolmu, jonka lapsisolmu jaetaan
+     medianKey = keskimmisen avaimen paikka issolmussa
+     left = solmu, joka jaetaan ja josta tulee vasemmanpuoleinen sisar */
+  void splitChild(StringBTreeNode *parent, int medianKey,
+                  StringBTreeNode *left);
+
+  /* Lis avaimen vaillinaiseen solmuun. [1]
+     node = alipuu, johon avain tulee
+     key = avain */
+  void insertNonfull(StringBTreeNode *node, const std::string &key);
+
+  /* Poistaa ja palauttaa edellisen avaimen.
+     branch = alipuu, josta avain poistetaan */
+  std::string removePredecessorKey(StringBTreeNode *branch);
+
+  /* Poistaa ja palauttaa seuraavan avaimen.
+     branch = alipuu, josta avain poistetaan */
+  std::string removeSuccessorKey(StringBTreeNode *branch);
+
+  /* Lainaa oikeanpuoleiselta sisarsolmulta avaimen.
+     parent = issolmu
+     index = lapsisolmun indeksi */
+  void rotateRight(StringBTreeNode *parent, int index);
+
+  /* Lainaa vasemmanpuoleiselta sisarsolmulta avaimen.
+     parent = issolmu
+     index = lapsisolmun indeksi */
+  void rotateLeft(StringBTreeNode *parent, int index);
+
+  /* Yhdist kaksi solmua. Palauttaa issolmun tai yhdistetyn solmun, jos
+     issolmu tuhotaan.
+     parent = issolmu, jonka kaksi lapsisolmua yhdistetn
+     mergeIndex = lapsisolmun, johon yhdistetn sisarsolmu, indeksi */
+  StringBTreeNode *mergeChildren(StringBTreeNode *parent, int mergeIndex);
+
+  /* Poistaa avaimen alipuusta.
+     key = poistettava avain
+     branch = alipuu, josta avain poistetaan */
+  void removeBranch(const std::string &key, StringBTreeNode *branch);
+
+public:
+  /* Luo puun.
+     degree = puun aste; oltava >= 2
+     debug = 1=lausekattavuustulostus */
+  StringBTree(int degree, int debug);
+
+  ~StringBTree();
+
+  /* Tulostaa puun avaimet nousevassa jrjestykses. */
+  void print();
+
+  /* Palauttaa true, jos avain on puussa. */
+  bool search(const std::string &key);
+
+  /* Lis tulosvektoriin nousevassa jrjestyksess avaimet, jotka ovat
+     vlill [lo, hi]. */
+  void range(const std::string &lo, const std::string &hi,
+             std::vector<std::string> &result);
+
+  /* Lis avaimen puuhun. */
+  void insert(const std::string &key);
+
+  /* Poistaa avaimen puusta. */
+  void remove(const std::string &key);
+
+  /* Tarkistaa, ett puu tytt B-puun mritelmn ja sislt tsmlleen
+     annetut avaimet. */
+  void validate(const std::vector<std::string> &keys);
+
+  /* Palauttaa avainvertailujen mrn. */
+  long long getCompares() const;
+
+  /* Palauttaa vertailujen mrn, joissa etutavut eivt riittneet ja
+     avainta luettiin puskurista. */
+  long long getFullCompares() const;
+
+  /* Nollaa vertailutilastot. */
+  void resetStats();
+
+  /* Palauttaa solmuihin tallennettujen avaintavujen mrn. */
+  long long getStoredBytes();
+};
+
+#endif
@@ -13,13 +13,37 @@ Ohjaaja: Janne Rinta-M
 #include <sstream>
 #include <algorithm>
 #include <csignal>
+#include <cstdio>
+#include <cmath>
+#include <iterator>
 #include "btree.h"
 #include "skiplist.h"
+#include "pagedbtree.h"
+#include "compressedbtree.h"
+#include "bufferedbtree.h"
+#include "stringbtree.h"
+#include "snapshot.h"
+#include "wal.h"
+#include "stream.h"
+#include "orderedset.h"
+#include "setalgebra.h"
+#include "bench.h"
+#include "memory.h"
+#include "workload.h"
+#include "tuner.h"
 #include "rng.h"
 
 // http://www.parashift.com/c++-faq-lite/containers-and-templates.html#faq-34.12
+#include "setalgebra.cc"
 #include "btree.cc"
 #include "skiplist.cc"
+#include "pagedbtree.cc"
+#include "compressedbtree.cc"
+#include "bufferedbtree.cc"
+#include "snapshot.cc"
+#include "frozenbtree.cc"
+#include "orderedset.cc"
+#include "validate.cc"
 
 using namespace std;
 
@@ -48,12 +72,49 @@ template<typename T> void readKeys(const char *fileName, vector<T> &keys) {
   ifs.close();
 }
 
+/* Yhdist tarkistusten vlill listyt avaimet jrjestettyyn odotettujen
+   avainten vektoriin. Vain puskuri jrjestetn, joten yhdistminen on
+   lineaarinen odotettujen avainten mrn suhteen. */
+template<typename T> void mergePendingKeys(vector<T> &expected,
+                                           vector<T> &pending,
+                                           int (*compare)(const T &,
+                                                          const T &)) {
+  KeyLess<T> less(compare);
+  sort(pending.begin(), pending.end(), less);
+  size_t middle=expected.size();
+  expected.insert(expected.end(), pending.begin(), pending.end());
+  inplace_merge(expected.begin(), expected.begin()+middle, expected.end(),
+                less);
+  pending.clear();
+}
+
+/* Poistaa tarkistusten vlill poistetut avaimet jrjestetyst odotettujen
+   avainten vektorista. Kustakin poistetusta avaimesta poistetaan yksi
+   kopio. */
+template<typename T> void erasePendingKeys(vector<T> &expected,
+                                           vector<T> &pending,
+                                           int (*compare)(const T &,
+                                                          const T &)) {
+  KeyLess<T> less(compare);
+  sort(pending.begin(), pending.end(), less);
+  vector<T> remaining;
+  remaining.reserve(expected.size());
+  set_difference(expected.begin(), expected.end(), pending.begin(),
+                 pending.end(), back_inserter(remaining), less);
+  expected.swap(remaining);
+  pending.clear();
+}
+
 /* Testaa puun avainten lisys- ja poisto-operaatioita sek mittaa
-   operaatioihin kuluvan ajan. */
+   operaatioihin kuluvan ajan. Tarkistettaessa operaatioiden avaimet
+   kertn puskuriin, joka yhdistetn odotettuihin avaimiin vasta
+   tarkistuskohdassa, joten operaatioiden vlinen kirjanpito on vakioaikaista.
+   validateEvery = tarkistetaan joka validateEvery:nnen operaation ja
+                   viimeisen operaation jlkeen */
 template<typename T> void testBTree(int degree, int iterations,
                                     vector<T> &keys,
                                     int (*compare)(const T &, const T &),
-                                    int debug) {
+                                    int debug, int validateEvery=1) {
   if (debug<0 || debug>4) {
     cerr << "Invalid debug level." << endl;
     raise(SIGABRT);
@@ -82,7 +143,7 @@ template<typename T> void testBTree(int degree, int iterations,
 
   // Lis jokaiseen puuhun avaimet satunnaisessa jrjestyksess
   for (int i=0; i<iterations; i++) {
-    vector<T> validateKeys;
+    vector<T> validateKeys, pendingKeys;
     random_shuffle(keys.begin(), keys.end(), random);
     for (unsigned int j=0; j<keys.size(); j++) {
       forest[i]->insert(keys[j]);
@@ -95,8 +156,11 @@ template<typename T> void testBTree(int degree, int iterations,
       else if (debug==2)
         cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size() << endl;
       if (debug>0) {
-        validateKeys.push_back(keys[j]);
-        forest[i]->validate(validateKeys);
+        pendingKeys.push_back(keys[j]);
+        if ((j+1)%validateEvery==0 || j+1==keys.size()) {
+          mergePendingKeys(validateKeys, pendingKeys, compare);
+          forest[i]->validate(validateKeys);
+        }
       }
     }
 
@@ -117,7 +181,9 @@ template<typename T> void testBTree(int degree, int iterations,
 
   // Poistaa jokaisesta puusta avaimet satunnaisessa jrjestyksess
   for (int i=0; i<iterations; i++) {
-    vector<T> validateKeys(keys);
+    vector<T> validateKeys(keys), pendingKeys;
+    if (debug>0)
+      sort(validateKeys.begin(), validateKeys.end(), KeyLess<T>(compare));
     random_shuffle(keys.begin(), keys.end(), random);
     for (unsigned int j=0; j<keys.size(); j++) {
       forest[i]->remove(keys[j]);
@@ -130,12 +196,11 @@ template<typename T> void testBTree(int degree, int iterations,
       else if (debug==2)
         cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size() << endl;
       if (debug>0) {
-        for (unsigned int k=0; k<validateKeys.size(); k++)
-          if (compare(keys[j], validateKeys[k])==0) {
-            validateKeys.erase(validateKeys.begin()+k);
-            break;
-          }
-        forest[i]->validate(validateKeys);
+        pendingKeys.push_back(keys[j]);
+        if ((j+1)%validateEvery==0 || j+1==keys.size()) {
+          erasePendingKeys(validateKeys, pendingKeys, compare);
+          forest[i]->validate(validateKeys);
+        }
       }
     }
 
@@ -155,11 +220,16 @@ template<typename T> void testBTree(int degree, int iterations,
   delete[] forest;
 }
 
+/* Testaa listan avainten lisys- ja poisto-operaatioita sek mittaa
+   operaatioihin kuluvan ajan. Odotetut avaimet yllpidetn kuten
+   testBTree():ss.
+   validateEvery = tarkistetaan joka validateEvery:nnen operaation ja
+                   viimeisen operaation jlkeen */
 template<typename T> void testSkipList(int level, double probability,
                                        const T &lastKey, int iterations,
                                        vector<T> &keys,
                                        int (*compare)(const T &, const T &),
-                                       int debug) {
+                                       int debug, int validateEvery=1) {
   if (debug<0 || debug>4) {
     cerr << "Invalid debug level." << endl;
     raise(SIGABRT);
@@ -186,7 +256,7 @@ template<typename T> void testSkipList(int level, double probability,
 
   // Lis jokaiseen listaan avaimet satunnaisessa jrjestyksess.
   for (int i=0; i<iterations; i++) {
-    vector<T> validateKeys;
+    vector<T> validateKeys, pendingKeys;
     random_shuffle(keys.begin(), keys.end(), random);
     for (unsigned int j=0; j<keys.size(); j++) {
       forest[i]->insert(keys[j]);
@@ -199,9 +269,11 @@ template<typename T> void testSkipList(int level, double probability,
       else if (debug==2)
         cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size() << endl;
       if (debug>0) {
-        //cout << "insert(" << keys[j] << ")" << endl;
-        validateKeys.push_back(keys[j]);
-        forest[i]->validate(validateKeys);
+        pendingKeys.push_back(keys[j]);
+        if ((j+1)%validateEvery==0 || j+1==keys.size()) {
+          mergePendingKeys(validateKeys, pendingKeys, compare);
+          forest[i]->validate(validateKeys);
+        }
       }
     }
 
@@ -222,7 +294,9 @@ template<typename T> void testSkipList(int level, double probability,
 
   // Poistaa avaimet listasta satunnaisessa jrjestyksess
   for (int i=0; i<iterations; i++) {
-    vector<T> validateKeys(keys);
+    vector<T> validateKeys(keys), pendingKeys;
+    if (debug>0)
+      sort(validateKeys.begin(), validateKeys.end(), KeyLess<T>(compare));
     random_shuffle(keys.begin(), keys.end(), random);
     for (unsigned int j=0; j<keys.size(); j++) {
       forest[i]->remove(keys[j]);
@@ -235,12 +309,11 @@ template<typename T> void testSkipList(int level, double probability,
       else if (debug==2)
         cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size() << endl;
       if (debug>0) {
-        for (unsigned int k=0; k<validateKeys.size(); k++)
-          if (compare(keys[j], validateKeys[k])==0) {
-            validateKeys.erase(validateKeys.begin()+k);
-            break;
-          }
-        forest[i]->validate(validateKeys);
+        pendingKeys.push_back(keys[j]);
+        if ((j+1)%validateEvery==0 || j+1==keys.size()) {
+          erasePendingKeys(validateKeys, pendingKeys, compare);
+          forest[i]->validate(validateKeys);
+        }
       }
     }
 
@@ -259,82 +332,2539 @@ template<typename T> void testSkipList(int level, double probability,
   delete[] forest;
 }
 
-/* Vertailee kokonaislukuavaimia. */
-inline int intCompare(const int &a, const int &b) {
-  if (a<b) return -1;
-  if (a>b) return 1;
-  return 0;
+/* Testaa levylle tallennettavan puun lisys- ja poisto-operaatioita
+   rajoitetulla puskurivarannolla ja mittaa operaatioihin kuluvan ajan sek
+   sivujen lukujen ja kirjoitusten mrn operaatiota kohden. */
+template<typename T> void testPagedBTree(int pageSize, int memory,
+                                         int iterations, vector<T> &keys,
+                                         int (*compare)(const T &,
+                                                        const T &),
+                                         int debug) {
+  if (debug<0 || debug>4) {
+    cerr << "Invalid debug level." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  RandomNumberGenerator random;
+  const char *fileName="pagedbtree.dat";
+  int numFrames=memory*1024/pageSize;
+  double insertTime=0, removeTime=0;
+  long long insertReads=0, insertWrites=0, removeReads=0, removeWrites=0;
+  double hitRatio=0;
+  int degree=PagedBTreeNode<T>::degreeFor(pageSize);
+
+  if (debug>0)
+    cout << "pageSize=" << pageSize << ", degree=" << degree
+         << ", frames=" << numFrames << ", iterations=" << iterations
+         << ", keys=" << keys.size() << endl;
+  else
+    cout << pageSize << "," << degree << "," << memory << ","
+         << iterations << "," << keys.size() << "," << flush;
+
+  for (int i=0; i<iterations; i++) {
+    PagedBTree<T> tree(fileName, pageSize, numFrames, compare, true,
+                       debug==4 ? 1 : 0);
+    BufferPool *pool=tree.getPool();
+    clock_t start, end;
+
+    // Lis puuhun avaimet satunnaisessa jrjestyksess.
+    vector<T> validateKeys;
+    random_shuffle(keys.begin(), keys.end(), random);
+    pool->resetStats();
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.insert(keys[j]);
+
+      if (debug==3) {
+        cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+        tree.printDebug();
+        cout << "---" << endl;
+      }
+      else if (debug==2)
+        cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug>0) {
+        validateKeys.push_back(keys[j]);
+        tree.validate(validateKeys);
+      }
+    }
+    tree.flush();
+    end=clock();
+    insertTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    insertReads+=pool->getReads();
+    insertWrites+=pool->getWrites();
+    hitRatio+=pool->getHitRatio();
+
+    // Poistaa puusta avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    pool->resetStats();
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.remove(keys[j]);
+
+      if (debug==3) {
+        cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+        tree.printDebug();
+        cout << "---" << endl;
+      }
+      else if (debug==2)
+        cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug>0) {
+        for (unsigned int k=0; k<validateKeys.size(); k++)
+          if (compare(keys[j], validateKeys[k])==0) {
+            validateKeys.erase(validateKeys.begin()+k);
+            break;
+          }
+        tree.validate(validateKeys);
+      }
+    }
+    tree.flush();
+    end=clock();
+    removeTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    removeReads+=pool->getReads();
+    removeWrites+=pool->getWrites();
+    hitRatio+=pool->getHitRatio();
+  }
+
+  remove(fileName);
+
+  double ops=double(iterations)*keys.size();
+  if (ops==0) ops=1;
+  if (debug==0)
+    cout << insertTime << "," << removeTime << ","
+         << insertReads/ops << "," << insertWrites/ops << ","
+         << removeReads/ops << "," << removeWrites/ops << ","
+         << (iterations>0 ? hitRatio/(2*iterations) : 0) << endl;
 }
 
-/* Vertailee merkkiavaimia. */
-inline int charCompare(const char &a, const char &b) {
-  if (a<b) return -1;
-  if (a>b) return 1;
-  return 0;
+/* Testaa pakattujen lehtien puun lisys-, haku- ja poisto-operaatioita ja
+   mittaa operaatioihin kuluvan ajan sek lehtien tilan avainta kohden. */
+template<typename T> void testCompressedBTree(int degree, int leafBytes,
+                                              int iterations,
+                                              vector<T> &keys, int debug) {
+  if (debug<0 || debug>4) {
+    cerr << "Invalid debug level." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  RandomNumberGenerator random;
+  double insertTime=0, searchTime=0, removeTime=0, bytesPerKey=0;
+  long long leaves=0;
+
+  if (debug>0)
+    cout << "degree=" << degree << ", leafBytes=" << leafBytes
+         << ", iterations=" << iterations << ", keys=" << keys.size()
+         << endl;
+  else
+    cout << degree << "," << leafBytes << "," << iterations << ","
+         << keys.size() << "," << flush;
+
+  for (int i=0; i<iterations; i++) {
+    CompressedBTree<T> tree(degree, leafBytes, debug==4 ? 1 : 0);
+    clock_t start, end;
+
+    // Lis puuhun avaimet satunnaisessa jrjestyksess.
+    vector<T> validateKeys;
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.insert(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        validateKeys.push_back(keys[j]);
+        tree.validate(validateKeys);
+      }
+    }
+    end=clock();
+    insertTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    leaves+=tree.getLeaves();
+    if (keys.size()>0)
+      bytesPerKey+=tree.getLeafBytes()/double(keys.size());
+
+    // Hakee puusta avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++)
+      if (!tree.search(keys[j])) {
+        cerr << "Key " << keys[j] << " not found." << endl;
+        raise(SIGABRT);
+        return;
+      }
+    end=clock();
+    searchTime+=(end-start)/(double)CLOCKS_PER_SEC;
+
+    // Poistaa puusta avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.remove(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        for (unsigned int k=0; k<validateKeys.size(); k++)
+          if (keys[j]==validateKeys[k]) {
+            validateKeys.erase(validateKeys.begin()+k);
+            break;
+          }
+        tree.validate(validateKeys);
+      }
+    }
+    end=clock();
+    removeTime+=(end-start)/(double)CLOCKS_PER_SEC;
+  }
+
+  if (debug==0)
+    cout << insertTime << "," << searchTime << "," << removeTime << ","
+         << (iterations>0 ? bytesPerKey/iterations : 0) << ","
+         << (iterations>0 ? leaves/iterations : 0) << endl;
 }
 
-/*
-  btree = testaa b-puuta
-  skiplist = testaa hyppylistaa
-  selftest
+/* Tarkistaa puskuroidun b-puun pienill asteilla (2-3) ja puskureilla
+   (1-4), joilla yhdistmiset tyhjentvt sissolmuja useimmin: lis
+   avaimet ja poistaa ne kaikki satunnaisessa jrjestyksess ja tarkistaa
+   puun snnllisin vlein sek lopuksi tyhjn. */
+template<typename T> void checkBufferedBTree(vector<T> &keys,
+                                             int (*compare)(const T &,
+                                                            const T &)) {
+  RandomNumberGenerator random;
+  unsigned int every=keys.size()/64+1;
 
-  degree = b-puun aste. oltava >=2
-  iterations = luotavien puiden/listojen mr (=iteraatioiden mr)
-  keys_file = tiedosto, josta avaimet luetaan
-  level = hyppylistan maksimitaso
-  probability = todennkisyys, jolla solmujen taso valitaan
-  debug_level = 0=ei debug-tulostusta,
-                1=tulostaa rakenteet kaikkien avainten lisysten ja poistojen
-                  jlkeen
-                2=tulostaa rakenteet jokaisen avaimen lisyksen ja poiston
-                  jlkeen
-                3=lausekattavuustulostus
-*/
-void usage(const char *self) {
-  cerr << "Usage: " << self << " btree <degree> <iterations>"
-       << " <keys_file> <debug_level>" << endl;
-  cerr << "       " << self << " skiplist <level> <probability>"
-       << " <iterations> <keys_file> <debug_level>" << endl;
+  for (int degree=2; degree<=3; degree++)
+    for (int bufferSize=1; bufferSize<=4; bufferSize++) {
+      BufferedBTree<T> tree(degree, bufferSize, compare, 0);
+      random_shuffle(keys.begin(), keys.end(), random);
+      for (unsigned int j=0; j<keys.size(); j++) tree.insert(keys[j]);
+      tree.validate(keys);
+
+      // Puussa ovat poistojrjestyksess viel poistamattomat avaimet.
+      random_shuffle(keys.begin(), keys.end(), random);
+      for (unsigned int j=0; j<keys.size(); j++) {
+        tree.remove(keys[j]);
+        if ((j+1)%every==0 || j+1==keys.size())
+          tree.validate(vector<T>(keys.begin()+j+1, keys.end()));
+      }
+    }
 }
 
-int main(int argc, char *argv[]) {
-  if (argc<2) {
-    cerr << "Invalid arguments." << endl;
-    usage(argv[0]);
-    return -1;
+/* Testaa puskuroidun b-puun lisys-, haku- ja poisto-operaatioita ja mittaa
+   operaatioihin kuluvan ajan sek puskureista lapsille siirrettyjen erien
+   keskikoon. */
+template<typename T> void testBufferedBTree(int degree, int bufferSize,
+                                            int iterations,
+                                            vector<T> &keys,
+                                            int (*compare)(const T &,
+                                                           const T &),
+                                            int debug) {
+  if (debug<0 || debug>4) {
+    cerr << "Invalid debug level." << endl;
+    raise(SIGABRT);
+    return;
   }
 
-  string test(argv[1]);
-  //transform(test.begin(), test.end(), test.begin(), tolower);
+  RandomNumberGenerator random;
+  double insertTime=0, searchTime=0, removeTime=0;
+  long long flushes=0, flushedMessages=0;
 
-  if (argc==6 && test=="btree") {
-    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[5]);
-    int degree, iterations, debug;
-    if (!(ss1 >> degree) || !(ss2 >> iterations) || !(ss3 >> debug)) {
-      cerr << "Invalid arguments." << endl;
-      usage(argv[0]);
-      return -1;
+  if (debug>0)
+    cout << "degree=" << degree << ", bufferSize=" << bufferSize
+         << ", iterations=" << iterations << ", keys=" << keys.size()
+         << endl;
+  else
+    cout << degree << "," << bufferSize << "," << iterations << ","
+         << keys.size() << "," << flush;
+
+  for (int i=0; i<iterations; i++) {
+    BufferedBTree<T> tree(degree, bufferSize, compare, debug==4 ? 1 : 0);
+    clock_t start, end;
+
+    // Lis puuhun avaimet satunnaisessa jrjestyksess.
+    vector<T> validateKeys;
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.insert(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        validateKeys.push_back(keys[j]);
+        tree.validate(validateKeys);
+      }
     }
+    end=clock();
+    insertTime+=(end-start)/(double)CLOCKS_PER_SEC;
 
-    vector<int> keys;
-    readKeys(argv[4], keys);
-    testBTree(degree, iterations, keys, &intCompare, debug);
+    // Hakee puusta avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++)
+      if (!tree.search(keys[j])) {
+        cerr << "Key " << keys[j] << " not found." << endl;
+        raise(SIGABRT);
+        return;
+      }
+    end=clock();
+    searchTime+=(end-start)/(double)CLOCKS_PER_SEC;
+
+    // Poistaa puusta avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.remove(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        for (unsigned int k=0; k<validateKeys.size(); k++)
+          if (keys[j]==validateKeys[k]) {
+            validateKeys.erase(validateKeys.begin()+k);
+            break;
+          }
+        tree.validate(validateKeys);
+      }
+    }
+    end=clock();
+    removeTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    flushes+=tree.getFlushes();
+    flushedMessages+=tree.getFlushedMessages();
   }
-  else if (argc==7 && test=="skiplist") {
-    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]), ss4(argv[6]);
-    int level, iterations, debug;
-    double probability;
-    if (!(ss1 >> level) || !(ss2 >> probability) || !(ss3 >> iterations)
-        || !(ss4 >> debug)) {
-      cerr << "Invalid arguments." << endl;
-      usage(argv[0]);
-      return -1;
+
+  if (debug==0)
+    cout << insertTime << "," << searchTime << "," << removeTime << ","
+         << (flushes>0 ? flushedMessages/double(flushes) : 0) << endl;
+}
+
+/* Testaa merkkijono-B-puun lisys-, haku- ja poisto-operaatioita ja vertaa
+   niiden kestoa merkkijonoja sellaisenaan tallentavaan B-puuhun. Tulostaa
+   lisksi niiden vertailujen osuuden, joissa avainta luettiin puskurista,
+   sek tallennettujen avaintavujen mrn avainta kohden. */
+void testStringBTree(int degree, int iterations, vector<string> &keys,
+                     int (*compare)(const string &, const string &),
+                     int debug) {
+  if (debug<0 || debug>4) {
+    cerr << "Invalid debug level." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  RandomNumberGenerator random;
+  double insertTime=0, searchTime=0, removeTime=0;
+  double baseInsertTime=0, baseSearchTime=0, baseRemoveTime=0;
+  long long compares=0, fullCompares=0, stored=0, raw=0;
+  for (unsigned int i=0; i<keys.size(); i++) raw+=keys[i].size();
+
+  if (debug>0)
+    cout << "degree=" << degree << ", iterations=" << iterations
+         << ", keys=" << keys.size() << endl;
+  else
+    cout << degree << "," << iterations << "," << keys.size() << ","
+         << flush;
+
+  for (int i=0; i<iterations; i++) {
+    StringBTree tree(degree, debug==4 ? 1 : 0);
+    BTree<string> base(degree, compare, 0);
+    clock_t start, end;
+
+    // Lis puihin avaimet satunnaisessa jrjestyksess.
+    vector<string> validateKeys;
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.insert(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "insert(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        validateKeys.push_back(keys[j]);
+        tree.validate(validateKeys);
+      }
     }
+    end=clock();
+    insertTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    stored+=tree.getStoredBytes();
 
-    vector<int> keys;
-    readKeys(argv[5], keys);
-    testSkipList(level, probability, 0x7fffffff, iterations, keys,
-                 &intCompare, debug);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) base.insert(keys[j]);
+    end=clock();
+    baseInsertTime+=(end-start)/(double)CLOCKS_PER_SEC;
+
+    // Hakee puista avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    tree.resetStats();
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++)
+      if (!tree.search(keys[j])) {
+        cerr << "Key " << keys[j] << " not found." << endl;
+        raise(SIGABRT);
+        return;
+      }
+    end=clock();
+    searchTime+=(end-start)/(double)CLOCKS_PER_SEC;
+    compares+=tree.getCompares();
+    fullCompares+=tree.getFullCompares();
+
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      BTreeNode<string> *node;
+      int index;
+      base.search(keys[j], &node, &index);
+    }
+    end=clock();
+    baseSearchTime+=(end-start)/(double)CLOCKS_PER_SEC;
+
+    // Poistaa puista avaimet satunnaisessa jrjestyksess.
+    random_shuffle(keys.begin(), keys.end(), random);
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) {
+      tree.remove(keys[j]);
+
+      if (debug==2 || debug==3)
+        cout << "remove(" << keys[j] << ") " << j+1 << "/" << keys.size()
+             << endl;
+      if (debug==3) {
+        tree.print();
+        cout << "---" << endl;
+      }
+      if (debug>0) {
+        for (unsigned int k=0; k<validateKeys.size(); k++)
+          if (keys[j]==validateKeys[k]) {
+            validateKeys.erase(validateKeys.begin()+k);
+            break;
+          }
+        tree.validate(validateKeys);
+      }
+    }
+    end=clock();
+    removeTime+=(end-start)/(double)CLOCKS_PER_SEC;
+
+    start=clock();
+    for (unsigned int j=0; j<keys.size(); j++) base.remove(keys[j]);
+    end=clock();
+    baseRemoveTime+=(end-start)/(double)CLOCKS_PER_SEC;
+  }
+
+  double n=double(iterations)*keys.size();
+  if (n==0) n=1;
+  if (debug==0)
+    cout << insertTime << "," << searchTime << "," << removeTime << ","
+         << baseInsertTime << "," << baseSearchTime << ","
+         << baseRemoveTime << ","
+         << (compares>0 ? fullCompares/double(compares) : 0) << ","
+         << stored/n << "," << raw*iterations/n << endl;
+}
+
+/* Vertaa jdytetyn hakurakenteen hakujen kestoa puun hakuihin. Tarkistaa
+   ensin, ett rakenne antaa samat tulokset kuin puu. */
+template<typename T> void testFrozen(int degree, int iterations,
+                                     vector<T> &keys,
+                                     int (*compare)(const T &, const T &)) {
+  RandomNumberGenerator random;
+  BTree<T> tree(degree, compare, 0);
+  random_shuffle(keys.begin(), keys.end(), random);
+  for (unsigned int i=0; i<keys.size(); i++) tree.insert(keys[i]);
+  FrozenBTree<T> *frozen=tree.freeze();
+
+  cout << degree << "," << iterations << "," << keys.size() << "," << flush;
+
+  // Tarkistetaan avainten lytyminen ja vlihaku koko avainjoukolla.
+  vector<T> sorted(keys), result;
+  sort(sorted.begin(), sorted.end());
+  if (frozen->size()!=(int)keys.size()) {
+    cerr << "Wrong number of frozen keys." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  for (unsigned int i=0; i<keys.size(); i++)
+    if (!frozen->contains(keys[i])) {
+      cerr << "Key " << keys[i] << " not found." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  if (keys.size()>0) {
+    frozen->range(sorted.front(), sorted.back(), result);
+    if (result!=sorted) {
+      cerr << "Range does not match keys." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+
+  clock_t start, end;
+  int found=0;
+
+  start=clock();
+  for (int i=0; i<iterations; i++)
+    for (unsigned int j=0; j<keys.size(); j++) {
+      BTreeNode<T> *node;
+      int index;
+      tree.search(keys[j], &node, &index);
+      if (node) found++;
+    }
+  end=clock();
+  double treeTime=(end-start)/(double)CLOCKS_PER_SEC;
+
+  start=clock();
+  for (int i=0; i<iterations; i++)
+    for (unsigned int j=0; j<keys.size(); j++)
+      if (frozen->contains(keys[j])) found--;
+  end=clock();
+  double frozenTime=(end-start)/(double)CLOCKS_PER_SEC;
+
+  // Laskuri varmistaa, ettei kntj poista hakuja.
+  if (found!=0) {
+    cerr << "Frozen lookups differ from tree." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  cout << treeTime << "," << frozenTime << ","
+       << (frozenTime>0 ? treeTime/frozenTime : 0) << endl;
+  delete frozen;
+}
+
+/* Luo b-puita mittauksia varten. */
+template<typename T> class BTreeFactory {
+  const int degree;
+  int (*const compare)(const T &, const T &);
+
+public:
+  typedef BTreeSet<T> Structure;
+
+  BTreeFactory(int degree, int (*const compare)(const T &, const T &)) :
+    degree(degree), compare(compare) {}
+
+  BTreeSet<T> *create() const {
+    return new BTreeSet<T>(degree, compare);
+  }
+};
+
+/* Luo hyppylistoja mittauksia varten. */
+template<typename T> class SkipListFactory {
+  const int level;
+  const double probability;
+  const T lastKey;
+  int (*const compare)(const T &, const T &);
+
+public:
+  typedef SkipListSet<T> Structure;
+
+  SkipListFactory(int level, double probability, const T &lastKey,
+                  int (*const compare)(const T &, const T &)) :
+    level(level), probability(probability), lastKey(lastKey),
+    compare(compare) {}
+
+  SkipListSet<T> *create() const {
+    return new SkipListSet<T>(level, probability, lastKey, compare);
+  }
+};
+
+/* Luo std::set-joukkoja mittauksia varten. */
+template<typename T> class StdSetFactory {
+  int (*const compare)(const T &, const T &);
+
+public:
+  typedef StdSet<T> Structure;
+
+  StdSetFactory(int (*const compare)(const T &, const T &)) :
+    compare(compare) {}
+
+  StdSet<T> *create() const {
+    return new StdSet<T>(compare);
+  }
+};
+
+/* Luo jrjestettyj vektoreita mittauksia varten. */
+template<typename T> class SortedVectorFactory {
+  int (*const compare)(const T &, const T &);
+
+public:
+  typedef SortedVectorSet<T> Structure;
+
+  SortedVectorFactory(int (*const compare)(const T &, const T &)) :
+    compare(compare) {}
+
+  SortedVectorSet<T> *create() const {
+    return new SortedVectorSet<T>(compare);
+  }
+};
+
+/* Mittaa rakenteen lisys-, haku- ja poisto-operaatioiden keston
+   toistetusti. Avainten jrjestysten arvonta sek rakenteen luonti ja
+   tuhoaminen tehdn ajanoton ulkopuolella. Jokaisen operaation viive
+   kirjataan histogrammiin; operaatiot ajoitetaan yhdell kellon
+   lukemisella, joka ptt edellisen ja aloittaa seuraavan operaation.
+   factory = rakenteen luova olio
+   warmup = mittausten mr, joiden tulokset hyltn
+   repetitions = mittausten mr
+   insert, search, remove = vaiheiden tunnusluvut palautetaan nihin
+   insertLatency, searchLatency, removeLatency = operaatioiden viiveet
+                                                 listn nihin
+   perf = lisys-, haku- ja poistovaiheen suorituskykylaskurit tai NULL,
+          jos laskureita ei kytet
+   memory = viimeisen mittauksen rakenteen muistinkytt lisysten
+            jlkeen listn thn
+   heapBytes = viimeisen mittauksen lisysten kekomuistin muutos
+               palautetaan thn; vaatii laskevat muistinvarauskoukut */
+template<typename T, typename F> void benchmark(
+  const F &factory, const vector<T> &keys, int warmup, int repetitions,
+  BenchmarkSummary *insert, BenchmarkSummary *search,
+  BenchmarkSummary *remove, LatencyHistogram *insertLatency,
+  LatencyHistogram *searchLatency, LatencyHistogram *removeLatency,
+  PerfCounters *perf, MemoryUsage *memory, long long *heapBytes) {
+  RandomNumberGenerator random;
+  vector<T> insertOrder(keys), searchOrder(keys), removeOrder(keys);
+  vector<double> insertSamples, searchSamples, removeSamples;
+  int found=0;
+
+  for (int i=-warmup; i<repetitions; i++) {
+    random_shuffle(insertOrder.begin(), insertOrder.end(), random);
+    random_shuffle(searchOrder.begin(), searchOrder.end(), random);
+    random_shuffle(removeOrder.begin(), removeOrder.end(), random);
+    long long heapStart=getHeapBytes();
+    typename F::Structure *structure=factory.create();
+    bool record=i>=0, count=record && perf;
+
+    if (count) perf[0].start();
+    long long start=monotonicNanos(), previous=start, now;
+    for (unsigned int j=0; j<insertOrder.size(); j++) {
+      structure->insert(insertOrder[j]);
+      now=monotonicNanos();
+      if (record) insertLatency->record(now-previous);
+      previous=now;
+    }
+    long long inserted=previous, searchStart=previous;
+    if (count) perf[0].stop();
+    // Muistinkytt luetaan ajanoton ulkopuolella.
+    if (i==repetitions-1) {
+      *heapBytes=getHeapBytes()-heapStart;
+      structure->memoryUsage(*memory);
+      previous=searchStart=monotonicNanos();
+    }
+    if (count) perf[1].start();
+    for (unsigned int j=0; j<searchOrder.size(); j++) {
+      if (structure->contains(searchOrder[j])) found++;
+      now=monotonicNanos();
+      if (record) searchLatency->record(now-previous);
+      previous=now;
+    }
+    long long searched=previous;
+    if (count) {
+      perf[1].stop();
+      perf[2].start();
+    }
+    for (unsigned int j=0; j<removeOrder.size(); j++) {
+      structure->remove(removeOrder[j]);
+      now=monotonicNanos();
+      if (record) removeLatency->record(now-previous);
+      previous=now;
+    }
+    if (count) perf[2].stop();
+
+    delete structure;
+    if (record) {
+      insertSamples.push_back((inserted-start)/1e9);
+      searchSamples.push_back((searched-searchStart)/1e9);
+      removeSamples.push_back((previous-searched)/1e9);
+    }
+  }
+
+  if (found!=(warmup+repetitions)*(int)keys.size()) {
+    cerr << "Inserted key not found." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  *insert=summarize(insertSamples);
+  *search=summarize(searchSamples);
+  *remove=summarize(removeSamples);
+}
+
+/* Lis rivin mittausten tunnusluvut, muistinkytn, viiveet ja
+   laskurien arvot operaatiota kohden ja tulostaa sen.
+   values = rivin parametrisarakkeet
+   memory = rakenteen muistinkytt
+   heapBytes = rakenteen kekomuistin kytt
+   keys = avainten mr
+   perf = vaiheiden laskurit tai NULL
+   operations = kunkin vaiheen operaatioiden mr */
+void reportBenchmark(BenchmarkReport &report, vector<double> &values,
+                     const BenchmarkSummary summary[3],
+                     const MemoryUsage &memory, long long heapBytes,
+                     double keys, const LatencyHistogram latency[3],
+                     PerfCounters *perf, double operations) {
+  for (int i=0; i<3; i++) BenchmarkReport::addSummary(values, summary[i]);
+  BenchmarkReport::addMemory(values, memory, heapBytes, keys);
+  for (int i=0; i<3; i++) BenchmarkReport::addLatency(values, latency[i]);
+  if (perf) {
+    for (int i=0; i<3; i++) {
+      BenchmarkReport::addPerf(values, perf[i], operations);
+      perf[i].reset();
+    }
+  }
+  report.row(values);
+}
+
+/* Mittaa b-puun kaikilla asteilla 2...40 ja hyppylistan kaikilla
+   tasoilla 1...40 todennkisyyksill 0.3, 0.5 ja 0.7 yhdess
+   prosessissa. Vertailukohtina kytettvt std::set ja jrjestetty vektori
+   mitataan yhdell rivill.
+   structure = "btree", "skiplist", "set" tai "vector"
+   json = true=JSON-muoto, false=CSV-muoto
+   counters = true=raportoi suorituskykylaskurit operaatiota kohden */
+template<typename T> void testBench(const string &structure,
+                                    vector<T> &keys, int warmup,
+                                    int repetitions, bool json,
+                                    bool counters,
+                                    int (*compare)(const T &, const T &)) {
+  const char *operations[]={"insert", "search", "remove"};
+  vector<string> columns;
+  if (structure=="btree") columns.push_back("degree");
+  else if (structure=="skiplist") {
+    columns.push_back("level");
+    columns.push_back("probability");
+  }
+  columns.push_back("repetitions");
+  columns.push_back("keys");
+  for (int i=0; i<3; i++)
+    BenchmarkReport::addSummaryColumns(columns,
+                                       string(operations[i])+"Time");
+  BenchmarkReport::addMemoryColumns(columns);
+  for (int i=0; i<3; i++)
+    BenchmarkReport::addLatencyColumns(columns, operations[i]);
+
+  // Laskurit avataan kerran; puuttuvat laskurit jvt tyhjiksi.
+  PerfCounters *perf=NULL;
+  if (counters) {
+    perf=new PerfCounters[3];
+    if (!perf[0].anyAvailable())
+      cerr << "Performance counters unavailable." << endl;
+    for (int i=0; i<3; i++)
+      BenchmarkReport::addPerfColumns(columns, operations[i]);
+  }
+
+  // Kekomuistin kytt lasketaan koko mittauksen ajan.
+  AllocationHooks hooks=setAllocationHooks(countingAllocationHooks());
+  BenchmarkReport report(json, columns);
+  BenchmarkSummary summary[3];
+  long long heapBytes;
+  double n=double(repetitions)*keys.size();
+
+  if (structure=="btree")
+    for (int degree=2; degree<41; degree++) {
+      LatencyHistogram latency[3];
+      MemoryUsage memory;
+      benchmark(BTreeFactory<T>(degree, compare), keys, warmup,
+                repetitions, &summary[0], &summary[1], &summary[2],
+                &latency[0], &latency[1], &latency[2], perf, &memory,
+                &heapBytes);
+      vector<double> values;
+      values.push_back(degree);
+      values.push_back(repetitions);
+      values.push_back(keys.size());
+      reportBenchmark(report, values, summary, memory, heapBytes,
+                      keys.size(), latency, perf, n);
+    }
+  else if (structure=="skiplist") {
+    const double probabilities[]={0.3, 0.5, 0.7};
+    for (int level=1; level<41; level++)
+      for (int i=0; i<3; i++) {
+        LatencyHistogram latency[3];
+        MemoryUsage memory;
+        benchmark(SkipListFactory<T>(level, probabilities[i], 0x7fffffff,
+                                     compare),
+                  keys, warmup, repetitions, &summary[0], &summary[1],
+                  &summary[2], &latency[0], &latency[1], &latency[2],
+                  perf, &memory, &heapBytes);
+        vector<double> values;
+        values.push_back(level);
+        values.push_back(probabilities[i]);
+        values.push_back(repetitions);
+        values.push_back(keys.size());
+        reportBenchmark(report, values, summary, memory, heapBytes,
+                        keys.size(), latency, perf, n);
+      }
+  }
+  else {
+    LatencyHistogram latency[3];
+    MemoryUsage memory;
+    if (structure=="set")
+      benchmark(StdSetFactory<T>(compare), keys, warmup, repetitions,
+                &summary[0], &summary[1], &summary[2], &latency[0],
+                &latency[1], &latency[2], perf, &memory, &heapBytes);
+    else
+      benchmark(SortedVectorFactory<T>(compare), keys, warmup, repetitions,
+                &summary[0], &summary[1], &summary[2], &latency[0],
+                &latency[1], &latency[2], perf, &memory, &heapBytes);
+    vector<double> values;
+    values.push_back(repetitions);
+    values.push_back(keys.size());
+    reportBenchmark(report, values, summary, memory, heapBytes,
+                    keys.size(), latency, perf, n);
+  }
+  setAllocationHooks(hooks);
+  delete[] perf;
+}
+
+/* Vertaa b-puun vlitnt ja laiskaa poistoa. Kullakin toistolla puuhun
+   listn avaimet ajanoton ulkopuolella ja ne poistetaan satunnaisessa
+   jrjestyksess kirjaten jokaisen poiston viive. Laiskassa poistossa
+   puu tiivistetn joka compactInterval:nnen poiston jlkeen enintn
+   compactBudget haudatun avaimen verran; tiivistysten viiveet kirjataan
+   erikseen, ja lopuksi loput haudatut avaimet poistetaan. Poistovaiheen
+   kesto sislt tiivistykset. Tulostaa kummastakin poistotavasta rivin
+   (lazy=0 tai 1) CSV- tai JSON-muodossa.
+   compactInterval = poistojen mr tiivistysten vlill
+   compactBudget = tiivistyksen kerralla poistamien avainten mr */
+template<typename T> void testLazyRemove(int degree, vector<T> &keys,
+                                         int repetitions,
+                                         int compactInterval,
+                                         int compactBudget,
+                                         int (*compare)(const T &,
+                                                        const T &)) {
+  vector<string> columns;
+  columns.push_back("lazy");
+  columns.push_back("degree");
+  columns.push_back("keys");
+  columns.push_back("repetitions");
+  BenchmarkReport::addSummaryColumns(columns, "removeTime");
+  BenchmarkReport::addLatencyColumns(columns, "remove");
+  columns.push_back("compactCount");
+  BenchmarkReport::addLatencyColumns(columns, "compact");
+  BenchmarkReport report(false, columns);
+
+  RandomNumberGenerator random;
+  vector<T> insertOrder(keys), removeOrder(keys), empty;
+  for (int lazy=0; lazy<2; lazy++) {
+    LatencyHistogram removeLatency, compactLatency;
+    vector<double> samples;
+    for (int i=0; i<repetitions; i++) {
+      random_shuffle(insertOrder.begin(), insertOrder.end(), random);
+      random_shuffle(removeOrder.begin(), removeOrder.end(), random);
+      BTree<T> tree(degree, compare, 0);
+      for (unsigned int j=0; j<insertOrder.size(); j++)
+        tree.insert(insertOrder[j]);
+      tree.setLazyRemove(lazy==1);
+
+      long long start=monotonicNanos(), previous=start, now;
+      for (unsigned int j=0; j<removeOrder.size(); j++) {
+        tree.remove(removeOrder[j]);
+        now=monotonicNanos();
+        removeLatency.record(now-previous);
+        previous=now;
+        if (lazy && (j+1)%compactInterval==0) {
+          tree.compact(compactBudget);
+          now=monotonicNanos();
+          compactLatency.record(now-previous);
+          previous=now;
+        }
+      }
+      tree.compact(-1);
+      samples.push_back((monotonicNanos()-start)/1e9);
+      tree.validate(empty);
+    }
+
+    vector<double> values;
+    values.push_back(lazy);
+    values.push_back(degree);
+    values.push_back(keys.size());
+    values.push_back(repetitions);
+    BenchmarkReport::addSummary(values, summarize(samples));
+    BenchmarkReport::addLatency(values, removeLatency);
+    values.push_back(compactLatency.getCount());
+    BenchmarkReport::addLatency(values, compactLatency);
+    report.row(values);
+  }
+}
+
+/* Vertaa b-puun tyttastetta, syvyytt, solmujen mr ja muistinkytt,
+   kun tysi solmu puolitetaan tai kun avaimia siirretn sisarille ja
+   tydet sisarukset jaetaan kolmeen (B*-puu). Avaimet listn sek
+   satunnaisessa ett nousevassa jrjestyksess. */
+template<typename T> void testFill(int degree, vector<T> &keys,
+                                   int (*compare)(const T &, const T &)) {
+  vector<string> columns;
+  columns.push_back("redistribute");
+  columns.push_back("sorted");
+  columns.push_back("degree");
+  columns.push_back("keys");
+  columns.push_back("depth");
+  columns.push_back("nodes");
+  columns.push_back("fill");
+  columns.push_back("insertTime");
+  BenchmarkReport::addMemoryColumns(columns);
+  BenchmarkReport report(false, columns);
+
+  // Kekomuistin kytt lasketaan koko mittauksen ajan.
+  AllocationHooks hooks=setAllocationHooks(countingAllocationHooks());
+  RandomNumberGenerator random;
+  vector<T> order(keys), sorted(keys);
+  random_shuffle(order.begin(), order.end(), random);
+  sort(sorted.begin(), sorted.end(), KeyLess<T>(compare));
+  for (int redistribute=0; redistribute<2; redistribute++)
+    for (int ascending=0; ascending<2; ascending++) {
+      const vector<T> &insertOrder=ascending ? sorted : order;
+      long long heapStart=getHeapBytes();
+      BTree<T> tree(degree, compare, 0);
+      tree.setRedistribute(redistribute==1);
+      long long start=monotonicNanos();
+      for (unsigned int i=0; i<insertOrder.size(); i++)
+        tree.insert(insertOrder[i]);
+      double seconds=(monotonicNanos()-start)/1e9;
+      long long heapBytes=getHeapBytes()-heapStart;
+
+      tree.validate(sorted);
+      MemoryUsage usage;
+      tree.memoryUsage(usage);
+      long long nodes=0;
+      for (int i=0; i<usage.size(); i++) nodes+=usage.getEntry(i).nodes;
+
+      vector<double> values;
+      values.push_back(redistribute);
+      values.push_back(ascending);
+      values.push_back(degree);
+      values.push_back(keys.size());
+      values.push_back(tree.getDepth());
+      values.push_back(nodes);
+      values.push_back(tree.getFillFactor());
+      values.push_back(seconds);
+      BenchmarkReport::addMemory(values, usage, heapBytes, keys.size());
+      report.row(values);
+    }
+  setAllocationHooks(hooks);
+}
+
+/* Suorittaa joukko-operaation rakenteille a ja b sek yhdell
+   lpikynnill ett naiivisti avain kerrallaan hakemalla, lismll ja
+   poistamalla, ja tarkistaa molempien tulokset. Rakenteet rakennetaan
+   kummallekin tavalle uudelleen jrjestetyist avaimista.
+   factory = sovittimen luova olio, jolla on metodi create() */
+template<typename T, typename F>
+void runSetOperation(const F &factory, int structure, int operation,
+                     const vector<T> &a, const vector<T> &b,
+                     int (*compare)(const T &, const T &),
+                     BenchmarkReport &report) {
+  vector<T> expected;
+  if (operation==SET_UNION)
+    set_union(a.begin(), a.end(), b.begin(), b.end(),
+              back_inserter(expected), KeyLess<T>(compare));
+  else if (operation==SET_INTERSECTION)
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                     back_inserter(expected), KeyLess<T>(compare));
+  else
+    set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                   back_inserter(expected), KeyLess<T>(compare));
+
+  typename F::Structure *first=factory.create(), *second=factory.create();
+  first->getStructure().build(a);
+  second->getStructure().build(b);
+  long long start=monotonicNanos();
+  if (operation==SET_UNION)
+    first->getStructure().unionWith(second->getStructure());
+  else if (operation==SET_INTERSECTION)
+    first->getStructure().intersect(second->getStructure());
+  else first->getStructure().difference(second->getStructure());
+  double mergeSeconds=(monotonicNanos()-start)/1e9;
+  first->getStructure().validate(expected);
+  delete first;
+  delete second;
+
+  // Sovittimen lisys ohittaa jo rakenteessa olevat avaimet.
+  first=factory.create();
+  second=factory.create();
+  first->getStructure().build(a);
+  second->getStructure().build(b);
+  start=monotonicNanos();
+  if (operation==SET_UNION) {
+    for (unsigned int i=0; i<b.size(); i++) first->insert(b[i]);
+  }
+  else if (operation==SET_INTERSECTION) {
+    for (unsigned int i=0; i<a.size(); i++)
+      if (!second->contains(a[i])) first->remove(a[i]);
+  }
+  else {
+    for (unsigned int i=0; i<b.size(); i++)
+      if (first->contains(b[i])) first->remove(b[i]);
+  }
+  double naiveSeconds=(monotonicNanos()-start)/1e9;
+  first->getStructure().validate(expected);
+  delete first;
+  delete second;
+
+  vector<double> values;
+  values.push_back(structure);
+  values.push_back(operation);
+  values.push_back(a.size());
+  values.push_back(b.size());
+  values.push_back(expected.size());
+  values.push_back(mergeSeconds);
+  values.push_back(naiveSeconds);
+  report.row(values);
+}
+
+/* Vertaa b-puun ja hyppylistan yhdisteen, leikkauksen ja erotuksen
+   lpikyntiin perustuvaa toteutusta avain kerrallaan tehtyyn. Joukot
+   ovat avainten puoliksi pllekkiset kolme neljnnest sek lisksi
+   pieni, noin 1/64 avaimista sisltv joukko, jolla laukkahaku
+   tulee kyttn. */
+template<typename T> void testSetOps(int degree, int level,
+                                     double probability, const T &lastKey,
+                                     vector<T> &keys,
+                                     int (*compare)(const T &, const T &)) {
+  vector<string> columns;
+  columns.push_back("structure");
+  columns.push_back("operation");
+  columns.push_back("sizeA");
+  columns.push_back("sizeB");
+  columns.push_back("result");
+  columns.push_back("mergeTime");
+  columns.push_back("naiveTime");
+  BenchmarkReport report(false, columns);
+
+  RandomNumberGenerator random;
+  vector<T> order(keys);
+  random_shuffle(order.begin(), order.end(), random);
+  unsigned int n=order.size();
+  vector<T> a(order.begin(), order.begin()+3*n/4),
+    large(order.begin()+n/4, order.end()), small;
+  for (unsigned int i=0; i<n; i+=64) small.push_back(order[i]);
+  sort(a.begin(), a.end(), KeyLess<T>(compare));
+  sort(large.begin(), large.end(), KeyLess<T>(compare));
+  sort(small.begin(), small.end(), KeyLess<T>(compare));
+
+  BTreeFactory<T> btreeFactory(degree, compare);
+  SkipListFactory<T> skipListFactory(level, probability, lastKey, compare);
+  for (int operation=SET_UNION; operation<=SET_DIFFERENCE; operation++)
+    for (int b=0; b<2; b++) {
+      const vector<T> &other=b==0 ? large : small;
+      runSetOperation(btreeFactory, 0, operation, a, other, compare,
+                      report);
+      runSetOperation(skipListFactory, 1, operation, a, other, compare,
+                      report);
+    }
+}
+
+/* Mittaa vanhimman neljnneksen avaimista vanhentamisen jakamalla
+   rakenne kahtia ja puolikkaiden liittmisen takaisin yhteen sek vertaa
+   niit avainten poistamiseen yksitellen.
+   factory = sovittimen luova olio, jolla on metodi create() */
+template<typename T, typename F>
+void runSplitJoin(const F &factory, int structure, const vector<T> &sorted,
+                  BenchmarkReport &report) {
+  unsigned int expired=sorted.size()/4;
+  vector<T> older(sorted.begin(), sorted.begin()+expired),
+    newer(sorted.begin()+expired, sorted.end());
+  typename F::Structure *first=factory.create(), *second=factory.create();
+  first->getStructure().build(sorted);
+
+  long long start=monotonicNanos();
+  if (!newer.empty())
+    first->getStructure().split(newer.front(), second->getStructure());
+  double splitSeconds=(monotonicNanos()-start)/1e9;
+  first->getStructure().validate(older);
+  second->getStructure().validate(newer);
+
+  start=monotonicNanos();
+  first->getStructure().join(second->getStructure());
+  double joinSeconds=(monotonicNanos()-start)/1e9;
+  first->getStructure().validate(sorted);
+  second->getStructure().validate(vector<T>());
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<expired; i++) first->remove(older[i]);
+  double removeSeconds=(monotonicNanos()-start)/1e9;
+  first->getStructure().validate(newer);
+  delete first;
+  delete second;
+
+  vector<double> values;
+  values.push_back(structure);
+  values.push_back(sorted.size());
+  values.push_back(expired);
+  values.push_back(splitSeconds);
+  values.push_back(joinSeconds);
+  values.push_back(removeSeconds);
+  report.row(values);
+}
+
+/* Vertaa b-puun ja hyppylistan jakamista ja liittmist avainten
+   poistamiseen yksitellen. */
+template<typename T> void testSplitJoin(int degree, int level,
+                                        double probability,
+                                        const T &lastKey, vector<T> &keys,
+                                        int (*compare)(const T &,
+                                                       const T &)) {
+  vector<string> columns;
+  columns.push_back("structure");
+  columns.push_back("keys");
+  columns.push_back("expired");
+  columns.push_back("splitTime");
+  columns.push_back("joinTime");
+  columns.push_back("removeTime");
+  BenchmarkReport report(false, columns);
+
+  vector<T> sorted(keys);
+  sort(sorted.begin(), sorted.end(), KeyLess<T>(compare));
+  runSplitJoin(BTreeFactory<T>(degree, compare), 0, sorted, report);
+  runSplitJoin(SkipListFactory<T>(level, probability, lastKey, compare), 1,
+               sorted, report);
+}
+
+/* Vertaa koosteellisen b-puun lisysten kestoa tavalliseen puuhun ja
+   mittaa satunnaisten vlien avainten mrn ja summan laskemisen
+   koosteista ja lpikymll vlin avaimet. Tarkistaa kaikkien kyselyjen
+   tulokset sek rank()- ja select()-metodit jokaiselle avaimelle. */
+template<typename T> void testAggregate(int degree, vector<T> &keys,
+                                        int (*compare)(const T &, const T &),
+                                        double (*value)(const T &),
+                                        double (*combine)(double, double)) {
+  vector<string> columns;
+  columns.push_back("degree");
+  columns.push_back("keys");
+  columns.push_back("queries");
+  columns.push_back("insertTime");
+  columns.push_back("aggregateInsertTime");
+  columns.push_back("aggregateTime");
+  columns.push_back("walkTime");
+  BenchmarkReport report(false, columns);
+
+  RandomNumberGenerator random;
+  vector<T> order(keys), sorted(keys);
+  random_shuffle(order.begin(), order.end(), random);
+  sort(sorted.begin(), sorted.end(), KeyLess<T>(compare));
+
+  BTree<T> plain(degree, compare, 0), tree(degree, compare, 0);
+  long long start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++) plain.insert(order[i]);
+  double insertSeconds=(monotonicNanos()-start)/1e9;
+  tree.setAggregate(value, combine, 0);
+  start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++) tree.insert(order[i]);
+  double aggregateInsertSeconds=(monotonicNanos()-start)/1e9;
+  tree.validate(sorted);
+
+  for (unsigned int i=0; i<sorted.size(); i++) {
+    T key;
+    if (tree.rank(sorted[i])!=(long long)i || !tree.select(i, &key) ||
+        compare(key, sorted[i])!=0) {
+      cerr << "VALIDATE: Invalid rank or select." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+
+  // Vlien rajat valitaan avaimista, jotta vlit eivt ole tyhji.
+  unsigned int queries=sorted.empty() ? 0 : 1000;
+  vector<T> lo(queries), hi(queries);
+  for (unsigned int i=0; i<queries; i++) {
+    lo[i]=sorted[random(sorted.size())];
+    hi[i]=sorted[random(sorted.size())];
+    if (compare(hi[i], lo[i])<0) swap(lo[i], hi[i]);
+  }
+  vector<long long> counts(queries);
+  vector<double> totals(queries);
+  start=monotonicNanos();
+  for (unsigned int i=0; i<queries; i++) {
+    counts[i]=tree.countInRange(lo[i], hi[i]);
+    totals[i]=tree.aggregateRange(lo[i], hi[i]);
+  }
+  double aggregateSeconds=(monotonicNanos()-start)/1e9;
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<queries; i++) {
+    vector<T> result;
+    plain.range(lo[i], hi[i], result);
+    double total=0;
+    for (unsigned int j=0; j<result.size(); j++)
+      total=combine(total, value(result[j]));
+    if ((long long)result.size()!=counts[i] || total!=totals[i]) {
+      cerr << "VALIDATE: Invalid range aggregate." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+  double walkSeconds=(monotonicNanos()-start)/1e9;
+
+  vector<double> values;
+  values.push_back(degree);
+  values.push_back(keys.size());
+  values.push_back(queries);
+  values.push_back(insertSeconds);
+  values.push_back(aggregateInsertSeconds);
+  values.push_back(aggregateSeconds);
+  values.push_back(walkSeconds);
+  report.row(values);
+}
+
+/* Vertaa b-puun erhakua avain kerrallaan tehtyyn hakuun. Puolet
+   hauista osuu puun avaimiin ja puolet ohi, ja haut tehdn satunnaisessa
+   jrjestyksess batchSize avaimen eriss. Tarkistaa, ett molemmat
+   hakutavat antavat samat tulokset. */
+template<typename T> void testSearchBatch(int degree, int batchSize,
+                                          vector<T> &keys,
+                                          int (*compare)(const T &,
+                                                         const T &)) {
+  vector<string> columns;
+  columns.push_back("degree");
+  columns.push_back("keys");
+  columns.push_back("batchSize");
+  columns.push_back("lookups");
+  columns.push_back("searchTime");
+  columns.push_back("batchTime");
+  BenchmarkReport report(false, columns);
+
+  // Joka toinen avain listn puuhun ja loput haetaan ohi osuvina.
+  RandomNumberGenerator random;
+  vector<T> order(keys), inserted;
+  random_shuffle(order.begin(), order.end(), random);
+  BTree<T> tree(degree, compare, 0);
+  for (unsigned int i=0; i<order.size(); i+=2) {
+    tree.insert(order[i]);
+    inserted.push_back(order[i]);
+  }
+  sort(inserted.begin(), inserted.end(), KeyLess<T>(compare));
+  tree.validate(inserted);
+  random_shuffle(order.begin(), order.end(), random);
+
+  vector<bool> expected(order.size());
+  long long start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++) {
+    BTreeNode<T> *node;
+    int index;
+    tree.search(order[i], &node, &index);
+    expected[i]=node!=NULL;
+  }
+  double searchSeconds=(monotonicNanos()-start)/1e9;
+
+  vector<bool> found;
+  found.reserve(order.size());
+  start=monotonicNanos();
+  for (unsigned int first=0; first<order.size(); first+=batchSize) {
+    unsigned int last=first+batchSize;
+    if (last>order.size()) last=order.size();
+    vector<T> batch(order.begin()+first, order.begin()+last);
+    vector<bool> results;
+    tree.searchBatch(batch, results);
+    found.insert(found.end(), results.begin(), results.end());
+  }
+  double batchSeconds=(monotonicNanos()-start)/1e9;
+
+  if (found!=expected) {
+    cerr << "VALIDATE: Invalid batch search result." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  vector<double> values;
+  values.push_back(degree);
+  values.push_back(inserted.size());
+  values.push_back(batchSize);
+  values.push_back(order.size());
+  values.push_back(searchSeconds);
+  values.push_back(batchSeconds);
+  report.row(values);
+}
+
+/* Lis monijoukkoon avaimet kappalemrineen, tarkistaa kappalemrt ja
+   poistaa kaikki kappaleet. Mittaa lisykset, kappalemrien haut ja
+   poistot ja tulostaa rivin raporttiin.
+   factory = sovittimen luova olio, jolla on metodi create(); monijoukko
+             ksitelln sovitettavan rakenteen kautta, koska sovitin
+             ohittaa jo joukossa olevan avaimen lisyksen
+   structure = rakenteen numero raportissa
+   order = listtvt kappaleet sekoitetussa jrjestyksess
+   sorted, copies = avaimet nousevassa jrjestyksess ja niiden
+                    kappalemrt */
+template<typename F, typename T>
+void runMultiset(const F &factory, int structure, const vector<T> &order,
+                 const vector<T> &sorted, const vector<int> &copies,
+                 BenchmarkReport &report) {
+  typename F::Structure *multiset=factory.create();
+  multiset->getStructure().setMultiset(true);
+  long long start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++)
+    multiset->getStructure().insert(order[i]);
+  double insertSeconds=(monotonicNanos()-start)/1e9;
+  multiset->getStructure().validate(sorted);
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<sorted.size(); i++)
+    if (multiset->getStructure().count(sorted[i])!=copies[i]) {
+      cerr << "VALIDATE: Invalid number of copies." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  double countSeconds=(monotonicNanos()-start)/1e9;
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++) multiset->remove(order[i]);
+  double removeSeconds=(monotonicNanos()-start)/1e9;
+  multiset->getStructure().validate(vector<T>());
+  delete multiset;
+
+  vector<double> values;
+  values.push_back(structure);
+  values.push_back(sorted.size());
+  values.push_back(order.size());
+  values.push_back(insertSeconds);
+  values.push_back(countSeconds);
+  values.push_back(removeSeconds);
+  report.row(values);
+}
+
+/* Vertaa b-puun ja hyppylistan monijoukkoja, joissa toistuvan avaimen
+   kappalemr on avaimen solmussa, b-puuhun, johon toistuvat avaimet
+   tallennetaan (avain, jrjestysnumero) -pareina. Kustakin avaimesta
+   listn 1-4 kappaletta satunnaisessa jrjestyksess. Parit pakataan
+   long long -lukuun, jonka ylimmiss biteiss on avain, joten parien
+   vertailu on yht halpa kuin avainten mutta avain on kaksi kertaa
+   suurempi. Rakenteet raportissa: 0=b-puu, 1=hyppylista, 2=b-puu
+   pareilla. */
+void testMultiset(int degree, int level, double probability, int lastKey,
+                  vector<int> &keys, int (*compare)(const int &, const int &),
+                  int (*pairCompare)(const long long &, const long long &)) {
+  vector<string> columns;
+  columns.push_back("structure");
+  columns.push_back("keys");
+  columns.push_back("inserts");
+  columns.push_back("insertTime");
+  columns.push_back("countTime");
+  columns.push_back("removeTime");
+  BenchmarkReport report(false, columns);
+
+  RandomNumberGenerator random;
+  vector<int> sorted(keys), copies(keys.size()), order;
+  sort(sorted.begin(), sorted.end(), KeyLess<int>(compare));
+  for (unsigned int i=0; i<sorted.size(); i++) {
+    copies[i]=1+random(4);
+    for (int j=0; j<copies[i]; j++) order.push_back(sorted[i]);
+  }
+  random_shuffle(order.begin(), order.end(), random);
+
+  runMultiset(BTreeFactory<int>(degree, compare), 0, order, sorted, copies,
+              report);
+  runMultiset(SkipListFactory<int>(level, probability, lastKey, compare), 1,
+              order, sorted, copies, report);
+
+  // Avaimen seuraavan kappaleen jrjestysnumero; poistot poistavat
+  // suurimman jrjestysnumeron.
+  vector<int> sequence(sorted.size(), 0);
+  vector<long long> pairs(order.size());
+  for (unsigned int i=0; i<order.size(); i++) {
+    int k=lower_bound(sorted.begin(), sorted.end(), order[i],
+                      KeyLess<int>(compare))-sorted.begin();
+    pairs[i]=((long long)order[i]<<32)|sequence[k]++;
+  }
+
+  BTree<long long> tree(degree, pairCompare, 0);
+  long long start=monotonicNanos();
+  for (unsigned int i=0; i<pairs.size(); i++) tree.insert(pairs[i]);
+  double insertSeconds=(monotonicNanos()-start)/1e9;
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<sorted.size(); i++) {
+    vector<long long> result;
+    tree.range((long long)sorted[i]<<32,
+               ((long long)sorted[i]<<32)|0xffffffffLL, result);
+    if ((int)result.size()!=copies[i]) {
+      cerr << "VALIDATE: Invalid number of copies." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  }
+  double countSeconds=(monotonicNanos()-start)/1e9;
+
+  start=monotonicNanos();
+  for (unsigned int i=0; i<order.size(); i++) {
+    int k=lower_bound(sorted.begin(), sorted.end(), order[i],
+                      KeyLess<int>(compare))-sorted.begin();
+    tree.remove(((long long)order[i]<<32)|--sequence[k]);
+  }
+  double removeSeconds=(monotonicNanos()-start)/1e9;
+  tree.validate(vector<long long>());
+
+  vector<double> values;
+  values.push_back(2);
+  values.push_back(sorted.size());
+  values.push_back(order.size());
+  values.push_back(insertSeconds);
+  values.push_back(countSeconds);
+  values.push_back(removeSeconds);
+  report.row(values);
+}
+
+/* Kalibroinnin mittausten mrt. Kalibroinnin on oltava lyhyt, joten
+   kukin ehdokas mitataan vain muutaman kerran. */
+#define TUNE_WARMUP 1
+#define TUNE_REPETITIONS 3
+
+/* Tiedosto, johon viritetyt parametrit tallennetaan, kun rakenteen
+   parametreiksi annetaan "auto". */
+#define TUNING_FILE "tuning.txt"
+
+/* Mittaa rakenteen lyhyesti ja palauttaa lisys-, haku- ja
+   poistovaiheiden mediaanien summan sekunteina.
+   factory = rakenteen luova olio */
+template<typename T, typename F> double calibrate(const F &factory,
+                                                  const vector<T> &keys) {
+  BenchmarkSummary summary[3];
+  LatencyHistogram latency[3];
+  MemoryUsage memory;
+  long long heapBytes;
+  benchmark(factory, keys, TUNE_WARMUP, TUNE_REPETITIONS, &summary[0],
+            &summary[1], &summary[2], &latency[0], &latency[1], &latency[2],
+            NULL, &memory, &heapBytes);
+  return summary[0].median+summary[1].median+summary[2].median;
+}
+
+/* Palauttaa avaimille viritetyn b-puun asteen. Tallennettu aste
+   palautetaan kalibroimatta. Muuten mitataan ensin harva joukko asteita
+   vlilt 2...128 ja sitten parhaan asteen naapurien vli tihemmin, ja
+   paras aste tallennetaan.
+   keyType = avaintyypin nimi
+   file = tallennetut parametrit
+   retune = true=kalibroidaan, vaikka aste olisi tallennettu
+   calibrated = palautetaan true, jos aste kalibroitiin */
+template<typename T> int tuneBTree(const vector<T> &keys,
+                                   int (*compare)(const T &, const T &),
+                                   const string &keyType, TuningFile &file,
+                                   bool retune, bool *calibrated) {
+  string name=tuningName("btree", keyType, sizeof(T), keys.size(),
+                         "degree");
+  double value;
+  *calibrated=retune || !file.get(name, &value);
+  if (!*calibrated) return (int)value;
+
+  const int degrees[]={2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128};
+  const int count=sizeof(degrees)/sizeof(degrees[0]);
+  int best=0;
+  double bestTime=0;
+  for (int i=0; i<count; i++) {
+    double time=calibrate(BTreeFactory<T>(degrees[i], compare), keys);
+    if (i==0 || time<bestTime) {
+      best=i;
+      bestTime=time;
+    }
+  }
+
+  // Tarkennetaan parhaan asteen ymprilt enintn kahdeksalla
+  // vlipisteell kummallakin puolella.
+  int degree=degrees[best];
+  int lo=degrees[best>0 ? best-1 : 0], hi=degrees[best<count-1 ? best+1 :
+                                                  count-1];
+  int step=(hi-lo)/16>1 ? (hi-lo)/16 : 1;
+  for (int d=lo+1; d<hi; d+=step) {
+    if (d==degrees[best]) continue;
+    double time=calibrate(BTreeFactory<T>(d, compare), keys);
+    if (time<bestTime) {
+      degree=d;
+      bestTime=time;
+    }
+  }
+
+  file.set(name, degree);
+  if (!file.save()) {
+    cerr << "Could not write tuning file." << endl;
+    raise(SIGABRT);
+  }
+  return degree;
+}
+
+/* Palauttaa avaimille viritetyn hyppylistan maksimitason ja
+   todennkisyyden. Tallennetut arvot palautetaan kalibroimatta. Muuten
+   mitataan todennkisyydet 0.25, 1/e, 0.5 ja 0.7 ja kullekin tasot
+   log_1/p(n)-1...log_1/p(n)+1, ja parhaat arvot tallennetaan.
+   lastKey = suurempi kuin mikn listtv avain
+   keyType = avaintyypin nimi
+   file = tallennetut parametrit
+   retune = true=kalibroidaan, vaikka arvot olisi tallennettu
+   level, probability = arvot palautetaan nihin
+   calibrated = palautetaan true, jos arvot kalibroitiin */
+template<typename T> void tuneSkipList(const vector<T> &keys,
+                                       const T &lastKey,
+                                       int (*compare)(const T &, const T &),
+                                       const string &keyType,
+                                       TuningFile &file, bool retune,
+                                       int *level, double *probability,
+                                       bool *calibrated) {
+  string levelName=tuningName("skiplist", keyType, sizeof(T), keys.size(),
+                              "level");
+  string probabilityName=tuningName("skiplist", keyType, sizeof(T),
+                                    keys.size(), "probability");
+  double levelValue, probabilityValue;
+  *calibrated=retune || !file.get(levelName, &levelValue)
+    || !file.get(probabilityName, &probabilityValue);
+  if (!*calibrated) {
+    *level=(int)levelValue;
+    *probability=probabilityValue;
+    return;
+  }
+
+  const double probabilities[]={0.25, 0.367879, 0.5, 0.7};
+  double bestTime=-1;
+  for (int i=0; i<4; i++) {
+    int expected=keys.size()>1 ?
+      (int)ceil(log((double)keys.size())/log(1/probabilities[i])) : 1;
+    for (int l=expected-1; l<=expected+1; l++) {
+      if (l<1) continue;
+      double time=calibrate(SkipListFactory<T>(l, probabilities[i], lastKey,
+                                               compare), keys);
+      if (bestTime<0 || time<bestTime) {
+        *level=l;
+        *probability=probabilities[i];
+        bestTime=time;
+      }
+    }
+  }
+
+  file.set(levelName, *level);
+  file.set(probabilityName, *probability);
+  if (!file.save()) {
+    cerr << "Could not write tuning file." << endl;
+    raise(SIGABRT);
+  }
+}
+
+/* Palauttaa kuorman tietueiden avaimet, joilla rakenne kalibroidaan. */
+void workloadKeys(const WorkloadConfig &config, vector<int> &keys) {
+  WorkloadGenerator generator(config, 0);
+  for (int i=0; i<config.records; i++) keys.push_back(generator.keyOf(i));
+}
+
+/* Lis avaimet rakenteeseen ja tulostaa sen muistinkytn erittelyn
+   CSV-muodossa. Erittelyn jlkeen tulostetaan yhteissumma (total) sek
+   rakenteen kekomuistin todellinen kytt (heap), jonka hukka sislt
+   mys muistinvaraajan pyristykset ja kirjanpidon. */
+template<typename T, typename S> void testMemory(S &structure,
+                                                 const vector<T> &keys) {
+  AllocationHooks hooks=setAllocationHooks(countingAllocationHooks());
+  long long heapStart=getHeapBytes();
+  for (unsigned int i=0; i<keys.size(); i++) structure.insert(keys[i]);
+  long long heapBytes=getHeapBytes()-heapStart;
+  setAllocationHooks(hooks);
+
+  MemoryUsage usage;
+  structure.memoryUsage(usage);
+  usage.print(cout);
+  long long nodes=0;
+  for (int i=0; i<usage.size(); i++) nodes+=usage.getEntry(i).nodes;
+  cout << "total," << nodes << "," << usage.getLive() << ","
+       << usage.getAllocated() << "," << usage.getSlack() << endl;
+  cout << "heap," << nodes << "," << usage.getLive() << "," << heapBytes
+       << "," << heapBytes-usage.getLive() << endl;
+}
+
+/* Suorittaa kuorman rakenteelle. Rakenne esitytetn ensin kuorman
+   tietueilla ajanoton ulkopuolella, mink jlkeen operaatioita
+   suoritetaan, kunnes annettu mr on tynn tai aika on kulunut. Aikaa
+   tarkistetaan 1024 operaation vlein. Tulostaa operaatioiden mrn,
+   keston ja lpisyn sek kunkin operaatiotyypin mrn ja viiveiden
+   persentiilit.
+   values = rivin parametrisarakkeet
+   columns = parametrisarakkeiden nimet */
+template<typename S> void testWorkload(S &structure,
+                                       const WorkloadConfig &config,
+                                       vector<double> &values,
+                                       vector<string> &columns) {
+  const char *operations[]={"insert", "search", "remove", "scan"};
+  WorkloadGenerator generator(config, RandomNumberGenerator().getSeed());
+  LatencyHistogram latency[WORKLOAD_OPERATIONS];
+  long long counts[WORKLOAD_OPERATIONS]={0, 0, 0, 0};
+  long long found=0, scanned=0;
+  vector<int> result;
+  int key;
+
+  while (generator.nextPrepopulate(&key)) structure.insert(key);
+
+  long long limit=config.operations>0 ? config.operations : -1;
+  long long deadline=config.duration>0 ?
+    monotonicNanos()+(long long)(config.duration*1e9) : -1;
+  long long start=monotonicNanos(), previous=start, now, done=0;
+  for (; done!=limit; done++) {
+    if ((done&1023)==0 && deadline>=0 && previous>=deadline) break;
+    WorkloadOperation operation=generator.next();
+    switch (operation.type) {
+    case WORKLOAD_INSERT:
+      structure.insert(operation.key);
+      break;
+    case WORKLOAD_SEARCH:
+      if (structure.contains(operation.key)) found++;
+      break;
+    case WORKLOAD_REMOVE:
+      structure.remove(operation.key);
+      break;
+    default:
+      result.clear();
+      structure.range(operation.key, operation.hi, result);
+      scanned+=result.size();
+    }
+    now=monotonicNanos();
+    latency[operation.type].record(now-previous);
+    counts[operation.type]++;
+    previous=now;
+  }
+  double seconds=(previous-start)/1e9;
+
+  columns.push_back("records");
+  columns.push_back("operations");
+  columns.push_back("seconds");
+  columns.push_back("opsPerSecond");
+  columns.push_back("found");
+  columns.push_back("scanned");
+  values.push_back(config.records);
+  values.push_back(done);
+  values.push_back(seconds);
+  values.push_back(seconds>0 ? done/seconds : 0);
+  values.push_back(found);
+  values.push_back(scanned);
+  for (int i=0; i<WORKLOAD_OPERATIONS; i++) {
+    columns.push_back(string(operations[i])+"Count");
+    values.push_back(counts[i]);
+    BenchmarkReport::addLatencyColumns(columns, operations[i]);
+    BenchmarkReport::addLatency(values, latency[i]);
+  }
+  BenchmarkReport report(false, columns);
+  report.row(values);
+}
+
+#ifdef STRUCTURE_TRACE
+/* Suorittaa kuorman rakenteelle ja tulostaa sen jlkeen rakenteen
+   tapahtumalaskurit. Laskurit sisltvt mys esitytn tapahtumat.
+   ringSize = rengaspuskurin koko tietueina, 0=ei puskuria
+   dumpFile = tiedosto, johon rengaspuskuri kirjoitetaan */
+template<typename S> void testTrace(S &structure,
+                                    const WorkloadConfig &config,
+                                    int ringSize, const char *dumpFile,
+                                    vector<double> &values,
+                                    vector<string> &columns) {
+  structure.getTrace().enableRing(ringSize);
+  testWorkload(structure, config, values, columns);
+  structure.getTrace().print(cout);
+  if (ringSize>0 && !structure.getTrace().dump(dumpFile)) {
+    cerr << "Could not write trace file '" << dumpFile << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+}
+#endif
+
+/* Tarkistaa, ett vedoksesta lytyvt kaikki avaimet ja ett koko
+   avainvlin kattava vlihaku palauttaa ne jrjestyksess. */
+template<typename T, typename S> void validateSnapshot(const S *snapshot,
+                                                       vector<T> keys,
+                                                       int (*compare)(
+                                                         const T &,
+                                                         const T &)) {
+  if (snapshot->size()!=(long long)keys.size()) {
+    cerr << "VALIDATE: Wrong number of keys in snapshot." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  for (unsigned int i=0; i<keys.size(); i++)
+    if (!snapshot->search(keys[i])) {
+      cerr << "VALIDATE: Missing key in snapshot." << endl;
+      raise(SIGABRT);
+      return;
+    }
+  if (keys.empty()) return;
+
+  sort(keys.begin(), keys.end());
+  vector<T> result;
+  snapshot->range(keys.front(), keys.back(), result);
+  for (unsigned int i=0; i<keys.size(); i++)
+    if (i>=result.size() || compare(result[i], keys[i])!=0) {
+      cerr << "VALIDATE: Invalid range scan in snapshot." << endl;
+      raise(SIGABRT);
+      return;
+    }
+}
+
+/* Tallentaa puun ja listan vedokset, liitt ne muistiin ja mittaa
+   tallentamiseen, avaamiseen ja kaikkien avainten hakemiseen kuluvan
+   ajan. */
+template<typename T> void testSnapshot(int degree, int level,
+                                       double probability, const T &lastKey,
+                                       vector<T> &keys,
+                                       int (*compare)(const T &, const T &)) {
+  RandomNumberGenerator random;
+  const char *btreeFile="btree.snapshot", *skipListFile="skiplist.snapshot";
+  clock_t start, end;
+
+  BTree<T> tree(degree, compare, 0);
+  SkipList<T> list(level, probability, lastKey, compare, 0);
+  random_shuffle(keys.begin(), keys.end(), random);
+  for (unsigned int i=0; i<keys.size(); i++) {
+    tree.insert(keys[i]);
+    list.insert(keys[i]);
+  }
+
+  cout << degree << "," << level << "," << probability << ","
+       << keys.size() << "," << flush;
+
+  start=clock();
+  tree.save(btreeFile);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << "," << flush;
+
+  start=clock();
+  BTreeSnapshot<T> *btreeSnapshot=BTree<T>::openReadOnly(btreeFile, compare);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << "," << flush;
+
+  start=clock();
+  validateSnapshot(btreeSnapshot, keys, compare);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << "," << flush;
+  delete btreeSnapshot;
+
+  start=clock();
+  list.save(skipListFile);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << "," << flush;
+
+  start=clock();
+  SkipListSnapshot<T> *skipListSnapshot=
+    SkipList<T>::openReadOnly(skipListFile, compare);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << "," << flush;
+
+  start=clock();
+  validateSnapshot(skipListSnapshot, keys, compare);
+  end=clock();
+  cout << (end-start)/(double)CLOCKS_PER_SEC << endl;
+  delete skipListSnapshot;
+
+  remove(btreeFile);
+  remove(skipListFile);
+}
+
+/* Testaa puun lokia: lis puolet avaimista, tallentaa vedoksen, lis
+   loput avaimet ja poistaa neljnneksen. Tmn jlkeen palauttaa uuden puun
+   vedoksesta ja lokista ja tarkistaa, ett se sislt samat avaimet.
+   Tulostaa kestvien operaatioiden mrn sekunnissa sek levylle vientien
+   mrn ja keston. */
+template<typename T> void testLog(int degree, long long windowMicros,
+                                  int windowBytes, vector<T> &keys,
+                                  int (*compare)(const T &, const T &)) {
+  RandomNumberGenerator random;
+  const char *logFile="btree.wal", *snapshotFile="btree.snapshot";
+
+  random_shuffle(keys.begin(), keys.end(), random);
+  unsigned int half=keys.size()/2, quarter=keys.size()/4;
+
+  BTree<T> tree(degree, compare, 0);
+  WriteAheadLog *log=new WriteAheadLog(logFile, sizeof(T), windowMicros,
+                                       windowBytes, true);
+  tree.setLog(log);
+
+  long long start=monotonicMicros();
+  for (unsigned int i=0; i<half; i++) tree.insert(keys[i]);
+  tree.checkpoint(snapshotFile);
+  for (unsigned int i=half; i<keys.size(); i++) tree.insert(keys[i]);
+  for (unsigned int i=0; i<quarter; i++) tree.remove(keys[i]);
+  log->commit();
+  long long end=monotonicMicros();
+
+  long long ops=keys.size()+quarter;
+  double seconds=(end-start)/1000000.0;
+  cout << degree << "," << windowMicros << "," << windowBytes << ","
+       << ops << "," << (seconds>0 ? ops/seconds : 0) << ","
+       << log->getCommits() << ","
+       << (log->getCommits()>0 ?
+           double(log->getCommitMicros())/log->getCommits() : 0) << ","
+       << log->getMaxCommitMicros() << ","
+       << (log->getRecords()>0 ?
+           double(log->getWaitMicros())/log->getRecords() : 0) << endl;
+  tree.setLog(NULL);
+  delete log;
+
+  // Palautetaan puu kuin prosessi olisi kaatunut.
+  BTree<T> recovered(degree, compare, 0);
+  recovered.recover(snapshotFile, logFile);
+  vector<T> expected(keys.begin()+quarter, keys.end());
+  recovered.validate(expected);
+  tree.validate(expected);
+
+  remove(logFile);
+  remove(snapshotFile);
+}
+
+/* Lukee operaatiot sytevirrasta ja suorittaa ne sit mukaa, kun niit
+   luetaan. Rivit ovat muotoa "I avain" (lisys), "R avain" (poisto),
+   "S avain" (haku) tai "Q alaraja ylraja" (vlihaku). Jo olemassa olevan
+   avaimen lisys ohitetaan. Tulostaa operaatioiden lukumrt ja
+   kuluneen ajan. */
+template<typename T, typename S> void testStream(S &structure,
+                                                 const char *fileName) {
+  LineStream stream(fileName, 65536);
+  long long inserts=0, removes=0, searches=0, found=0, queries=0,
+    rangeKeys=0, skipped=0;
+  vector<T> result;
+  string buffer;
+  int line=1;
+
+  bool valid=true;
+  clock_t start=clock();
+  for (; valid && stream.nextLine(buffer); line++) {
+    stringstream ss(buffer);
+    char op;
+    T key, hi;
+    if (!(ss >> op)) continue;
+
+    if (op=='Q') {
+      if (!(ss >> key >> hi)) valid=false;
+      else {
+        result.clear();
+        structure.range(key, hi, result);
+        rangeKeys+=result.size();
+        queries++;
+      }
+    }
+    else if (!(ss >> key)) valid=false;
+    else if (op=='I') {
+      if (structure.contains(key)) skipped++;
+      else structure.insert(key);
+      inserts++;
+    }
+    else if (op=='R') {
+      structure.remove(key);
+      removes++;
+    }
+    else if (op=='S') {
+      if (structure.contains(key)) found++;
+      searches++;
+    }
+    else valid=false;
+  }
+  clock_t end=clock();
+
+  if (!valid) {
+    cerr << "Invalid operation in input on line " << line-1 << "." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  cout << inserts << "," << skipped << "," << removes << "," << searches
+       << "," << found << "," << queries << "," << rangeKeys << ","
+       << (end-start)/(double)CLOCKS_PER_SEC << endl;
+}
+
+/* Vertailee kokonaislukuavaimia. */
+inline int intCompare(const int &a, const int &b) {
+  if (a<b) return -1;
+  if (a>b) return 1;
+  return 0;
+}
+
+/* Vertailee pakattuja (avain, jrjestysnumero) -pareja. */
+inline int longLongCompare(const long long &a, const long long &b) {
+  if (a<b) return -1;
+  if (a>b) return 1;
+  return 0;
+}
+
+/* Vertailee merkkijonoavaimia. */
+inline int stringCompare(const string &a, const string &b) {
+  return a.compare(b);
+}
+
+/* Vertailee merkkiavaimia. */
+inline int charCompare(const char &a, const char &b) {
+  if (a<b) return -1;
+  if (a>b) return 1;
+  return 0;
+}
+
+/* Palauttaa kokonaislukuavaimen arvon koosteessa. */
+inline double intValue(const int &key) {
+  return key;
+}
+
+/* Yhdist koosteet summaksi. */
+inline double sumCombine(double a, double b) {
+  return a+b;
+}
+
+/*
+  btree = testaa b-puuta
+  skiplist = testaa hyppylistaa
+  pagedbtree = testaa levylle tallennettavaa b-puuta
+  compressed = testaa pakattujen lehtien b-puuta
+  buffered = testaa puskuroitua b-puuta (B^e-puu) tarkistettuaan sen ensin
+             pienill asteilla ja puskureilla
+  strings = testaa merkkijonoavainten b-puuta
+  frozen = vertaa jdytetyn b-puun hakuja puun hakuihin
+  bench = mittaa b-puun kaikki asteet tai hyppylistan kaikki tasot ja
+          todennkisyydet toistetusti yhdess prosessissa; set ja vector
+          mittaavat vertailukohtina std::set-joukon ja jrjestetyn
+          vektorin
+  fill = vertaa b-puun tyttastetta ja kokoa, kun tysi solmu puolitetaan
+         tai kun avaimia siirretn sisarille ja tydet sisarukset
+         jaetaan kolmeen (B*-puu)
+  setops = vertaa b-puun ja hyppylistan yhdisteen, leikkauksen ja erotuksen
+           yhdell lpikynnill tehty toteutusta avain kerrallaan
+           tehtyyn
+  splitjoin = vertaa b-puun ja hyppylistan jakamista ja liittmist
+              avainten poistamiseen yksitellen
+  aggregate = vertaa koosteellisen b-puun vlikyselyj vlin avainten
+              lpikyntiin ja lisyksi tavalliseen b-puuhun
+  batch = vertaa b-puun erhakua, jossa useat haut etenevt rinnakkain
+          esihakien solmunsa, avain kerrallaan tehtyyn hakuun
+  multiset = vertaa b-puun ja hyppylistan monijoukkoja, joissa toistuvien
+             avainten kappalemrt ovat solmuissa, b-puuhun, jossa
+             toistuvat avaimet ovat (avain, jrjestysnumero) -pareina
+  lazyremove = vertaa b-puun vlittmn ja laiskan (haudattavan) poiston
+               viiveit
+  tune = valitsee b-puun asteen tai hyppylistan maksimitason ja
+         todennkisyyden lyhyell kalibrointimittauksella ja tallentaa
+         ne tiedostoon; tallennetut arvot tulostetaan kalibroimatta, ellei
+         anneta retune
+  memory = tulostaa rakenteen muistinkytn solmutyypeittin ja tasoittain
+  workload = suorittaa YCSB-tyylisen kuorman b-puulle, puskuroidulle
+             b-puulle, hyppylistalle, std::set-joukolle tai jrjestetylle
+             vektorille; b-puun asteeksi tai hyppylistan tasoksi ja
+             todennkisyydeksi voi antaa auto, jolloin ne viritetn
+             kuorman tietueilla ja tallennetaan tiedostoon tuning.txt
+  trace = suorittaa kuorman kuten workload ja tulostaa rakenteen
+          tapahtumalaskurit; vaatii knnksen make TRACE=-DSTRUCTURE_TRACE
+  snapshot = testaa b-puun ja hyppylistan vedoksia
+  wal = testaa b-puun lokia ja sen palauttamista
+  stream = suorittaa tiedostosta tai vakiosytteest (-) luettavat
+           operaatiot b-puulle, hyppylistalle, std::set-joukolle tai
+           jrjestetylle vektorille
+  selftest
+
+  degree = b-puun aste. oltava >=2
+  iterations = luotavien puiden/listojen mr (=iteraatioiden mr)
+  keys_file = tiedosto, josta avaimet luetaan
+  level = hyppylistan maksimitaso
+  probability = todennkisyys, jolla solmujen taso valitaan
+  page_size = levylle tallennettavan b-puun sivun koko tavuina,
+              4096-65536; mr puun asteen
+  memory_kb = puskurivarannon koko kilotavuina
+  leaf_bytes = pakatun lehden avaimille varattu tavumr, >=16
+  buffer_size = puskuroidun b-puun sissolmun puskurin koko viestein, >=1
+  window_us = lokin aikaikkuna mikrosekunteina
+  window_bytes = lokin kokoikkuna tavuina
+  warmup = mittaukset, joiden tulokset hyltn
+  repetitions = mittausten mr kutakin parametria kohden
+  perf = raportoi suorituskykylaskurit (kellojaksot, kskyt, vlimuisti-,
+         hyppy- ja dTLB-hudit) operaatiota kohden
+  workload_spec = kuorman asetukset muotoa "nimi=arvo,..." (ks.
+                  workload.h), esim. "insert=.5,search=.5,dist=latest"
+  ring_size = tapahtumien rengaspuskurin koko, 0=ei puskuria
+  trace_file = tiedosto, johon rengaspuskuri kirjoitetaan
+  tuning_file = tiedosto, johon viritetyt parametrit tallennetaan
+  compact_interval = laiskojen poistojen mr tiivistysten vlill
+  compact_budget = tiivistyksen kerralla poistamien haudattujen avainten
+                   mr
+  debug_level = 0=ei debug-tulostusta,
+                1=tulostaa rakenteet kaikkien avainten lisysten ja poistojen
+                  jlkeen
+                2=tulostaa rakenteet jokaisen avaimen lisyksen ja poiston
+                  jlkeen
+                3=lausekattavuustulostus
+  validate_every = debug-tasoilla 1-4 rakenne tarkistetaan joka
+                   validate_every:nnen operaation ja viimeisen operaation
+                   jlkeen, oletus 1
+*/
+void usage(const char *self) {
+  cerr << "Usage: " << self << " btree <degree> <iterations>"
+       << " <keys_file> <debug_level> [validate_every]" << endl;
+  cerr << "       " << self << " skiplist <level> <probability>"
+       << " <iterations> <keys_file> <debug_level> [validate_every]"
+       << endl;
+  cerr << "       " << self << " pagedbtree <page_size> <memory_kb>"
+       << " <iterations> <keys_file> <debug_level>" << endl;
+  cerr << "       " << self << " compressed <degree> <leaf_bytes>"
+       << " <iterations> <keys_file> <debug_level>" << endl;
+  cerr << "       " << self << " buffered <degree> <buffer_size>"
+       << " <iterations> <keys_file> <debug_level>" << endl;
+  cerr << "       " << self << " strings <degree> <iterations>"
+       << " <keys_file> <debug_level>" << endl;
+  cerr << "       " << self << " frozen <degree> <iterations> <keys_file>"
+       << endl;
+  cerr << "       " << self << " bench btree|skiplist|set|vector <keys_file>"
+       << " <warmup> <repetitions> csv|json [perf]" << endl;
+  cerr << "       " << self << " fill <degree> <keys_file>" << endl;
+  cerr << "       " << self << " setops <degree> <level> <probability>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " splitjoin <degree> <level> <probability>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " aggregate <degree> <keys_file>" << endl;
+  cerr << "       " << self << " batch <degree> <batch_size> <keys_file>"
+       << endl;
+  cerr << "       " << self << " multiset <degree> <level> <probability>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " lazyremove <degree> <keys_file>"
+       << " <repetitions> <compact_interval> <compact_budget>" << endl;
+  cerr << "       " << self << " tune btree|skiplist <keys_file>"
+       << " <tuning_file> [retune]" << endl;
+  cerr << "       " << self << " memory btree <degree> <keys_file>"
+       << endl;
+  cerr << "       " << self << " memory skiplist <level> <probability>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " memory set|vector <keys_file>" << endl;
+  cerr << "       " << self << " workload btree <degree>|auto"
+       << " <workload_spec>" << endl;
+  cerr << "       " << self << " workload buffered <degree> <buffer_size>"
+       << " <workload_spec>" << endl;
+  cerr << "       " << self << " workload skiplist <level> <probability>"
+       << " <workload_spec>" << endl;
+  cerr << "       " << self << " workload skiplist auto auto"
+       << " <workload_spec>" << endl;
+  cerr << "       " << self << " workload set|vector <workload_spec>"
+       << endl;
+  cerr << "       " << self << " trace btree <degree> <ring_size>"
+       << " <trace_file> <workload_spec>" << endl;
+  cerr << "       " << self << " trace skiplist <level> <probability>"
+       << " <ring_size> <trace_file> <workload_spec>" << endl;
+  cerr << "       " << self << " snapshot <degree> <level> <probability>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " wal <degree> <window_us> <window_bytes>"
+       << " <keys_file>" << endl;
+  cerr << "       " << self << " stream btree <degree> <operations_file>"
+       << endl;
+  cerr << "       " << self << " stream skiplist <level> <probability>"
+       << " <operations_file>" << endl;
+  cerr << "       " << self << " stream set|vector <operations_file>"
+       << endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc<2) {
+    cerr << "Invalid arguments." << endl;
+    usage(argv[0]);
+    return -1;
+  }
+
+  string test(argv[1]);
+  //transform(test.begin(), test.end(), test.begin(), tolower);
+
+  if ((argc==6 || argc==7) && test=="btree") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[5]),
+      ss4(argc==7 ? argv[6] : "1");
+    int degree, iterations, debug, validateEvery;
+    if (!(ss1 >> degree) || !(ss2 >> iterations) || !(ss3 >> debug)
+        || !(ss4 >> validateEvery) || validateEvery<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[4], keys);
+    testBTree(degree, iterations, keys, &intCompare, debug, validateEvery);
+  }
+  else if ((argc==7 || argc==8) && test=="skiplist") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]), ss4(argv[6]),
+      ss5(argc==8 ? argv[7] : "1");
+    int level, iterations, debug, validateEvery;
+    double probability;
+    if (!(ss1 >> level) || !(ss2 >> probability) || !(ss3 >> iterations)
+        || !(ss4 >> debug) || !(ss5 >> validateEvery) || validateEvery<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testSkipList(level, probability, 0x7fffffff, iterations, keys,
+                 &intCompare, debug, validateEvery);
+  }
+  else if (argc==7 && test=="pagedbtree") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]), ss4(argv[6]);
+    int pageSize, memory, iterations, debug;
+    if (!(ss1 >> pageSize) || !(ss2 >> memory) || !(ss3 >> iterations)
+        || !(ss4 >> debug) || pageSize<4096 || pageSize>65536
+        || memory*1024/pageSize<4) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testPagedBTree(pageSize, memory, iterations, keys, &intCompare, debug);
+  }
+  else if (argc==7 && test=="compressed") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]), ss4(argv[6]);
+    int degree, leafBytes, iterations, debug;
+    if (!(ss1 >> degree) || !(ss2 >> leafBytes) || !(ss3 >> iterations)
+        || !(ss4 >> debug) || degree<2 || leafBytes<16) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testCompressedBTree(degree, leafBytes, iterations, keys, debug);
+  }
+  else if (argc==7 && test=="buffered") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]), ss4(argv[6]);
+    int degree, bufferSize, iterations, debug;
+    if (!(ss1 >> degree) || !(ss2 >> bufferSize) || !(ss3 >> iterations)
+        || !(ss4 >> debug) || degree<2 || bufferSize<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    checkBufferedBTree(keys, &intCompare);
+    testBufferedBTree(degree, bufferSize, iterations, keys, &intCompare,
+                      debug);
+  }
+  else if (argc==6 && test=="strings") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[5]);
+    int degree, iterations, debug;
+    if (!(ss1 >> degree) || !(ss2 >> iterations) || !(ss3 >> debug)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<string> keys;
+    readKeys(argv[4], keys);
+    testStringBTree(degree, iterations, keys, &stringCompare, debug);
+  }
+  else if (argc==5 && test=="frozen") {
+    stringstream ss1(argv[2]), ss2(argv[3]);
+    int degree, iterations;
+    if (!(ss1 >> degree) || !(ss2 >> iterations)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[4], keys);
+    testFrozen(degree, iterations, keys, &intCompare);
+  }
+  else if ((argc==7 || argc==8) && test=="bench" &&
+           (string(argv[2])=="btree" || string(argv[2])=="skiplist" ||
+            string(argv[2])=="set" || string(argv[2])=="vector")) {
+    stringstream ss1(argv[4]), ss2(argv[5]);
+    string format(argv[6]);
+    bool counters=argc==8 && string(argv[7])=="perf";
+    int warmup, repetitions;
+    if (!(ss1 >> warmup) || !(ss2 >> repetitions) || warmup<0
+        || repetitions<1 || (format!="csv" && format!="json")
+        || (argc==8 && !counters)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    testBench(argv[2], keys, warmup, repetitions, format=="json", counters,
+              &intCompare);
+  }
+  else if (argc==4 && test=="fill") {
+    stringstream ss1(argv[2]);
+    int degree;
+    if (!(ss1 >> degree) || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    testFill(degree, keys, &intCompare);
+  }
+  else if (argc==6 && test=="setops") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]);
+    int degree, level;
+    double probability;
+    if (!(ss1 >> degree) || !(ss2 >> level) || !(ss3 >> probability)
+        || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testSetOps(degree, level, probability, 0x7fffffff, keys, &intCompare);
+  }
+  else if (argc==6 && test=="splitjoin") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]);
+    int degree, level;
+    double probability;
+    if (!(ss1 >> degree) || !(ss2 >> level) || !(ss3 >> probability)
+        || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testSplitJoin(degree, level, probability, 0x7fffffff, keys,
+                  &intCompare);
+  }
+  else if (argc==6 && test=="multiset") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]);
+    int degree, level;
+    double probability;
+    if (!(ss1 >> degree) || !(ss2 >> level) || !(ss3 >> probability)
+        || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testMultiset(degree, level, probability, 0x7fffffff, keys, &intCompare,
+                 &longLongCompare);
+  }
+  else if (argc==4 && test=="aggregate") {
+    stringstream ss1(argv[2]);
+    int degree;
+    if (!(ss1 >> degree) || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    testAggregate(degree, keys, &intCompare, &intValue, &sumCombine);
+  }
+  else if (argc==5 && test=="batch") {
+    stringstream ss1(argv[2]), ss2(argv[3]);
+    int degree, batchSize;
+    if (!(ss1 >> degree) || !(ss2 >> batchSize) || degree<2
+        || batchSize<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[4], keys);
+    testSearchBatch(degree, batchSize, keys, &intCompare);
+  }
+  else if (argc==7 && test=="lazyremove") {
+    stringstream ss1(argv[2]), ss2(argv[4]), ss3(argv[5]), ss4(argv[6]);
+    int degree, repetitions, compactInterval, compactBudget;
+    if (!(ss1 >> degree) || !(ss2 >> repetitions)
+        || !(ss3 >> compactInterval) || !(ss4 >> compactBudget)
+        || degree<2 || repetitions<1 || compactInterval<1
+        || compactBudget<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    testLazyRemove(degree, keys, repetitions, compactInterval,
+                   compactBudget, &intCompare);
+  }
+  else if ((argc==5 || argc==6) && test=="tune"
+           && (string(argv[2])=="btree" || string(argv[2])=="skiplist")) {
+    if (argc==6 && string(argv[5])!="retune") {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    TuningFile file(argv[4]);
+    bool calibrated;
+    if (string(argv[2])=="btree") {
+      int degree=tuneBTree(keys, &intCompare, "int", file, argc==6,
+                           &calibrated);
+      cout << "degree,calibrated" << endl;
+      cout << degree << "," << calibrated << endl;
+    }
+    else {
+      int level;
+      double probability;
+      tuneSkipList(keys, 0x7fffffff, &intCompare, "int", file, argc==6,
+                   &level, &probability, &calibrated);
+      cout << "level,probability,calibrated" << endl;
+      cout << level << "," << probability << "," << calibrated << endl;
+    }
+  }
+  else if (argc==5 && test=="memory" && string(argv[2])=="btree") {
+    stringstream ss1(argv[3]);
+    int degree;
+    if (!(ss1 >> degree) || degree<2) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[4], keys);
+    BTreeSet<int> tree(degree, &intCompare);
+    testMemory(tree, keys);
+  }
+  else if (argc==6 && test=="memory" && string(argv[2])=="skiplist") {
+    stringstream ss1(argv[3]), ss2(argv[4]);
+    int level;
+    double probability;
+    if (!(ss1 >> level) || !(ss2 >> probability) || level<1) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    SkipListSet<int> list(level, probability, 0x7fffffff, &intCompare);
+    testMemory(list, keys);
+  }
+  else if (argc==4 && test=="memory" &&
+           (string(argv[2])=="set" || string(argv[2])=="vector")) {
+    vector<int> keys;
+    readKeys(argv[3], keys);
+    if (string(argv[2])=="set") {
+      StdSet<int> set(&intCompare);
+      testMemory(set, keys);
+    }
+    else {
+      SortedVectorSet<int> sorted(&intCompare);
+      testMemory(sorted, keys);
+    }
+  }
+  else if (argc==5 && test=="workload" && string(argv[2])=="btree") {
+    stringstream ss1(argv[3]);
+    int degree=0;
+    WorkloadConfig config;
+    bool tune=string(argv[3])=="auto";
+    if ((!tune && (!(ss1 >> degree) || degree<2)) || !config.parse(argv[4])) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    if (tune) {
+      vector<int> keys;
+      workloadKeys(config, keys);
+      TuningFile file(TUNING_FILE);
+      bool calibrated;
+      degree=tuneBTree(keys, &intCompare, "int", file, false, &calibrated);
+    }
+
+    BTreeSet<int> tree(degree, &intCompare);
+    vector<string> columns(1, "degree");
+    vector<double> values(1, degree);
+    testWorkload(tree, config, values, columns);
+  }
+  else if (argc==6 && test=="workload" && string(argv[2])=="buffered") {
+    stringstream ss1(argv[3]), ss2(argv[4]);
+    int degree, bufferSize;
+    WorkloadConfig config;
+    if (!(ss1 >> degree) || !(ss2 >> bufferSize) || degree<2
+        || bufferSize<1 || !config.parse(argv[5])) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    BufferedBTreeSet<int> tree(degree, bufferSize, &intCompare);
+    vector<string> columns(1, "degree");
+    vector<double> values(1, degree);
+    columns.push_back("buffer_size");
+    values.push_back(bufferSize);
+    testWorkload(tree, config, values, columns);
+  }
+  else if (argc==6 && test=="workload" && string(argv[2])=="skiplist") {
+    stringstream ss1(argv[3]), ss2(argv[4]);
+    int level=0;
+    double probability=0;
+    WorkloadConfig config;
+    bool tune=string(argv[3])=="auto" && string(argv[4])=="auto";
+    if ((!tune && (!(ss1 >> level) || !(ss2 >> probability) || level<1))
+        || !config.parse(argv[5])) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    if (tune) {
+      vector<int> keys;
+      workloadKeys(config, keys);
+      TuningFile file(TUNING_FILE);
+      bool calibrated;
+      tuneSkipList(keys, 0x7fffffff, &intCompare, "int", file, false, &level,
+                   &probability, &calibrated);
+    }
+
+    SkipListSet<int> list(level, probability, 0x7fffffff, &intCompare);
+    vector<string> columns(1, "level");
+    vector<double> values(1, level);
+    columns.push_back("probability");
+    values.push_back(probability);
+    testWorkload(list, config, values, columns);
+  }
+  else if (argc==4 && test=="workload" &&
+           (string(argv[2])=="set" || string(argv[2])=="vector")) {
+    WorkloadConfig config;
+    if (!config.parse(argv[3])) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<string> columns;
+    vector<double> values;
+    if (string(argv[2])=="set") {
+      StdSet<int> set(&intCompare);
+      testWorkload(set, config, values, columns);
+    }
+    else {
+      SortedVectorSet<int> sorted(&intCompare);
+      testWorkload(sorted, config, values, columns);
+    }
+  }
+  else if ((argc==7 || argc==8) && test=="trace") {
+#ifdef STRUCTURE_TRACE
+    string structure(argv[2]);
+    stringstream ss1(argv[3]), ss2(argv[4]), ss3(argv[argc-3]);
+    int degree, level, ringSize;
+    double probability;
+    WorkloadConfig config;
+    bool valid;
+    if (argc==7)
+      valid=structure=="btree" && (ss1 >> degree) && degree>=2;
+    else
+      valid=structure=="skiplist" && (ss1 >> level) && level>=1 &&
+        (ss2 >> probability);
+    if (!valid || !(ss3 >> ringSize) || ringSize<0
+        || !config.parse(argv[argc-1])) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<string> columns;
+    vector<double> values;
+    if (argc==7) {
+      BTreeSet<int> tree(degree, &intCompare);
+      columns.push_back("degree");
+      values.push_back(degree);
+      testTrace(tree, config, ringSize, argv[5], values, columns);
+    }
+    else {
+      SkipListSet<int> list(level, probability, 0x7fffffff, &intCompare);
+      columns.push_back("level");
+      columns.push_back("probability");
+      values.push_back(level);
+      values.push_back(probability);
+      testTrace(list, config, ringSize, argv[6], values, columns);
+    }
+#else
+    cerr << "Structure tracing not compiled in; build with"
+         << " make TRACE=-DSTRUCTURE_TRACE." << endl;
+    return -1;
+#endif
+  }
+  else if (argc==6 && test=="snapshot") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]);
+    int degree, level;
+    double probability;
+    if (!(ss1 >> degree) || !(ss2 >> level) || !(ss3 >> probability)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testSnapshot(degree, level, probability, 0x7fffffff, keys, &intCompare);
+  }
+  else if (argc==6 && test=="wal") {
+    stringstream ss1(argv[2]), ss2(argv[3]), ss3(argv[4]);
+    int degree, windowBytes;
+    long long windowMicros;
+    if (!(ss1 >> degree) || !(ss2 >> windowMicros) || !(ss3 >> windowBytes)
+        || windowMicros<0 || windowBytes<0) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    vector<int> keys;
+    readKeys(argv[5], keys);
+    testLog(degree, windowMicros, windowBytes, keys, &intCompare);
+  }
+  else if (argc==5 && test=="stream" && string(argv[2])=="btree") {
+    stringstream ss1(argv[3]);
+    int degree;
+    if (!(ss1 >> degree)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    BTreeSet<int> tree(degree, &intCompare);
+    cout << degree << "," << flush;
+    testStream<int>(tree, argv[4]);
+  }
+  else if (argc==6 && test=="stream" && string(argv[2])=="skiplist") {
+    stringstream ss1(argv[3]), ss2(argv[4]);
+    int level;
+    double probability;
+    if (!(ss1 >> level) || !(ss2 >> probability)) {
+      cerr << "Invalid arguments." << endl;
+      usage(argv[0]);
+      return -1;
+    }
+
+    SkipListSet<int> list(level, probability, 0x7fffffff, &intCompare);
+    cout << level << "," << probability << "," << flush;
+    testStream<int>(list, argv[5]);
+  }
+  else if (argc==4 && test=="stream" && string(argv[2])=="set") {
+    StdSet<int> set(&intCompare);
+    testStream<int>(set, argv[3]);
+  }
+  else if (argc==4 && test=="stream" && string(argv[2])=="vector") {
+    SortedVectorSet<int> sorted(&intCompare);
+    testStream<int>(sorted, argv[3]);
   }
   else {
     cerr << "Invalid arguments." << endl;
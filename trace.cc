@@ -0,0 +1,95 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden tapahtumalaskurit ja tapahtumien rengaspuskurin.
+
+*/
+
+#include <iostream>
+#include <fstream>
+#include "trace.h"
+
+using namespace std;
+
+StructureTrace::StructureTrace() : ring(NULL), ringMask(0), next(0) {
+  reset();
+}
+
+StructureTrace::~StructureTrace() {
+  delete[] ring;
+}
+
+/* Palauttaa tapahtuman nimen. */
+const char *StructureTrace::getName(int event) {
+  const char *names[TRACE_EVENTS]={
+    "split", "merge", "rotateLeft", "rotateRight", "rootGrow",
+    "rootCollapse", "levelRaise", "levelLower", "searchStep"
+  };
+  return event>=0 && event<TRACE_EVENTS ? names[event] : "";
+}
+
+/* Ottaa rengaspuskurin kyttn. Aiemmat tietueet hvitetn.
+   size = tietueiden mr; pyristetn ylspin kahden potenssiin,
+          0=ei puskuria */
+void StructureTrace::enableRing(int size) {
+  delete[] ring;
+  ring=NULL;
+  ringMask=0;
+  next=0;
+  if (size<=0) return;
+
+  long long capacity=1;
+  while (capacity<size) capacity*=2;
+  ring=new TraceRecord[capacity];
+  ringMask=capacity-1;
+}
+
+/* Palauttaa tapahtuman mrn kaikilla tasoilla. */
+long long StructureTrace::getCount(int event) const {
+  return counts[event];
+}
+
+/* Palauttaa tapahtuman mrn tasolla. */
+long long StructureTrace::getCount(int event, int level) const {
+  return levels[event][level];
+}
+
+/* Nollaa laskurit ja tyhjent rengaspuskurin. */
+void StructureTrace::reset() {
+  for (int i=0; i<TRACE_EVENTS; i++) {
+    counts[i]=0;
+    for (int j=0; j<TRACE_LEVELS; j++) levels[i][j]=0;
+  }
+  next=0;
+}
+
+/* Tulostaa laskurit CSV-muodossa otsakeriveineen: kunkin tapahtuman
+   kokonaismr (taso "all") ja mrt tasoittain. */
+void StructureTrace::print(ostream &os) const {
+  os << "event,level,count" << endl;
+  for (int i=0; i<TRACE_EVENTS; i++) {
+    os << getName(i) << ",all," << counts[i] << endl;
+    for (int j=0; j<TRACE_LEVELS; j++)
+      if (levels[i][j]>0)
+        os << getName(i) << "," << j << "," << levels[i][j] << endl;
+  }
+}
+
+/* Kirjoittaa rengaspuskurin tietueet vanhimmasta uusimpaan
+   tiedostoon. Tiedoston alussa on tietueiden mr long long
+   -lukuna. Palauttaa false, jos tiedostoa ei voitu kirjoittaa.
+   fileName = tiedosto */
+bool StructureTrace::dump(const char *fileName) const {
+  ofstream ofs(fileName, ios::out | ios::binary | ios::trunc);
+  if (!ofs) return false;
+
+  // Puskurin tytytty vanhin tietue on seuraavan kirjoituskohdan
+  // kohdalla.
+  long long size=ring ? (next<ringMask+1 ? next : ringMask+1) : 0;
+  ofs.write((const char *)&size, sizeof(size));
+  for (long long i=next-size; i<next; i++)
+    ofs.write((const char *)&ring[i&ringMask], sizeof(TraceRecord));
+  return ofs.good();
+}
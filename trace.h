@@ -0,0 +1,112 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden tapahtumalaskurit ja tapahtumien rengaspuskurin.
+Rakenteet kirjaavat rakenteelliset tapahtumat (jaot, yhdistmiset,
+kierrot, juuren kasvut ja poistot, tason nostot ja laskut sek hakujen
+askeleet tasoittain) TRACE_EVENT-makrolla, joka kntyy tyhjksi, ellei
+STRUCTURE_TRACE ole mritelty (make TRACE=-DSTRUCTURE_TRACE). Tllin
+rakenteissa ei ole laskureita lainkaan eik kirjaus maksa mitn.
+
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <iostream>
+
+/* Tapahtumat. */
+#define TRACE_SPLIT 0
+#define TRACE_MERGE 1
+#define TRACE_ROTATE_LEFT 2
+#define TRACE_ROTATE_RIGHT 3
+#define TRACE_ROOT_GROW 4
+#define TRACE_ROOT_COLLAPSE 5
+#define TRACE_LEVEL_RAISE 6
+#define TRACE_LEVEL_LOWER 7
+#define TRACE_SEARCH_STEP 8
+#define TRACE_EVENTS 9
+
+/* Tasojen mr, jolle tapahtumat eritelln; syvemmt tasot kirjataan
+   viimeiselle tasolle. */
+#define TRACE_LEVELS 64
+
+#ifdef STRUCTURE_TRACE
+#define TRACE_EVENT(trace, event, level, count) \
+  (trace).record(event, level, count)
+#else
+#define TRACE_EVENT(trace, event, level, count) ((void)0)
+#endif
+
+/* Rengaspuskurin tietue. Tiedostoon kirjoitetaan tietueet sellaisenaan. */
+struct TraceRecord {
+  long long sequence;
+  short event;
+  short level;
+  int count;
+};
+
+/* Rakenteen tapahtumalaskurit ja valinnainen rengaspuskuri, joka silytt
+   viimeisimmt tapahtumat. */
+class StructureTrace {
+  long long counts[TRACE_EVENTS];
+  long long levels[TRACE_EVENTS][TRACE_LEVELS];
+  TraceRecord *ring;
+  long long ringMask, next;
+
+public:
+  StructureTrace();
+  ~StructureTrace();
+
+  /* Palauttaa tapahtuman nimen. */
+  static const char *getName(int event);
+
+  /* Ottaa rengaspuskurin kyttn. Aiemmat tietueet hvitetn.
+     size = tietueiden mr; pyristetn ylspin kahden potenssiin,
+            0=ei puskuria */
+  void enableRing(int size);
+
+  /* Kirjaa tapahtuman.
+     event = tapahtuma
+     level = taso, jolla tapahtuma sattui, tai 0, jos tasoa ei tunneta
+     count = tapahtumien mr */
+  void record(int event, int level, long long count);
+
+  /* Palauttaa tapahtuman mrn kaikilla tasoilla. */
+  long long getCount(int event) const;
+
+  /* Palauttaa tapahtuman mrn tasolla. */
+  long long getCount(int event, int level) const;
+
+  /* Nollaa laskurit ja tyhjent rengaspuskurin. */
+  void reset();
+
+  /* Tulostaa laskurit CSV-muodossa otsakeriveineen: kunkin tapahtuman
+     kokonaismr (taso "all") ja mrt tasoittain. */
+  void print(std::ostream &os) const;
+
+  /* Kirjoittaa rengaspuskurin tietueet vanhimmasta uusimpaan
+     tiedostoon. Tiedoston alussa on tietueiden mr long long
+     -lukuna. Palauttaa false, jos tiedostoa ei voitu kirjoittaa.
+     fileName = tiedosto */
+  bool dump(const char *fileName) const;
+};
+
+/* Kirjaus on hakujen sissilmukoissa, joten se mritelln otsakkeessa,
+   jotta kntj voi upottaa sen. */
+inline void StructureTrace::record(int event, int level, long long count) {
+  if (level>=TRACE_LEVELS) level=TRACE_LEVELS-1;
+  counts[event]+=count;
+  levels[event][level]+=count;
+  if (ring) {
+    TraceRecord &entry=ring[next&ringMask];
+    entry.sequence=next++;
+    entry.event=event;
+    entry.level=level;
+    entry.count=count;
+  }
+}
+
+#endif
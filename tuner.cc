@@ -0,0 +1,114 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa virityksen tulosten tallennuksen.
+
+*/
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include "tuner.h"
+
+using namespace std;
+
+/* Palauttaa vlimuistin koon tai 0, jos sit ei tunneta. */
+static long cacheSize(int name) {
+  long size=sysconf(name);
+  return size>0 ? size : 0;
+}
+
+/* Palauttaa koneen vlimuistihierarkian kuvauksen muodossa
+   "l1d=...,l2=...,l3=...,line=..." (tavuina). Tuntemattomat koot ovat 0. */
+string cacheSignature() {
+  stringstream ss;
+  ss << "l1d=" << cacheSize(_SC_LEVEL1_DCACHE_SIZE)
+     << ",l2=" << cacheSize(_SC_LEVEL2_CACHE_SIZE)
+     << ",l3=" << cacheSize(_SC_LEVEL3_CACHE_SIZE)
+     << ",line=" << cacheSize(_SC_LEVEL1_DCACHE_LINESIZE);
+  return ss.str();
+}
+
+/* Palauttaa viritettvn parametrin nimen.
+   structure = rakenne, esim. "btree"
+   keyType = avaintyypin nimi, esim. "int"
+   keySize = avaimen koko tavuina
+   keys = avainten mr
+   parameter = parametrin nimi, esim. "degree" */
+string tuningName(const string &structure, const string &keyType,
+                  int keySize, int keys, const string &parameter) {
+  int bucket=1;
+  while (bucket<=keys/2) bucket*=2;
+  stringstream ss;
+  ss << structure << "." << keyType << keySize << "." << bucket << "."
+     << parameter;
+  return ss.str();
+}
+
+/* Lukee tallennetut parametrit. Puuttuva tiedosto tai toisen koneen
+   vlimuistihierarkialla viritetyt parametrit tulkitaan tyhjiksi.
+   fileName = tiedosto */
+TuningFile::TuningFile(const string &fileName) : fileName(fileName) {
+  ifstream ifs(fileName.c_str());
+  string line;
+  while (getline(ifs, line)) {
+    if (line.empty() || line[0]=='#') continue;
+    string::size_type separator=line.find('=');
+    if (separator==string::npos) continue;
+    string name=line.substr(0, separator), value=line.substr(separator+1);
+
+    if (name=="cache") {
+      if (value!=cacheSignature()) {
+        names.clear();
+        values.clear();
+        return;
+      }
+      continue;
+    }
+
+    stringstream ss(value);
+    double number;
+    if (ss >> number) set(name, number);
+  }
+}
+
+/* Palauttaa parametrin arvon tai false, jos parametria ei ole
+   viritetty.
+   name = parametrin nimi
+   value = arvo palautetaan thn */
+bool TuningFile::get(const string &name, double *value) const {
+  for (unsigned int i=0; i<names.size(); i++)
+    if (names[i]==name) {
+      *value=values[i];
+      return true;
+    }
+  return false;
+}
+
+/* Asettaa parametrin arvon. */
+void TuningFile::set(const string &name, double value) {
+  for (unsigned int i=0; i<names.size(); i++)
+    if (names[i]==name) {
+      values[i]=value;
+      return;
+    }
+  names.push_back(name);
+  values.push_back(value);
+}
+
+/* Kirjoittaa parametrit tiedostoon. Palauttaa false, jos tiedostoa ei
+   voitu kirjoittaa. */
+bool TuningFile::save() const {
+  ofstream ofs(fileName.c_str(), ios::out | ios::trunc);
+  if (!ofs) return false;
+  ofs << "# Viritetyt parametrit; poista tiedosto kalibroidaksesi uudelleen."
+      << endl;
+  ofs << "cache=" << cacheSignature() << endl;
+  for (unsigned int i=0; i<names.size(); i++)
+    ofs << names[i] << "=" << values[i] << endl;
+  return ofs.good();
+}
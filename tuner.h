@@ -0,0 +1,66 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa virityksen tulosten tallennuksen. Lyhyell kalibrointimittauksella
+valitut b-puun aste sek hyppylistan maksimitaso ja todennkisyys
+tallennetaan tiedostoon, jotta myhemmt ajot voivat ohittaa kalibroinnin.
+Tulokset ovat ptevi vain samalla vlimuistihierarkialla, joten tiedostoon
+tallennetaan mys vlimuistien koot; jos ne eroavat koneen vlimuisteista,
+tallennetut tulokset hyltn.
+
+Tiedoston rivit ovat muotoa "nimi=arvo". Rivi "cache=..." kertoo
+vlimuistien koot, ja #-merkill alkavat rivit ovat kommentteja.
+
+*/
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <string>
+#include <vector>
+
+/* Palauttaa koneen vlimuistihierarkian kuvauksen muodossa
+   "l1d=...,l2=...,l3=...,line=..." (tavuina). Tuntemattomat koot ovat 0. */
+std::string cacheSignature();
+
+/* Palauttaa viritettvn parametrin nimen. Avainten mr pyristetn
+   alaspin kahden potenssiin, koska paras aste riippuu siit, mahtuuko
+   rakenne vlimuistiin.
+   structure = rakenne, esim. "btree"
+   keyType = avaintyypin nimi, esim. "int"
+   keySize = avaimen koko tavuina
+   keys = avainten mr
+   parameter = parametrin nimi, esim. "degree" */
+std::string tuningName(const std::string &structure,
+                       const std::string &keyType, int keySize, int keys,
+                       const std::string &parameter);
+
+/* Tiedostoon tallennetut viritetyt parametrit. */
+class TuningFile {
+  const std::string fileName;
+  std::vector<std::string> names;
+  std::vector<double> values;
+
+public:
+  /* Lukee tallennetut parametrit. Puuttuva tiedosto tai toisen koneen
+     vlimuistihierarkialla viritetyt parametrit tulkitaan tyhjiksi.
+     fileName = tiedosto */
+  TuningFile(const std::string &fileName);
+
+  /* Palauttaa parametrin arvon tai false, jos parametria ei ole
+     viritetty.
+     name = parametrin nimi
+     value = arvo palautetaan thn */
+  bool get(const std::string &name, double *value) const;
+
+  /* Asettaa parametrin arvon. */
+  void set(const std::string &name, double value);
+
+  /* Kirjoittaa parametrit tiedostoon. Palauttaa false, jos tiedostoa ei
+     voitu kirjoittaa. */
+  bool save() const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden tarkistusten yhteisen osan: rakenteesta
+jrjestyksess kerttyjen avainten vertailun odotettuihin avaimiin.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <vector>
+#include "validate.h"
+
+using namespace std;
+
+/* Tarkistaa, ett rakenteesta kertyt avaimet ovat aidosti nousevassa
+   jrjestyksess ja tsmlleen samat kuin odotetut avaimet. Jos odotetut
+   avaimet ovat nousevassa jrjestyksess, ne verrataan rinnakkain
+   lineaarisessa ajassa; muuten kukin odotettu avain haetaan
+   binrihaulla. Tulostaa virheen ja palauttaa false, jos avaimet
+   eroavat.
+   found = rakenteen avaimet sisjrjestyksess
+   expected = odotetut, keskenn erisuuret avaimet
+   compare = avainten vertailufunktio */
+template<typename T> bool validateKeys(const vector<T> &found,
+                                       const vector<T> &expected,
+                                       int (*compare)(const T &,
+                                                      const T &)) {
+  for (unsigned int i=1; i<found.size(); i++)
+    if (compare(found[i-1], found[i])>=0) {
+      cerr << "VALIDATE: Keys not in order." << endl;
+      raise(SIGABRT);
+      return false;
+    }
+
+  if (found.size()!=expected.size()) {
+    cerr << "VALIDATE: " << found.size() << " keys, expected "
+         << expected.size() << "." << endl;
+    raise(SIGABRT);
+    return false;
+  }
+
+  bool sorted=true;
+  for (unsigned int i=1; sorted && i<expected.size(); i++)
+    if (compare(expected[i-1], expected[i])>=0) sorted=false;
+
+  for (unsigned int i=0; i<expected.size(); i++) {
+    bool present;
+    if (sorted) present=compare(found[i], expected[i])==0;
+    else {
+      int lo=0, hi=found.size()-1;
+      present=false;
+      while (lo<=hi && !present) {
+        int middle=lo+(hi-lo)/2, c=compare(found[middle], expected[i]);
+        if (c==0) present=true;
+        else if (c<0) lo=middle+1;
+        else hi=middle-1;
+      }
+    }
+    if (!present) {
+      cerr << "VALIDATE: Missing key." << endl;
+      raise(SIGABRT);
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,30 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa rakenteiden tarkistusten yhteisen osan: rakenteesta
+jrjestyksess kerttyjen avainten vertailun odotettuihin avaimiin.
+
+*/
+
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <vector>
+
+/* Tarkistaa, ett rakenteesta kertyt avaimet ovat aidosti nousevassa
+   jrjestyksess ja tsmlleen samat kuin odotetut avaimet. Jos odotetut
+   avaimet ovat nousevassa jrjestyksess, ne verrataan rinnakkain
+   lineaarisessa ajassa; muuten kukin odotettu avain haetaan
+   binrihaulla. Tulostaa virheen ja palauttaa false, jos avaimet
+   eroavat.
+   found = rakenteen avaimet sisjrjestyksess
+   expected = odotetut, keskenn erisuuret avaimet
+   compare = avainten vertailufunktio */
+template<typename T> bool validateKeys(const std::vector<T> &found,
+                                       const std::vector<T> &expected,
+                                       int (*compare)(const T &,
+                                                      const T &));
+
+#endif
@@ -0,0 +1,330 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa tietorakenteiden muutosten lokin (write-ahead log), johon
+lisykset ja poistot kirjoitetaan ennen niiden tekemist. Lokiin
+kirjoitetut tietueet kertn puskuriin ja viedn levylle yhdell
+fdatasync()-kutsulla (group commit), kun aika- tai kokoikkuna tyttyy.
+
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "wal.h"
+
+using namespace std;
+
+/* Palauttaa monotonisen kellon ajan mikrosekunteina. */
+long long monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+/* Korvaa tiedoston valmiiksi kirjoitetulla vliaikaistiedostolla niin, ett
+   kaatumisen jlkeen levyll on joko vanha tai uusi tiedosto kokonaisena.
+   tempName = vliaikaistiedosto samassa hakemistossa
+   fileName = korvattava tiedosto */
+void replaceFileDurably(const char *tempName, const char *fileName) {
+  int fd=open(tempName, O_RDONLY);
+  if (fd<0 || fsync(fd)!=0) {
+    cerr << "Could not sync file '" << tempName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  close(fd);
+
+  if (rename(tempName, fileName)!=0) {
+    cerr << "Could not rename '" << tempName << "' to '" << fileName
+         << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Uusi nimi on kestv vasta, kun hakemisto on viety levylle.
+  string name(fileName);
+  string::size_type slash=name.rfind('/');
+  string directory=slash==string::npos ? "." :
+    slash==0 ? "/" : name.substr(0, slash);
+  fd=open(directory.c_str(), O_RDONLY);
+  if (fd<0 || fsync(fd)!=0) {
+    cerr << "Could not sync directory '" << directory << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  close(fd);
+}
+
+/* Avaa lokin kirjoitettavaksi ja kynnist taustasikeen.
+   fileName = lokitiedosto
+   keySize = avaimen koko tavuina
+   windowMicros = aikaikkuna
+   windowBytes = kokoikkuna
+   truncate = true=tyhjent olemassa olevan lokin */
+WriteAheadLog::WriteAheadLog(const char *fileName, int keySize,
+                             long long windowMicros, int windowBytes,
+                             bool truncate) :
+  keySize(keySize), windowMicros(windowMicros), windowBytes(windowBytes),
+  firstPending(0), pendingRecords(0), pendingMicros(0), numRecords(0),
+  numCommits(0), commitMicros(0), maxCommitMicros(0), waitMicros(0),
+  stopping(false) {
+  if (keySize<1 || windowMicros<0 || windowBytes<0) {
+    cerr << "WriteAheadLog(): Invalid arguments." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  fd=open(fileName, O_WRONLY|O_CREAT|O_APPEND|(truncate ? O_TRUNC : 0),
+          0644);
+  if (fd<0) {
+    cerr << "Could not open log file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  // Uuteen lokiin kirjoitetaan otsake heti.
+  if (lseek(fd, 0, SEEK_END)==0) {
+    int header[2]={WAL_MAGIC, keySize};
+    pending.insert(pending.end(), reinterpret_cast<char *>(header),
+                   reinterpret_cast<char *>(header)+sizeof(header));
+    commitLocked();
+  }
+
+  // Aikaikkunan odotus mitataan samalla monotonisella kellolla kuin
+  // tietueiden lisysajat.
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_create(&thread, NULL, flushAhead, this);
+}
+
+/* Pysytt taustasikeen, vie odottavat tietueet levylle ja sulkee
+   lokin. */
+WriteAheadLog::~WriteAheadLog() {
+  pthread_mutex_lock(&mutex);
+  stopping=true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, NULL);
+
+  commitLocked();
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+  close(fd);
+}
+
+/* Taustasikeen aloitusfunktio. */
+void *WriteAheadLog::flushAhead(void *log) {
+  static_cast<WriteAheadLog *>(log)->run();
+  return NULL;
+}
+
+/* Vie odottavat tietueet levylle aikaikkunan kuluttua, kunnes loki
+   suljetaan. */
+void WriteAheadLog::run() {
+  pthread_mutex_lock(&mutex);
+  while (!stopping) {
+    if (pendingRecords==0) {
+      pthread_cond_wait(&cond, &mutex);
+      continue;
+    }
+    long long deadline=firstPending+windowMicros;
+    if (monotonicMicros()>=deadline) {
+      commitLocked();
+      continue;
+    }
+    struct timespec ts;
+    ts.tv_sec=deadline/1000000;
+    ts.tv_nsec=deadline%1000000*1000;
+    pthread_cond_timedwait(&cond, &mutex, &ts);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Lis tietueen lokiin ja vie odottavat tietueet levylle, jos
+   kokoikkuna on tyttynyt. Aikaikkunan tyttyess taustasie vie
+   tietueet levylle.
+   op = WAL_INSERT tai WAL_REMOVE
+   key = osoitin avaimeen */
+void WriteAheadLog::append(char op, const void *key) {
+  pthread_mutex_lock(&mutex);
+  long long now=monotonicMicros();
+  bool first=pendingRecords==0;
+  if (first) firstPending=now;
+
+  pending.push_back(op);
+  pending.insert(pending.end(), static_cast<const char *>(key),
+                 static_cast<const char *>(key)+keySize);
+  pendingRecords++;
+  pendingMicros+=now;
+  numRecords++;
+
+  if ((int)pending.size()>=windowBytes || now-firstPending>=windowMicros)
+    commitLocked();
+  // Hertetn taustasie odottamaan uuden ikkunan pttymist.
+  else if (first) pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Kirjoittaa odottavat tietueet lokiin ja odottaa, ett ne ovat levyll. */
+void WriteAheadLog::commit() {
+  pthread_mutex_lock(&mutex);
+  commitLocked();
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Kirjoittaa odottavat tietueet lokiin ja odottaa, ett ne ovat levyll.
+   Kutsujalla on oltava lukko. */
+void WriteAheadLog::commitLocked() {
+  if (pending.empty()) return;
+
+  long long start=monotonicMicros();
+  unsigned int written=0;
+  while (written<pending.size()) {
+    ssize_t n=write(fd, &pending[written], pending.size()-written);
+    if (n<0) {
+      cerr << "Could not write log." << endl;
+      raise(SIGABRT);
+      return;
+    }
+    written+=n;
+  }
+  if (fdatasync(fd)!=0) {
+    cerr << "Could not sync log." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  long long end=monotonicMicros();
+
+  numCommits++;
+  commitMicros+=end-start;
+  if (end-start>maxCommitMicros) maxCommitMicros=end-start;
+  waitMicros+=pendingRecords*end-pendingMicros;
+  pending.clear();
+  pendingRecords=pendingMicros=0;
+}
+
+/* Tyhjent lokin esimerkiksi vedoksen tallentamisen jlkeen. */
+void WriteAheadLog::truncate() {
+  pthread_mutex_lock(&mutex);
+  commitLocked();
+  if (ftruncate(fd, 0)!=0) {
+    cerr << "Could not truncate log." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  int header[2]={WAL_MAGIC, keySize};
+  pending.insert(pending.end(), reinterpret_cast<char *>(header),
+                 reinterpret_cast<char *>(header)+sizeof(header));
+  commitLocked();
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Palauttaa lokiin listtyjen tietueiden lukumrn. */
+long long WriteAheadLog::getRecords() const {
+  pthread_mutex_lock(&mutex);
+  long long value=numRecords;
+  pthread_mutex_unlock(&mutex);
+  return value;
+}
+
+/* Palauttaa levylle vientien lukumrn. */
+long long WriteAheadLog::getCommits() const {
+  pthread_mutex_lock(&mutex);
+  long long value=numCommits;
+  pthread_mutex_unlock(&mutex);
+  return value;
+}
+
+/* Palauttaa levylle vienteihin kuluneen ajan mikrosekunteina. */
+long long WriteAheadLog::getCommitMicros() const {
+  pthread_mutex_lock(&mutex);
+  long long value=commitMicros;
+  pthread_mutex_unlock(&mutex);
+  return value;
+}
+
+/* Palauttaa pisimmn levylle viennin keston mikrosekunteina. */
+long long WriteAheadLog::getMaxCommitMicros() const {
+  pthread_mutex_lock(&mutex);
+  long long value=maxCommitMicros;
+  pthread_mutex_unlock(&mutex);
+  return value;
+}
+
+/* Palauttaa tietueiden yhteenlasketun odotusajan lisyksest levylle
+   vientiin mikrosekunteina. */
+long long WriteAheadLog::getWaitMicros() const {
+  pthread_mutex_lock(&mutex);
+  long long value=waitMicros;
+  pthread_mutex_unlock(&mutex);
+  return value;
+}
+
+/* Avaa lokin luettavaksi.
+   fileName = lokitiedosto
+   keySize = avaimen koko tavuina */
+WriteAheadLogReader::WriteAheadLogReader(const char *fileName,
+                                         int keySize) :
+  keySize(keySize), position(0) {
+  fd=open(fileName, O_RDONLY);
+  if (fd<0) {
+    cerr << "Could not open log file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+
+  char chunk[65536];
+  ssize_t n;
+  while ((n=read(fd, chunk, sizeof(chunk)))>0)
+    buffer.insert(buffer.end(), chunk, chunk+n);
+
+  int header[2];
+  if (buffer.size()<sizeof(header)) {
+    cerr << "Invalid log file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  memcpy(header, &buffer[0], sizeof(header));
+  if (header[0]!=WAL_MAGIC || header[1]!=keySize) {
+    cerr << "Invalid log file '" << fileName << "'." << endl;
+    raise(SIGABRT);
+    return;
+  }
+  position=sizeof(header);
+}
+
+/* Sulkee lokin. */
+WriteAheadLogReader::~WriteAheadLogReader() {
+  close(fd);
+}
+
+/* Lukee seuraavan tietueen. Palauttaa false, jos tietueita ei ole en.
+   op = operaatio palautetaan thn
+   key = avain kopioidaan thn */
+bool WriteAheadLogReader::next(char *op, void *key) {
+  // Kaatumisen yhteydess kesken jnyt tietue ohitetaan.
+  if (position+1+keySize>buffer.size()) return false;
+  *op=buffer[position];
+  if (*op!=WAL_INSERT && *op!=WAL_REMOVE) {
+    cerr << "Invalid log record." << endl;
+    raise(SIGABRT);
+    return false;
+  }
+  memcpy(key, &buffer[position+1], keySize);
+  position+=1+keySize;
+  return true;
+}
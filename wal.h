@@ -0,0 +1,137 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa tietorakenteiden muutosten lokin (write-ahead log), johon
+lisykset ja poistot kirjoitetaan ennen niiden tekemist. Lokiin
+kirjoitetut tietueet kertn puskuriin ja viedn levylle yhdell
+fdatasync()-kutsulla (group commit), kun aika- tai kokoikkuna tyttyy.
+Aikaikkunaa valvoo taustasie, joten viimeisetkin tietueet viedn
+levylle ikkunan kuluessa, vaikka uusia tietueita ei en tulisi.
+
+*/
+
+#ifndef WAL_H
+#define WAL_H
+
+#include <vector>
+#include <pthread.h>
+
+/* Lokin tunniste. */
+#define WAL_MAGIC 0x57414c31
+
+/* Lokitietueen operaatiot. */
+#define WAL_INSERT 'I'
+#define WAL_REMOVE 'R'
+
+/* Palauttaa monotonisen kellon ajan mikrosekunteina. */
+long long monotonicMicros();
+
+/* Korvaa tiedoston valmiiksi kirjoitetulla vliaikaistiedostolla niin, ett
+   kaatumisen jlkeen levyll on joko vanha tai uusi tiedosto kokonaisena:
+   vliaikaistiedosto viedn levylle, nimetn uudelleen ja lopuksi
+   viedn levylle mys hakemisto, jossa nimen muutos on.
+   tempName = vliaikaistiedosto samassa hakemistossa
+   fileName = korvattava tiedosto */
+void replaceFileDurably(const char *tempName, const char *fileName);
+
+/* Lokiin kirjoittava luokka. Lokin alussa on otsake (tunniste ja avaimen
+   koko), jota seuraavat tietueet: operaatio (1 tavu) ja avain. Metodit
+   ovat sieturvallisia taustasikeen suhteen. */
+class WriteAheadLog {
+  int fd;
+  const int keySize;
+  const long long windowMicros;
+  const int windowBytes;
+  std::vector<char> pending;
+  long long firstPending, pendingRecords, pendingMicros;
+  long long numRecords, numCommits, commitMicros, maxCommitMicros;
+  long long waitMicros;
+  bool stopping;
+  pthread_t thread;
+  mutable pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* Taustasikeen aloitusfunktio. */
+  static void *flushAhead(void *log);
+
+protected:
+  /* Vie odottavat tietueet levylle aikaikkunan kuluttua, kunnes loki
+     suljetaan. */
+  void run();
+
+  /* Kirjoittaa odottavat tietueet lokiin ja odottaa, ett ne ovat levyll.
+     Kutsujalla on oltava lukko. */
+  void commitLocked();
+
+public:
+  /* Avaa lokin kirjoitettavaksi ja kynnist taustasikeen.
+     fileName = lokitiedosto
+     keySize = avaimen koko tavuina
+     windowMicros = aikaikkuna; tietueet viedn levylle viimeistn, kun
+                    ensimmisen odottavan tietueen lismisest on kulunut
+                    nin monta mikrosekuntia, 0=jokainen tietue heti
+     windowBytes = kokoikkuna; tietueet viedn levylle, kun odottavia
+                   tavuja on vhintn nin monta
+     truncate = true=tyhjent olemassa olevan lokin */
+  WriteAheadLog(const char *fileName, int keySize, long long windowMicros,
+                int windowBytes, bool truncate);
+
+  /* Pysytt taustasikeen, vie odottavat tietueet levylle ja sulkee
+     lokin. */
+  ~WriteAheadLog();
+
+  /* Lis tietueen lokiin ja vie odottavat tietueet levylle, jos
+     kokoikkuna on tyttynyt. Aikaikkunan tyttyess taustasie vie
+     tietueet levylle.
+     op = WAL_INSERT tai WAL_REMOVE
+     key = osoitin avaimeen */
+  void append(char op, const void *key);
+
+  /* Kirjoittaa odottavat tietueet lokiin ja odottaa, ett ne ovat levyll. */
+  void commit();
+
+  /* Tyhjent lokin esimerkiksi vedoksen tallentamisen jlkeen. */
+  void truncate();
+
+  /* Palauttaa lokiin listtyjen tietueiden lukumrn. */
+  long long getRecords() const;
+
+  /* Palauttaa levylle vientien lukumrn. */
+  long long getCommits() const;
+
+  /* Palauttaa levylle vienteihin kuluneen ajan mikrosekunteina. */
+  long long getCommitMicros() const;
+
+  /* Palauttaa pisimmn levylle viennin keston mikrosekunteina. */
+  long long getMaxCommitMicros() const;
+
+  /* Palauttaa tietueiden yhteenlasketun odotusajan lisyksest levylle
+     vientiin mikrosekunteina. */
+  long long getWaitMicros() const;
+};
+
+/* Lokia lukeva luokka. Keskenerinen viimeinen tietue ohitetaan. */
+class WriteAheadLogReader {
+  int fd;
+  const int keySize;
+  std::vector<char> buffer;
+  unsigned int position;
+
+public:
+  /* Avaa lokin luettavaksi.
+     fileName = lokitiedosto
+     keySize = avaimen koko tavuina */
+  WriteAheadLogReader(const char *fileName, int keySize);
+
+  /* Sulkee lokin. */
+  ~WriteAheadLogReader();
+
+  /* Lukee seuraavan tietueen. Palauttaa false, jos tietueita ei ole en.
+     op = operaatio palautetaan thn
+     key = avain kopioidaan thn */
+  bool next(char *op, void *key);
+};
+
+#endif
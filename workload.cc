@@ -0,0 +1,233 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa YCSB-tyylisen kuormageneraattorin. Kuorma koostuu lisyksist,
+hauista, poistoista ja vlihauista annetuissa suhteissa, ja ksiteltvt
+tietueet valitaan tasaisesta, Zipf-, uusimpia suosivasta, perkkisest
+tai ryppisest jakaumasta. Tietueet numeroidaan lisysjrjestyksess, ja
+tietueen numero muunnetaan avaimeksi joko sellaisenaan (perkkinen ja
+ryppinen jakauma) tai sekoitettuna koko avainavaruuteen.
+
+*/
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include "workload.h"
+
+using namespace std;
+
+/* Suurin avain. Hyppylista kytt sit listan loppumerkkin, joten sit
+   ei anneta tietueille. */
+#define WORKLOAD_LAST_KEY 0x7fffffff
+
+/* Oletusasetukset: 95 % hakuja, 5 % lisyksi, Zipf-jakauma. */
+WorkloadConfig::WorkloadConfig() :
+  distribution(DISTRIBUTION_ZIPFIAN), records(100000), operations(1000000),
+  duration(0), scanLength(100), theta(0.99), clusterSize(64) {
+  mix[WORKLOAD_INSERT]=0.05;
+  mix[WORKLOAD_SEARCH]=0.95;
+  mix[WORKLOAD_REMOVE]=0;
+  mix[WORKLOAD_SCAN]=0;
+}
+
+/* Lukee asetukset muotoa "nimi=arvo,nimi=arvo" olevasta merkkijonosta.
+   Palauttaa false, jos asetus on virheellinen. */
+bool WorkloadConfig::parse(const string &spec) {
+  const char *operationNames[]={"insert", "search", "remove", "scan"};
+  const char *distributionNames[]={"uniform", "zipfian", "latest",
+                                   "sequential", "clustered"};
+  stringstream items(spec);
+  string item;
+  while (getline(items, item, ',')) {
+    string::size_type equals=item.find('=');
+    if (equals==string::npos) return false;
+    string name=item.substr(0, equals);
+    stringstream value(item.substr(equals+1));
+
+    bool known=false;
+    for (int i=0; i<WORKLOAD_OPERATIONS; i++)
+      if (name==operationNames[i]) {
+        if (!(value >> mix[i]) || mix[i]<0) return false;
+        known=true;
+      }
+    if (name=="dist") {
+      distribution=-1;
+      for (int i=0; i<5; i++)
+        if (value.str()==distributionNames[i]) distribution=i;
+      if (distribution<0) return false;
+      known=true;
+    }
+    else if (name=="records") {
+      if (!(value >> records) || records<0) return false;
+      known=true;
+    }
+    else if (name=="ops") {
+      if (!(value >> operations) || operations<0) return false;
+      known=true;
+    }
+    else if (name=="duration") {
+      if (!(value >> duration) || duration<0) return false;
+      known=true;
+    }
+    else if (name=="scanlength") {
+      if (!(value >> scanLength) || scanLength<1) return false;
+      known=true;
+    }
+    else if (name=="theta") {
+      if (!(value >> theta) || theta<=0 || theta>=1) return false;
+      known=true;
+    }
+    else if (name=="cluster") {
+      if (!(value >> clusterSize) || clusterSize<1) return false;
+      known=true;
+    }
+    if (!known) return false;
+  }
+
+  double sum=0;
+  for (int i=0; i<WORKLOAD_OPERATIONS; i++) sum+=mix[i];
+  return sum>0 && (operations>0 || duration>0);
+}
+
+/* Palauttaa jakauman nimen. */
+const char *WorkloadConfig::getDistributionName() const {
+  const char *names[]={"uniform", "zipfian", "latest", "sequential",
+                       "clustered"};
+  return names[distribution];
+}
+
+/* config = kuorman asetukset
+   seed = satunnaislukujen siemen */
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig &config,
+                                     int seed) :
+  config(config), random(seed), inserted(0), position(0), clusterStart(0),
+  clusterLeft(0), zetaN(0), zetaCount(0) {
+  double sum=0;
+  for (int i=0; i<WORKLOAD_OPERATIONS; i++) sum+=config.mix[i];
+  double total=0;
+  for (int i=0; i<WORKLOAD_OPERATIONS; i++) {
+    total+=config.mix[i]/sum;
+    cumulative[i]=total;
+  }
+  cumulative[WORKLOAD_OPERATIONS-1]=1;
+
+  zeta2=1+pow(0.5, config.theta);
+  alpha=1/(1-config.theta);
+  eta=0;
+}
+
+/* Palauttaa satunnaisluvun vlilt [0, 1). */
+double WorkloadGenerator::nextDouble() {
+  return rand()/(RAND_MAX+1.0);
+}
+
+/* Pivitt Zipf-jakauman vakiot tietueiden mrlle n. */
+void WorkloadGenerator::updateZipfian(int n) {
+  // Zeta-summa kasvatetaan vain uusien tietueiden osalta, joten vakioiden
+  // yllpito on lisysten mrn nhden lineaarista.
+  if (n==zetaCount) return;
+  for (int i=zetaCount+1; i<=n; i++) zetaN+=1/pow((double)i, config.theta);
+  zetaCount=n;
+  eta=(1-pow(2.0/n, 1-config.theta))/(1-zeta2/zetaN);
+}
+
+/* Palauttaa Zipf-jakautuneen luvun vlilt [0, n); 0 on yleisin. */
+int WorkloadGenerator::nextZipfian(int n) {
+  updateZipfian(n);
+  double u=nextDouble();
+  double uz=u*zetaN;
+  if (uz<1) return 0;
+  if (uz<1+pow(0.5, config.theta)) return n>1 ? 1 : 0;
+  int result=(int)(n*pow(eta*u-eta+1, alpha));
+  return result<n ? result : n-1;
+}
+
+/* Valitsee olemassa olevan tietueen jakauman mukaan. */
+int WorkloadGenerator::chooseRecord() {
+  if (inserted==0) return 0;
+
+  switch (config.distribution) {
+  case DISTRIBUTION_UNIFORM:
+    return (int)(nextDouble()*inserted);
+  case DISTRIBUTION_ZIPFIAN:
+    return nextZipfian(inserted);
+  case DISTRIBUTION_LATEST:
+    return inserted-1-nextZipfian(inserted);
+  case DISTRIBUTION_SEQUENTIAL:
+    return (int)(position++%inserted);
+  default:
+    // Ryppinen jakauma: perkkiset operaatiot osuvat samaan
+    // clusterSize-tietueen ryppseen, joka arvotaan vlill uudelleen.
+    if (clusterLeft==0) {
+      clusterStart=(int)(nextDouble()*inserted);
+      clusterLeft=config.clusterSize;
+    }
+    clusterLeft--;
+    return (clusterStart+(int)(nextDouble()*config.clusterSize))%inserted;
+  }
+}
+
+/* Palauttaa tietueen avaimen. Avaimet ovat erisuuria ja vlill
+   [0, 2^31-1). */
+int WorkloadGenerator::keyOf(int record) const {
+  if (config.distribution==DISTRIBUTION_SEQUENTIAL ||
+      config.distribution==DISTRIBUTION_CLUSTERED)
+    return record;
+
+  // Parittomalla luvulla kertominen ja xor-siirto ovat bijektioita
+  // vlill [0, 2^31), joten avaimet pysyvt erisuurina. Loppumerkin
+  // osuessa kohdalle jatketaan kuvausta, kunnes tulos on muu.
+  unsigned int x=record;
+  do {
+    x=(x*2654435761u)&0x7fffffff;
+    x^=x>>15;
+  } while (x==WORKLOAD_LAST_KEY);
+  return (int)x;
+}
+
+/* Palauttaa seuraavan esitytn avaimen tai false, jos esitytt on
+   valmis. */
+bool WorkloadGenerator::nextPrepopulate(int *key) {
+  if (inserted>=config.records) return false;
+  *key=keyOf(inserted++);
+  return true;
+}
+
+/* Palauttaa seuraavan operaation. */
+WorkloadOperation WorkloadGenerator::next() {
+  WorkloadOperation operation;
+  double u=nextDouble();
+  operation.type=0;
+  while (operation.type<WORKLOAD_OPERATIONS-1 &&
+         u>=cumulative[operation.type])
+    operation.type++;
+
+  if (operation.type==WORKLOAD_INSERT) {
+    operation.key=keyOf(inserted++);
+    operation.hi=operation.key;
+    return operation;
+  }
+
+  operation.key=keyOf(chooseRecord());
+  operation.hi=operation.key;
+  if (operation.type==WORKLOAD_SCAN) {
+    // Vlin pituus arvotaan vlilt 1...scanLength tietuetta. Sekoitetuilla
+    // avaimilla vli skaalataan avainten keskimrisell etisyydell.
+    long long length=1+(long long)(nextDouble()*config.scanLength);
+    if (config.distribution!=DISTRIBUTION_SEQUENTIAL &&
+        config.distribution!=DISTRIBUTION_CLUSTERED && inserted>0)
+      length*=WORKLOAD_LAST_KEY/inserted;
+    long long hi=operation.key+length-1;
+    operation.hi=hi<WORKLOAD_LAST_KEY ? (int)hi : WORKLOAD_LAST_KEY-1;
+  }
+  return operation;
+}
+
+/* Palauttaa listtyjen tietueiden mrn. */
+int WorkloadGenerator::getInserted() const {
+  return inserted;
+}
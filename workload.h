@@ -0,0 +1,113 @@
+/*
+
+Tietorakenteiden harjoitusty, syksy 2004, Jussi Jousimo
+Ohjaaja: Janne Rinta-Mnty
+
+Toteuttaa YCSB-tyylisen kuormageneraattorin. Kuorma koostuu lisyksist,
+hauista, poistoista ja vlihauista annetuissa suhteissa, ja ksiteltvt
+tietueet valitaan tasaisesta, Zipf-, uusimpia suosivasta, perkkisest
+tai ryppisest jakaumasta. Tietueet numeroidaan lisysjrjestyksess, ja
+tietueen numero muunnetaan avaimeksi joko sellaisenaan (perkkinen ja
+ryppinen jakauma) tai sekoitettuna koko avainavaruuteen.
+
+*/
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <string>
+#include "rng.h"
+
+/* Operaatiotyypit. */
+#define WORKLOAD_INSERT 0
+#define WORKLOAD_SEARCH 1
+#define WORKLOAD_REMOVE 2
+#define WORKLOAD_SCAN 3
+#define WORKLOAD_OPERATIONS 4
+
+/* Tietueiden valintajakaumat. */
+#define DISTRIBUTION_UNIFORM 0
+#define DISTRIBUTION_ZIPFIAN 1
+#define DISTRIBUTION_LATEST 2
+#define DISTRIBUTION_SEQUENTIAL 3
+#define DISTRIBUTION_CLUSTERED 4
+
+/* Kuorman asetukset. */
+struct WorkloadConfig {
+  double mix[WORKLOAD_OPERATIONS];
+  int distribution;
+  int records;
+  long long operations;
+  double duration;
+  int scanLength;
+  double theta;
+  int clusterSize;
+
+  /* Oletusasetukset: 95 % hakuja, 5 % lisyksi, Zipf-jakauma. */
+  WorkloadConfig();
+
+  /* Lukee asetukset muotoa "nimi=arvo,nimi=arvo" olevasta merkkijonosta.
+     Nimet: insert, search, remove, scan (osuudet), dist (uniform,
+     zipfian, latest, sequential, clustered), records, ops, duration
+     (sekunteina), scanlength, theta ja cluster. Palauttaa false, jos
+     asetus on virheellinen. */
+  bool parse(const std::string &spec);
+
+  /* Palauttaa jakauman nimen. */
+  const char *getDistributionName() const;
+};
+
+/* Yksi kuorman operaatio. Vlihaun ylraja on hi; muilla operaatioilla
+   sit ei kytet. */
+struct WorkloadOperation {
+  int type;
+  int key;
+  int hi;
+};
+
+/* Kuormageneraattori. */
+class WorkloadGenerator {
+  const WorkloadConfig config;
+  RandomNumberGenerator random;
+  double cumulative[WORKLOAD_OPERATIONS];
+  int inserted;
+  long long position;
+  int clusterStart, clusterLeft;
+  double zetaN, zeta2, alpha, eta;
+  int zetaCount;
+
+  /* Palauttaa satunnaisluvun vlilt [0, 1). */
+  double nextDouble();
+
+  /* Pivitt Zipf-jakauman vakiot tietueiden mrlle n. */
+  void updateZipfian(int n);
+
+  /* Palauttaa Zipf-jakautuneen luvun vlilt [0, n); 0 on yleisin. [1]
+     [1] Gray et al. Quickly Generating Billion-Record Synthetic Databases.
+         SIGMOD 1994. */
+  int nextZipfian(int n);
+
+  /* Valitsee olemassa olevan tietueen jakauman mukaan. */
+  int chooseRecord();
+
+public:
+  /* config = kuorman asetukset
+     seed = satunnaislukujen siemen */
+  WorkloadGenerator(const WorkloadConfig &config, int seed);
+
+  /* Palauttaa tietueen avaimen. Avaimet ovat erisuuria ja vlill
+     [0, 2^31-1). */
+  int keyOf(int record) const;
+
+  /* Palauttaa seuraavan esitytn avaimen tai false, jos esitytt on
+     valmis. */
+  bool nextPrepopulate(int *key);
+
+  /* Palauttaa seuraavan operaation. */
+  WorkloadOperation next();
+
+  /* Palauttaa listtyjen tietueiden mrn. */
+  int getInserted() const;
+};
+
+#endif